@@ -0,0 +1,169 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+/*
+  bench.h - the harness shared by the benchmarks under bench/.
+
+    static void push_64(void *context) { arena_push(context, 64); }
+    ...
+    bench_begin("bench_base", argc, argv);
+    bench_run("arena_push 64B", push_64, arena, 64);
+    return bench_end();
+
+  bench_run warms `fn` up for BENCH_WARMUP_MS, then times BENCH_SAMPLES
+  samples of it with the monotonic clock. Operations that take less than
+  BENCH_SAMPLE_US are called in batches (sized during the warm up) so a
+  sample is never just the timer's resolution; times are reported per call.
+  `bytes` is how much a call processes, for the throughput column (0 when
+  that doesn't apply).
+
+  Every result is printed as a row of a table and, when BENCH_OUTPUT names a
+  file, appended to it as a json object per line:
+
+    {"suite": "bench_base", "name": "arena_push 64B", "commit": "1bcd0bc", "samples": 101,
+     "batch": 65536, "median_ns": 2.1, "p99_ns": 2.4, "min_ns": 2.0, "bytes": 64,
+     "bytes_per_s": 3.0e10, "samples_ns": [2.0, 2.0, ...]}
+
+  `make bench` sets it to build/bench/results.jsonl and BENCH_COMMIT to the
+  commit being measured. Every sample is kept so bench/compare.c can tell a
+  regression from noise. A benchmark's first argument, if any, only runs
+  the cases whose name contains it.
+
+  Benchmarks must define _POSIX_C_SOURCE before including anything, for
+  clock_gettime.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "base.h"
+
+#define BENCH_WARMUP_MS  50
+#define BENCH_SAMPLE_US  200
+#define BENCH_SAMPLES    101
+#define BENCH_MAX_BATCH  (1 << 24)
+
+typedef void (*BenchFn)(void *context);
+
+typedef struct BenchResult {
+  char *name;
+  bool  is_skipped;   // filtered out
+  u64   batch;        // calls per sample
+  f64   median_ns;    // per call
+  f64   p99_ns;
+  f64   min_ns;
+  u64   bytes;        // per call
+  f64   bytes_per_s;  // at the median
+  f64   samples[BENCH_SAMPLES];  // ns per call, sorted
+} BenchResult;
+
+void        bench_begin(char *suite, i32 argc, char **argv);
+i32         bench_end(void);
+BenchResult bench_run(char *name, BenchFn fn, void *context, u64 bytes);
+void        bench_consume(u64 value);
+f64         bench_now_ns(void);
+
+static int  __bench_compare_f64(const void *a, const void *b);
+static void __bench_write(BenchResult *result);
+
+static char *bench_suite = "bench";
+static char *bench_filter = NULL;
+static volatile u64 bench_sink;  // results nothing reads go here, so they aren't optimized out
+
+void bench_begin(char *suite, i32 argc, char **argv) {
+  bench_suite = suite;
+  bench_filter = argc > 1 ? argv[1] : NULL;
+  printf("%-36s %12s %12s %12s %12s\n", suite, "median", "p99", "min", "MB/s");
+}
+
+i32 bench_end(void) {
+  fflush(stdout);
+  return 0;
+}
+
+BenchResult bench_run(char *name, BenchFn fn, void *context, u64 bytes) {
+  BenchResult result = { .name = name, .is_skipped = false, .batch = 1, .bytes = bytes };
+  if (bench_filter != NULL && strstr(name, bench_filter) == NULL) {
+    result.is_skipped = true;
+    return result;
+  }
+
+  // warm up, doubling the batch until a sample is long enough to time
+  f64 warmup_end = bench_now_ns() + (BENCH_WARMUP_MS * 1e6);
+  do {
+    f64 start = bench_now_ns();
+    for (u64 i = 0; i < result.batch; i++) {
+      fn(context);
+    }
+    if (bench_now_ns() - start < BENCH_SAMPLE_US * 1e3 && result.batch < BENCH_MAX_BATCH) {
+      result.batch *= 2;
+    }
+  } while (bench_now_ns() < warmup_end);
+
+  f64 *samples = result.samples;
+  for (i32 s = 0; s < BENCH_SAMPLES; s++) {
+    f64 start = bench_now_ns();
+    for (u64 i = 0; i < result.batch; i++) {
+      fn(context);
+    }
+    samples[s] = (bench_now_ns() - start) / result.batch;
+  }
+  qsort(samples, BENCH_SAMPLES, sizeof(f64), __bench_compare_f64);
+
+  result.min_ns = samples[0];
+  result.median_ns = samples[BENCH_SAMPLES / 2];
+  result.p99_ns = samples[(BENCH_SAMPLES * 99) / 100];
+  result.bytes_per_s = bytes ? bytes / (result.median_ns / 1e9) : 0;
+
+  if (bytes) {
+    printf("%-36s %9.1f ns %9.1f ns %9.1f ns %12.1f\n", name, result.median_ns, result.p99_ns, result.min_ns, result.bytes_per_s / MB);
+  } else {
+    printf("%-36s %9.1f ns %9.1f ns %9.1f ns %12s\n", name, result.median_ns, result.p99_ns, result.min_ns, "-");
+  }
+  __bench_write(&result);
+  return result;
+}
+
+void bench_consume(u64 value) {
+  bench_sink += value;
+}
+
+f64 bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec * 1e9) + ts.tv_nsec;
+}
+
+static int __bench_compare_f64(const void *a, const void *b) {
+  f64 lhs = *(f64 *)a;
+  f64 rhs = *(f64 *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+/* appends `result` to $BENCH_OUTPUT, names are ours so they need no escaping */
+static void __bench_write(BenchResult *result) {
+  char *path = getenv("BENCH_OUTPUT");
+  if (path == NULL || path[0] == '\0') {
+    return;
+  }
+
+  FILE *f = fopen(path, "a");
+  if (f == NULL) {
+    fprintf(stderr, "ERROR: Failed to open BENCH_OUTPUT=%s.\n", path);
+    return;
+  }
+  char *commit = getenv("BENCH_COMMIT") ? getenv("BENCH_COMMIT") : "";
+  fprintf(f, "{\"suite\": \"%s\", \"name\": \"%s\", \"commit\": \"%s\", \"samples\": %d, \"batch\": %llu, "
+             "\"median_ns\": %.3f, \"p99_ns\": %.3f, \"min_ns\": %.3f, \"bytes\": %llu, \"bytes_per_s\": %.1f, \"samples_ns\": [",
+          bench_suite, result->name, commit, BENCH_SAMPLES, (unsigned long long)result->batch,
+          result->median_ns, result->p99_ns, result->min_ns, (unsigned long long)result->bytes, result->bytes_per_s);
+  for (i32 i = 0; i < BENCH_SAMPLES; i++) {
+    fprintf(f, i ? ", %.3f" : "%.3f", result->samples[i]);
+  }
+  fprintf(f, "]}\n");
+  fclose(f);
+}
+
+#endif
@@ -0,0 +1,149 @@
+/*
+  bench_base.c
+
+  measures the arena and String8 primitives everything else is built on,
+  per call.
+*/
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <string.h>
+
+#include "base.h"
+#include "bench.h"
+
+#define ARENA_BYTES   (64 * MB)
+#define STRING_BYTES  (4 * KB)
+
+typedef struct ArenaCase {
+  MemoryArena *arena;
+  u64 size;
+} ArenaCase;
+
+typedef struct StringCase {
+  MemoryArena *arena;
+  String8 lhs;
+  String8 rhs;
+} StringCase;
+
+/* starts over before running out, the cost of that is spread over ~a million pushes */
+static void arena_reset_if_full(MemoryArena *arena, u64 size) {
+  if (arena->position + size >= arena->capacity) {  // arena_push wants room to spare
+    arena_clear(arena);
+  }
+}
+
+static void push(void *context) {
+  ArenaCase *c = context;
+  arena_reset_if_full(c->arena, c->size);
+  bench_consume((u64)arena_push(c->arena, c->size));
+}
+
+static void push_nozero(void *context) {
+  ArenaCase *c = context;
+  arena_reset_if_full(c->arena, c->size);
+  bench_consume((u64)arena_push_nozero(c->arena, c->size));
+}
+
+static void push_pop(void *context) {
+  ArenaCase *c = context;
+  u64 position = c->arena->position;
+  bench_consume((u64)arena_push(c->arena, c->size));
+  arena_pop_to(c->arena, position);
+}
+
+/* the topmost allocation grows in place, one size step per call */
+static void grow_in_place(void *context) {
+  ArenaCase *c = context;
+  arena_reset_if_full(c->arena, 2 * c->size);
+  u8 *p = arena_push_nozero(c->arena, c->size);
+  bench_consume((u64)arena_grow(c->arena, p, c->size, 2 * c->size));
+}
+
+static void equals(void *context) {
+  StringCase *c = context;
+  bench_consume(string8_equals(c->lhs, c->rhs));
+}
+
+static void compare(void *context) {
+  StringCase *c = context;
+  bench_consume((u64)string8_compare(c->lhs, c->rhs));
+}
+
+static void startswith(void *context) {
+  StringCase *c = context;
+  bench_consume(string8_startswith(c->lhs, c->rhs));
+}
+
+static void clone_string(void *context) {
+  StringCase *c = context;
+  arena_reset_if_full(c->arena, c->lhs.length + 1);
+  bench_consume((u64)string8_clone(c->arena, c->lhs).data);
+}
+
+static void concat(void *context) {
+  StringCase *c = context;
+  arena_reset_if_full(c->arena, c->lhs.length + c->rhs.length + 1);
+  bench_consume((u64)string8_concat(c->arena, c->lhs, c->rhs).data);
+}
+
+static void join(void *context) {
+  StringCase *c = context;
+  arena_reset_if_full(c->arena, 2 * (c->lhs.length + c->rhs.length) + 8);
+  bench_consume((u64)string8_join(c->arena, STRING8(", "), 3, c->lhs, c->rhs, c->lhs).data);
+}
+
+int main(int argc, char **argv) {
+  bench_begin("bench_base", argc, argv);
+
+  MemoryArena *arena = arena_create(ARENA_BYTES);
+  u64 sizes[] = { 16, 64, 4 * KB };
+  char name[64];
+  for (usize i = 0; i < COUNTOF(sizes); i++) {
+    ArenaCase c = { .arena = arena, .size = sizes[i] };
+    arena_clear(arena);
+
+    snprintf(name, sizeof(name), "arena_push %lluB", (unsigned long long)sizes[i]);
+    bench_run(name, push, &c, c.size);
+    snprintf(name, sizeof(name), "arena_push_nozero %lluB", (unsigned long long)sizes[i]);
+    bench_run(name, push_nozero, &c, c.size);
+    snprintf(name, sizeof(name), "arena_push + pop_to %lluB", (unsigned long long)sizes[i]);
+    bench_run(name, push_pop, &c, c.size);
+  }
+  ArenaCase grow = { .arena = arena, .size = 4 * KB };
+  arena_clear(arena);
+  bench_run("arena_grow in place 4KB", grow_in_place, &grow, grow.size);
+
+  // equal strings, so the comparisons look at every byte
+  char *lhs = malloc(STRING_BYTES);
+  char *rhs = malloc(STRING_BYTES);
+  for (u64 i = 0; i < STRING_BYTES; i++) {
+    lhs[i] = rhs[i] = 'a' + (i % 26);
+  }
+  StringCase long_strings = {
+    .arena = arena,
+    .lhs = { .data = lhs, .length = STRING_BYTES },
+    .rhs = { .data = rhs, .length = STRING_BYTES },
+  };
+  StringCase short_strings = {
+    .arena = arena,
+    .lhs = { .data = lhs, .length = 64 },
+    .rhs = { .data = rhs, .length = 64 },
+  };
+  arena_clear(arena);
+
+  bench_run("string8_equals 4KB", equals, &long_strings, STRING_BYTES);
+  bench_run("string8_compare 4KB", compare, &long_strings, STRING_BYTES);
+  bench_run("string8_startswith 4KB", startswith, &long_strings, STRING_BYTES);
+  bench_run("string8_equals 64B", equals, &short_strings, 64);
+  bench_run("string8_clone 64B", clone_string, &short_strings, 64);
+  bench_run("string8_clone 4KB", clone_string, &long_strings, STRING_BYTES);
+  bench_run("string8_concat 64B + 64B", concat, &short_strings, 128);
+  bench_run("string8_concat 4KB + 4KB", concat, &long_strings, 2 * STRING_BYTES);
+  bench_run("string8_join 3 x 64B", join, &short_strings, 192);
+
+  free(lhs);
+  free(rhs);
+  arena_destroy(arena);
+  return bench_end();
+}
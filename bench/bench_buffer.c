@@ -0,0 +1,148 @@
+/*
+  bench_buffer.c
+
+  measures GapBuffer edits: the keystroke sized ones per call (through
+  bench.h), then large pastes since that's where the per-byte insert path
+  and the growth policy hurt the most.
+*/
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "base.h"
+#include "buffer.h"
+#include "bench.h"
+
+#define PASTE_BYTES  (64 * MB)
+#define CHUNK_BYTES  (4 * KB)
+#define MOVE_COUNT   100000
+#define MOVE_WINDOW  (64 * KB)
+#define DOCUMENT_BYTES (1 * MB)
+#define LINE_BYTES   80
+
+typedef struct EditCase {
+  GapBuffer *gb;
+  String8 line;
+  i32 positions[2];  // the gap alternates between them
+  i32 next;
+} EditCase;
+
+static f64 now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec * 1000.0) + (ts.tv_nsec / 1000000.0);
+}
+
+static void report(char *name, f64 elapsed_ms, u64 bytes) {
+  f64 mb_per_s = (bytes / (f64)MB) / (elapsed_ms / 1000.0);
+  printf("%-32s %10.2f ms %10.2f MB/s\n", name, elapsed_ms, mb_per_s);
+}
+
+/* --- per edit, in the middle of a 1MB document --- */
+
+static void type_and_erase(void *context) {
+  EditCase *c = context;
+  buffer_insert(c->gb, 'x');
+  buffer_backspace(c->gb);
+}
+
+static void paste_line(void *context) {
+  EditCase *c = context;
+  buffer_insert_string8(c->gb, c->line);
+  for (u64 i = 0; i < c->line.length; i++) {
+    buffer_backspace(c->gb);
+  }
+}
+
+static void replace_char(void *context) {
+  EditCase *c = context;
+  buffer_delete(c->gb);
+  buffer_insert(c->gb, 'x');
+}
+
+static void move_gap(void *context) {
+  EditCase *c = context;
+  buffer_move_gap(c->gb, c->positions[c->next]);
+  c->next = !c->next;
+}
+
+static void bench_edits(char *paste) {
+  GapBuffer gb = buffer_create();
+  buffer_insert_string8(&gb, (String8){ .data = paste, .length = DOCUMENT_BYTES });
+  buffer_move_gap(&gb, DOCUMENT_BYTES / 2);
+
+  i32 middle = DOCUMENT_BYTES / 2;
+  EditCase c = { .gb = &gb, .line = { .data = paste, .length = LINE_BYTES }, .next = 0 };
+  bench_run("insert + backspace", type_and_erase, &c, 1);
+  bench_run("insert_string8 80B + backspace", paste_line, &c, LINE_BYTES);
+  bench_run("delete + insert", replace_char, &c, 1);
+
+  c.positions[0] = middle, c.positions[1] = middle + LINE_BYTES;
+  bench_run("move_gap 1 line", move_gap, &c, LINE_BYTES);
+  c.positions[0] = middle, c.positions[1] = middle + (64 * KB);
+  bench_run("move_gap 64KB", move_gap, &c, 64 * KB);
+  c.positions[0] = 0, c.positions[1] = DOCUMENT_BYTES;
+  bench_run("move_gap 1MB (start <-> end)", move_gap, &c, DOCUMENT_BYTES);
+
+  buffer_destroy(&gb);
+}
+
+int main(int argc, char **argv) {
+  char *paste = malloc(PASTE_BYTES);
+  for (u64 i = 0; i < PASTE_BYTES; i++) {
+    paste[i] = (i % 80 == 79) ? '\n' : 'a' + (i % 26);
+  }
+
+  bench_begin("bench_buffer", argc, argv);
+  bench_edits(paste);
+  printf("\n");
+
+  // 1. a single large paste into an empty buffer
+  GapBuffer gb = buffer_create();
+  f64 start = now_ms();
+  buffer_insert_string8(&gb, (String8){ .data = paste, .length = PASTE_BYTES });
+  report("paste (single insert)", now_ms() - start, PASTE_BYTES);
+  buffer_destroy(&gb);
+
+  // 2. the same paste delivered in chunks, i.e. text input events
+  gb = buffer_create();
+  start = now_ms();
+  for (u64 i = 0; i < PASTE_BYTES; i += CHUNK_BYTES) {
+    buffer_insert_string8(&gb, (String8){ .data = paste + i, .length = CHUNK_BYTES });
+  }
+  report("paste (4KB chunks)", now_ms() - start, PASTE_BYTES);
+  buffer_destroy(&gb);
+
+  // 3. the same paste one byte at a time
+  gb = buffer_create();
+  start = now_ms();
+  for (u64 i = 0; i < PASTE_BYTES; i++) {
+    buffer_insert(&gb, paste[i]);
+  }
+  report("paste (per byte)", now_ms() - start, PASTE_BYTES);
+
+  // 4. paste into the middle of existing text, which has to carry the text
+  //    after the gap along when the buffer grows
+  buffer_move_gap(&gb, PASTE_BYTES / 2);
+  start = now_ms();
+  buffer_insert_string8(&gb, (String8){ .data = paste, .length = PASTE_BYTES });
+  report("paste (middle of 64MB)", now_ms() - start, PASTE_BYTES);
+
+  // 5. cursor jumps around the current position followed by a keystroke
+  srand(42);
+  u64 moved = 0;
+  start = now_ms();
+  for (i32 i = 0; i < MOVE_COUNT; i++) {
+    i32 pos = gb.gap_start + (rand() % MOVE_WINDOW) - (MOVE_WINDOW / 2);
+    moved += labs(pos - gb.gap_start);
+    buffer_move_gap(&gb, pos);
+    buffer_insert(&gb, 'x');
+  }
+  report("move gap + insert (local)", now_ms() - start, moved);
+
+  buffer_destroy(&gb);
+  free(paste);
+  return bench_end();
+}
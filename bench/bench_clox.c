@@ -0,0 +1,153 @@
+/*
+  bench_clox.c
+
+  measures the dispatch of the clox VM (learn/clox.c) on hand-assembled chunks,
+  clox has no compiler yet. Per run of a chunk, the bytes are its bytecode.
+  The string case allocates on every step, the gc's pauses are printed after.
+  The arithmetic chunk runs a second time after optimize_chunk, with the
+  instructions each version executes (chunks don't jump, so that's all of them).
+  A large generated script is measured for the memory its chunk takes, next to
+  what an int per byte of lines and a constant per use would have taken.
+
+  Builds with computed goto where the compiler has it, to time the switch loop
+  on the same chunks:
+
+    make bench BENCH_FLAGS="-O2 -DCLOX_SWITCH_DISPATCH"
+*/
+#define _POSIX_C_SOURCE 199309L
+#define CLOX_NO_MAIN
+
+#include "../learn/clox.c"
+#include "bench.h"
+
+#define CHUNK_OPS    1000
+#define SCRIPT_LINES 20000
+
+/* keeps x bounded: x = -((x + 1.5) * 0.5) - 0.25, then / 1.0001 */
+static void write_arithmetic(Chunk* chunk) {
+  uint8_t constants[] = {
+    (uint8_t)add_constant(chunk, NUMBER_VAL(1.5)),
+    (uint8_t)add_constant(chunk, NUMBER_VAL(0.5)),
+    (uint8_t)add_constant(chunk, NUMBER_VAL(0.25)),
+    (uint8_t)add_constant(chunk, NUMBER_VAL(1.0001)),
+  };
+  uint8_t ops[] = { OP_ADD, OP_MULTIPLY, OP_SUBTRACT, OP_DIVIDE };
+
+  write_chunk(chunk, OP_CONSTANT, 1);
+  write_chunk(chunk, constants[0], 1);
+  for (int i = 0; i < CHUNK_OPS / 3; i++) {
+    int k = i % 4;
+    write_chunk(chunk, OP_CONSTANT, 1);
+    write_chunk(chunk, constants[k], 1);
+    write_chunk(chunk, ops[k], 1);
+    if (k == 1) {
+      write_chunk(chunk, OP_NEGATE, 1);
+    }
+  }
+  write_chunk(chunk, OP_RETURN, 1);
+}
+
+/* the cheapest instruction over and over, so the time is nearly all dispatch */
+static void write_negates(Chunk* chunk) {
+  write_chunk(chunk, OP_CONSTANT, 1);
+  write_chunk(chunk, (uint8_t)add_constant(chunk, NUMBER_VAL(2.0)), 1);
+  for (int i = 0; i < CHUNK_OPS; i++) {
+    write_chunk(chunk, OP_NEGATE, 1);
+  }
+  write_chunk(chunk, OP_RETURN, 1);
+}
+
+/* grows a string 100 times, every step allocates and the previous one is garbage */
+static void write_concat(Chunk* chunk) {
+  uint8_t start = (uint8_t)add_constant(chunk, OBJ_VAL((Obj*)copy_string("lox", 3)));
+  uint8_t step = (uint8_t)add_constant(chunk, OBJ_VAL((Obj*)copy_string("0123456789", 10)));
+  write_chunk(chunk, OP_CONSTANT, 1);
+  write_chunk(chunk, start, 1);
+  for (int i = 0; i < 100; i++) {
+    write_chunk(chunk, OP_CONSTANT, 1);
+    write_chunk(chunk, step, 1);
+    write_chunk(chunk, OP_ADD, 1);
+  }
+  write_chunk(chunk, OP_RETURN, 1);
+}
+
+/* a line per statement, `x = (x + i % 1000) * 0.5;`, so past 256 constants */
+static int write_script(Chunk* chunk) {
+  int constants_written = 1;
+  write_constant(chunk, NUMBER_VAL(0), 1);
+  for (int line = 1; line <= SCRIPT_LINES; line++) {
+    write_constant(chunk, NUMBER_VAL(line % 1000), line);
+    write_chunk(chunk, OP_ADD, line);
+    write_constant(chunk, NUMBER_VAL(0.5), line);
+    write_chunk(chunk, OP_MULTIPLY, line);
+    constants_written += 2;
+  }
+  write_chunk(chunk, OP_RETURN, SCRIPT_LINES);
+  return constants_written;
+}
+
+static void print_script_memory(Chunk* chunk, int constants_written) {
+  size_t code = chunk->capacity * sizeof(uint8_t);
+  size_t lines = chunk->line_capacity * sizeof(LineStart);
+  size_t constants = (chunk->constants.capacity * sizeof(Value)) + (chunk->slot_capacity * sizeof(ConstantSlot));
+  size_t byte_lines = chunk->capacity * sizeof(int);
+  size_t every_constant = constants_written * sizeof(Value);
+
+  printf("script of %d lines, %d bytes of code, %d constants:\n", SCRIPT_LINES, chunk->count, chunk->constants.count);
+  printf("  code %zu B, lines %zu B (%zu B an int per byte), constants %zu B (%zu B one per use)\n",
+         code, lines, byte_lines, constants, every_constant);
+  printf("  %zu B in all, %zu B before\n", code + lines + constants, code + byte_lines + every_constant);
+}
+
+static int count_instructions(Chunk* chunk) {
+  int count = 0;
+  for (int offset = 0; offset < chunk->count; offset += instruction_length(chunk->code[offset])) {
+    count++;
+  }
+  return count;
+}
+
+static void run_chunk(void *context) {
+  interpret(context);
+  bench_consume((u64)vm.result);
+}
+
+int main(int argc, char **argv) {
+  bench_begin("bench_clox", argc, argv);
+  init_vm();
+
+  Chunk arithmetic;
+  init_chunk(&arithmetic);
+  write_arithmetic(&arithmetic);
+  Chunk fused;
+  init_chunk(&fused);
+  write_arithmetic(&fused);
+  optimize_chunk(&fused);
+  Chunk script;
+  init_chunk(&script);
+  int constants_written = write_script(&script);
+  Chunk negates;
+  init_chunk(&negates);
+  write_negates(&negates);
+  Chunk concat;
+  init_chunk(&concat);
+  write_concat(&concat);
+
+  bench_run("clox arithmetic 1k ops", run_chunk, &arithmetic, arithmetic.count);
+  bench_run("clox arithmetic 1k ops, peephole", run_chunk, &fused, fused.count);
+  bench_run("clox negate 1k ops", run_chunk, &negates, negates.count);
+  bench_run("clox concat 100 strings", run_chunk, &concat, concat.count);
+  bench_run("clox script 20k lines", run_chunk, &script, script.count);
+  printf("instructions: arithmetic %d, after the peephole pass %d\n",
+         count_instructions(&arithmetic), count_instructions(&fused));
+  print_gc_stats();
+  print_script_memory(&script, constants_written);
+
+  free_chunk(&arithmetic);
+  free_chunk(&fused);
+  free_chunk(&negates);
+  free_chunk(&concat);
+  free_chunk(&script);
+  free_vm();
+  return bench_end();
+}
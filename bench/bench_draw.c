@@ -0,0 +1,177 @@
+/*
+  bench_draw.c
+
+  measures the software renderer on a 1280x800 frame: fills, bitblt of a
+  256x256 sprite with every DrawOp, the __merge row loop underneath it,
+  lines and glyphs.
+
+  Glyphs need a font, fonts/ttf/JetBrainsMonoNL-Thin.ttf (what fooled uses)
+  or BENCH_FONT, their cases are skipped without one.
+*/
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "base.h"
+#include "draw.h"
+#include "font.h"
+#include "bench.h"
+
+#define FRAME_W      1280
+#define FRAME_H      800
+#define SPRITE_SIZE  256
+#define FONT_SIZE    16
+#define DEFAULT_FONT "fonts/ttf/JetBrainsMonoNL-Thin.ttf"
+
+typedef struct DrawCase {
+  Bitmap *frame;
+  Bitmap *src;
+  DrawOp op;
+  Point from;
+  Point to;
+  Rect clip;
+  Font *font;
+} DrawCase;
+
+static void clear(void *context) {
+  DrawCase *c = context;
+  bitmap_clear(c->frame);
+}
+
+static void fill(void *context) {
+  DrawCase *c = context;
+  bitmap_fill(c->frame, PALETTE_PALE_GREY_BLUE);
+}
+
+static void fill_rect(void *context) {
+  DrawCase *c = context;
+  bitmap_fill_rect(c->frame, bitmap_rect(c->src), PALETTE_PALE_GREY_BLUE);
+}
+
+static void blt(void *context) {
+  DrawCase *c = context;
+  bitblt(c->src, c->frame, bitmap_rect(c->src), (Point){ 100, 100 }, c->op);
+}
+
+/* half of the sprite hangs off the frame's corner */
+static void blt_clipped(void *context) {
+  DrawCase *c = context;
+  Point at = { FRAME_W - (SPRITE_SIZE / 2), FRAME_H - (SPRITE_SIZE / 2) };
+  bitblt(c->src, c->frame, bitmap_rect(c->src), at, c->op);
+}
+
+static void merge_row(void *context) {
+  DrawCase *c = context;
+  __merge(c->src, c->frame, 0, 0, 0, 0, c->src->w, c->op);
+}
+
+static void line(void *context) {
+  DrawCase *c = context;
+  draw_line_clipped(c->src, c->frame, c->from, c->to, c->clip, c->op);
+}
+
+static void render_char(void *context) {
+  DrawCase *c = context;
+  bench_consume(font_render_char(c->font, 'g', c->frame, (Point){ 100, 100 }, PALETTE_BLACK).x_advance);
+}
+
+/* a line of text the way the editors draw it, a glyph at a time */
+static void render_line(void *context) {
+  DrawCase *c = context;
+  String8 text = STRING8("  for (i32 i = 0; i < count; i++) { total += samples[i]; } // sum them up");
+  Point at = { 10, 100 };
+  for (u64 i = 0; i < text.length; i++) {
+    at.x += font_render_char(c->font, text.data[i], c->frame, at, PALETTE_BLACK).x_advance;
+  }
+}
+
+/* font_create prints every glyph it loads, keep that out of the table */
+static bool load_font(MemoryArena *arena, Font *font) {
+  char *path = getenv("BENCH_FONT") ? getenv("BENCH_FONT") : DEFAULT_FONT;
+  if (access(path, R_OK) != 0) {
+    printf("%-36s skipped, no font at %s (set BENCH_FONT)\n", "font_render_char", path);
+    return false;
+  }
+
+  fflush(stdout);
+  i32 saved = dup(STDOUT_FILENO);
+  freopen("/dev/null", "w", stdout);
+  *font = font_create(arena, string8_from_charbuf(arena, path, strlen(path)), FONT_SIZE, FONT_SIZE);
+  fflush(stdout);
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  bench_begin("bench_draw", argc, argv);
+
+  MemoryArena *arena = arena_create(64 * MB);
+  Bitmap frame = bitmap_create(arena, FRAME_W, FRAME_H);
+  Bitmap opaque = bitmap_create(arena, SPRITE_SIZE, SPRITE_SIZE);
+  Bitmap translucent = bitmap_create(arena, SPRITE_SIZE, SPRITE_SIZE);
+  Bitmap row = bitmap_create(arena, FRAME_W, 1);
+  Bitmap pen = bitmap_create(arena, 1, 1);
+  Bitmap brush = bitmap_create(arena, 3, 3);
+  bitmap_fill(&frame, PALETTE_WHITE);
+  bitmap_fill(&row, PALETTE_BLUE);
+  bitmap_fill(&pen, PALETTE_BLACK);
+  bitmap_fill(&brush, PALETTE_BLACK);
+  for (i32 i = 0; i < SPRITE_SIZE * SPRITE_SIZE; i++) {
+    opaque.pixels[i] = (i * 2654435761u) | 0xFF;  // opaque, noisy colors
+    translucent.pixels[i] = (opaque.pixels[i] & 0xFFFFFF00) | 0x80;
+  }
+
+  u64 frame_bytes = FRAME_W * FRAME_H * sizeof(Color);
+  u64 sprite_bytes = SPRITE_SIZE * SPRITE_SIZE * sizeof(Color);
+  DrawCase c = { .frame = &frame, .src = &opaque, .op = DRAWOP_STORE, .clip = bitmap_rect(&frame) };
+
+  bench_run("bitmap_clear 1280x800", clear, &c, frame_bytes);
+  bench_run("bitmap_fill 1280x800", fill, &c, frame_bytes);
+  bench_run("bitmap_fill_rect 256x256", fill_rect, &c, sprite_bytes);
+
+  char *op_names[] = { "STORE", "STORE_INVERT", "OR", "AND", "XOR", "CLR" };
+  char name[64];
+  for (DrawOp op = DRAWOP_STORE; op <= DRAWOP_CLR; op++) {
+    c.op = op;
+    snprintf(name, sizeof(name), "bitblt 256x256 %s", op_names[op]);
+    bench_run(name, blt, &c, sprite_bytes);
+  }
+  c.op = DRAWOP_STORE;
+  c.src = &translucent;
+  bench_run("bitblt 256x256 STORE (alpha)", blt, &c, sprite_bytes);
+  c.src = &opaque;
+  bench_run("bitblt 256x256 STORE (clipped)", blt_clipped, &c, sprite_bytes / 4);
+
+  c.src = &row;
+  bench_run("__merge 1280px STORE", merge_row, &c, FRAME_W * sizeof(Color));
+  c.op = DRAWOP_XOR;
+  bench_run("__merge 1280px XOR", merge_row, &c, FRAME_W * sizeof(Color));
+
+  c.op = DRAWOP_STORE;
+  c.src = &pen;
+  c.from = (Point){ 10, 400 }, c.to = (Point){ 1270, 400 };
+  bench_run("draw_line horizontal 1260px", line, &c, 0);
+  c.from = (Point){ 640, 10 }, c.to = (Point){ 640, 790 };
+  bench_run("draw_line vertical 780px", line, &c, 0);
+  c.from = (Point){ 10, 10 }, c.to = (Point){ 1270, 790 };
+  bench_run("draw_line diagonal", line, &c, 0);
+  c.src = &brush;
+  bench_run("draw_line diagonal 3x3 brush", line, &c, 0);
+  c.src = &pen;
+  c.clip = (Rect){ { 0, 0 }, { FRAME_W / 2, FRAME_H / 2 } };
+  bench_run("draw_line diagonal (clipped)", line, &c, 0);
+
+  Font font;
+  if (load_font(arena, &font)) {
+    c.font = &font;
+    bench_run("font_render_char", render_char, &c, 0);
+    bench_run("font_render_char 74 char line", render_line, &c, 0);
+    font_destroy(&font);
+  }
+
+  arena_destroy(arena);
+  return bench_end();
+}
@@ -0,0 +1,252 @@
+/*
+  bench_http.c
+
+  measures the per request latency of http_post against a local HTTPS stub,
+  with a fresh HttpClient per request (a TCP and TLS handshake every time)
+  and with a single persistent HttpClient (connections and TLS sessions are
+  reused).
+
+  The stub is forked from this process and speaks HTTP/1.1 with keep-alive,
+  its self-signed certificate is generated with the openssl command line tool.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include "base.h"
+#include "http.h"
+#include "http.c"
+
+#define REQUESTS       200
+#define RESPONSE_BYTES (16 * KB)
+#define REQUEST_BYTES  (8 * KB)
+
+static f64 now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec * 1000.0) + (ts.tv_nsec / 1000000.0);
+}
+
+static int compare_f64(const void *a, const void *b) {
+  f64 lhs = *(f64 *)a;
+  f64 rhs = *(f64 *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static void report(char *name, f64 *samples, i32 count) {
+  qsort(samples, count, sizeof(f64), compare_f64);
+  f64 total = 0;
+  for (i32 i = 0; i < count; i++) {
+    total += samples[i];
+  }
+  printf("%-32s %10.3f ms/req (median) %10.3f ms/req (mean)\n", name, samples[count / 2], total / count);
+}
+
+/* --- https stub --- */
+
+/* serves one keep-alive connection, every request gets the same response */
+static void stub_serve(SSL *ssl, char *response, i32 response_length) {
+  char request[REQUEST_BYTES] = { 0 };
+  i32 length = 0;
+
+  for (;;) {
+    char *headers_end = NULL;
+    while ((headers_end = strstr(request, "\r\n\r\n")) == NULL) {
+      i32 n = SSL_read(ssl, request + length, REQUEST_BYTES - 1 - length);
+      if (n <= 0) {
+        return;
+      }
+      length += n;
+      request[length] = 0;
+    }
+
+    // skip the request body, if any
+    i32 body_length = 0;
+    for (char *line = request; line < headers_end; line = strstr(line, "\r\n") + 2) {
+      if (strncasecmp(line, "Content-Length:", 15) == 0) {
+        body_length = atoi(line + 15);
+      }
+    }
+
+    i32 request_length = (i32)(headers_end + 4 - request) + body_length;
+    while (length < request_length) {
+      i32 n = SSL_read(ssl, request + length, REQUEST_BYTES - 1 - length);
+      if (n <= 0) {
+        return;
+      }
+      length += n;
+    }
+
+    if (SSL_write(ssl, response, response_length) <= 0) {
+      return;
+    }
+
+    // keep anything that belongs to the next request
+    memmove(request, request + request_length, length - request_length);
+    length -= request_length;
+    request[length] = 0;
+  }
+}
+
+/* forks the stub, returns its pid and the port it listens on */
+static pid_t stub_start(char *cert_path, char *key_path, i32 *port) {
+  SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+  if (SSL_CTX_use_certificate_file(ctx, cert_path, SSL_FILETYPE_PEM) <= 0
+      || SSL_CTX_use_PrivateKey_file(ctx, key_path, SSL_FILETYPE_PEM) <= 0) {
+    ERR_print_errors_fp(stderr);
+    exit(1);
+  }
+
+  i32 fd = socket(AF_INET, SOCK_STREAM, 0);
+  i32 reuse = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = 0 };
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_length = sizeof(addr);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+    perror("bench_http: failed to listen");
+    exit(1);
+  }
+  getsockname(fd, (struct sockaddr *)&addr, &addr_length);
+  *port = ntohs(addr.sin_port);
+
+  pid_t pid = fork();
+  if (pid != 0) {
+    close(fd);
+    SSL_CTX_free(ctx);
+    return pid;
+  }
+
+  // child: build the response once, then serve connections until killed
+  static char response[RESPONSE_BYTES + 256];
+  i32 header_length = sprintf(response,
+                              "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: application/json\r\n"
+                              "Content-Length: %d\r\n"
+                              "Connection: keep-alive\r\n\r\n",
+                              RESPONSE_BYTES);
+  memset(response + header_length, 'x', RESPONSE_BYTES);
+
+  signal(SIGCHLD, SIG_IGN);
+  for (;;) {
+    i32 client = accept(fd, NULL, NULL);
+    if (client < 0) {
+      continue;
+    }
+
+    if (fork() == 0) {
+      SSL *ssl = SSL_new(ctx);
+      SSL_set_fd(ssl, client);
+      if (SSL_accept(ssl) > 0) {
+        stub_serve(ssl, response, header_length + RESPONSE_BYTES);
+      }
+      SSL_free(ssl);
+      close(client);
+      _exit(0);
+    }
+    close(client);
+  }
+}
+
+/* --- benchmark --- */
+
+static HttpClient create_client(char *cert_path) {
+  HttpClient client = http_client_create();
+  if (!client.created) {
+    exit(1);
+  }
+  // options set on the client outlive each request
+  curl_easy_setopt(client.curl, CURLOPT_CAINFO, cert_path);
+  return client;
+}
+
+static f64 timed_post(HttpClient client, HttpRequest request, MemoryArena *arena) {
+  u64 position = arena->position;
+  f64 start = now_ms();
+  HttpResponse response = http_post(client, request, arena);
+  f64 elapsed = now_ms() - start;
+
+  if (response.status != 200 || response.body.length != RESPONSE_BYTES) {
+    fprintf(stderr, "bench_http: unexpected response, status=%zu length=%lu\n", response.status, response.body.length);
+    exit(1);
+  }
+  arena_pop_to(arena, position);
+  return elapsed;
+}
+
+int main(void) {
+  char dir[] = "/tmp/bench_http_XXXXXX";
+  if (mkdtemp(dir) == NULL) {
+    perror("bench_http: mkdtemp");
+    return 1;
+  }
+
+  char cert_path[64], key_path[64], command[512];
+  snprintf(cert_path, sizeof(cert_path), "%s/cert.pem", dir);
+  snprintf(key_path, sizeof(key_path), "%s/key.pem", dir);
+  snprintf(command, sizeof(command),
+           "openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj /CN=localhost "
+           "-addext subjectAltName=DNS:localhost -keyout %s -out %s 2>/dev/null",
+           key_path, cert_path);
+  if (system(command) != 0) {
+    fprintf(stderr, "bench_http: failed to create a certificate, is openssl installed?\n");
+    return 1;
+  }
+
+  i32 port = 0;
+  pid_t stub = stub_start(cert_path, key_path, &port);
+
+  char url[64];
+  snprintf(url, sizeof(url), "https://localhost:%d/search", port);
+  String8 headers[1] = { STRING8("Content-Type: application/json") };
+  HttpRequest request = {
+    .method = STRING8("POST"),
+    .uri = (String8){ .data = url, .length = strlen(url) },
+    .body = STRING8("{\"query\": \"hollow purple 1hr\"}"),
+    .headers = headers,
+    .header_count = 1,
+  };
+
+  MemoryArena *arena = arena_create(4 * MB);
+  f64 *samples = malloc(REQUESTS * sizeof(f64));
+
+  // 1. a new client per request, every request pays for a new connection
+  for (i32 i = 0; i < REQUESTS; i++) {
+    HttpClient client = create_client(cert_path);
+    samples[i] = timed_post(client, request, arena);
+    http_client_destroy(&client);
+  }
+  report("https post (new client)", samples, REQUESTS);
+
+  // 2. one client for every request
+  HttpClient client = create_client(cert_path);
+  timed_post(client, request, arena);  // warm up, opens the connection
+  for (i32 i = 0; i < REQUESTS; i++) {
+    samples[i] = timed_post(client, request, arena);
+  }
+  report("https post (persistent client)", samples, REQUESTS);
+  http_client_destroy(&client);
+
+  free(samples);
+  arena_destroy(arena);
+  kill(stub, SIGKILL);
+  waitpid(stub, NULL, 0);
+
+  snprintf(command, sizeof(command), "rm -r %s", dir);
+  system(command);
+  return 0;
+}
@@ -0,0 +1,212 @@
+/*
+  bench_json.c
+
+  measures parsing the captured youtube search response, the json-c path
+  ymp used to take (a tree of the whole document, walked down to each
+  videoRenderer) against parse_response on top of json_scan.h.
+
+  Time is measured with bench.h, memory is how much a single parse grows
+  the peak rss of a fresh child process that already touched the input.
+
+  The soak then runs parse_response 10000 times the way ymp does a search
+  (an arena per parse, truncated responses mixed in) and fails if rss keeps
+  growing after the warm up. Build with DEBUG_FLAGS=-fsanitize=address to
+  have the leak checker look at the same run (asan's quarantine grows rss on
+  its own, so expect the rss check to fail there).
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <json-c/json.h>
+
+#include "base.h"
+#include "file.h"
+#include "http.h"
+#include "http.c"
+#include "http_cache.h"
+#include "http_cache.c"
+#include "json_scan.h"
+#include "ymp/yt.h"
+#include "youtube_fixture.h"
+#include "bench.h"
+
+#define RESULT_BYTES (1 * MB)
+
+#define SOAK_PARSES    10000
+#define SOAK_WARMUP    100
+#define SOAK_GROWTH_KB 256   // a leak of even 32 bytes per parse is well above this
+
+typedef usize (*ParseFn)(String8 body, MemoryArena *arena);
+
+/* --- json-c, a tree of the whole response --- */
+
+static String8 json_c_string(MemoryArena *arena, json_object *json) {
+  char *s = json != NULL ? (char *)json_object_get_string(json) : NULL;
+  return s != NULL ? string8_from_charbuf(arena, s, strlen(s)) : STRING8("");
+}
+
+static usize parse_json_c(String8 body, MemoryArena *arena) {
+  struct json_tokener *tokener = json_tokener_new_ex(JSON_TOKENER_DEFAULT_DEPTH);
+  json_object *json = json_tokener_parse_ex(tokener, body.data, (int)body.length);
+  json_tokener_free(tokener);
+
+  char *path[] = { "contents", "twoColumnSearchResultsRenderer", "primaryContents", "sectionListRenderer", "contents" };
+  json_object *sections = json;
+  for (usize i = 0; i < COUNTOF(path) && sections != NULL; i++) {
+    sections = json_object_object_get(sections, path[i]);
+  }
+
+  json_object *item_section = json_object_object_get(json_object_array_get_idx(sections, 0), "itemSectionRenderer");
+  json_object *items = json_object_object_get(item_section, "contents");
+
+  usize count = 0;
+  usize item_count = json_object_array_length(items);
+  VideoData *videos = arena_push(arena, sizeof(VideoData) * item_count);
+  for (usize i = 0; i < item_count; i++) {
+    json_object *video = json_object_object_get(json_object_array_get_idx(items, i), "videoRenderer");
+    if (video == NULL) {
+      continue;
+    }
+
+    json_object *runs = json_object_object_get(json_object_object_get(video, "title"), "runs");
+    VideoData *v = &(videos[count++]);
+    v->uid = json_c_string(arena, json_object_object_get(video, "videoId"));
+    v->title = json_c_string(arena, json_object_object_get(json_object_array_get_idx(runs, 0), "text"));
+    v->length = json_c_string(arena, json_object_object_get(json_object_object_get(video, "lengthText"), "simpleText"));
+    v->url = string8_concat(arena, YT_WATCH_URL, v->uid);
+  }
+
+  json_object_put(json);
+  return count;
+}
+
+/* --- json_scan.h, as ymp does it now --- */
+
+static usize parse_json_scan(String8 body, MemoryArena *arena) {
+  return parse_response(body, arena).video_count;
+}
+
+/* --- benchmark --- */
+
+static i64 max_rss_kb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / KB;  // bytes on macos
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+/* how much (KB) a single parse in a child process grows its peak rss */
+static i64 peak_rss_kb(ParseFn parse, String8 body) {
+  i32 fds[2];
+  if (pipe(fds) < 0) {
+    return -1;
+  }
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    volatile u64 sum = 0;
+    for (u64 i = 0; i < body.length; i += 4 * KB) {
+      sum += (u8)body.data[i];
+    }
+
+    MemoryArena *arena = arena_create(RESULT_BYTES);
+    i64 before = max_rss_kb();
+    parse(body, arena);
+    i64 peak = max_rss_kb() - before;
+
+    write(fds[1], &peak, sizeof(peak));
+    _exit(0);
+  }
+
+  i64 peak = -1;
+  close(fds[1]);
+  read(fds[0], &peak, sizeof(peak));
+  close(fds[0]);
+  waitpid(pid, NULL, 0);
+  return peak;
+}
+
+typedef struct ParseCase {
+  ParseFn parse;
+  String8 body;
+  MemoryArena *arena;
+} ParseCase;
+
+static void parse_once(void *context) {
+  ParseCase *c = context;
+  arena_clear(c->arena);
+  bench_consume(c->parse(c->body, c->arena));
+}
+
+static void run(char *name, ParseFn parse, String8 body) {
+  ParseCase c = { .parse = parse, .body = body, .arena = arena_create(RESULT_BYTES) };
+  BenchResult result = bench_run(name, parse_once, &c, body.length);
+  if (!result.is_skipped) {
+    printf("%-36s %zu videos %8ld KB peak\n", "", parse(body, c.arena), peak_rss_kb(parse, body));
+  }
+  arena_destroy(c.arena);
+}
+
+/* repeated searches must not grow the process, failed ones must not grow the arena */
+static bool soak(String8 body) {
+  String8 truncated = { .data = body.data, .length = body.length / 2 };
+  MemoryArena *expected = arena_create(RESULT_BYTES);
+  usize videos = parse_json_scan(body, expected);
+  arena_destroy(expected);
+
+  i64 warm_kb = 0;
+
+  for (i32 i = 0; i < SOAK_PARSES; i++) {
+    if (i == SOAK_WARMUP) {
+      warm_kb = max_rss_kb();
+    }
+
+    MemoryArena *arena = arena_create(RESULT_BYTES);
+    YoutubeSearchResponse response = parse_response(i % 10 == 9 ? truncated : body, arena);
+    bool ok = i % 10 == 9 ? (response.code == YT_SEARCH_PARSE_ERROR && arena->position == 0)
+                          : (response.code == YT_SEARCH_OK && response.video_count == videos);
+    arena_destroy(arena);
+
+    if (!ok) {
+      fprintf(stderr, "bench_json: parse %d came back wrong, code=%d\n", i, response.code);
+      return false;
+    }
+  }
+
+  i64 growth_kb = max_rss_kb() - warm_kb;
+  printf("%-36s %d parses %8ld KB rss growth after warm up\n", "soak (parse_response)", SOAK_PARSES, growth_kb);
+  return growth_kb <= SOAK_GROWTH_KB;
+}
+
+int main(int argc, char **argv) {
+  MappedFile file = file_map(STRING8(YOUTUBE_FIXTURE_PATH));
+  if (!file.is_mapped) {
+    fprintf(stderr, "bench_json: run from the repository root\n");
+    return 1;
+  }
+
+  // json-c wants a null terminated copy
+  String8 payload = youtube_fixture_payload(&file);
+  String8 body = { .data = malloc(payload.length + 1), .length = payload.length };
+  memcpy(body.data, payload.data, payload.length);
+  body.data[body.length] = 0;
+
+  bench_begin("bench_json", argc, argv);
+  run("parse (json-c tree)", parse_json_c, body);
+  run("parse_response", parse_json_scan, body);
+  bool flat = soak(body);
+
+  free(body.data);
+  file_unmap(&file);
+  return flat ? 0 : 1;
+}
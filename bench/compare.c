@@ -0,0 +1,262 @@
+/*
+  compare.c
+
+  compares a benchmark run against a baseline, both in the json lines format
+  bench.h writes (see `make bench-baseline` and `make bench-compare`):
+
+    compare <baseline.jsonl> <results.jsonl>
+
+  A case is slower or faster only when both
+    - a one-sided Mann-Whitney U test on the two sets of samples says so
+      with p < COMPARE_ALPHA, so noisy cases need a consistent shift, and
+    - the median moved by more than COMPARE_THRESHOLD (BENCH_THRESHOLD in
+      the environment overrides it) and by more than the two runs' own
+      spread (interquartile range over median, added up), so a real but
+      tiny shift doesn't count, nor does a case that jitters that much
+      from sample to sample anyway.
+
+  Samples of a run are taken back to back, a machine that changes speed
+  between runs (frequency scaling, noisy neighbours) shows up as a shift;
+  compare on a quiet machine, or raise the threshold.
+
+  Prints a table of every case and exits 1 if one of the hot paths in
+  `guarded` (matched as name prefixes) got slower, 2 if a file can't be read.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base.h"
+#include "file.h"
+#include "json_scan.h"
+
+#define COMPARE_ALPHA      0.01
+#define COMPARE_THRESHOLD  0.05   // of the baseline's median
+#define COMPARE_MAX_CASES  256
+#define COMPARE_MAX_SAMPLES 1024
+
+static char *guarded[] = { "__merge", "bitmap_fill", "font_render_char", "parse_response" };
+
+typedef struct Case {
+  String8 suite;
+  String8 name;
+  String8 commit;
+  f64 median_ns;
+  f64 *samples;
+  i32 sample_count;
+} Case;
+
+typedef struct Run {
+  Case cases[COMPARE_MAX_CASES];
+  i32 count;
+  MappedFile file;
+} Run;
+
+typedef struct Rank {
+  f64 value;
+  bool is_current;
+} Rank;
+
+/* reads one case per line, strings point into the mapped file */
+static bool read_run(char *path, Run *run, MemoryArena *arena) {
+  run->count = 0;
+  run->file = file_map((String8){ .data = path, .length = strlen(path) });
+  if (!run->file.is_mapped) {
+    fprintf(stderr, "compare: can't read %s\n", path);
+    return false;
+  }
+
+  String8 contents = run->file.contents;
+  u64 start = 0;
+  while (start < contents.length && run->count < COMPARE_MAX_CASES) {
+    u64 end = start;
+    while (end < contents.length && contents.data[end] != '\n') {
+      end++;
+    }
+    String8 line = { .data = contents.data + start, .length = end - start };
+    start = end + 1;
+    if (line.length == 0) {
+      continue;
+    }
+
+    Case *c = &(run->cases[run->count]);
+    *c = (Case){ .sample_count = 0 };
+    c->samples = arena_push(arena, COMPARE_MAX_SAMPLES * sizeof(f64));
+
+    JsonScanner scanner = json_scan_create(line);
+    String8 key = { 0 };
+    JsonToken token;
+    while ((token = json_scan_next(&scanner)) != JSON_END && token != JSON_ERROR && token != JSON_NEED_MORE) {
+      if (token == JSON_KEY) {
+        key = scanner.value;
+      } else if (token == JSON_STRING && string8_equals(key, STRING8("suite"))) {
+        c->suite = scanner.value;
+      } else if (token == JSON_STRING && string8_equals(key, STRING8("name"))) {
+        c->name = scanner.value;
+      } else if (token == JSON_STRING && string8_equals(key, STRING8("commit"))) {
+        c->commit = scanner.value;
+      } else if (token == JSON_NUMBER && string8_equals(key, STRING8("median_ns"))) {
+        c->median_ns = strtod(scanner.value.data, NULL);
+      } else if (token == JSON_NUMBER && string8_equals(key, STRING8("samples_ns"))
+                 && c->sample_count < COMPARE_MAX_SAMPLES) {
+        c->samples[c->sample_count++] = strtod(scanner.value.data, NULL);
+      }
+    }
+
+    if (token != JSON_END || c->name.length == 0 || c->sample_count == 0) {
+      fprintf(stderr, "compare: skipping a malformed line of %s\n", path);
+      continue;
+    }
+    run->count++;
+  }
+  return true;
+}
+
+static Case *find_case(Run *run, Case *c) {
+  for (i32 i = 0; i < run->count; i++) {
+    if (string8_equals(run->cases[i].suite, c->suite) && string8_equals(run->cases[i].name, c->name)) {
+      return &(run->cases[i]);
+    }
+  }
+  return NULL;
+}
+
+static int compare_rank(const void *a, const void *b) {
+  f64 lhs = ((Rank *)a)->value;
+  f64 rhs = ((Rank *)b)->value;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+/*
+ * p-value of "current's samples tend to be larger than baseline's", from
+ * the normal approximation of U with the correction for ties. Swap the
+ * arguments for "smaller".
+ */
+static f64 mann_whitney_p(Case *baseline, Case *current, MemoryArena *arena) {
+  i32 n1 = current->sample_count;
+  i32 n2 = baseline->sample_count;
+  i32 n = n1 + n2;
+
+  u64 position = arena->position;
+  Rank *ranks = arena_push(arena, n * sizeof(Rank));
+  for (i32 i = 0; i < n1; i++) {
+    ranks[i] = (Rank){ .value = current->samples[i], .is_current = true };
+  }
+  for (i32 i = 0; i < n2; i++) {
+    ranks[n1 + i] = (Rank){ .value = baseline->samples[i], .is_current = false };
+  }
+  qsort(ranks, n, sizeof(Rank), compare_rank);
+
+  // tied values share the average of their ranks
+  f64 current_rank_sum = 0;
+  f64 ties = 0;
+  for (i32 i = 0; i < n;) {
+    i32 j = i;
+    while (j < n && ranks[j].value == ranks[i].value) {
+      j++;
+    }
+    f64 rank = (i + 1 + j) / 2.0;
+    for (i32 k = i; k < j; k++) {
+      current_rank_sum += ranks[k].is_current ? rank : 0;
+    }
+    f64 t = j - i;
+    ties += (t * t * t) - t;
+    i = j;
+  }
+  arena_pop_to(arena, position);
+
+  f64 u = current_rank_sum - (n1 * (n1 + 1) / 2.0);
+  f64 mean = n1 * n2 / 2.0;
+  f64 variance = (n1 * (f64)n2 / 12.0) * ((n + 1) - ties / ((f64)n * (n - 1)));
+  if (variance <= 0) {
+    return 1.0;  // every sample is the same value
+  }
+
+  f64 z = (u - mean - 0.5) / sqrt(variance);
+  return 0.5 * erfc(z / sqrt(2.0));
+}
+
+/* (q3 - q1) / median, the samples are sorted by bench.h */
+static f64 spread(Case *c) {
+  f64 q1 = c->samples[c->sample_count / 4];
+  f64 q3 = c->samples[(c->sample_count * 3) / 4];
+  return c->median_ns > 0 ? (q3 - q1) / c->median_ns : 0;
+}
+
+static bool is_guarded(String8 name) {
+  for (usize i = 0; i < COUNTOF(guarded); i++) {
+    if (string8_startswith(name, (String8){ .data = guarded[i], .length = strlen(guarded[i]) })) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: compare <baseline.jsonl> <results.jsonl>\n");
+    return 2;
+  }
+
+  f64 threshold = getenv("BENCH_THRESHOLD") ? strtod(getenv("BENCH_THRESHOLD"), NULL) : COMPARE_THRESHOLD;
+  MemoryArena *arena = arena_create(64 * MB);
+  static Run baseline;
+  static Run current;
+  if (!read_run(argv[1], &baseline, arena) || !read_run(argv[2], &current, arena)) {
+    return 2;
+  }
+
+  String8 from = baseline.count ? baseline.cases[0].commit : STRING8("?");
+  String8 to = current.count ? current.cases[0].commit : STRING8("?");
+  printf("%.*s -> %.*s (p < %.2f and a median change over %.0f%% and the noise)\n\n",
+         (i32)from.length, from.data, (i32)to.length, to.data, COMPARE_ALPHA, threshold * 100);
+  printf("%-14s %-36s %12s %12s %9s %9s  %s\n", "suite", "name", "baseline", "current", "change", "p", "");
+
+  i32 regressions = 0;
+  for (i32 i = 0; i < current.count; i++) {
+    Case *c = &(current.cases[i]);
+    Case *b = find_case(&baseline, c);
+    if (b == NULL) {
+      printf("%-14.*s %-36.*s %12s %9.1f ns %9s %9s  new\n", (i32)c->suite.length, c->suite.data,
+             (i32)c->name.length, c->name.data, "-", c->median_ns, "-", "-");
+      continue;
+    }
+
+    f64 change = (c->median_ns - b->median_ns) / b->median_ns;
+    f64 p_slower = mann_whitney_p(b, c, arena);
+    f64 p_faster = mann_whitney_p(c, b, arena);
+
+    char *verdict = "";
+    f64 p = MIN(p_slower, p_faster);
+    f64 min_change = MAX(threshold, spread(b) + spread(c));
+    if (p_slower < COMPARE_ALPHA && change > min_change) {
+      bool is_regression = is_guarded(c->name);
+      verdict = is_regression ? "REGRESSION" : "slower";
+      regressions += is_regression;
+    } else if (p_faster < COMPARE_ALPHA && change < -min_change) {
+      verdict = "faster";
+    }
+
+    printf("%-14.*s %-36.*s %9.1f ns %9.1f ns %+8.1f%% %9.4f  %s\n", (i32)c->suite.length, c->suite.data,
+           (i32)c->name.length, c->name.data, b->median_ns, c->median_ns, change * 100, p, verdict);
+  }
+  for (i32 i = 0; i < baseline.count; i++) {
+    Case *b = &(baseline.cases[i]);
+    if (find_case(&current, b) == NULL) {
+      printf("%-14.*s %-36.*s %9.1f ns %12s %9s %9s  missing\n", (i32)b->suite.length, b->suite.data,
+             (i32)b->name.length, b->name.data, b->median_ns, "-", "-", "-");
+    }
+  }
+
+  if (regressions) {
+    printf("\n%d regression(s) in guarded hot paths\n", regressions);
+  }
+
+  file_unmap(&(baseline.file));
+  file_unmap(&(current.file));
+  arena_destroy(arena);
+  return regressions ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+#ifndef __FUZZ_H__
+#define __FUZZ_H__
+
+/*
+  fuzz.h - what the fuzz targets under fuzz/ share.
+
+  Every target is a libFuzzer entry point that reads its arguments out of
+  the fuzzer's bytes with a FuzzInput, runs the code under test and checks
+  the result against something simple enough to be obviously right (libc,
+  a plain array, a pixel at a time), FUZZ_CHECK aborts on a mismatch so the
+  fuzzer keeps the input that caused it:
+
+    int LLVMFuzzerTestOneInput(const u8 *data, usize length) {
+      FuzzInput in = fuzz_input(data, length);
+      String8 s = fuzz_string8(&in, 64);
+      FUZZ_CHECK(string8_equals(s, s));
+      return 0;
+    }
+
+  `make fuzz` builds them with clang's -fsanitize=fuzzer,address,undefined
+  and runs each for FUZZ_TIME seconds, `make fuzz-<name>` runs one (i.e.
+  make fuzz-bitblt). Crashes are written to the working directory, run a
+  target with the crash file as its argument to reproduce it.
+
+  AFL++ takes the same targets, afl-clang-fast links its own driver when
+  given -fsanitize=fuzzer:
+
+    make fuzz CC=afl-clang-fast FUZZ_TIME=0   # builds, runs nothing
+    afl-fuzz -i build/fuzz/seeds/yt -o build/fuzz/afl -- build/fuzz/fuzz_yt
+
+  Compilers without libFuzzer can build a target with -DFUZZ_STANDALONE,
+  it then runs the files given as arguments (or stdin) once each.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base.h"
+
+#define FUZZ_CHECK(condition)                                                           \
+  do {                                                                                  \
+    if (!(condition)) {                                                                 \
+      fprintf(stderr, "%s:%d: FUZZ_CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      abort();                                                                          \
+    }                                                                                   \
+  } while (0)
+
+typedef struct FuzzInput {
+  const u8 *data;
+  usize size;
+  usize position;
+} FuzzInput;
+
+int LLVMFuzzerTestOneInput(const u8 *data, usize length);
+
+FuzzInput fuzz_input(const u8 *data, usize size);
+bool      fuzz_is_done(FuzzInput *in);
+u8        fuzz_u8(FuzzInput *in);
+u32       fuzz_u32(FuzzInput *in);
+i32       fuzz_range(FuzzInput *in, i32 min, i32 max);
+String8   fuzz_string8(FuzzInput *in, usize max_length);
+
+FuzzInput fuzz_input(const u8 *data, usize size) {
+  return (FuzzInput){ .data = data, .size = size, .position = 0 };
+}
+
+bool fuzz_is_done(FuzzInput *in) {
+  return in->position >= in->size;
+}
+
+/* 0 once the input runs out, so every input decodes to something */
+u8 fuzz_u8(FuzzInput *in) {
+  return in->position < in->size ? in->data[in->position++] : 0;
+}
+
+u32 fuzz_u32(FuzzInput *in) {
+  u32 value = 0;
+  for (i32 i = 0; i < 4; i++) {
+    value = (value << 8) | fuzz_u8(in);
+  }
+  return value;
+}
+
+/* in [min, max] */
+i32 fuzz_range(FuzzInput *in, i32 min, i32 max) {
+  u32 span = (u32)(max - min) + 1;
+  u32 value = span <= 256 ? fuzz_u8(in) : fuzz_u32(in);
+  return min + (i32)(value % span);
+}
+
+/* a slice of the input of up to `max_length` bytes, not terminated */
+String8 fuzz_string8(FuzzInput *in, usize max_length) {
+  usize length = (usize)fuzz_range(in, 0, (i32)max_length);
+  length = MIN(length, in->size - MIN(in->position, in->size));
+  String8 s = { .data = (char *)(in->data + in->position), .length = length };
+  in->position += length;
+  return s;
+}
+
+#ifdef FUZZ_STANDALONE
+
+static void __fuzz_run(FILE *f, char *name) {
+  usize capacity = 4096;
+  usize size = 0;
+  u8 *data = malloc(capacity);
+  usize n;
+  while ((n = fread(data + size, 1, capacity - size, f)) > 0) {
+    size += n;
+    if (size == capacity) {
+      capacity *= 2;
+      data = realloc(data, capacity);
+    }
+  }
+  LLVMFuzzerTestOneInput(data, size);
+  printf("%s: ok (%zu bytes)\n", name, size);
+  free(data);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    __fuzz_run(stdin, "stdin");
+    return 0;
+  }
+
+  for (i32 i = 1; i < argc; i++) {
+    FILE *f = fopen(argv[i], "rb");
+    if (f == NULL) {
+      fprintf(stderr, "ERROR: Failed to read %s.\n", argv[i]);
+      return 1;
+    }
+    __fuzz_run(f, argv[i]);
+    fclose(f);
+  }
+  return 0;
+}
+
+#endif
+
+#endif
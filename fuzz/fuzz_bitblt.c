@@ -0,0 +1,88 @@
+/*
+  fuzz_bitblt.c
+
+  bitblt_clipped with random bitmaps, source rects, positions and clip
+  rects (negative, oversized, outside the destination), checked against a
+  reference that decides for every destination pixel on its own whether
+  and what it gets. Each bitmap is a separate allocation, so a write past
+  one is caught by the address sanitizer.
+*/
+#include "base.h"
+#include "draw.h"
+#include "fuzz.h"
+
+#define FUZZ_BITMAP_MAX 24  // pixels per side
+#define FUZZ_COORD_MAX  32  // rects and positions are in [-FUZZ_COORD_MAX, FUZZ_COORD_MAX]
+
+/* the pixels come from a seed, the input's bytes are better spent on the rects */
+static Bitmap fuzz_bitmap(FuzzInput *in) {
+  Bitmap b = { .w = fuzz_range(in, 0, FUZZ_BITMAP_MAX), .h = fuzz_range(in, 0, FUZZ_BITMAP_MAX) };
+  b.pixels = malloc(MAX(1, b.w * b.h) * sizeof(Color));
+  u32 state = fuzz_u32(in) | 1;
+  for (i32 i = 0; i < b.w * b.h; i++) {
+    state ^= state << 13;  // xorshift32
+    state ^= state >> 17;
+    state ^= state << 5;
+    b.pixels[i] = state;
+  }
+  return b;
+}
+
+/* mostly the right way up, a corner above or left of the origin is allowed too */
+static Rect fuzz_rect(FuzzInput *in) {
+  Rect r;
+  r.origin.x = fuzz_range(in, -FUZZ_COORD_MAX, FUZZ_COORD_MAX);
+  r.origin.y = fuzz_range(in, -FUZZ_COORD_MAX, FUZZ_COORD_MAX);
+  r.corner.x = r.origin.x + fuzz_range(in, -4, FUZZ_COORD_MAX);
+  r.corner.y = r.origin.y + fuzz_range(in, -4, FUZZ_COORD_MAX);
+  return r;
+}
+
+static bool contains(Rect r, i32 x, i32 y) {
+  return x >= r.origin.x && x < r.corner.x && y >= r.origin.y && y < r.corner.y;
+}
+
+/*
+ * A pixel at a time: source pixel (sx, sy) of `src_rect` goes to
+ * `at` + (sx, sy) - `src_rect.origin` when it is in `src`, and that is in
+ * `clip_rect` and `dst`. Combining it with the destination is __merge's
+ * job, so it's done by a 1 pixel __merge.
+ */
+static void reference_bitblt(Bitmap *src, Bitmap *dst, Rect src_rect, Point at, Rect clip_rect, DrawOp op) {
+  for (i32 y = 0; y < dst->h; y++) {
+    for (i32 x = 0; x < dst->w; x++) {
+      i32 sx = src_rect.origin.x + (x - at.x);
+      i32 sy = src_rect.origin.y + (y - at.y);
+      if (contains(clip_rect, x, y) && contains(src_rect, sx, sy) && contains(bitmap_rect(src), sx, sy)) {
+        __merge(src, dst, sx, sy, x, y, 1, op);
+      }
+    }
+  }
+}
+
+int LLVMFuzzerTestOneInput(const u8 *data, usize length) {
+  FuzzInput in = fuzz_input(data, length);
+  Bitmap src = fuzz_bitmap(&in);
+  Bitmap dst = fuzz_bitmap(&in);
+  Rect src_rect = fuzz_rect(&in);
+  Rect clip_rect = fuzz_rect(&in);
+  Point at = { fuzz_range(&in, -FUZZ_COORD_MAX, FUZZ_COORD_MAX), fuzz_range(&in, -FUZZ_COORD_MAX, FUZZ_COORD_MAX) };
+  DrawOp op = fuzz_range(&in, DRAWOP_STORE, DRAWOP_CLR);
+
+  // half the time the whole destination, the usual case
+  if (fuzz_u8(&in) & 1) {
+    clip_rect = bitmap_rect(&dst);
+  }
+
+  Bitmap expected = { .w = dst.w, .h = dst.h, .pixels = malloc(MAX(1, dst.w * dst.h) * sizeof(Color)) };
+  memcpy(expected.pixels, dst.pixels, dst.w * dst.h * sizeof(Color));
+
+  bitblt_clipped(&src, &dst, src_rect, at, clip_rect, op);
+  reference_bitblt(&src, &expected, src_rect, at, clip_rect, op);
+  FUZZ_CHECK(memcmp(dst.pixels, expected.pixels, dst.w * dst.h * sizeof(Color)) == 0);
+
+  free(src.pixels);
+  free(dst.pixels);
+  free(expected.pixels);
+  return 0;
+}
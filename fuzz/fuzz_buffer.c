@@ -0,0 +1,109 @@
+/*
+  fuzz_buffer.c
+
+  sequences of GapBuffer edits (inserts, pastes, deletes, gap moves), the
+  text is checked against a plain array after each one. The buffer starts
+  tiny and keeps little slack so it grows all the time.
+*/
+#define GAP_SIZE_BYTES 8
+#define GAP_MIN_BYTES  1
+
+#include "base.h"
+#include "buffer.h"
+#include "fuzz.h"
+
+#define FUZZ_TEXT_BYTES (64 * KB)
+#define FUZZ_PASTE_BYTES 300
+
+typedef enum EditOp {
+  EDIT_INSERT,
+  EDIT_PASTE,
+  EDIT_BACKSPACE,
+  EDIT_DELETE,
+  EDIT_MOVE,
+  EDIT_OP_COUNT,
+} EditOp;
+
+/* the text the buffer should have, and where its gap should be */
+typedef struct Model {
+  char text[FUZZ_TEXT_BYTES];
+  i32 length;
+  i32 cursor;
+} Model;
+
+static Model model;
+
+static void model_insert(String8 s) {
+  memmove(model.text + model.cursor + s.length, model.text + model.cursor, model.length - model.cursor);
+  memcpy(model.text + model.cursor, s.data, s.length);
+  model.length += s.length;
+  model.cursor += s.length;
+}
+
+static void check(GapBuffer *gb) {
+  FUZZ_CHECK(buffer_length(gb) == model.length);
+  FUZZ_CHECK(gb->gap_start == model.cursor);
+  FUZZ_CHECK(gb->gap_start <= gb->gap_end && gb->gap_end <= gb->size);
+  FUZZ_CHECK(memcmp(gb->buf, model.text, gb->gap_start) == 0);
+  FUZZ_CHECK(memcmp(gb->buf + gb->gap_end, model.text + gb->gap_start, gb->size - gb->gap_end) == 0);
+}
+
+int LLVMFuzzerTestOneInput(const u8 *data, usize length) {
+  FuzzInput in = fuzz_input(data, length);
+  GapBuffer gb = buffer_create();
+  model.length = 0;
+  model.cursor = 0;
+
+  while (!fuzz_is_done(&in)) {
+    EditOp op = fuzz_u8(&in) % EDIT_OP_COUNT;
+    switch (op) {
+    case EDIT_INSERT: {
+      char c = (char)fuzz_u8(&in);
+      if (model.length + 1 <= FUZZ_TEXT_BYTES) {
+        buffer_insert(&gb, c);
+        model_insert((String8){ .data = &c, .length = 1 });
+      }
+      break;
+    }
+    case EDIT_PASTE: {
+      String8 s = fuzz_string8(&in, FUZZ_PASTE_BYTES);
+      if (model.length + (i32)s.length <= FUZZ_TEXT_BYTES) {
+        buffer_insert_string8(&gb, s);
+        model_insert(s);
+      }
+      break;
+    }
+    case EDIT_BACKSPACE:
+      buffer_backspace(&gb);
+      if (model.cursor > 0) {
+        memmove(model.text + model.cursor - 1, model.text + model.cursor, model.length - model.cursor);
+        model.cursor--;
+        model.length--;
+      }
+      break;
+    case EDIT_DELETE:
+      buffer_delete(&gb);
+      if (model.cursor < model.length) {
+        memmove(model.text + model.cursor, model.text + model.cursor + 1, model.length - model.cursor - 1);
+        model.length--;
+      }
+      break;
+    case EDIT_MOVE: {
+      // past either end too, the buffer clamps
+      i32 pos = fuzz_range(&in, -8, model.length + 8);
+      buffer_move_gap(&gb, pos);
+      model.cursor = MAX(0, MIN(pos, model.length));
+      break;
+    }
+    default:
+      break;
+    }
+    check(&gb);
+  }
+
+  for (i32 i = -1; i <= model.length; i++) {
+    FUZZ_CHECK(buffer_get(&gb, i) == (i >= 0 && i < model.length ? model.text[i] : -1));
+  }
+  buffer_destroy(&gb);
+  return 0;
+}
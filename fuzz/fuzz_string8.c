@@ -0,0 +1,85 @@
+/*
+  fuzz_string8.c
+
+  the string8_* functions on arbitrary bytes (embedded zeros, high bytes,
+  empty strings), checked against libc.
+*/
+#include <stdarg.h>
+
+#include "base.h"
+#include "fuzz.h"
+
+#define FUZZ_STRING_BYTES 256
+
+static i32 sign(i64 value) {
+  return (value > 0) - (value < 0);
+}
+
+/* what string8_compare means: chars compared as chars, then lengths */
+static i32 reference_compare(String8 lhs, String8 rhs) {
+  usize n = MIN(lhs.length, rhs.length);
+  for (usize i = 0; i < n; i++) {
+    if (lhs.data[i] != rhs.data[i]) {
+      return sign(lhs.data[i] - rhs.data[i]);
+    }
+  }
+  return sign((i64)lhs.length - (i64)rhs.length);
+}
+
+static bool has_contents(String8 s, String8 a, String8 b) {
+  return s.length == a.length + b.length
+    && memcmp(s.data, a.data, a.length) == 0
+    && memcmp(s.data + a.length, b.data, b.length) == 0;
+}
+
+int LLVMFuzzerTestOneInput(const u8 *data, usize length) {
+  FuzzInput in = fuzz_input(data, length);
+  String8 lhs = fuzz_string8(&in, FUZZ_STRING_BYTES);
+  String8 rhs = fuzz_string8(&in, FUZZ_STRING_BYTES);
+  String8 separator = fuzz_string8(&in, 8);
+  u64 start = fuzz_u8(&in);
+
+  MemoryArena *arena = arena_create(8 * KB);
+
+  // comparisons
+  bool is_equal = lhs.length == rhs.length && memcmp(lhs.data, rhs.data, lhs.length) == 0;
+  FUZZ_CHECK(string8_equals(lhs, rhs) == is_equal);
+  FUZZ_CHECK(string8_equals(lhs, lhs));
+  FUZZ_CHECK(sign(string8_compare(lhs, rhs)) == reference_compare(lhs, rhs));
+  FUZZ_CHECK(sign(string8_compare(lhs, rhs)) == -sign(string8_compare(rhs, lhs)));
+  FUZZ_CHECK((string8_compare(lhs, rhs) == 0) == is_equal);
+
+  bool is_prefix = rhs.length <= lhs.length && memcmp(lhs.data, rhs.data, rhs.length) == 0;
+  bool is_suffix = rhs.length <= lhs.length && memcmp(lhs.data + lhs.length - rhs.length, rhs.data, rhs.length) == 0;
+  FUZZ_CHECK(string8_startswith(lhs, rhs) == is_prefix);
+  FUZZ_CHECK(string8_endswith(lhs, rhs) == is_suffix);
+
+  for (usize i = 0; i < lhs.length + 2; i++) {
+    FUZZ_CHECK(string8_get(lhs, i) == (i < lhs.length ? lhs.data[i] : -1));
+  }
+
+  // copies are terminated, the input isn't
+  String8 empty = STRING8("");
+  String8 copy = string8_from_charbuf(arena, lhs.data, lhs.length);
+  FUZZ_CHECK(has_contents(copy, lhs, empty) && copy.data[copy.length] == '\0');
+  String8 clone = string8_clone(arena, rhs);
+  FUZZ_CHECK(has_contents(clone, rhs, empty) && clone.data[clone.length] == '\0');
+
+  String8 concat = string8_concat(arena, lhs, rhs);
+  FUZZ_CHECK(has_contents(concat, lhs, rhs) && concat.data[concat.length] == '\0');
+
+  String8 joined = string8_join(arena, separator, 3, lhs, rhs, lhs);
+  String8 expected = string8_concat(arena, string8_concat(arena, lhs, separator), rhs);
+  expected = string8_concat(arena, string8_concat(arena, expected, separator), lhs);
+  FUZZ_CHECK(string8_equals(joined, expected) && joined.data[joined.length] == '\0');
+
+  String8 rest = string8_substringfrom(lhs, start);
+  if (start < lhs.length) {
+    FUZZ_CHECK(rest.data == lhs.data + start && rest.length == lhs.length - start);
+  } else {
+    FUZZ_CHECK(rest.length == 0);
+  }
+
+  arena_destroy(arena);
+  return 0;
+}
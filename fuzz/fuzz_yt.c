@@ -0,0 +1,57 @@
+/*
+  fuzz_yt.c
+
+  search responses as they come from the network: parse_response on any
+  bytes, and the same bytes fed to the streaming parser in pieces (the way
+  curl hands them over) must give the same videos. Seeded with the
+  recorded response under data/.
+*/
+#include "base.h"
+#include "file.h"
+#include "http.h"
+#include "http.c"
+#include "http_cache.h"
+#include "http_cache.c"
+#include "json_scan.h"
+#include "ymp/yt.h"
+#include "fuzz.h"
+
+static bool videos_equal(VideoData *a, VideoData *b) {
+  return string8_equals(a->uid, b->uid)
+    && string8_equals(a->title, b->title)
+    && string8_equals(a->length, b->length)
+    && string8_equals(a->url, b->url);
+}
+
+int LLVMFuzzerTestOneInput(const u8 *data, usize length) {
+  String8 body = { .data = (char *)data, .length = length };
+  // videos are copied (unescaped) out of the body, twice
+  MemoryArena *arena = arena_create((4 * length) + MB);
+
+  YoutubeSearchResponse whole = parse_response(body, arena);
+  FUZZ_CHECK(whole.video_count == 0 || whole.code == YT_SEARCH_OK);
+  for (usize i = 0; i < whole.video_count; i++) {
+    FUZZ_CHECK(string8_startswith(whole.videos[i].url, YT_WATCH_URL));
+    FUZZ_CHECK(string8_endswith(whole.videos[i].url, whole.videos[i].uid));
+  }
+
+  // what arrived so far grows by 1 to 256 bytes at a time, picked by the input
+  usize step = length ? 1 + data[length / 2] : 1;
+  VideoParser parser;
+  parser_init(&parser, arena, false, NULL, NULL);
+  for (usize received = MIN(step, length); received < length; received = MIN(received + step, length)) {
+    parser_feed(&parser, (String8){ .data = body.data, .length = received }, false);
+  }
+  parser_feed(&parser, body, true);
+  YoutubeSearchResponse streamed = parser_finish(&parser, YT_SEARCH_OK);
+
+  FUZZ_CHECK(streamed.code == whole.code);
+  FUZZ_CHECK(streamed.video_count == whole.video_count);
+  for (usize i = 0; i < whole.video_count; i++) {
+    FUZZ_CHECK(videos_equal(&(whole.videos[i]), &(streamed.videos[i])));
+  }
+  FUZZ_CHECK(string8_equals(streamed.continuation, whole.continuation));
+
+  arena_destroy(arena);
+  return 0;
+}
@@ -0,0 +1,25 @@
+/*
+  seed_yt.c
+
+  writes the response body of the recorded search response to stdout, the
+  seed for fuzz_yt (see the Makefile).
+
+    seed_yt data/youtube-search-response.json > response.json
+*/
+#include <stdio.h>
+
+#include "youtube_fixture.h"
+
+int main(int argc, char **argv) {
+  char *path = argc > 1 ? argv[1] : YOUTUBE_FIXTURE_PATH;
+  MappedFile file = file_map((String8){ .data = path, .length = strlen(path) });
+  String8 payload = youtube_fixture_payload(&file);
+  if (payload.length == 0) {
+    fprintf(stderr, "seed_yt: no response payload in %s\n", path);
+    return 1;
+  }
+
+  fwrite(payload.data, 1, payload.length, stdout);
+  file_unmap(&file);
+  return 0;
+}
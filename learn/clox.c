@@ -1,14 +1,33 @@
 /* One File LOX Implementation */
 
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L  // clock_gettime, for the gc's pause times
+#endif
+
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
-
-#define DEBUG_TRACE_EXECUTION
+/*
+ * Build flags:
+ *   -DDEBUG_TRACE_EXECUTION  prints the stack and disassembles every instruction as it runs
+ *   -DCLOX_SWITCH_DISPATCH   dispatches through a switch even where computed goto is supported
+ *   -DCLOX_NO_MAIN           leaves main out, to include the VM elsewhere (i.e. bench/bench_clox.c)
+ *   -DDEBUG_STRESS_GC        collects before every allocation, to shake out missing roots
+ *   -DDEBUG_LOG_GC           prints every collection and, on exit, the pause-time statistics
+ *   -DDEBUG_PRINT_CODE       disassembles every chunk before and after optimize_chunk
+ */
 #define STACK_MAX 256
+#define GC_HEAP_GROW_FACTOR 2
+#define GC_FIRST_COLLECTION (1024 * 1024)
+
+#if defined(__GNUC__) && !defined(CLOX_SWITCH_DISPATCH)
+#define CLOX_THREADED_DISPATCH
+#endif
 
 // -- MEMORY UTILS
 #define GROW_CAPACITY(capacity) \
@@ -20,7 +39,51 @@
 #define FREE_ARRAY(type, pointer, old_count)	\
   reallocate(pointer, sizeof(type) * (old_count), 0)
 
+typedef struct Obj Obj;
+typedef struct Chunk Chunk;
+
+/*
+ * The heap's bookkeeping: every object is on the `objects` list, every chunk that
+ * was initialized and not yet freed on the `chunks` one (their constants are roots).
+ */
+typedef struct {
+  Obj* objects;
+  Chunk* chunks;
+  size_t bytes_allocated;
+  size_t next_gc;          // collect once bytes_allocated goes past this
+
+  int gray_count;
+  int gray_capacity;
+  Obj** gray_stack;        // marked objects whose references aren't marked yet
+
+  // pause-time statistics
+  int collections;
+  double total_pause_ms;
+  double max_pause_ms;
+  double last_pause_ms;
+  size_t bytes_freed;
+} Gc;
+
+Gc gc = { .next_gc = GC_FIRST_COLLECTION };
+
+void collect_garbage();
+
+/*
+ * Every allocation, growth and free of the heap goes through here, so the bytes
+ * it counts are what triggers a collection.
+ */
 void* reallocate(void* pointer, size_t old_size, size_t new_size) {
+  gc.bytes_allocated += new_size - old_size;
+  if (new_size > old_size) {
+#ifdef DEBUG_STRESS_GC
+    collect_garbage();
+#else
+    if (gc.bytes_allocated > gc.next_gc) {
+      collect_garbage();
+    }
+#endif
+  }
+
   if (new_size == 0) {
     free(pointer);
     return NULL;
@@ -37,7 +100,125 @@ void* reallocate(void* pointer, size_t old_size, size_t new_size) {
 
 // -- TYPES & VALUES
 
-typedef double Value;
+/*
+ * Values are NaN-boxed: a double is stored as itself, everything else hides in the
+ * payload of a quiet NaN no arithmetic produces. nil, false and true are tagged in
+ * its low bits, an object pointer (48 bits) is stored whole with the sign bit set.
+ */
+typedef uint64_t Value;
+
+#define SIGN_BIT ((uint64_t)0x8000000000000000)
+#define QNAN     ((uint64_t)0x7ffc000000000000)
+
+#define TAG_NIL   1
+#define TAG_FALSE 2
+#define TAG_TRUE  3
+
+#define NIL_VAL         ((Value)(uint64_t)(QNAN | TAG_NIL))
+#define FALSE_VAL       ((Value)(uint64_t)(QNAN | TAG_FALSE))
+#define TRUE_VAL        ((Value)(uint64_t)(QNAN | TAG_TRUE))
+#define BOOL_VAL(b)     ((b) ? TRUE_VAL : FALSE_VAL)
+#define NUMBER_VAL(num) num_to_value(num)
+#define OBJ_VAL(obj)    (Value)(SIGN_BIT | QNAN | (uint64_t)(uintptr_t)(obj))
+
+#define IS_NIL(value)    ((value) == NIL_VAL)
+#define IS_BOOL(value)   (((value) | 1) == TRUE_VAL)
+#define IS_NUMBER(value) (((value) & QNAN) != QNAN)
+#define IS_OBJ(value)    (((value) & (QNAN | SIGN_BIT)) == (QNAN | SIGN_BIT))
+
+#define AS_BOOL(value)   ((value) == TRUE_VAL)
+#define AS_NUMBER(value) value_to_num(value)
+#define AS_OBJ(value)    ((Obj*)(uintptr_t)((value) & ~(SIGN_BIT | QNAN)))
+
+static inline double value_to_num(Value value) {
+  double num;
+  memcpy(&num, &value, sizeof(Value));
+  return num;
+}
+
+static inline Value num_to_value(double num) {
+  Value value;
+  memcpy(&value, &num, sizeof(double));
+  return value;
+}
+
+typedef enum {
+  OBJ_STRING,
+} ObjType;
+
+struct Obj {
+  ObjType type;
+  bool is_marked;
+  struct Obj* next;
+};
+
+typedef struct {
+  Obj obj;
+  int length;
+  char chars[];  // length bytes and a '\0', allocated with the object
+} ObjString;
+
+#define OBJ_TYPE(value)  (AS_OBJ(value)->type)
+#define IS_STRING(value) (IS_OBJ(value) && OBJ_TYPE(value) == OBJ_STRING)
+#define AS_STRING(value) ((ObjString*)AS_OBJ(value))
+#define AS_CSTRING(value) (AS_STRING(value)->chars)
+
+static Obj* allocate_object(size_t size, ObjType type) {
+  Obj* object = (Obj*)reallocate(NULL, 0, size);
+  object->type = type;
+  object->is_marked = false;
+  object->next = gc.objects;
+  gc.objects = object;
+  return object;
+}
+
+/* may collect, whatever the caller still needs must be reachable from a root */
+static ObjString* allocate_string(int length) {
+  ObjString* string = (ObjString*)allocate_object(sizeof(ObjString) + length + 1, OBJ_STRING);
+  string->length = length;
+  string->chars[length] = '\0';
+  return string;
+}
+
+ObjString* copy_string(const char* chars, int length) {
+  ObjString* string = allocate_string(length);
+  memcpy(string->chars, chars, length);
+  return string;
+}
+
+static void free_object(Obj* object) {
+  switch (object->type) {
+  case OBJ_STRING: {
+    ObjString* string = (ObjString*)object;
+    reallocate(object, sizeof(ObjString) + string->length + 1, 0);
+    break;
+  }
+  }
+}
+
+void print_value(Value value) {
+  if (IS_BOOL(value)) {
+    printf(AS_BOOL(value) ? "true" : "false");
+  } else if (IS_NIL(value)) {
+    printf("nil");
+  } else if (IS_NUMBER(value)) {
+    printf("%g", AS_NUMBER(value));
+  } else if (IS_STRING(value)) {
+    printf("%s", AS_CSTRING(value));
+  }
+}
+
+bool values_equal(Value a, Value b) {
+  if (IS_NUMBER(a) && IS_NUMBER(b)) {
+    return AS_NUMBER(a) == AS_NUMBER(b);  // NaN != NaN
+  }
+  if (IS_STRING(a) && IS_STRING(b)) {
+    ObjString* lhs = AS_STRING(a);
+    ObjString* rhs = AS_STRING(b);
+    return lhs->length == rhs->length && memcmp(lhs->chars, rhs->chars, lhs->length) == 0;
+  }
+  return a == b;
+}
 
 typedef struct {
   int capacity;
@@ -45,10 +226,6 @@ typedef struct {
   Value* values;
 } ValueArray;
 
-void print_value(Value value) {
-  printf("%g", value);
-}
-
 void init_value_array(ValueArray* array) {
   array->count = 0;
   array->capacity = 0;
@@ -73,32 +250,112 @@ void free_value_array(ValueArray* array) {
 
 typedef enum {
   OP_CONSTANT,
+  OP_CONSTANT_LONG,  // a 24 bit little-endian index, past the first 256 constants
+  OP_NIL,
+  OP_TRUE,
+  OP_FALSE,
+  OP_EQUAL,
+  OP_GREATER,
+  OP_LESS,
   OP_ADD,
   OP_SUBTRACT,
   OP_MULTIPLY,
   OP_DIVIDE,
+  OP_NOT,
   OP_NEGATE,
   OP_RETURN,
+  // superinstructions, only written by optimize_chunk
+  OP_ADD_CONSTANT,       // OP_CONSTANT k (a number), OP_ADD
+  OP_SUBTRACT_CONSTANT,
+  OP_MULTIPLY_CONSTANT,
+  OP_DIVIDE_CONSTANT,
+  OP_NOT_EQUAL,          // OP_EQUAL, OP_NOT
+  OP_GREATER_EQUAL,      // OP_LESS, OP_NOT
+  OP_LESS_EQUAL,         // OP_GREATER, OP_NOT
 } OpCode;
 
+#define MAX_CONSTANTS (1 << 24)
+
+/* where a line's bytecode starts, the line table holds one per change of line */
+typedef struct {
+  int offset;
+  int line;
+} LineStart;
+
+/* a slot of the open-addressed table add_constant looks duplicates up in */
+typedef struct {
+  Value key;
+  int index;  // into constants, -1 when the slot is empty
+} ConstantSlot;
+
 /*
  * Chunks represents sequences of bytecode as a dynamic array of instructions.
+ * Lines are run-length encoded (get_line finds an offset's by binary search), a
+ * constant is only stored once however often it's added.
  */
-typedef struct {
+struct Chunk {
   int count;
   int capacity;
   uint8_t* code;
-  int* lines;
+  int line_count;
+  int line_capacity;
+  LineStart* lines;
   ValueArray constants;
-} Chunk;
-
+  int slot_capacity;    // a power of 2
+  ConstantSlot* slots;
+  struct Chunk* next;   // on gc.chunks
+};
 
-void init_chunk(Chunk* chunk) {
+static void reset_chunk(Chunk* chunk) {
   chunk->count = 0;
   chunk->capacity = 0;
   chunk->code = NULL;
+  chunk->line_count = 0;
+  chunk->line_capacity = 0;
   chunk->lines = NULL;
   init_value_array(&chunk->constants);
+  chunk->slot_capacity = 0;
+  chunk->slots = NULL;
+}
+
+void init_chunk(Chunk* chunk) {
+  reset_chunk(chunk);
+  chunk->next = gc.chunks;
+  gc.chunks = chunk;
+}
+
+/* starts a new run unless `line` is the one the bytecode before `offset` is on */
+static void add_line(Chunk* chunk, int offset, int line) {
+  if (chunk->line_count > 0 && chunk->lines[chunk->line_count - 1].line == line) {
+    return;
+  }
+
+  if (chunk->line_capacity < chunk->line_count + 1) {
+    int old_capacity = chunk->line_capacity;
+    chunk->line_capacity = GROW_CAPACITY(old_capacity);
+    chunk->lines = GROW_ARRAY(LineStart, chunk->lines, old_capacity, chunk->line_capacity);
+  }
+  chunk->lines[chunk->line_count].offset = offset;
+  chunk->lines[chunk->line_count].line = line;
+  chunk->line_count++;
+}
+
+static int find_line(LineStart* lines, int line_count, int offset) {
+  int low = 0;
+  int high = line_count - 1;
+  while (low < high) {
+    int mid = low + (high - low + 1) / 2;
+    if (lines[mid].offset <= offset) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return lines[low].line;
+}
+
+int get_line(Chunk* chunk, int offset) {
+  return find_line(chunk->lines, chunk->line_count, offset);
 }
 
 void write_chunk(Chunk* chunk, uint8_t byte, int line) {
@@ -106,29 +363,113 @@ void write_chunk(Chunk* chunk, uint8_t byte, int line) {
     int old_capacity = chunk->capacity;
     chunk->capacity = GROW_CAPACITY(old_capacity);
     chunk->code = GROW_ARRAY(uint8_t, chunk->code, old_capacity, chunk->capacity);
-    chunk->lines = GROW_ARRAY(int, chunk->lines, old_capacity, chunk->capacity);
   }
 
+  add_line(chunk, chunk->count, line);
   chunk->code[chunk->count] = byte;
-  chunk->lines[chunk->count] = line;
   chunk->count++;
 }
 
+/* on the value's bits: a number by its exact value, an object by identity */
+static uint32_t hash_value(Value value) {
+  value ^= value >> 33;
+  value *= 0xff51afd7ed558ccdULL;
+  value ^= value >> 33;
+  return (uint32_t)value;
+}
+
+static ConstantSlot* find_slot(ConstantSlot* slots, int capacity, Value value) {
+  uint32_t index = hash_value(value) & (capacity - 1);
+  for (;;) {
+    ConstantSlot* slot = &slots[index];
+    if (slot->index == -1 || slot->key == value) {
+      return slot;
+    }
+    index = (index + 1) & (capacity - 1);
+  }
+}
+
+/* keeps the table at most 3/4 full */
+static void grow_slots(Chunk* chunk) {
+  int capacity = GROW_CAPACITY(chunk->slot_capacity);
+  ConstantSlot* slots = GROW_ARRAY(ConstantSlot, NULL, 0, capacity);
+  for (int i = 0; i < capacity; i++) {
+    slots[i].index = -1;
+  }
+  for (int i = 0; i < chunk->constants.count - 1; i++) {  // but the one being added
+    ConstantSlot* slot = find_slot(slots, capacity, chunk->constants.values[i]);
+    slot->key = chunk->constants.values[i];
+    slot->index = i;
+  }
+
+  FREE_ARRAY(ConstantSlot, chunk->slots, chunk->slot_capacity);
+  chunk->slots = slots;
+  chunk->slot_capacity = capacity;
+}
+
+void push(Value value);
+Value pop();
+
+/* the index of `value` in the chunk's constants, added unless it's there already */
 int add_constant(Chunk* chunk, Value value) {
+  if (chunk->slot_capacity > 0) {
+    ConstantSlot* slot = find_slot(chunk->slots, chunk->slot_capacity, value);
+    if (slot->index != -1) {
+      return slot->index;
+    }
+  }
+
+  push(value);  // a root while growing the constants may collect
   write_value_array(&chunk->constants, value);
-  return chunk->constants.count - 1;
+  int index = chunk->constants.count - 1;
+  if ((chunk->constants.count * 4) > (chunk->slot_capacity * 3)) {
+    grow_slots(chunk);
+  }
+  ConstantSlot* slot = find_slot(chunk->slots, chunk->slot_capacity, value);
+  slot->key = value;
+  slot->index = index;
+  pop();
+  return index;
+}
+
+/* OP_CONSTANT or, past the first 256 constants, OP_CONSTANT_LONG. False when the chunk is full */
+bool write_constant(Chunk* chunk, Value value, int line) {
+  int index = add_constant(chunk, value);
+  if (index >= MAX_CONSTANTS) {
+    return false;
+  }
+
+  if (index < 256) {
+    write_chunk(chunk, OP_CONSTANT, line);
+    write_chunk(chunk, (uint8_t)index, line);
+  } else {
+    write_chunk(chunk, OP_CONSTANT_LONG, line);
+    write_chunk(chunk, (uint8_t)(index & 0xff), line);
+    write_chunk(chunk, (uint8_t)((index >> 8) & 0xff), line);
+    write_chunk(chunk, (uint8_t)((index >> 16) & 0xff), line);
+  }
+  return true;
 }
 
 void free_chunk(Chunk* chunk) {
+  for (Chunk** link = &gc.chunks; *link != NULL; link = &(*link)->next) {
+    if (*link == chunk) {
+      *link = chunk->next;
+      break;
+    }
+  }
+
   FREE_ARRAY(uint8_t, chunk->code, chunk->capacity);
-  FREE_ARRAY(int, chunk->lines, chunk->capacity);
+  FREE_ARRAY(LineStart, chunk->lines, chunk->line_capacity);
   free_value_array(&chunk->constants);
-  init_chunk(chunk);
+  FREE_ARRAY(ConstantSlot, chunk->slots, chunk->slot_capacity);
+  reset_chunk(chunk);
 }
 // -- DEBUG
 int disassemble_instruction(Chunk* chunk, int offset);
 static int simple_instruction(const char* name, int offset);
 static int constant_instruction(const char* name, Chunk* chunk, int offset);
+static int constant_long_instruction(const char* name, Chunk* chunk, int offset);
 
 void disassemble_chunk(Chunk* chunk, const char* name) {
   printf("== %s ==\n", name);
@@ -141,16 +482,31 @@ void disassemble_chunk(Chunk* chunk, const char* name) {
 int disassemble_instruction(Chunk* chunk, int offset) {
   printf("%04d ", offset);
 
-  if (offset > 0 && chunk->lines[offset] == chunk->lines[offset - 1]) {
+  int line = get_line(chunk, offset);
+  if (offset > 0 && line == get_line(chunk, offset - 1)) {
     printf("   | ");
   } else {
-    printf("%4d ", chunk->lines[offset]);
+    printf("%4d ", line);
   }
 
   uint8_t instruction = chunk->code[offset];
   switch(instruction) {
   case OP_CONSTANT:
     return constant_instruction("OP_CONSTANT", chunk, offset);
+  case OP_CONSTANT_LONG:
+    return constant_long_instruction("OP_CONSTANT_LONG", chunk, offset);
+  case OP_NIL:
+    return simple_instruction("OP_NIL", offset);
+  case OP_TRUE:
+    return simple_instruction("OP_TRUE", offset);
+  case OP_FALSE:
+    return simple_instruction("OP_FALSE", offset);
+  case OP_EQUAL:
+    return simple_instruction("OP_EQUAL", offset);
+  case OP_GREATER:
+    return simple_instruction("OP_GREATER", offset);
+  case OP_LESS:
+    return simple_instruction("OP_LESS", offset);
   case OP_ADD:
     return simple_instruction("OP_ADD", offset);
   case OP_SUBTRACT:
@@ -159,10 +515,26 @@ int disassemble_instruction(Chunk* chunk, int offset) {
     return simple_instruction("OP_MULTIPLY", offset);
   case OP_DIVIDE:
     return simple_instruction("OP_DIVIDE", offset);
+  case OP_NOT:
+    return simple_instruction("OP_NOT", offset);
   case OP_NEGATE:
     return simple_instruction("OP_NEGATE", offset);
   case OP_RETURN:
     return simple_instruction("OP_RETURN", offset);
+  case OP_ADD_CONSTANT:
+    return constant_instruction("OP_ADD_CONSTANT", chunk, offset);
+  case OP_SUBTRACT_CONSTANT:
+    return constant_instruction("OP_SUBTRACT_CONSTANT", chunk, offset);
+  case OP_MULTIPLY_CONSTANT:
+    return constant_instruction("OP_MULTIPLY_CONSTANT", chunk, offset);
+  case OP_DIVIDE_CONSTANT:
+    return constant_instruction("OP_DIVIDE_CONSTANT", chunk, offset);
+  case OP_NOT_EQUAL:
+    return simple_instruction("OP_NOT_EQUAL", offset);
+  case OP_GREATER_EQUAL:
+    return simple_instruction("OP_GREATER_EQUAL", offset);
+  case OP_LESS_EQUAL:
+    return simple_instruction("OP_LESS_EQUAL", offset);
   default:
     printf("Unknown OpCode %d\n", instruction);
     return offset + 1;
@@ -182,6 +554,119 @@ static int constant_instruction(const char* name, Chunk* chunk, int offset) {
   return offset + 2;
 }
 
+static int constant_long_instruction(const char* name, Chunk* chunk, int offset) {
+  uint8_t* operand = &chunk->code[offset + 1];
+  int constant = operand[0] | (operand[1] << 8) | (operand[2] << 16);
+  printf("%-16s %4d '", name, constant);
+  print_value(chunk->constants.values[constant]);
+  printf("'\n");
+  return offset + 4;
+}
+
+// -- OPTIMIZER
+
+int instruction_length(uint8_t instruction) {
+  switch (instruction) {
+  case OP_CONSTANT:
+  case OP_ADD_CONSTANT:
+  case OP_SUBTRACT_CONSTANT:
+  case OP_MULTIPLY_CONSTANT:
+  case OP_DIVIDE_CONSTANT:
+    return 2;
+  case OP_CONSTANT_LONG:
+    return 4;
+  default:
+    return 1;
+  }
+}
+
+/* the superinstruction for OP_CONSTANT followed by `instruction`, -1 if there's none */
+static int constant_form(uint8_t instruction) {
+  switch (instruction) {
+  case OP_ADD:      return OP_ADD_CONSTANT;
+  case OP_SUBTRACT: return OP_SUBTRACT_CONSTANT;
+  case OP_MULTIPLY: return OP_MULTIPLY_CONSTANT;
+  case OP_DIVIDE:   return OP_DIVIDE_CONSTANT;
+  default:          return -1;
+  }
+}
+
+/* the superinstruction for `instruction` followed by OP_NOT, -1 if there's none */
+static int negated_form(uint8_t instruction) {
+  switch (instruction) {
+  case OP_EQUAL:   return OP_NOT_EQUAL;
+  case OP_LESS:    return OP_GREATER_EQUAL;
+  case OP_GREATER: return OP_LESS_EQUAL;
+  default:         return -1;
+  }
+}
+
+/*
+ * A peephole pass over a finished chunk: pairs of instructions that always run
+ * together are rewritten in place into one superinstruction, saving a dispatch
+ * and (for the constant forms) a push and a pop. A fused instruction keeps the
+ * line of the pair's second instruction, where its runtime errors came from, so
+ * the line table is rebuilt as it goes.
+ *
+ * Offsets move, which is fine as long as nothing jumps.
+ */
+void optimize_chunk(Chunk* chunk) {
+#ifdef DEBUG_PRINT_CODE
+  disassemble_chunk(chunk, "before peephole");
+#endif
+
+  uint8_t* code = chunk->code;
+  LineStart* lines = chunk->lines;
+  int line_count = chunk->line_count;
+  int line_capacity = chunk->line_capacity;
+  chunk->lines = NULL;
+  chunk->line_count = 0;
+  chunk->line_capacity = 0;
+
+  int out = 0;
+  for (int in = 0; in < chunk->count;) {
+    int length = instruction_length(code[in]);
+    int next = in + length;
+
+    if (next < chunk->count) {
+      // only numbers, OP_ADD of a string constant still has to concatenate
+      int fused = code[in] == OP_CONSTANT && IS_NUMBER(chunk->constants.values[code[in + 1]])
+        ? constant_form(code[next])
+        : -1;
+      if (fused != -1) {
+        code[out] = (uint8_t)fused;
+        code[out + 1] = code[in + 1];
+        add_line(chunk, out, find_line(lines, line_count, next));
+        out += 2;
+        in = next + 1;
+        continue;
+      }
+
+      fused = code[next] == OP_NOT ? negated_form(code[in]) : -1;
+      if (fused != -1) {
+        code[out] = (uint8_t)fused;
+        add_line(chunk, out, find_line(lines, line_count, next));
+        out += 1;
+        in = next + 1;
+        continue;
+      }
+    }
+
+    for (int i = 0; i < length; i++) {
+      add_line(chunk, out + i, find_line(lines, line_count, in + i));
+    }
+    memmove(code + out, code + in, length);
+    out += length;
+    in = next;
+  }
+  chunk->count = out;
+  FREE_ARRAY(LineStart, lines, line_capacity);
+
+#ifdef DEBUG_PRINT_CODE
+  disassemble_chunk(chunk, "after peephole");
+#endif
+}
+
 // -- VM
 
 typedef enum {
@@ -195,70 +680,229 @@ typedef struct {
   uint8_t* ip;
   Value stack[STACK_MAX];
   Value* stack_top;
+  Value result;  // what the last OP_RETURN popped
 } VM;
 
 VM vm;
 
-void push(Value value);
-Value pop();
-
 static void reset_stack() {
   vm.stack_top = vm.stack;
 }
 
+static void runtime_error(const char* message, uint8_t* ip) {
+  size_t instruction = ip - vm.chunk->code - 1;
+  fprintf(stderr, "%s\n[line %d] in script\n", message, get_line(vm.chunk, (int)instruction));
+  reset_stack();
+}
+
+static bool is_falsey(Value value) {
+  return IS_NIL(value) || (IS_BOOL(value) && !AS_BOOL(value));
+}
+
+/* a and b stay on the stack until the result replaces them, allocating may collect */
+static Value concatenate(ObjString* a, ObjString* b) {
+  ObjString* result = allocate_string(a->length + b->length);
+  memcpy(result->chars, a->chars, a->length);
+  memcpy(result->chars + a->length, b->chars, b->length);
+  return OBJ_VAL((Obj*)result);
+}
+
+#ifdef DEBUG_TRACE_EXECUTION
+static void trace_instruction(uint8_t* ip, Value* stack_top) {
+  printf("          ");
+  for (Value* slot = vm.stack; slot < stack_top; slot++) {
+    printf("[ ");
+    print_value(*slot);
+    printf(" ]");
+  }
+  printf("\n");
+  disassemble_instruction(vm.chunk, (int)(ip - vm.chunk->code));
+}
+#endif
+
+/*
+ * ip and stack_top live in locals while running so the compiler can keep them in
+ * registers, they're written back to the vm before returning and before anything
+ * that allocates (the gc finds its roots on vm's stack). Nothing called from here
+ * may use push() or pop().
+ *
+ * With computed goto (GCC, Clang) every instruction ends by jumping straight to the
+ * next one's handler, each of those jumps is predicted on its own rather than all
+ * of them going through the switch's single indirect jump.
+ */
 static InterpretResult run() {
-#define READ_BYTE()   (*vm.ip++)
-#define READ_CONSTANT() (vm.chunk->constants.values[READ_BYTE()])
-#define BINARY_OP(op) \
+  uint8_t* ip = vm.ip;
+  Value* stack_top = vm.stack_top;
+  Value* constants = vm.chunk->constants.values;
+
+#define READ_BYTE()     (*ip++)
+#define READ_CONSTANT() (constants[READ_BYTE()])
+#define READ_CONSTANT_LONG() \
+  (ip += 3, constants[ip[-3] | (ip[-2] << 8) | (ip[-1] << 16)])
+#define PUSH(value)     (*stack_top++ = (value))
+#define POP()           (*--stack_top)
+#define RUNTIME_ERROR(message) \
   do { \
-    double b = pop(); \
-    double a = pop(); \
-    push(a op b);     \
+    runtime_error(message, ip); \
+    return INTERPRET_RUNTIME_ERROR; \
+  } while (false)
+#define BINARY_OP(value_type, op) \
+  do { \
+    if (!IS_NUMBER(stack_top[-1]) || !IS_NUMBER(stack_top[-2])) { \
+      RUNTIME_ERROR("Operands must be numbers."); \
+    } \
+    double b = AS_NUMBER(POP()); \
+    stack_top[-1] = value_type(AS_NUMBER(stack_top[-1]) op b); \
+  } while (false)
+#define NOT_BOOL_VAL(b) BOOL_VAL(!(b))
+#define BINARY_CONSTANT_OP(op, message) \
+  do { \
+    double b = AS_NUMBER(READ_CONSTANT()); \
+    if (!IS_NUMBER(stack_top[-1])) { \
+      RUNTIME_ERROR(message); \
+    } \
+    stack_top[-1] = NUMBER_VAL(AS_NUMBER(stack_top[-1]) op b); \
   } while (false)
 
-  for (;;) {
 #ifdef DEBUG_TRACE_EXECUTION
-    printf("          ");
-    for (Value* slot = vm.stack; slot < vm.stack_top; slot++) {
-      printf("[ ");
-      print_value(*slot);
-      printf(" ]");
-    }
-    printf("\n");
-    disassemble_instruction(vm.chunk, (int)(vm.ip - vm.chunk->code));
+#define TRACE_INSTRUCTION() trace_instruction(ip, stack_top)
+#else
+#define TRACE_INSTRUCTION() ((void)0)
 #endif
 
-    uint8_t instruction;
-    switch (instruction = READ_BYTE()) {
-    case OP_CONSTANT: {
-      Value constant = READ_CONSTANT();
-      push(constant);
-      break;
+#ifdef CLOX_THREADED_DISPATCH
+  static void* dispatch_table[] = {
+    [OP_CONSTANT] = &&op_OP_CONSTANT,
+    [OP_CONSTANT_LONG] = &&op_OP_CONSTANT_LONG,
+    [OP_NIL]      = &&op_OP_NIL,
+    [OP_TRUE]     = &&op_OP_TRUE,
+    [OP_FALSE]    = &&op_OP_FALSE,
+    [OP_EQUAL]    = &&op_OP_EQUAL,
+    [OP_GREATER]  = &&op_OP_GREATER,
+    [OP_LESS]     = &&op_OP_LESS,
+    [OP_ADD]      = &&op_OP_ADD,
+    [OP_SUBTRACT] = &&op_OP_SUBTRACT,
+    [OP_MULTIPLY] = &&op_OP_MULTIPLY,
+    [OP_DIVIDE]   = &&op_OP_DIVIDE,
+    [OP_NOT]      = &&op_OP_NOT,
+    [OP_NEGATE]   = &&op_OP_NEGATE,
+    [OP_RETURN]   = &&op_OP_RETURN,
+    [OP_ADD_CONSTANT]      = &&op_OP_ADD_CONSTANT,
+    [OP_SUBTRACT_CONSTANT] = &&op_OP_SUBTRACT_CONSTANT,
+    [OP_MULTIPLY_CONSTANT] = &&op_OP_MULTIPLY_CONSTANT,
+    [OP_DIVIDE_CONSTANT]   = &&op_OP_DIVIDE_CONSTANT,
+    [OP_NOT_EQUAL]         = &&op_OP_NOT_EQUAL,
+    [OP_GREATER_EQUAL]     = &&op_OP_GREATER_EQUAL,
+    [OP_LESS_EQUAL]        = &&op_OP_LESS_EQUAL,
+  };
+#define CASE(opcode) op_##opcode
+#define DISPATCH() \
+  do { \
+    TRACE_INSTRUCTION(); \
+    goto *dispatch_table[READ_BYTE()]; \
+  } while (false)
+
+  DISPATCH();
+#else
+#define CASE(opcode) case opcode
+#define DISPATCH() break
+
+  for (;;) {
+    TRACE_INSTRUCTION();
+    switch (READ_BYTE()) {
+#endif
+
+    CASE(OP_CONSTANT): {
+      PUSH(READ_CONSTANT());
+      DISPATCH();
+    }
+    CASE(OP_CONSTANT_LONG): {
+      PUSH(READ_CONSTANT_LONG());
+      DISPATCH();
     }
-    case OP_ADD:      BINARY_OP(+); break;
-    case OP_SUBTRACT: BINARY_OP(-); break;
-    case OP_MULTIPLY: BINARY_OP(*); break;
-    case OP_DIVIDE:   BINARY_OP(/); break;
+    CASE(OP_NIL):   PUSH(NIL_VAL); DISPATCH();
+    CASE(OP_TRUE):  PUSH(TRUE_VAL); DISPATCH();
+    CASE(OP_FALSE): PUSH(FALSE_VAL); DISPATCH();
 
-    case OP_NEGATE:
-      push(-pop());
-      break;
+    CASE(OP_EQUAL): {
+      Value b = POP();
+      stack_top[-1] = BOOL_VAL(values_equal(stack_top[-1], b));
+      DISPATCH();
+    }
+    CASE(OP_GREATER): BINARY_OP(BOOL_VAL, >); DISPATCH();
+    CASE(OP_LESS):    BINARY_OP(BOOL_VAL, <); DISPATCH();
 
-    case OP_RETURN: {
-      print_value(pop());
-      printf("\n");
+    CASE(OP_ADD): {
+      if (IS_STRING(stack_top[-1]) && IS_STRING(stack_top[-2])) {
+        vm.stack_top = stack_top;
+        Value result = concatenate(AS_STRING(stack_top[-2]), AS_STRING(stack_top[-1]));
+        stack_top--;
+        stack_top[-1] = result;
+      } else if (IS_NUMBER(stack_top[-1]) && IS_NUMBER(stack_top[-2])) {
+        BINARY_OP(NUMBER_VAL, +);
+      } else {
+        RUNTIME_ERROR("Operands must be two numbers or two strings.");
+      }
+      DISPATCH();
+    }
+    CASE(OP_SUBTRACT): BINARY_OP(NUMBER_VAL, -); DISPATCH();
+    CASE(OP_MULTIPLY): BINARY_OP(NUMBER_VAL, *); DISPATCH();
+    CASE(OP_DIVIDE):   BINARY_OP(NUMBER_VAL, /); DISPATCH();
+
+    CASE(OP_NOT):
+      stack_top[-1] = BOOL_VAL(is_falsey(stack_top[-1]));
+      DISPATCH();
+
+    CASE(OP_NEGATE):
+      if (!IS_NUMBER(stack_top[-1])) {
+        RUNTIME_ERROR("Operand must be a number.");
+      }
+      stack_top[-1] = NUMBER_VAL(-AS_NUMBER(stack_top[-1]));
+      DISPATCH();
+
+    CASE(OP_RETURN): {
+      vm.result = POP();
+      vm.ip = ip;
+      vm.stack_top = stack_top;
       return INTERPRET_OK;
     }
 
+    CASE(OP_ADD_CONSTANT):      BINARY_CONSTANT_OP(+, "Operands must be two numbers or two strings."); DISPATCH();
+    CASE(OP_SUBTRACT_CONSTANT): BINARY_CONSTANT_OP(-, "Operands must be numbers."); DISPATCH();
+    CASE(OP_MULTIPLY_CONSTANT): BINARY_CONSTANT_OP(*, "Operands must be numbers."); DISPATCH();
+    CASE(OP_DIVIDE_CONSTANT):   BINARY_CONSTANT_OP(/, "Operands must be numbers."); DISPATCH();
+
+    CASE(OP_NOT_EQUAL): {
+      Value b = POP();
+      stack_top[-1] = BOOL_VAL(!values_equal(stack_top[-1], b));
+      DISPATCH();
+    }
+    // negated rather than >= and <=, so a NaN compares the way the unfused pair did
+    CASE(OP_GREATER_EQUAL): BINARY_OP(NOT_BOOL_VAL, <); DISPATCH();
+    CASE(OP_LESS_EQUAL):    BINARY_OP(NOT_BOOL_VAL, >); DISPATCH();
+
+#ifndef CLOX_THREADED_DISPATCH
     }
   }
+#endif
+
 #undef READ_BYTE
 #undef READ_CONSTANT
+#undef READ_CONSTANT_LONG
+#undef PUSH
+#undef POP
+#undef RUNTIME_ERROR
 #undef BINARY_OP
+#undef BINARY_CONSTANT_OP
+#undef NOT_BOOL_VAL
+#undef TRACE_INSTRUCTION
+#undef CASE
+#undef DISPATCH
 }
 
 void init_vm() {
   reset_stack();
+  vm.result = NIL_VAL;
 }
 
 InterpretResult interpret(Chunk* chunk) {
@@ -277,8 +921,134 @@ Value pop() {
   return *vm.stack_top;
 }
 
-void free_vm() {}
+// -- GC
+
+/*
+ * Mark-sweep: marks everything reachable from the roots (the stack, the last
+ * result and the constants of every live chunk), then frees the rest. Marked
+ * objects wait on the gray stack until what they reference is marked too, so
+ * deep structures don't recurse.
+ */
+static void mark_object(Obj* object) {
+  if (object == NULL || object->is_marked) {
+    return;
+  }
+  object->is_marked = true;
+
+  if (gc.gray_capacity < gc.gray_count + 1) {
+    gc.gray_capacity = GROW_CAPACITY(gc.gray_capacity);
+    // not reallocate(), growing the gray stack mustn't start another collection
+    gc.gray_stack = (Obj**)realloc(gc.gray_stack, sizeof(Obj*) * gc.gray_capacity);
+    if (gc.gray_stack == NULL) {
+      exit(1);
+    }
+  }
+  gc.gray_stack[gc.gray_count++] = object;
+}
+
+static void mark_value(Value value) {
+  if (IS_OBJ(value)) {
+    mark_object(AS_OBJ(value));
+  }
+}
+
+static void mark_roots() {
+  for (Value* slot = vm.stack; slot < vm.stack_top; slot++) {
+    mark_value(*slot);
+  }
+  mark_value(vm.result);
+  for (Chunk* chunk = gc.chunks; chunk != NULL; chunk = chunk->next) {
+    for (int i = 0; i < chunk->constants.count; i++) {
+      mark_value(chunk->constants.values[i]);
+    }
+  }
+}
+
+static void blacken_object(Obj* object) {
+  switch (object->type) {
+  case OBJ_STRING:
+    break;  // references nothing
+  }
+}
+
+static void trace_references() {
+  while (gc.gray_count > 0) {
+    blacken_object(gc.gray_stack[--gc.gray_count]);
+  }
+}
+
+static void sweep() {
+  Obj** link = &gc.objects;
+  while (*link != NULL) {
+    Obj* object = *link;
+    if (object->is_marked) {
+      object->is_marked = false;
+      link = &object->next;
+    } else {
+      *link = object->next;
+      free_object(object);
+    }
+  }
+}
+
+static double gc_now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec * 1e3) + (ts.tv_nsec / 1e6);
+}
+
+void collect_garbage() {
+  double start = gc_now_ms();
+  size_t before = gc.bytes_allocated;
+
+  mark_roots();
+  trace_references();
+  sweep();
+
+  gc.next_gc = gc.bytes_allocated * GC_HEAP_GROW_FACTOR;
+  if (gc.next_gc < GC_FIRST_COLLECTION) {
+    gc.next_gc = GC_FIRST_COLLECTION;
+  }
 
+  double pause = gc_now_ms() - start;
+  gc.collections++;
+  gc.total_pause_ms += pause;
+  gc.last_pause_ms = pause;
+  gc.max_pause_ms = pause > gc.max_pause_ms ? pause : gc.max_pause_ms;
+  gc.bytes_freed += before - gc.bytes_allocated;
+
+#ifdef DEBUG_LOG_GC
+  printf("-- gc collected %zu bytes (from %zu to %zu) next at %zu, paused %.3f ms\n",
+         before - gc.bytes_allocated, before, gc.bytes_allocated, gc.next_gc, pause);
+#endif
+}
+
+void print_gc_stats() {
+  printf("gc: %d collections, paused %.3f ms (mean %.3f ms, max %.3f ms), freed %zu bytes, %zu in use\n",
+         gc.collections, gc.total_pause_ms, gc.collections ? gc.total_pause_ms / gc.collections : 0.0,
+         gc.max_pause_ms, gc.bytes_freed, gc.bytes_allocated);
+}
+
+static void free_objects() {
+  Obj* object = gc.objects;
+  while (object != NULL) {
+    Obj* next = object->next;
+    free_object(object);
+    object = next;
+  }
+  gc.objects = NULL;
+
+  free(gc.gray_stack);
+  gc.gray_stack = NULL;
+  gc.gray_count = 0;
+  gc.gray_capacity = 0;
+}
+
+void free_vm() {
+  free_objects();
+}
+
+#ifndef CLOX_NO_MAIN
 static void repl() {
   char line[1024];
   for (;;) {
@@ -289,7 +1059,8 @@ static void repl() {
       break;
     }
 
-    interpret(line);
+    // interpret takes a chunk, there's no compiler to make one from source yet
+    fprintf(stderr, "clox can't compile source yet.\n");
   }
 }
 
@@ -309,6 +1080,10 @@ int main(int argc, const char* argv[]) {
     exit(64);
   }
 
+#ifdef DEBUG_LOG_GC
+  print_gc_stats();
+#endif
   free_vm();
   return 0;
 }
+#endif
@@ -1,28 +1,64 @@
+#ifndef __EDITOR_H__
+#define __EDITOR_H__
+
 #include <time.h>
 
 #include "base.h"
+#include "rope.h"
 
 typedef struct Status {
   bool is_ok;
   String8 err;
 } Status;
 
+typedef struct Buffer Buffer;
+
 typedef struct Editor {
   Buffer *buffer_chain;
   Buffer *current_buffer;
 } Editor;
 
+/*
+  On an insert right at a mark's location MARK_FIXED marks stay where they
+  are (before the inserted text) and MARK_NORMAL marks move with the text
+  (after the inserted text).
+*/
 typedef enum MarkType {
   MARK_FIXED,
   MARK_NORMAL,
 } MarkType;
 
-typedef struct Mark Mark;
-struct Mark {
-  Mark *next_mark;
-  i32 location;
+typedef struct Mark {
+  i32 id;
+  i32 location;  // see MarkList on how to read this
   MarkType type;
-};
+} Mark;
+
+/*
+  Marks are kept sorted by location (FIXED before NORMAL on ties) in a gap
+  array. Marks before the gap store their location, marks after the gap
+  store their distance to the end of the text.
+
+  An edit first moves the gap to the edit location, which only touches the
+  marks between the previous edit and this one, and after that marks need
+  no updating: the ones before the edit don't move and the ones after it
+  keep their distance to the end of the text. For the usual editing pattern
+  (edits close to each other) that's O(1) per edit instead of walking every
+  mark. It is not sublinear in general: edits alternating between the start
+  and the end of the text move every mark across the gap each time.
+
+  Marks are referenced by id, `slots` maps ids to their index in `marks`.
+*/
+typedef struct MarkList {
+  Mark *marks;
+  i32 gap_start;
+  i32 gap_end;
+  i32 capacity;
+  i32 *slots;       // id -> index into marks, -1 for removed marks
+  i32 slot_count;
+  i32 slot_capacity;
+  i32 text_length;  // used to convert end relative locations
+} MarkList;
 
 typedef struct EditorMode EditorMode;
 struct EditorMode {
@@ -31,7 +67,26 @@ struct EditorMode {
   Status (*add_proc)();
 };
 
-typedef struct Buffer Buffer;
+/*
+  The text before an edit, kept to undo it. A snapshot is O(1) and shares
+  every node the edit didn't touch with the text after it.
+*/
+typedef struct UndoStep {
+  Rope contents;
+  i32 point;       // before the edit
+  i32 location;    // of the edit, to move the marks back
+  i32 length;
+  bool is_insert;
+} UndoStep;
+
+#define UNDO_INITIAL_CAPACITY 64
+
+/*
+  `point`, `current_line`, `char_count` and `line_count` are kept up to date
+  on every edit. Line lookups go through the rope's per node newline counts,
+  so moving the point, going to a line or finding the line of a mark is
+  O(log n) rather than a rescan of the text.
+*/
 struct Buffer {
   Buffer *next_buffer;
   Buffer *prev_buffer;
@@ -40,9 +95,356 @@ struct Buffer {
   i32 current_line;
   i32 char_count;
   i32 line_count;
-  Mark *mark_list;
-  GapBuffer *contents;
+  MarkList marks;
+  Rope contents;        // current text, edits replace the root
+  UndoStep *undo_list;  // oldest first
+  i32 undo_count;
+  i32 undo_capacity;
   time_t last_sync;
   bool is_modified;
   EditorMode *mode_list;
 };
+
+MarkList mark_list_create();
+void     mark_list_destroy(MarkList *ml);
+i32      mark_list_count(MarkList *ml);
+i32      mark_add(MarkList *ml, i32 location, MarkType type);
+void     mark_remove(MarkList *ml, i32 id);
+i32      mark_get(MarkList *ml, i32 id);
+void     mark_set(MarkList *ml, i32 id, i32 location);
+void     mark_list_insert(MarkList *ml, i32 location, i32 length);
+void     mark_list_delete(MarkList *ml, i32 location, i32 length);
+
+Buffer editor_buffer_create(String8 name, Rope contents);
+void   editor_buffer_destroy(Buffer *b);
+void   editor_buffer_set_point(Buffer *b, i32 point);
+void   editor_buffer_goto_line(Buffer *b, i32 line);
+i32    editor_buffer_column(Buffer *b);
+i32    editor_buffer_mark_line(Buffer *b, i32 mark_id);
+void   editor_buffer_insert(Buffer *b, String8 s);
+void   editor_buffer_delete(Buffer *b, i32 count);
+bool   editor_buffer_undo(Buffer *b);
+
+i32  __mark_location(MarkList *ml, i32 index);
+bool __mark_before(Mark *m, i32 location, bool include_normal);
+void __mark_list_move_gap(MarkList *ml, i32 location, bool include_normal);
+void __mark_list_place(MarkList *ml, i32 id, i32 location, MarkType type);
+void __editor_buffer_push_undo(Buffer *b, i32 location, i32 length, bool is_insert);
+void __editor_buffer_count(Buffer *b);
+
+/* --- marks --- */
+
+#define MARK_LIST_INITIAL_CAPACITY 16
+
+MarkList mark_list_create() {
+  MarkList ml = {
+    .marks = NEW(Mark, MARK_LIST_INITIAL_CAPACITY * sizeof(Mark)),
+    .gap_start = 0,
+    .gap_end = MARK_LIST_INITIAL_CAPACITY,
+    .capacity = MARK_LIST_INITIAL_CAPACITY,
+    .slots = NEW(i32, MARK_LIST_INITIAL_CAPACITY * sizeof(i32)),
+    .slot_count = 0,
+    .slot_capacity = MARK_LIST_INITIAL_CAPACITY,
+    .text_length = 0,
+  };
+  assert(ml.marks != NULL && ml.slots != NULL);
+  return ml;
+}
+
+void mark_list_destroy(MarkList *ml) {
+  DELETE(ml->marks);
+  DELETE(ml->slots);
+  ml->capacity = 0;
+  ml->slot_capacity = 0;
+}
+
+i32 mark_list_count(MarkList *ml) {
+  return ml->capacity - (ml->gap_end - ml->gap_start);
+}
+
+/* adds a mark at `location` and returns its id */
+i32 mark_add(MarkList *ml, i32 location, MarkType type) {
+  if (ml->slot_count == ml->slot_capacity) {
+    ml->slot_capacity *= 2;
+    ml->slots = RESIZE(i32, ml->slots, ml->slot_capacity * sizeof(i32));
+    assert(ml->slots != NULL);
+  }
+
+  i32 id = ml->slot_count++;
+  __mark_list_place(ml, id, location, type);
+  return id;
+}
+
+void mark_remove(MarkList *ml, i32 id) {
+  i32 index = ml->slots[id];
+  if (index < 0) {
+    return;
+  }
+
+  // move the gap after the mark (and any marks sharing its location),
+  // then shift those marks over it
+  __mark_list_move_gap(ml, __mark_location(ml, index), true);
+  for (i32 i = ml->slots[id]; i < ml->gap_start - 1; i++) {
+    ml->marks[i] = ml->marks[i + 1];
+    ml->slots[ml->marks[i].id] = i;
+  }
+
+  ml->gap_start--;
+  ml->slots[id] = -1;
+}
+
+/* returns the location of mark `id` */
+i32 mark_get(MarkList *ml, i32 id) {
+  assert(ml->slots[id] >= 0);
+  return __mark_location(ml, ml->slots[id]);
+}
+
+/* moves mark `id` (not removed) to `location`, keeping its type */
+void mark_set(MarkList *ml, i32 id, i32 location) {
+  assert(ml->slots[id] >= 0);
+  MarkType type = ml->marks[ml->slots[id]].type;
+  mark_remove(ml, id);
+  __mark_list_place(ml, id, location, type);
+}
+
+/* updates marks for `length` bytes inserted at `location` */
+void mark_list_insert(MarkList *ml, i32 location, i32 length) {
+  __mark_list_move_gap(ml, location, false);
+  ml->text_length += length;
+}
+
+/* updates marks for `length` bytes deleted at `location` */
+void mark_list_delete(MarkList *ml, i32 location, i32 length) {
+  i32 end = location + length;
+  __mark_list_move_gap(ml, end, true);
+
+  // marks inside the deleted range collapse to its start
+  i32 run = ml->gap_start;
+  while (run > 0 && ml->marks[run - 1].location >= location) {
+    run--;
+    ml->marks[run].location = location;
+  }
+
+  // keep FIXED before NORMAL for the marks now sharing `location`
+  for (i32 i = run + 1; i < ml->gap_start; i++) {
+    Mark m = ml->marks[i];
+    i32 j = i;
+    while (j > run && m.type == MARK_FIXED && ml->marks[j - 1].type == MARK_NORMAL) {
+      ml->marks[j] = ml->marks[j - 1];
+      ml->slots[ml->marks[j].id] = j;
+      j--;
+    }
+    ml->marks[j] = m;
+    ml->slots[m.id] = j;
+  }
+
+  ml->text_length -= length;
+}
+
+i32 __mark_location(MarkList *ml, i32 index) {
+  if (index < ml->gap_start) {
+    return ml->marks[index].location;
+  }
+  return ml->text_length - ml->marks[index].location;
+}
+
+/* whether `m` belongs before the gap when the gap is at `location` */
+bool __mark_before(Mark *m, i32 location, bool include_normal) {
+  return m->location < location ||
+         (m->location == location && (include_normal || m->type == MARK_FIXED));
+}
+
+/*
+ * Moves the gap to the position where marks before `location` (and at
+ * `location`, FIXED ones only unless `include_normal`) are before it.
+ */
+void __mark_list_move_gap(MarkList *ml, i32 location, bool include_normal) {
+  // marks before the gap that belong after it
+  while (ml->gap_start > 0) {
+    Mark m = ml->marks[ml->gap_start - 1];
+    if (__mark_before(&m, location, include_normal)) break;
+
+    m.location = ml->text_length - m.location;
+    ml->marks[--ml->gap_end] = m;
+    ml->slots[m.id] = ml->gap_end;
+    ml->gap_start--;
+  }
+
+  // marks after the gap that belong before it
+  while (ml->gap_end < ml->capacity) {
+    Mark m = ml->marks[ml->gap_end];
+    m.location = ml->text_length - m.location;
+    if (!__mark_before(&m, location, include_normal)) break;
+
+    ml->marks[ml->gap_start] = m;
+    ml->slots[m.id] = ml->gap_start;
+    ml->gap_start++;
+    ml->gap_end++;
+  }
+}
+
+/* inserts mark `id` in its sorted position */
+void __mark_list_place(MarkList *ml, i32 id, i32 location, MarkType type) {
+  if (location < 0) location = 0;
+  if (location > ml->text_length) location = ml->text_length;
+
+  if (ml->gap_start == ml->gap_end) {
+    // grow, moving the marks after the gap to the end of the new array
+    i32 after = ml->capacity - ml->gap_end;
+    i32 new_capacity = ml->capacity * 2;
+    ml->marks = RESIZE(Mark, ml->marks, new_capacity * sizeof(Mark));
+    assert(ml->marks != NULL);
+    memmove(ml->marks + new_capacity - after, ml->marks + ml->gap_end, after * sizeof(Mark));
+
+    ml->gap_end = new_capacity - after;
+    ml->capacity = new_capacity;
+    for (i32 i = ml->gap_end; i < ml->capacity; i++) {
+      ml->slots[ml->marks[i].id] = i;
+    }
+  }
+
+  __mark_list_move_gap(ml, location, type == MARK_NORMAL);
+  ml->marks[ml->gap_start] = (Mark){ .id = id, .location = location, .type = type };
+  ml->slots[id] = ml->gap_start;
+  ml->gap_start++;
+}
+
+/* --- buffers --- */
+
+Buffer editor_buffer_create(String8 name, Rope contents) {
+  Buffer b = {
+    .next_buffer = NULL,
+    .prev_buffer = NULL,
+    .name = name,
+    .point = 0,
+    .current_line = 0,
+    .char_count = (i32)rope_length(&contents),
+    .line_count = (i32)rope_line_count(&contents),
+    .marks = mark_list_create(),
+    .contents = contents,
+    .undo_list = NULL,
+    .undo_count = 0,
+    .undo_capacity = 0,
+    .last_sync = time(NULL),
+    .is_modified = false,
+    .mode_list = NULL,
+  };
+  b.marks.text_length = b.char_count;
+  return b;
+}
+
+void editor_buffer_destroy(Buffer *b) {
+  for (i32 i = 0; i < b->undo_count; i++) {
+    rope_destroy(&(b->undo_list[i].contents));
+  }
+  DELETE(b->undo_list);
+  b->undo_count = 0;
+  b->undo_capacity = 0;
+  rope_destroy(&(b->contents));
+  mark_list_destroy(&(b->marks));
+}
+
+void editor_buffer_set_point(Buffer *b, i32 point) {
+  if (point < 0) point = 0;
+  if (point > b->char_count) point = b->char_count;
+
+  b->point = point;
+  b->current_line = (i32)rope_line_of(&(b->contents), point);
+}
+
+void editor_buffer_goto_line(Buffer *b, i32 line) {
+  if (line < 0) line = 0;
+  if (line >= b->line_count) line = b->line_count - 1;
+
+  b->point = (i32)rope_line_start(&(b->contents), line);
+  b->current_line = line;
+}
+
+i32 editor_buffer_column(Buffer *b) {
+  return b->point - (i32)rope_line_start(&(b->contents), b->current_line);
+}
+
+/* returns the line of the mark, i.e. to map it to a screen row */
+i32 editor_buffer_mark_line(Buffer *b, i32 mark_id) {
+  return (i32)rope_line_of(&(b->contents), mark_get(&(b->marks), mark_id));
+}
+
+/* inserts `s` at the point, leaving the point after it */
+void editor_buffer_insert(Buffer *b, String8 s) {
+  if (s.length == 0) {
+    return;
+  }
+
+  __editor_buffer_push_undo(b, b->point, (i32)s.length, true);
+  i32 newlines = (i32)__rope_count_newlines(s.data, s.length);
+  rope_insert(&(b->contents), b->point, s);
+  mark_list_insert(&(b->marks), b->point, (i32)s.length);
+
+  b->point += s.length;
+  b->char_count += s.length;
+  b->current_line += newlines;
+  b->line_count += newlines;
+  b->is_modified = true;
+}
+
+/* deletes `count` chars after the point */
+void editor_buffer_delete(Buffer *b, i32 count) {
+  count = MIN(count, b->char_count - b->point);
+  if (count <= 0) {
+    return;
+  }
+
+  __editor_buffer_push_undo(b, b->point, count, false);
+  i32 newlines = (i32)(rope_line_of(&(b->contents), b->point + count) - b->current_line);
+  rope_delete(&(b->contents), b->point, count);
+  mark_list_delete(&(b->marks), b->point, count);
+
+  b->char_count -= count;
+  b->line_count -= newlines;
+  b->is_modified = true;
+}
+
+/* reverts the last edit, returns false when there's none left */
+bool editor_buffer_undo(Buffer *b) {
+  if (b->undo_count == 0) {
+    return false;
+  }
+
+  UndoStep *step = &(b->undo_list[--b->undo_count]);
+  rope_destroy(&(b->contents));
+  b->contents = step->contents;
+  if (step->is_insert) {
+    mark_list_delete(&(b->marks), step->location, step->length);
+  } else {
+    mark_list_insert(&(b->marks), step->location, step->length);
+  }
+
+  __editor_buffer_count(b);
+  editor_buffer_set_point(b, step->point);
+  b->is_modified = true;
+  return true;
+}
+
+/* snapshots the text before an edit */
+void __editor_buffer_push_undo(Buffer *b, i32 location, i32 length, bool is_insert) {
+  if (b->undo_count == b->undo_capacity) {
+    b->undo_capacity = b->undo_capacity ? b->undo_capacity * 2 : UNDO_INITIAL_CAPACITY;
+    b->undo_list = RESIZE(UndoStep, b->undo_list, b->undo_capacity * sizeof(UndoStep));
+    assert(b->undo_list != NULL);
+  }
+
+  b->undo_list[b->undo_count++] = (UndoStep){
+    .contents = rope_snapshot(&(b->contents)),
+    .point = b->point,
+    .location = location,
+    .length = length,
+    .is_insert = is_insert,
+  };
+}
+
+void __editor_buffer_count(Buffer *b) {
+  b->char_count = (i32)rope_length(&(b->contents));
+  b->line_count = (i32)rope_line_count(&(b->contents));
+}
+
+#endif
@@ -4,8 +4,14 @@
 
 #include "base.h"
 #include "draw.h"
+#include "file.h"
 #include "font.h"
+#include "hud.h"
+#include "rope.h"
 #include "runtime-sdl.c"
+#include "view.h"
+
+#define INDEX_STEP_BYTES (8 * MB)  // newlines counted per frame while a file is being indexed
 
 typedef struct Theme {
   Color background;
@@ -35,16 +41,21 @@ typedef struct DisplayManager {
 } DisplayManager;
 
 typedef struct Buffer {
-  char **lines;
-  i32 length;
-  i32 capacity;
-  Point position;
+  Rope text;
+  MappedFile file;  // original (read-only) text when opened from a file
+  Point position;  // x is the column, y is the line
   bool has_changed;
 } Buffer;
 
-Buffer *buffer_create();
-Buffer *buffer_create_from_string(char *s, i32 len);
-void buffer_add_line(Buffer *b, char *line);
+Buffer buffer_create();
+Buffer buffer_create_from_string(String8 s);
+Buffer buffer_create_from_file(String8 filepath);
+void buffer_destroy(Buffer *b);
+void buffer_insert(Buffer *b, String8 s);
+void buffer_backspace(Buffer *b);
+u64 buffer_offset(Buffer *b);
+String8 buffer_get_line(Buffer *b, MemoryArena *arena, i32 line);
+TextSource buffer_text_source(Buffer *b);
 
 typedef struct LineEditor {
   Buffer *buffer;
@@ -53,18 +64,150 @@ typedef struct LineEditor {
 typedef struct Fooled {
   DisplayManager display;
   LineEditor editor;
+  TextView view;
 } Fooled;
 
-String8 __read_file(String8 filepath);
 Fooled __fooled_create(MemoryArena *arena, i32 width, i32 height);
 
+Buffer buffer_create() {
+  return (Buffer){ .text = rope_create(), .position = {0, 0}, .has_changed = false };
+}
+
+Buffer buffer_create_from_string(String8 s) {
+  return (Buffer){ .text = rope_from_string8(s), .position = {0, 0}, .has_changed = false };
+}
+
+/*
+ * Maps the file instead of reading it, the rope references the mapping
+ * directly so only edited regions are ever copied. Lines are indexed
+ * lazily, a chunk per frame, see `on_step`.
+ */
+Buffer buffer_create_from_file(String8 filepath) {
+  MappedFile file = file_map(filepath);
+  return (Buffer){
+    .text = rope_from_external(file.contents),
+    .file = file,
+    .position = {0, 0},
+    .has_changed = false,
+  };
+}
+
+void buffer_destroy(Buffer *b) {
+  // release the rope first, its leaves point into the mapping
+  rope_destroy(&(b->text));
+  if (b->file.is_mapped) {
+    file_unmap(&(b->file));
+  }
+}
+
+/* inserts `s` at the buffer's position and moves the position past it */
+void buffer_insert(Buffer *b, String8 s) {
+  rope_insert(&(b->text), buffer_offset(b), s);
+  for (u64 i=0; i < s.length; i++) {
+    if (s.data[i] == '\n') {
+      b->position.y++;
+      b->position.x = 0;
+      continue;
+    }
+    b->position.x++;
+  }
+  b->has_changed = true;
+}
+
+/* deletes the char before the buffer's position */
+void buffer_backspace(Buffer *b) {
+  u64 offset = buffer_offset(b);
+  if (offset == 0) {
+    return;
+  }
+
+  rope_delete(&(b->text), offset - 1, 1);
+  if (b->position.x > 0) {
+    b->position.x--;
+  } else {
+    b->position.y--;
+    b->position.x = (i32)(offset - 1 - rope_line_start(&(b->text), b->position.y));
+  }
+  b->has_changed = true;
+}
+
+/* text offset of the buffer's position */
+u64 buffer_offset(Buffer *b) {
+  return rope_line_start(&(b->text), b->position.y) + b->position.x;
+}
+
+/* returns a copy of `line` without its trailing newline */
+String8 buffer_get_line(Buffer *b, MemoryArena *arena, i32 line) {
+  u64 start = rope_line_start(&(b->text), line);
+  u64 end = rope_line_start(&(b->text), line + 1);
+  if (end > start && rope_get(&(b->text), end - 1) == '\n') {
+    end--;
+  }
+  return rope_to_string8(&(b->text), arena, start, end - start);
+}
+
+u64 __buffer_text_length(void *context) {
+  return rope_length(&(((Buffer *)context)->text));
+}
+
+char __buffer_text_char_at(void *context, u64 offset) {
+  return rope_get(&(((Buffer *)context)->text), offset);
+}
+
+/* the line through the rope's newline index, not a walk back over it */
+u64 __buffer_text_line_start(void *context, u64 offset) {
+  Rope *text = &(((Buffer *)context)->text);
+  return rope_line_start(text, rope_line_of(text, offset));
+}
+
+TextSource buffer_text_source(Buffer *b) {
+  return (TextSource){
+    .context = b,
+    .length = __buffer_text_length,
+    .char_at = __buffer_text_char_at,
+    .line_start = __buffer_text_line_start,
+  };
+}
+
 void on_step(Runtime *runtime) {
+  Fooled *fooled = (Fooled *)(runtime->context);
+  Buffer *buffer = fooled->editor.buffer;
+  if (!buffer) {
+    return;
+  }
+
+  // keep indexing newlines in the background, a chunk per frame
+  if (!rope_is_indexed(&(buffer->text))) {
+    rope_index_step(&(buffer->text), INDEX_STEP_BYTES);
+  }
+
+  // only the rows that changed since the last frame are laid out and drawn
+  TextSource src = buffer_text_source(buffer);
+  text_view_scroll_to(&(fooled->view), src, buffer_offset(buffer));
+  text_view_update(&(fooled->view), src, &(runtime->screen));
 }
 
 void on_text_in(Runtime *runtime, String8 s) {
+  Fooled *fooled = (Fooled *)(runtime->context);
+  Buffer *buffer = fooled->editor.buffer;
+
+  text_view_edit(&(fooled->view), buffer_offset(buffer), (i64)s.length);
+  buffer_insert(buffer, s);
 }
 
 void on_key_down(Runtime *runtime) {
+  Fooled *fooled = (Fooled *)(runtime->context);
+  Buffer *buffer = fooled->editor.buffer;
+
+  if (runtime->keyboard.keys[K_RETURN]) {
+    text_view_edit(&(fooled->view), buffer_offset(buffer), 1);
+    buffer_insert(buffer, STRING8("\n"));
+  }
+
+  if (runtime->keyboard.keys[K_BACKSPACE] && buffer_offset(buffer) > 0) {
+    text_view_edit(&(fooled->view), buffer_offset(buffer) - 1, -1);
+    buffer_backspace(buffer);
+  }
 }
 
 Fooled __fooled_create(MemoryArena *arena, i32 width, i32 height) {
@@ -83,35 +226,43 @@ Fooled __fooled_create(MemoryArena *arena, i32 width, i32 height) {
 
   char *home_env_var = getenv("HOME");
   String8 home_path = string8_from_charbuf(arena, home_env_var, strlen(home_env_var));
-  Font usr_font = font_create(arena,
+  // the display keeps pointers to these, so they live in the arena
+  Font *usr_font = arena_push(arena, sizeof(Font));
+  Font *sys_font = arena_push(arena, sizeof(Font));
+  Font *err_font = arena_push(arena, sizeof(Font));
+  Bitmap *pen = arena_push(arena, sizeof(Bitmap));
+
+  *usr_font = font_create(arena,
 			      string8_join(arena, STRING8("/"), 2, home_path, theme.usr_font_path),
                               theme.usr_font_size,
 			      theme.usr_font_size);
-  Font sys_font = font_create(arena,
+  *sys_font = font_create(arena,
 			      string8_join(arena, STRING8("/"), 2, home_path, theme.sys_font_path),
                               theme.sys_font_size,
 			      theme.sys_font_size);
-  Font err_font = font_create(arena,
+  *err_font = font_create(arena,
 			      string8_join(arena, STRING8("/"), 2, home_path, theme.err_font_path),
                               theme.err_font_size,
 			      theme.err_font_size);
-  Bitmap pen = bitmap_create(arena, 2, 2);
-  bitmap_fill(&pen, PALETTE_BLUE);
+  *pen = bitmap_create(arena, 2, 2);
+  bitmap_fill(pen, PALETTE_BLUE);
 
   DisplayManager display = {
     .theme = theme,
     .display_w = width,
     .display_h = height,
-    .usr_font = &usr_font,
-    .sys_font = &sys_font,
-    .err_font = &err_font,
-    .line_painter = &pen,
+    .usr_font = usr_font,
+    .sys_font = sys_font,
+    .err_font = err_font,
+    .line_painter = pen,
   };
 
-  LineEditor editor;
+  Rect frame = { .origin = {0, 0}, .corner = {width, height} };
+  LineEditor editor = { .buffer = NULL };
   return (Fooled){
     .display = display,
     .editor = editor,
+    .view = text_view_create(arena, usr_font, frame, theme.usr_text_color, theme.background),
   };
 }
 
@@ -127,6 +278,22 @@ int main(int argc, char *argv[]) {
 			     height,
 			     1);
   Fooled program_state = __fooled_create(arena, width, height);
+
+  Buffer *buffer = arena_push(arena, sizeof(Buffer));
+  if (argc == 2) {
+    String8 filepath = string8_from_charbuf(arena, argv[1], strlen(argv[1]));
+    *buffer = buffer_create_from_file(filepath);
+  } else {
+    *buffer = buffer_create();
+  }
+  program_state.editor.buffer = buffer;
+
+  // F3 shows the hud, the editor's own font is the one whose glyphs it counts
+  Hud hud = hud_create(arena, program_state.display.sys_font);
+  hud_track_arena(&hud, "arena", arena);
+  hud_track_font(&hud, program_state.display.usr_font);
+  runtime_attach_hud(&r, &hud);
+
   r.context = (void *)&program_state;
   r.on_step = on_step;
   r.on_text_in = on_text_in;
@@ -134,5 +301,6 @@ int main(int argc, char *argv[]) {
 
   runtime_start(&r);
   runtime_destroy(&r);
+  buffer_destroy(buffer);
   arena_destroy(arena);
 }
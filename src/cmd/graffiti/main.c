@@ -5,13 +5,17 @@
 
 */
 #include <stdbool.h>
+#include <unistd.h>
 
 #include "base.h"
 #include "draw.h"
+#include "font.h"
+#include "hud.h"
 #include "runtime-sdl.c"
 
 #define WIDTH 800
 #define HEIGHT 600
+#define HUD_FONT "fonts/ttf/JetBrainsMonoNL-Italic.ttf"  // under $HOME, like fooled's
 
 typedef struct PointList {
   Point **points;
@@ -43,12 +47,28 @@ int main(void) {
 
   Graffiti g = { .pen = pen };
 
+  // F3 shows the hud, without its font it only has the frame graph
+  Font font;
+  char *home = getenv("HOME") ? getenv("HOME") : ".";
+  String8 home_path = string8_from_charbuf(arena, home, strlen(home));
+  String8 font_path = string8_join(arena, STRING8("/"), 2, home_path, STRING8(HUD_FONT));
+  bool has_font = access(font_path.data, R_OK) == 0;
+  if (has_font) {
+    font = font_create(arena, font_path, 12, 12);
+  }
+  Hud hud = hud_create(arena, has_font ? &font : NULL);
+  hud_track_arena(&hud, "arena", arena);
+  runtime_attach_hud(&runtime, &hud);
+
   runtime.context = (void *)&g;
   runtime.on_mouse_down = on_mouse_down;
   runtime.on_mouse_motion = on_mouse_motion;
   runtime_start(&runtime);
 
   runtime_destroy(&runtime);
+  if (has_font) {
+    font_destroy(&font);
+  }
   arena_destroy(arena);
 }
 
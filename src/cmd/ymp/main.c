@@ -1,25 +1,89 @@
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <json-c/json.h>
 
 #include "base.h"
 #include "http.h"
 #include "http.c"
+#include "http_cache.h"
+#include "http_cache.c"
+#include "profile.h"
 #include "yt.h"
+#include "yt_snapshot.h"
+
+#define YMP_CACHE_MAX_AGE 300  // seconds a search result is reused for
+#define YMP_MAX_IN_FLIGHT 4    // background requests, i.e. the next page
+#define YMP_LAST_SEARCH   STRING8("/last-search.yts")  // in the cache dir, see yt_snapshot.h
+
+/* $XDG_CACHE_HOME/ymp, or ~/.cache/ymp */
+String8 cache_dir(MemoryArena *arena) {
+  char *xdg_cache = getenv("XDG_CACHE_HOME");
+  if (xdg_cache != NULL && xdg_cache[0] != '\0') {
+    String8 base = { .data = xdg_cache, .length = strlen(xdg_cache) };
+    return string8_concat(arena, base, STRING8("/ymp"));
+  }
+
+  char *home = getenv("HOME");
+  String8 base = home != NULL ? (String8){ .data = home, .length = strlen(home) } : STRING8("/tmp");
+  return string8_concat(arena, base, STRING8("/.cache/ymp"));
+}
+
+void print_video(VideoData *video, usize index, void *context) {
+  // TODO unpack this better
+  printf("%zu: %s\t%s\t%s\n", index, video->uid.data, video->length.data, video->title.data);
+  fflush(stdout);
+}
+
+/* reads a line from stdin, the next page keeps downloading while the user types */
+bool read_line(HttpAsync *async, char *line, i32 size) {
+  struct pollfd input = { .fd = STDIN_FILENO, .events = POLLIN };
+  while (poll(&input, 1, 0) == 0) {
+    if (http_async_run(async, HTTP_ASYNC_POLL_MS) == 0) {
+      poll(&input, 1, -1);  // nothing downloading, just wait for the user
+    }
+  }
+  return fgets(line, size, stdin) != NULL;
+}
 
 int main(int argc, char *argv[]) {
+  profile_init();
+  profile_thread_name("main");
+
   HttpClient client = http_client_create();
   if (!client.created) { return -1; }
 
+  MemoryArena *cache_arena = arena_create(KB);
+  String8 dir = cache_dir(cache_arena);
+  String8 last_search_path = string8_concat(cache_arena, dir, YMP_LAST_SEARCH);
+  HttpCache cache = http_cache_create(&client, dir);
+  // search responses say no-cache, reuse them for a while anyway
+  cache.ignore_cache_control = true;
+  cache.default_max_age = YMP_CACHE_MAX_AGE;
+
+  HttpAsync async = http_async_create(&client, YMP_MAX_IN_FLIGHT);
   MemoryArena *arena = arena_create(2000000);
-  YoutubeSearchResponse response;
+  YoutubeSearch search = yt_search_create(&cache, &async, arena);
+
+  // the last search is back right away, its videos are used from the mapping
+  MappedFile last_search = { .contents = { .data = NULL, .length = 0 }, .is_mapped = false };
+  if (access(last_search_path.data, R_OK) == 0) {
+    last_search = file_map(last_search_path);
+    YoutubeSnapshot snapshot = yt_snapshot_open(last_search.contents);
+    yt_search_restore(&search, &snapshot);
+    if (search.videos.count > 0) {
+      printf("%zu videos from the last search, see /play and /more.\n", search.videos.count);
+    }
+  }
 
   char line[1024];
   for (;;) {
     printf("> ");
+    fflush(stdout);
 
-    if (!fgets(line, sizeof(line), stdin)) {
+    if (!read_line(&async, line, sizeof(line))) {
       printf("\n");
       break;
     }
@@ -29,6 +93,7 @@ int main(int argc, char *argv[]) {
     if (string8_startswith(parsed, STRING8("/help"))) {
       printf("\t- /help.   this help menu.\n");
       printf("\t- /search  search for videos to play.\n");
+      printf("\t- /more    show the next page of results.\n");
       printf("\t- /play.   play video with index.\n");
       printf("\t- /quit    quit.\n");
     }
@@ -36,26 +101,34 @@ int main(int argc, char *argv[]) {
     if (string8_startswith(parsed, STRING8("/search "))) {
       arena_clear(arena);
       String8 query = string8_substringfrom(parsed, 8);
-      response = yt_search(client, query, arena);
-
       printf("Searching for query=%s\n", query.data);
+
+      // results are printed as they're parsed, while the rest downloads
+      YoutubeSearchResponse response = yt_search_begin(&search, query, print_video, NULL);
       printf("Total videos found: %zu\n", response.video_count);
-      for (usize i = 0; i < response.video_count; i++) {
-        // TODO add method to get a specific video by index
-        VideoData video = response.videos[i];
+      yt_search_save(&search, last_search_path, arena);
+    }
 
-        // TODO unpack this better
-        printf("%zu: %s\t%s\t%s\n", i, video.uid.data, video.length.data, video.title.data);
+    if (string8_startswith(parsed, STRING8("/more"))) {
+      YoutubeSearchResponse response = yt_search_next_page(&search, print_video, NULL);
+      if (response.code == YT_SEARCH_NONE) {
+        printf("No more results.\n");
       }
+      printf("Total videos found: %zu\n", search.videos.count);
+      yt_search_save(&search, last_search_path, arena);
     }
 
     if (string8_startswith(parsed, STRING8("/play "))) {
       String8 selected = string8_substringfrom(parsed, 6);
       usize index = atoi(selected.data);
-      VideoData video_to_play = response.videos[index];
+      VideoData *video_to_play = yt_search_video(&search, index);
+      if (video_to_play == NULL) {
+        printf("No video %zu, see /search and /more.\n", index);
+        continue;
+      }
 
-      printf("Playing url=%s...\n", video_to_play.url.data);
-      String8 video_arg = string8_join(arena, STRING8(""), 3, STRING8("'"), video_to_play.url, STRING8("'"));
+      printf("Playing url=%s...\n", video_to_play->url.data);
+      String8 video_arg = string8_join(arena, STRING8(""), 3, STRING8("'"), video_to_play->url, STRING8("'"));
       system(string8_concat(arena, STRING8("mpv "), video_arg).data);
     }
 
@@ -65,7 +138,16 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  yt_search_destroy(&search);
+  file_unmap(&last_search);
   arena_destroy(arena);
+  http_async_destroy(&async);
+  http_cache_destroy(&cache);
+  arena_destroy(cache_arena);
   http_client_destroy(&client);
+
+  // a no-op unless built with PROFILE=1
+  char *profile_path = getenv("PROFILE_OUTPUT") ? getenv("PROFILE_OUTPUT") : "profile.json";
+  profile_export((String8){ .data = profile_path, .length = strlen(profile_path) });
   return 0;
 }
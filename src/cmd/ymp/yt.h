@@ -3,9 +3,25 @@
 
 #include <json-c/json.h>
 
-#define JSON_MAX_DETPH 100
+#include "json_scan.h"
+#include "profile.h"
+
 #define YT_SEARCH_URL STRING8("https://www.youtube.com/youtubei/v1/search?key=None")
 #define YT_WATCH_URL  STRING8("https://www.youtube.com/watch?v=")
+#define YT_VIDEOS_PER_PAGE 32  // a page of results has ~20
+#define YT_VIDEO_BLOCK     32  // videos per block of a YoutubeVideoList
+#define YT_SCRATCH_BYTES   20000000  // a page's request, response and parser
+#define YT_PAGE_BYTES      (1 * MB)  // a prefetched page's videos, ~10KB
+
+// where the search results are, see parse_response. The first page has them
+// under contents, the following ones (continuations) under onResponseReceivedCommands
+#define YT_FIRST_PAGE_ITEMS "contents.twoColumnSearchResultsRenderer.primaryContents.sectionListRenderer.contents[*]"
+#define YT_NEXT_PAGE_ITEMS  "onResponseReceivedCommands[*].appendContinuationItemsAction.continuationItems[*]"
+#define YT_VIDEO_RENDERER   ".itemSectionRenderer.contents[*].videoRenderer"
+#define YT_CONTINUATION     ".continuationItemRenderer.continuationEndpoint.continuationCommand.token"
+
+#define YT_PAGE_PATH(is_continuation, path) \
+  ((is_continuation) ? STRING8(YT_NEXT_PAGE_ITEMS path) : STRING8(YT_FIRST_PAGE_ITEMS path))
 
 char *search_request_body =
   "{"
@@ -37,50 +53,272 @@ typedef struct YoutubeSearchResponse {
   enum YoutubeErrorCode code;
   VideoData *videos;
   usize video_count;
+  String8 continuation;  // token of the next page, empty on the last one
 } YoutubeSearchResponse;
 
-YoutubeSearchResponse yt_search(HttpClient client, String8 query, MemoryArena *arena);
+/* called with each video as soon as the response has all of it */
+typedef void (*YoutubeVideoCallback)(VideoData *video, usize index, void *context);
+
+// the json paths the parser subscribes to
+enum YoutubeMatch {
+  YT_MATCH_VIDEO,
+  YT_MATCH_ID,
+  YT_MATCH_TITLE,
+  YT_MATCH_LENGTH,
+  YT_MATCH_CONTINUATION,
+  YT_MATCH_COUNT
+};
+
+/* parses the response while it downloads, see parser_feed */
+typedef struct VideoParser {
+  JsonScanner scanner;
+  JsonPattern patterns[YT_MATCH_COUNT];
+  JsonToken token;
+
+  MemoryArena *arena;
+  u64 arena_start;      // everything the parse allocates in arena is above it
+  VideoData *videos;    // in arena, grown while their strings are decoded after it
+  usize count;
+  usize capacity;
+  VideoData current;    // raw slices of the body, until its videoRenderer closes
+  String8 continuation; // raw slice of the body
+
+  YoutubeVideoCallback on_video;
+  void *context;
+} VideoParser;
 
-static String8 prepare_request_body(String8 query, MemoryArena *arena);
-static YoutubeSearchResponse parse_response(String8 body, MemoryArena *arena);
-static VideoData parse_video_data(json_object *json, MemoryArena *arena);
-static String8 get_video_id(json_object *video_renderer_json, MemoryArena *arena);
-static String8 get_title(json_object *video_renderer_json, MemoryArena *arena);
-static String8 get_length(json_object *video_renderer_json, MemoryArena *arena);
+/*
+  Every video of a search: each page's videos stay where the page put them
+  and the list keeps pointers to them in blocks of YT_VIDEO_BLOCK, so a video
+  is found by its index in O(1) however many pages were appended.
+*/
+typedef struct YoutubeVideoList {
+  MemoryArena *arena;
+  VideoData ***blocks;
+  usize block_count;
+  usize block_capacity;
+  usize count;
+} YoutubeVideoList;
+
+/* the next page, downloaded and parsed in the background */
+typedef struct YoutubePrefetch {
+  MemoryArena *arena;       // its request, parser and videos
+  MemoryArena *body_arena;  // the response alone, so it grows in place while it downloads
+  VideoParser *parser;
+  struct YoutubeSearch *search;  // NULL once the search moved on without it
+  bool is_done;
+  YoutubeSearchResponse response;
+} YoutubePrefetch;
 
-YoutubeSearchResponse yt_search(HttpClient client, String8 query, MemoryArena *arena) {
-  // TODO consider using a scratch arena for the http call and then allocate the parsed
-  //      videos from the `arena` passed in
+/*
+  A search across pages. The first page is fetched (through the cache) when
+  the search begins, from then on the next page is always downloading on
+  `async` while the current one is read, so asking for it is usually instant.
+  Nothing downloads unless `async` is run, see http_async_run.
+*/
+typedef struct YoutubeSearch {
+  HttpCache *cache;
+  HttpAsync *async;
+  MemoryArena *arena;        // the videos of every page so far
+  YoutubeVideoList videos;
+  String8 continuation;      // of the next page, empty after the last one
+  YoutubePrefetch *next;     // NULL when there is no next page
+} YoutubeSearch;
+
+YoutubeSearchResponse yt_search(HttpCache *cache, String8 query, MemoryArena *arena);
+YoutubeSearchResponse yt_search_stream(HttpCache *cache, String8 query, MemoryArena *arena,
+                                       YoutubeVideoCallback on_video, void *context);
+
+YoutubeSearch         yt_search_create(HttpCache *cache, HttpAsync *async, MemoryArena *arena);
+void                  yt_search_destroy(YoutubeSearch *search);
+YoutubeSearchResponse yt_search_begin(YoutubeSearch *search, String8 query, YoutubeVideoCallback on_video, void *context);
+YoutubeSearchResponse yt_search_next_page(YoutubeSearch *search, YoutubeVideoCallback on_video, void *context);
+VideoData            *yt_search_video(YoutubeSearch *search, usize index);
+
+static String8 prepare_request_body(String8 query, String8 continuation, MemoryArena *arena);
+static YoutubeSearchResponse parse_response(String8 body, MemoryArena *arena);
+static void parser_init(VideoParser *parser, MemoryArena *arena, bool is_continuation,
+                        YoutubeVideoCallback on_video, void *context);
+static void parser_feed(VideoParser *parser, String8 body, bool is_last);
+static void parser_on_body(String8 body, void *context);
+static YoutubeSearchResponse parser_finish(VideoParser *parser, enum YoutubeErrorCode code);
+static void on_video_match(JsonMatch *match, void *context);
+static void prefetch_start(YoutubeSearch *search);
+static void prefetch_on_done(HttpResponse response, void *context);
+static void prefetch_destroy(YoutubePrefetch *next);
+static YoutubeVideoList video_list_create(MemoryArena *arena);
+static void video_list_push(YoutubeVideoList *list, VideoData *video);
+static VideoData *video_list_get(YoutubeVideoList *list, usize index);
+
+YoutubeSearchResponse yt_search(HttpCache *cache, String8 query, MemoryArena *arena) {
+  return yt_search_stream(cache, query, arena, NULL, NULL);
+}
 
+/*
+ * Searches for `query`, videos are parsed while the response downloads and
+ * handed to `on_video` (if any) one by one, long before the whole response
+ * is there. The returned response has all of them.
+ */
+YoutubeSearchResponse yt_search_stream(HttpCache *cache, String8 query, MemoryArena *arena,
+                                       YoutubeVideoCallback on_video, void *context) {
+  // the request, the response and the parser's state live in a scratch arena, only
+  // the videos are allocated from `arena`
   String8 headers[2] = {
     STRING8("Accept: application/json"),
     STRING8("Content-Type: application/json")
   };
 
-  MemoryArena *scratch_arena = arena_create(20000000);
-  String8 body = prepare_request_body(query, scratch_arena);
+  PROFILE_BEGIN(yt_search);
+  MemoryArena *scratch_arena = arena_create(YT_SCRATCH_BYTES);
+  VideoParser *parser = arena_push(scratch_arena, sizeof(VideoParser));
+  parser_init(parser, arena, false, on_video, context);
+
+  String8 body = prepare_request_body(query, (String8){ .data = NULL, .length = 0 }, scratch_arena);
   HttpRequest req = {
-    .method = "POST",
+    .method = STRING8("POST"),
     .uri = YT_SEARCH_URL,
     .body = body,
     .headers = headers,
-    .header_count = 2
+    .header_count = 2,
+    .on_body = parser_on_body,
+    .on_body_context = parser
   };
 
-  HttpResponse resp = http_post(client, req, scratch_arena);
-  if (resp.status != 200) {
-    fprintf(stderr, "ERROR: Failed to query yt, failed with http response %zu.", resp.status);
-    return (YoutubeSearchResponse){ .code = YT_SEARCH_ERROR, .videos = NULL };
+  // repeated searches are answered from the cache's mapped entry
+  HttpResponse resp = http_cache_request(cache, req, scratch_arena);
+  enum YoutubeErrorCode code = YT_SEARCH_OK;
+  if (resp.status == 200) {
+    parser_feed(parser, resp.body, true);
+  } else {
+    fprintf(stderr, "ERROR: Failed to query yt, failed with http response %zu.\n", resp.status);
+    code = YT_SEARCH_ERROR;
   }
 
-  YoutubeSearchResponse response = parse_response(resp.body, arena);
+  // the only way out, a failed search leaves nothing behind in either arena
+  YoutubeSearchResponse response = parser_finish(parser, code);
   arena_destroy(scratch_arena);
+  PROFILE_END(yt_search);
+  return response;
+}
+
+YoutubeSearch yt_search_create(HttpCache *cache, HttpAsync *async, MemoryArena *arena) {
+  return (YoutubeSearch){
+    .cache = cache,
+    .async = async,
+    .arena = arena,
+    .videos = video_list_create(arena),
+    .continuation = { .data = NULL, .length = 0 },
+    .next = NULL,
+  };
+}
+
+/*
+ * Waits for the pages still downloading (including the ones of earlier
+ * searches), curl writes to their arenas until they're done.
+ */
+void yt_search_destroy(YoutubeSearch *search) {
+  while (http_async_run(search->async, HTTP_ASYNC_POLL_MS) > 0) {
+  }
+
+  if (search->next != NULL) {
+    prefetch_destroy(search->next);
+    search->next = NULL;
+  }
+}
+
+/*
+ * Starts a new search, the previous one's videos are forgotten (the caller
+ * owns `search->arena`, it can be cleared before). Returns the first page,
+ * the same way yt_search_stream does, and starts prefetching the second.
+ */
+YoutubeSearchResponse yt_search_begin(YoutubeSearch *search, String8 query, YoutubeVideoCallback on_video, void *context) {
+  if (search->next != NULL) {
+    // still downloading, its callback cleans up
+    if (search->next->is_done) {
+      prefetch_destroy(search->next);
+    } else {
+      search->next->search = NULL;
+    }
+    search->next = NULL;
+  }
+
+  search->videos = video_list_create(search->arena);
+  YoutubeSearchResponse response = yt_search_stream(search->cache, query, search->arena, on_video, context);
+  for (usize i = 0; i < response.video_count; i++) {
+    video_list_push(&(search->videos), &(response.videos[i]));
+  }
+
+  search->continuation = response.continuation;
+  prefetch_start(search);
+  return response;
+}
+
+/*
+ * Appends the next page to the search's videos, it's most likely already
+ * prefetched, if not this waits for it. `on_video` is called with each
+ * video's index in the whole search. Returns YT_SEARCH_NONE after the last
+ * page, a page that failed is requested again by the next call.
+ */
+YoutubeSearchResponse yt_search_next_page(YoutubeSearch *search, YoutubeVideoCallback on_video, void *context) {
+  if (search->next == NULL) {
+    prefetch_start(search);
+  }
+
+  YoutubePrefetch *next = search->next;
+  if (next == NULL) {
+    return (YoutubeSearchResponse){ .code = YT_SEARCH_NONE };
+  }
+
+  while (!next->is_done) {
+    http_async_run(search->async, HTTP_ASYNC_POLL_MS);
+  }
+  search->next = NULL;
+
+  YoutubeSearchResponse response = next->response;
+  if (response.code != YT_SEARCH_OK) {
+    prefetch_destroy(next);
+    return response;
+  }
+
+  // only the videos are kept, the page's arenas (and the response in them) go
+  usize first_index = search->videos.count;
+  arena_align(search->arena, sizeof(u64));
+  VideoData *videos = arena_push(search->arena, response.video_count * sizeof(VideoData));
+  for (usize i = 0; i < response.video_count; i++) {
+    VideoData *video = &(videos[i]);
+    video->uid = string8_clone(search->arena, response.videos[i].uid);
+    video->title = string8_clone(search->arena, response.videos[i].title);
+    video->length = string8_clone(search->arena, response.videos[i].length);
+    video->url = string8_clone(search->arena, response.videos[i].url);
+    video_list_push(&(search->videos), video);
+
+    if (on_video != NULL) {
+      on_video(video, first_index + i, context);
+    }
+  }
+
+  search->continuation = string8_clone(search->arena, response.continuation);
+  prefetch_destroy(next);
+  prefetch_start(search);
+
+  response.videos = videos;
+  response.continuation = search->continuation;
   return response;
 }
 
-static String8 prepare_request_body(String8 query, MemoryArena *arena) {
+/* the video at `index` of all pages so far, NULL past the end */
+VideoData *yt_search_video(YoutubeSearch *search, usize index) {
+  return video_list_get(&(search->videos), index);
+}
+
+/* `continuation` is empty for the first page */
+static String8 prepare_request_body(String8 query, String8 continuation, MemoryArena *arena) {
   json_object *body = json_tokener_parse(search_request_body);
-  json_object_object_add(body, "query", json_object_new_string(query.data));
+  if (continuation.length > 0) {
+    json_object_object_add(body, "continuation", json_object_new_string(continuation.data));
+  } else {
+    json_object_object_add(body, "query", json_object_new_string(query.data));
+  }
 
   char *jsonstr = (char *)json_object_to_json_string(body);
   String8 req_body = string8_from_charbuf(arena, jsonstr, strlen(jsonstr));
@@ -140,153 +378,224 @@ static String8 prepare_request_body(String8 query, MemoryArena *arena) {
 */
 
 static YoutubeSearchResponse parse_response(String8 body, MemoryArena *arena) {
-  if (body.length == 0) {
-    return (YoutubeSearchResponse) { .code = YT_SEARCH_NONE };
-  }
-
-  struct json_tokener *tokener = json_tokener_new_ex(JSON_MAX_DETPH);
-
-  // TODO release this on each error path, refactor error handling
-  json_object *json = json_tokener_parse_ex(tokener, body.data, -1);
-  enum json_tokener_error json_error = json_tokener_get_error(tokener);
+  VideoParser parser;
+  parser_init(&parser, arena, false, NULL, NULL);
+  parser_feed(&parser, body, true);
+  return parser_finish(&parser, YT_SEARCH_OK);
+}
 
-  if (json_error != json_tokener_success) {
-    fprintf(stderr, "ERROR: Failed to parse json string: %u\n", json_error);
-    json_object_put(json);
-    return (YoutubeSearchResponse) { .code = YT_SEARCH_PARSE_ERROR };
-  }
+/* `is_continuation` for the pages after the first, their results are elsewhere */
+static void parser_init(VideoParser *parser, MemoryArena *arena, bool is_continuation,
+                        YoutubeVideoCallback on_video, void *context) {
+  *parser = (VideoParser){
+    .scanner = json_scan_create((String8){ .data = NULL, .length = 0 }),
+    .patterns = {
+      [YT_MATCH_VIDEO]        = json_pattern(YT_PAGE_PATH(is_continuation, YT_VIDEO_RENDERER)),
+      [YT_MATCH_ID]           = json_pattern(YT_PAGE_PATH(is_continuation, YT_VIDEO_RENDERER ".videoId")),
+      [YT_MATCH_TITLE]        = json_pattern(YT_PAGE_PATH(is_continuation, YT_VIDEO_RENDERER ".title.runs[0].text")),
+      [YT_MATCH_LENGTH]       = json_pattern(YT_PAGE_PATH(is_continuation, YT_VIDEO_RENDERER ".lengthText.simpleText")),
+      [YT_MATCH_CONTINUATION] = json_pattern(YT_PAGE_PATH(is_continuation, YT_CONTINUATION)),
+    },
+    .token = JSON_NEED_MORE,
+    .arena = arena,
+    .arena_start = arena->position,
+    .videos = NULL,
+    .count = 0,
+    .capacity = YT_VIDEOS_PER_PAGE,
+    .continuation = { .data = NULL, .length = 0 },
+    .on_video = on_video,
+    .context = context,
+  };
 
-  json_object *contents = json_object_object_get(json, "contents");
-  if (contents == NULL) {
-    return (YoutubeSearchResponse) { .code = YT_SEARCH_NONE };
-  }
+  // the result is built where it is returned, a page's worth is reserved up front
+  // and only moves (once) for searches with more videos than that
+  arena_align(arena, sizeof(u64));
+  parser->videos = arena_push(arena, parser->capacity * sizeof(VideoData));
+}
 
-  json_object *search_results = json_object_object_get(contents, "twoColumnSearchResultsRenderer");
-  if (search_results == NULL) {
-    return (YoutubeSearchResponse) { .code = YT_SEARCH_NONE };
+/* scans `body`, everything received so far, for the videos it completes */
+static void parser_feed(VideoParser *parser, String8 body, bool is_last) {
+  if (parser->token != JSON_NEED_MORE) {
+    return;
   }
 
-  json_object *primary_contents = json_object_object_get(search_results, "primaryContents");
-  if (primary_contents == NULL) {
-    return (YoutubeSearchResponse) { .code = YT_SEARCH_NONE };
-  }
+  PROFILE_BEGIN(yt_parse);
+  json_scan_feed(&(parser->scanner), body, is_last);
+  parser->token = json_scan_match(&(parser->scanner), parser->patterns, YT_MATCH_COUNT, on_video_match, parser);
+  PROFILE_END(yt_parse);
+}
 
-  json_object *section_list = json_object_object_get(primary_contents, "sectionListRenderer");
-  if (section_list == NULL) {
-    return (YoutubeSearchResponse) { .code = YT_SEARCH_NONE };
-  }
+static void parser_on_body(String8 body, void *context) {
+  parser_feed((VideoParser *)context, body, false);
+}
 
-  json_object *section_contents = json_object_object_get(section_list, "contents");
-  if (section_contents == NULL) {
-    return (YoutubeSearchResponse) { .code = YT_SEARCH_NONE };
+/*
+ * Every parse ends here, `code` is YT_SEARCH_OK unless the response never
+ * arrived. Anything but a result gives back all the parse took from the
+ * caller's arena (the videos handed to on_video go with it).
+ */
+static YoutubeSearchResponse parser_finish(VideoParser *parser, enum YoutubeErrorCode code) {
+  if (code == YT_SEARCH_OK && parser->scanner.input.length == 0) {
+    code = YT_SEARCH_NONE;
+  } else if (code == YT_SEARCH_OK && parser->token != JSON_END) {
+    fprintf(stderr, "ERROR: Failed to parse json string at offset %lu\n", parser->scanner.position);
+    code = YT_SEARCH_PARSE_ERROR;
+  } else if (code == YT_SEARCH_OK && parser->count == 0) {
+    code = YT_SEARCH_NONE;
   }
 
-  json_object *first_section = json_object_array_get_idx(section_contents, 0);
-  if (first_section == NULL) {
-    return (YoutubeSearchResponse) { .code = YT_SEARCH_NONE };
+  if (code != YT_SEARCH_OK) {
+    arena_pop_to(parser->arena, parser->arena_start);
+    return (YoutubeSearchResponse) { .code = code };
   }
 
-  json_object *item_section = json_object_object_get(first_section, "itemSectionRenderer");
-  if (item_section == NULL) {
-    return (YoutubeSearchResponse) { .code = YT_SEARCH_NONE };
-  }
+  return (YoutubeSearchResponse) {
+    .code = YT_SEARCH_OK,
+    .videos = parser->videos,
+    .video_count = parser->count,
+    .continuation = json_string_decode(parser->arena, parser->continuation)
+  };
+}
 
-  json_object *item_contents = json_object_object_get(item_section, "contents");
-  if (item_contents == NULL) {
-    return (YoutubeSearchResponse) { .code = YT_SEARCH_NONE };
-  }
+/*
+ * Collects each videoRenderer's fields as raw slices of the body, only
+ * they are copied (and unescaped) out of it once the videoRenderer closes.
+ */
+static void on_video_match(JsonMatch *match, void *context) {
+  VideoParser *parser = context;
+
+  switch (match->pattern) {
+  case YT_MATCH_VIDEO:
+    if (match->event == JSON_MATCH_BEGIN) {
+      parser->current = (VideoData){ 0 };
+      return;
+    }
 
-  usize item_count = json_object_array_length(item_contents);
-  usize video_count = 0;
-  VideoData videos[item_count];
+    if (parser->count == parser->capacity) {
+      // the strings decoded since are on top of the videos, they always move
+      usize capacity = parser->capacity * 2;
+      arena_align(parser->arena, sizeof(u64));
+      VideoData *videos = arena_push(parser->arena, capacity * sizeof(VideoData));
+      memcpy(videos, parser->videos, parser->count * sizeof(VideoData));
+      parser->videos = videos;
+      parser->capacity = capacity;
+    }
 
-  for (usize i = 0; i < item_count; i++) {
-    json_object *data = json_object_array_get_idx(item_contents, i);
-    json_object *video_renderer = json_object_object_get(data, "videoRenderer");
+    VideoData *video = &(parser->videos[parser->count]);
+    video->uid = json_string_decode(parser->arena, parser->current.uid);
+    video->title = json_string_decode(parser->arena, parser->current.title);
+    video->length = json_string_decode(parser->arena, parser->current.length);
+    video->url = string8_concat(parser->arena, YT_WATCH_URL, video->uid);
 
-    if (video_renderer != NULL) {
-      VideoData video = parse_video_data(video_renderer, arena);
-      videos[video_count] = video;
-      video_count++;
+    if (parser->on_video != NULL) {
+      parser->on_video(video, parser->count, parser->context);
     }
+    parser->count++;
+    return;
+
+  case YT_MATCH_ID:     parser->current.uid = match->value; return;
+  case YT_MATCH_TITLE:  parser->current.title = match->value; return;
+  case YT_MATCH_LENGTH: parser->current.length = match->value; return;
+  case YT_MATCH_CONTINUATION: parser->continuation = match->value; return;
   }
+}
 
-  VideoData *actual_videos = arena_push(arena, sizeof(VideoData) * video_count);
-  for (usize i = 0; i < video_count; i++) {
-    actual_videos[i] = videos[i];
+/* requests the page after the last one in the background, if there is one */
+static void prefetch_start(YoutubeSearch *search) {
+  if (search->continuation.length == 0) {
+    return;
   }
 
-  json_object_put(json);
-  return (YoutubeSearchResponse) {
-    .code = YT_SEARCH_OK,
-    .videos = actual_videos,
-    .video_count = video_count
+  String8 headers[2] = {
+    STRING8("Accept: application/json"),
+    STRING8("Content-Type: application/json")
   };
-}
 
-static VideoData parse_video_data(json_object *video_renderer_json, MemoryArena *arena) {
-  String8 id = get_video_id(video_renderer_json, arena);
-  String8 title = get_title(video_renderer_json, arena);
-  String8 length = get_length(video_renderer_json, arena);
-  String8 url = string8_concat(arena, YT_WATCH_URL, id);
+  // the page is parsed into its own arena while it downloads, the search's
+  // arena is left to the caller until the page is asked for
+  MemoryArena *arena = arena_create(YT_PAGE_BYTES);
+  YoutubePrefetch *next = arena_push(arena, sizeof(YoutubePrefetch));
+  next->arena = arena;
+  next->body_arena = arena_create(YT_SCRATCH_BYTES);
+  next->search = search;
+  next->parser = arena_push(arena, sizeof(VideoParser));
+  parser_init(next->parser, arena, true, NULL, NULL);
 
-  return (VideoData) { .uid = id, .title = title, .length = length, .url = url };
-}
+  // the headers are copied when the request starts, not now
+  String8 *request_headers = arena_push(arena, sizeof(headers));
+  memcpy(request_headers, headers, sizeof(headers));
 
-static String8 get_video_id(json_object *video_renderer_json, MemoryArena *arena) {
-  json_object *id_json = json_object_object_get(video_renderer_json, "videoId");
+  HttpRequest req = {
+    .method = STRING8("POST"),
+    .uri = YT_SEARCH_URL,
+    .body = prepare_request_body((String8){ .data = NULL, .length = 0 }, search->continuation, arena),
+    .headers = request_headers,
+    .header_count = 2,
+    .on_body = parser_on_body,
+    .on_body_context = next->parser
+  };
 
-  if (id_json == NULL) {
-    return STRING8("");
+  // continuation tokens are single use, these don't go through the cache
+  HttpHandle handle = http_submit(search->async, req, next->body_arena, prefetch_on_done, next);
+  if (handle.slot < 0) {
+    prefetch_destroy(next);
+    return;
   }
+  search->next = next;
+}
 
-  char *id = (char *)json_object_get_string(id_json);
-  if (id == NULL) {
-    return STRING8("");
+static void prefetch_on_done(HttpResponse response, void *context) {
+  YoutubePrefetch *next = context;
+  if (next->search == NULL) {
+    prefetch_destroy(next);
+    return;
   }
 
-  return string8_from_charbuf(arena, id, strlen(id));
+  if (response.status == 200) {
+    parser_feed(next->parser, response.body, true);
+  } else {
+    fprintf(stderr, "ERROR: Failed to fetch the next page, failed with http response %zu.\n", response.status);
+  }
+  next->response = parser_finish(next->parser, response.status == 200 ? YT_SEARCH_OK : YT_SEARCH_ERROR);
+  next->is_done = true;
 }
 
-static String8 get_title(json_object *video_renderer_json, MemoryArena *arena) {
-  json_object *title_json = json_object_object_get(video_renderer_json, "title");
-
-  if (title_json == NULL) {
-    return STRING8("");
-  }
+static void prefetch_destroy(YoutubePrefetch *next) {
+  arena_destroy(next->body_arena);
+  arena_destroy(next->arena);  // `next` is in it
+}
 
-  json_object *runs_json = json_object_object_get(title_json, "runs");
-  if (runs_json == NULL) {
-    return STRING8("");
-  }
+static YoutubeVideoList video_list_create(MemoryArena *arena) {
+  return (YoutubeVideoList){ .arena = arena, .blocks = NULL, .block_count = 0, .block_capacity = 0, .count = 0 };
+}
 
-  json_object *first_run = json_object_array_get_idx(runs_json, 0);
-  if (first_run == NULL) {
-    return STRING8("");
-  }
+static void video_list_push(YoutubeVideoList *list, VideoData *video) {
+  if (list->count == list->block_count * YT_VIDEO_BLOCK) {
+    if (list->block_count == list->block_capacity) {
+      // only the table of blocks moves, never the blocks
+      usize capacity = MAX(list->block_capacity * 2, 8);
+      arena_align(list->arena, sizeof(u64));
+      VideoData ***blocks = arena_push(list->arena, capacity * sizeof(VideoData **));
+      if (list->block_count > 0) {
+        memcpy(blocks, list->blocks, list->block_count * sizeof(VideoData **));
+      }
+      list->blocks = blocks;
+      list->block_capacity = capacity;
+    }
 
-  json_object *text_json = json_object_object_get(first_run, "text");
-  if (text_json == NULL) {
-    return STRING8("");
+    arena_align(list->arena, sizeof(u64));
+    list->blocks[list->block_count++] = arena_push(list->arena, YT_VIDEO_BLOCK * sizeof(VideoData *));
   }
 
-  char *title = (char *)json_object_get_string(text_json);
-  return string8_from_charbuf(arena, title, strlen(title));
+  list->blocks[list->count / YT_VIDEO_BLOCK][list->count % YT_VIDEO_BLOCK] = video;
+  list->count++;
 }
 
-static String8 get_length(json_object *video_renderer_json, MemoryArena *arena) {
-  json_object *length_text = json_object_object_get(video_renderer_json, "lengthText");
-  if (length_text == NULL) {
-    return STRING8("");
+static VideoData *video_list_get(YoutubeVideoList *list, usize index) {
+  if (index >= list->count) {
+    return NULL;
   }
-
-  json_object *simple_text = json_object_object_get(length_text, "simpleText");
-  if (simple_text == NULL) {
-    return STRING8("");
-  }
-
-  char *length = (char *)json_object_get_string(simple_text);
-  return string8_from_charbuf(arena, length, strlen(length));
+  return list->blocks[index / YT_VIDEO_BLOCK][index % YT_VIDEO_BLOCK];
 }
 
 #endif
@@ -0,0 +1,224 @@
+#ifndef __YT_SNAPSHOT_H__
+#define __YT_SNAPSHOT_H__
+
+/*
+  yt_snapshot.h - search results saved as a flat binary image.
+
+  A snapshot is laid out to be mapped and used in place, there is no
+  deserialization step:
+
+    [ YoutubeSnapshotHeader | YoutubeSnapshotVideo * video_count | strings ]
+
+  Strings are stored as offsets from the start of the image (so the image
+  can live at any address) and are null terminated, a VideoData is just
+  the image's address added to them, see yt_snapshot_video. Opening a
+  snapshot only checks its header, whatever the number of videos.
+
+  Integers are stored in the machine's byte order, snapshots are a cache
+  for the machine that wrote them. Anything that changes the layout bumps
+  YT_SNAPSHOT_VERSION, older snapshots are then ignored.
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "base.h"
+#include "file.h"
+#include "yt.h"
+
+#define YT_SNAPSHOT_MAGIC   0x59545331  // "YTS1"
+#define YT_SNAPSHOT_VERSION 1
+
+typedef struct YoutubeSnapshotString {
+  u64 offset;  // from the start of the image
+  u64 length;  // without the null terminator
+} YoutubeSnapshotString;
+
+typedef struct YoutubeSnapshotVideo {
+  YoutubeSnapshotString uid;
+  YoutubeSnapshotString title;
+  YoutubeSnapshotString length;
+  YoutubeSnapshotString url;
+} YoutubeSnapshotVideo;
+
+typedef struct YoutubeSnapshotHeader {
+  u32 magic;
+  u32 version;
+  u64 size;          // of the whole image
+  u64 video_count;
+  YoutubeSnapshotString continuation;
+} YoutubeSnapshotHeader;
+
+typedef struct YoutubeSnapshot {
+  bool is_valid;
+  String8 image;
+  YoutubeSnapshotHeader *header;
+  YoutubeSnapshotVideo *videos;
+} YoutubeSnapshot;
+
+String8         yt_snapshot_write(MemoryArena *arena, YoutubeSearchResponse response);
+bool            yt_snapshot_save(String8 path, YoutubeSearchResponse response, MemoryArena *scratch);
+YoutubeSnapshot yt_snapshot_open(String8 image);
+VideoData       yt_snapshot_video(YoutubeSnapshot *snapshot, usize index);
+String8         yt_snapshot_continuation(YoutubeSnapshot *snapshot);
+bool            yt_search_save(YoutubeSearch *search, String8 path, MemoryArena *scratch);
+void            yt_search_restore(YoutubeSearch *search, YoutubeSnapshot *snapshot);
+
+static YoutubeSnapshotString __yt_snapshot_put(MemoryArena *arena, u8 *image, String8 s);
+static String8               __yt_snapshot_get(YoutubeSnapshot *snapshot, YoutubeSnapshotString s);
+
+/*
+ * Builds the snapshot of `response` as a single allocation in `arena`, the
+ * returned image is what yt_snapshot_save writes.
+ */
+String8 yt_snapshot_write(MemoryArena *arena, YoutubeSearchResponse response) {
+  u64 table_size = sizeof(YoutubeSnapshotHeader) + (response.video_count * sizeof(YoutubeSnapshotVideo));
+
+  arena_align(arena, sizeof(u64));
+  u8 *image = arena_push(arena, table_size);
+
+  // the strings are pushed right after the table, so the image stays contiguous
+  YoutubeSnapshotVideo *videos = (YoutubeSnapshotVideo *)(image + sizeof(YoutubeSnapshotHeader));
+  for (usize i = 0; i < response.video_count; i++) {
+    videos[i].uid = __yt_snapshot_put(arena, image, response.videos[i].uid);
+    videos[i].title = __yt_snapshot_put(arena, image, response.videos[i].title);
+    videos[i].length = __yt_snapshot_put(arena, image, response.videos[i].length);
+    videos[i].url = __yt_snapshot_put(arena, image, response.videos[i].url);
+  }
+
+  YoutubeSnapshotHeader *header = (YoutubeSnapshotHeader *)image;
+  header->magic = YT_SNAPSHOT_MAGIC;
+  header->version = YT_SNAPSHOT_VERSION;
+  header->video_count = response.video_count;
+  header->continuation = __yt_snapshot_put(arena, image, response.continuation);
+  header->size = (arena->memory + arena->position) - image;
+
+  return (String8){ .data = (char *)image, .length = header->size };
+}
+
+/*
+ * Writes the snapshot of `response` to `path`, through a temporary file
+ * that is renamed so existing mappings of `path` are left untouched.
+ */
+bool yt_snapshot_save(String8 path, YoutubeSearchResponse response, MemoryArena *scratch) {
+  u64 position = scratch->position;
+  String8 image = yt_snapshot_write(scratch, response);
+  String8 tmp_path = string8_concat(scratch, path, STRING8(".tmp"));
+
+  FILE *f = fopen(tmp_path.data, "wb");
+  bool ok = f != NULL && fwrite(image.data, 1, image.length, f) == image.length;
+  ok = (f != NULL && fclose(f) == 0) && ok;
+
+  if (!ok || rename(tmp_path.data, path.data) < 0) {
+    fprintf(stderr, "ERROR: Failed to write snapshot=%s.\n", path.data);
+    unlink(tmp_path.data);
+    ok = false;
+  }
+
+  arena_pop_to(scratch, position);
+  return ok;
+}
+
+/*
+ * Checks that `image` (i.e. a mapped file) is a snapshot this version can
+ * read, `is_valid` is false if it isn't. The image must outlive the snapshot
+ * and every VideoData taken from it.
+ */
+YoutubeSnapshot yt_snapshot_open(String8 image) {
+  YoutubeSnapshot snapshot = { .is_valid = false, .image = image, .header = NULL, .videos = NULL };
+  if (image.length < sizeof(YoutubeSnapshotHeader)) {
+    return snapshot;
+  }
+
+  YoutubeSnapshotHeader *header = (YoutubeSnapshotHeader *)image.data;
+  u64 max_videos = (image.length - sizeof(YoutubeSnapshotHeader)) / sizeof(YoutubeSnapshotVideo);
+  if (header->magic != YT_SNAPSHOT_MAGIC || header->version != YT_SNAPSHOT_VERSION
+      || header->size != image.length || header->video_count > max_videos) {
+    return snapshot;
+  }
+
+  snapshot.is_valid = true;
+  snapshot.header = header;
+  snapshot.videos = (YoutubeSnapshotVideo *)(image.data + sizeof(YoutubeSnapshotHeader));
+  return snapshot;
+}
+
+/* the video at `index`, its strings point into the image */
+VideoData yt_snapshot_video(YoutubeSnapshot *snapshot, usize index) {
+  if (!snapshot->is_valid || index >= snapshot->header->video_count) {
+    return (VideoData){ 0 };
+  }
+
+  YoutubeSnapshotVideo *video = &(snapshot->videos[index]);
+  return (VideoData){
+    .uid = __yt_snapshot_get(snapshot, video->uid),
+    .title = __yt_snapshot_get(snapshot, video->title),
+    .length = __yt_snapshot_get(snapshot, video->length),
+    .url = __yt_snapshot_get(snapshot, video->url),
+  };
+}
+
+String8 yt_snapshot_continuation(YoutubeSnapshot *snapshot) {
+  if (!snapshot->is_valid) {
+    return (String8){ .data = NULL, .length = 0 };
+  }
+  return __yt_snapshot_get(snapshot, snapshot->header->continuation);
+}
+
+/* saves every video of every page so far, and where the next page starts */
+bool yt_search_save(YoutubeSearch *search, String8 path, MemoryArena *scratch) {
+  u64 position = scratch->position;
+
+  arena_align(scratch, sizeof(u64));
+  YoutubeSearchResponse response = {
+    .code = YT_SEARCH_OK,
+    .videos = arena_push(scratch, search->videos.count * sizeof(VideoData)),
+    .video_count = search->videos.count,
+    .continuation = search->continuation,
+  };
+  for (usize i = 0; i < response.video_count; i++) {
+    response.videos[i] = *video_list_get(&(search->videos), i);
+  }
+
+  bool ok = yt_snapshot_save(path, response, scratch);
+  arena_pop_to(scratch, position);
+  return ok;
+}
+
+/*
+ * Makes the snapshot's videos the search's results, as if they had just
+ * been searched: /play N and the next page work right away. Only the
+ * VideoData are built in the search's arena, the strings stay in the image.
+ */
+void yt_search_restore(YoutubeSearch *search, YoutubeSnapshot *snapshot) {
+  search->videos = video_list_create(search->arena);
+  search->continuation = yt_snapshot_continuation(snapshot);
+  if (!snapshot->is_valid) {
+    return;
+  }
+
+  usize count = snapshot->header->video_count;
+  arena_align(search->arena, sizeof(u64));
+  VideoData *videos = arena_push(search->arena, count * sizeof(VideoData));
+  for (usize i = 0; i < count; i++) {
+    videos[i] = yt_snapshot_video(snapshot, i);
+    video_list_push(&(search->videos), &(videos[i]));
+  }
+}
+
+/* copies `s` (and a null terminator) to the end of the image */
+static YoutubeSnapshotString __yt_snapshot_put(MemoryArena *arena, u8 *image, String8 s) {
+  String8 copy = string8_clone(arena, s);
+  return (YoutubeSnapshotString){ .offset = (u8 *)copy.data - image, .length = s.length };
+}
+
+/* a string that doesn't fit in the image (a corrupt snapshot) is empty */
+static String8 __yt_snapshot_get(YoutubeSnapshot *snapshot, YoutubeSnapshotString s) {
+  if (s.offset >= snapshot->image.length || s.length >= snapshot->image.length - s.offset
+      || snapshot->image.data[s.offset + s.length] != '\0') {
+    return (String8){ .data = "", .length = 0 };
+  }
+  return (String8){ .data = snapshot->image.data + s.offset, .length = s.length };
+}
+
+#endif
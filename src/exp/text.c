@@ -7,6 +7,7 @@
 #include "runtime-sdl.c"
 #include "font.h"
 #include "buffer.h"
+#include "view.h"
 
 #define FONT_SIZE 13
 #define COLS 80
@@ -15,13 +16,14 @@
 typedef struct TextWriter {
   Font font;
   Color text_color;
-  Point cursor;
   GapBuffer buffer;
+  TextView view;
   Bitmap pen;
   bool dirty;
 } TextWriter;
 
-void render_char(FT_Face face, char c, Bitmap *b, Point pos, Color bg, Color fg);
+u64  text_length(void *context);
+char text_char_at(void *context, u64 offset);
 
 int main(int argc, char *argv[]) {
   assert(argc == 2);
@@ -36,13 +38,15 @@ int main(int argc, char *argv[]) {
   TextWriter ctx = {
     .font = font_create(arena, string8_from_charbuf(arena, fontpath, fontpath_len), FONT_SIZE, FONT_SIZE),
     .text_color = PALETTE_DARK_YELLOW,
-    .cursor = (Point){0, FONT_SIZE},
     .buffer = buffer_create(),
     .pen = bitmap_create(arena, 1, 1),
     .dirty = false,
   };
   bitmap_fill(&(ctx.pen), PALETTE_BLUE);
 
+  Rect frame = { .origin = {0, 0}, .corner = {width, height} };
+  ctx.view = text_view_create(arena, &(ctx.font), frame, ctx.text_color, PALETTE_TRANSPARENT);
+
   r.context = (void *)&ctx;
   r.on_step = on_step;
   r.on_text_in = on_text_in;
@@ -52,6 +56,14 @@ int main(int argc, char *argv[]) {
   arena_destroy(arena);
 }
 
+u64  text_length(void *context) {
+  return (u64)buffer_length((GapBuffer *)context);
+}
+
+char text_char_at(void *context, u64 offset) {
+  return buffer_get((GapBuffer *)context, (i32)offset);
+}
+
 void on_step(Runtime *runtime) {
   TextWriter *ctx = (TextWriter *)(runtime->context);
 
@@ -60,42 +72,10 @@ void on_step(Runtime *runtime) {
     return;
   }
 
-  // clear the screen and reset drawing cursor
-  bitmap_clear(&(runtime->screen));
-
-  // TODO this should be a local since it's now only used for rendering
-  ctx->cursor.x = 0;
-  ctx->cursor.y = FONT_SIZE;
-
-
-  // draw buffer contents
-  // TODO: encapsulate a little
-
-  // draw text to the left of the gap
-  for (i32 li=0; li < ctx->buffer.gap_start; li++) {
-    if ((ctx->buffer.buf[li] == '\n') || (ctx->cursor.x >= runtime->width - FONT_SIZE)) {
-      // found new line, go to start of the next line
-      ctx->cursor.x = 0;
-      ctx->cursor.y += FONT_SIZE;
-      continue;
-    }
-
-    Glyph g = font_render_char(&(ctx->font), ctx->buffer.buf[li], &(runtime->screen), ctx->cursor, ctx->text_color);
-    ctx->cursor.x += g.x_advance + g.x_bearing_h;
-  }
-
-  // print data to the right of the gap
-  for (i32 ri=ctx->buffer.gap_end; ri < ctx->buffer.size; ri++) {
-    if ((ctx->buffer.buf[ri] == '\n') || (ctx->cursor.x >= runtime->width - FONT_SIZE)) {
-      // found new line, go to start of the next line
-      ctx->cursor.x = 0;
-      ctx->cursor.y += FONT_SIZE;
-      continue;
-    }
-
-    Glyph g = font_render_char(&(ctx->font), ctx->buffer.buf[ri], &(runtime->screen), ctx->cursor, ctx->text_color);
-    ctx->cursor.x += g.x_advance + g.x_bearing_h;
-  }
+  // only the rows touched by the edits since the last frame are redrawn
+  TextSource src = { .context = &(ctx->buffer), .length = text_length, .char_at = text_char_at };
+  text_view_scroll_to(&(ctx->view), src, ctx->buffer.gap_start);
+  text_view_update(&(ctx->view), src, &(runtime->screen));
 
   ctx->dirty = false;
 }
@@ -103,9 +83,8 @@ void on_step(Runtime *runtime) {
 void on_text_in(Runtime *runtime, String8 s) {
   TextWriter *ctx = (TextWriter *)(runtime->context);
 
-  for (u64 i=0; i < s.length; i++) {
-    buffer_insert(&(ctx->buffer), s.data[i]);
-  }
+  text_view_edit(&(ctx->view), ctx->buffer.gap_start, (i64)s.length);
+  buffer_insert_string8(&(ctx->buffer), s);
   ctx->dirty = true;
 }
 
@@ -113,11 +92,13 @@ void on_key_down(Runtime *runtime) {
   TextWriter *ctx = (TextWriter *)(runtime->context);
 
   if (runtime->keyboard.keys[K_RETURN]) {
+    text_view_edit(&(ctx->view), ctx->buffer.gap_start, 1);
     buffer_insert(&(ctx->buffer), '\n');
     ctx->dirty = true;
   }
 
-  if (runtime->keyboard.keys[K_BACKSPACE]) {
+  if (runtime->keyboard.keys[K_BACKSPACE] && ctx->buffer.gap_start > 0) {
+    text_view_edit(&(ctx->view), ctx->buffer.gap_start - 1, -1);
     buffer_backspace(&(ctx->buffer));
     ctx->dirty = true;
   }
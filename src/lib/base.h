@@ -9,6 +9,7 @@
 #include <stdlib.h>
 
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
 #define COUNTOF(a) (size)(sizeof(a) / sizeof(*(a)))
 #define LENGTHOF(s) (COUNTOF(s) - 1)
 #define NEW(type, numbytes) (type *)malloc(numbytes)
@@ -73,6 +74,7 @@ typedef size_t usize;
 typedef struct MemoryArena {
   u64 capacity;
   u64 position;
+  u64 high_water;  // the furthest position ever reached
   u8  *memory;
 } MemoryArena;
 
@@ -81,6 +83,7 @@ void arena_destroy(MemoryArena *arena);
 void *arena_push(MemoryArena *arena, u64 size);
 void *arena_push_nozero(MemoryArena *arena, u64 size);
 void *arena_grow(MemoryArena *arena, void *old_ptr, u64 old_size, u64 new_size);
+void arena_align(MemoryArena *arena, u64 alignment);
 void arena_pop(MemoryArena *arena, u64 size);
 void arena_pop_to(MemoryArena *arena, u64 pos);
 void arena_clear(MemoryArena *arena);
@@ -93,6 +96,7 @@ MemoryArena *arena_create(u64 capacity) {
 
   arena->capacity = capacity;
   arena->position = 0;
+  arena->high_water = 0;
   arena->memory = malloc((sizeof(u8)) * capacity);
   assert(arena->memory != NULL);
 
@@ -116,11 +120,17 @@ void *arena_push_nozero(MemoryArena *arena, u64 size) {
 
   u8 *data = &arena->memory[arena->position];
   arena->position += size;
+  arena->high_water = MAX(arena->high_water, arena->position);
 
   return data;
 }
 
-/* grow the topmost allocation */
+/*
+ * Resizes an allocation of `old_size` bytes to `new_size` bytes. The topmost
+ * allocation is resized in place (it can also shrink), anything else is
+ * copied to a new allocation when it grows. Growing in place doesn't zero
+ * the new bytes.
+ */
 void *arena_grow(MemoryArena *arena, void *old_ptr, u64 old_size, u64 new_size) {
   // case 1: old_ptr is null so we treat it as a new allocation.
   if (old_ptr == NULL) {
@@ -128,20 +138,38 @@ void *arena_grow(MemoryArena *arena, void *old_ptr, u64 old_size, u64 new_size)
   }
 
   // case 2: old_ptr points to the top most allocation, we extend it
-  if (old_ptr == arena->position - old_size) {
+  if ((u8 *)old_ptr + old_size == arena->memory + arena->position) {
     u64 new_position = arena->position - old_size + new_size;
     assert(new_position < arena->capacity);
 
     arena->position = new_position;
+    arena->high_water = MAX(arena->high_water, arena->position);
+    return old_ptr;
+  }
+
+  // case 3: old_ptr is not the top most allocation but it already fits
+  if (new_size <= old_size) {
     return old_ptr;
   }
 
-  // case 3: old_ptr does not point to the top most position, copy data over with updated size
+  // case 4: old_ptr does not point to the top most position, copy data over with updated size
   void *new_ptr = arena_push(arena, new_size);
-  memcpy(old_ptr, new_ptr, old_size);
+  memcpy(new_ptr, old_ptr, old_size);
   return new_ptr;
 }
 
+/*
+ * Pads the arena so the next allocation is aligned to `alignment` (a power
+ * of two). Allocations aren't aligned by default, use this before pushing
+ * structs after byte buffers.
+ */
+void arena_align(MemoryArena *arena, u64 alignment) {
+  u64 misalignment = (uptr)(arena->memory + arena->position) & (alignment - 1);
+  if (misalignment) {
+    arena_push_nozero(arena, alignment - misalignment);
+  }
+}
+
 void arena_pop(MemoryArena *arena, u64 size) {
   assert(size <= arena->position);
   arena->position -= size;
@@ -291,8 +319,9 @@ String8 string8_from_charbuf(MemoryArena *arena, char *buf, u64 length) {
   new_str.data = (char*)arena_push(arena, length + 1);
   new_str.length = length;
 
+  // buf doesn't have to be null terminated, the terminator comes from arena_push
   if (length) {
-    memcpy(new_str.data, buf, length + 1);
+    memcpy(new_str.data, buf, length);
   }
   return new_str;
 }
@@ -306,7 +335,7 @@ String8 string8_clone(MemoryArena *arena, String8 s) {
   new_str.length = s.length;
 
   if (s.length) {
-    memcpy(new_str.data, s.data, s.length + 1);  // copying the null terminator
+    memcpy(new_str.data, s.data, s.length);  // s may be a slice, the terminator comes from arena_push
   }
   return new_str;
 }
@@ -322,7 +351,7 @@ String8 string8_concat(MemoryArena *arena, String8 lhs, String8 rhs) {
   if (new_length) {
     memcpy(p, lhs.data, lhs.length);      // copy lhs string data
     p += lhs.length;                      // advance p to end of lhs data
-    memcpy(p, rhs.data, rhs.length + 1);  // copy rhs string data along with the null terminator
+    memcpy(p, rhs.data, rhs.length);      // copy rhs string data, the terminator comes from arena_push
   }
   return new_str;
 }
@@ -469,7 +498,7 @@ bool string8_endswith(String8 s, String8 suffix) {
   }
 
   for (usize i = s.length - suffix.length; i < s.length; i++) {
-    if (string8_get(s, i) != string8_get(suffix, i - suffix.length)) {
+    if (string8_get(s, i) != string8_get(suffix, i - (s.length - suffix.length))) {
       return false;
     }
   }
@@ -3,6 +3,18 @@
 
 /*
   buffer.h - a simple implementation of a gap buffer for text editing.
+
+  The text lives in a single allocation with a "gap" of unused bytes at the
+  cursor position:
+
+    [ text before the gap | ... gap ... | text after the gap ]
+    0                     gap_start     gap_end               size
+
+  Inserting and deleting at the gap is O(1), moving the gap to a new position
+  is a single memmove of the bytes in between. When the gap runs out the
+  buffer grows geometrically (at least doubling) so repeated inserts stay
+  amortized O(1), and it always leaves at least GAP_MIN_BYTES of free space
+  so a burst of typing after a grow doesn't immediately trigger another one.
 */
 
 #include <assert.h>
@@ -11,7 +23,16 @@
 
 #include "base.h"
 
-#define GAP_SIZE_BYTES 512
+// both can be overridden at compile time, i.e. -DGAP_MIN_BYTES=4096
+#ifndef GAP_SIZE_BYTES
+#define GAP_SIZE_BYTES 512  // initial size of the buffer
+#endif
+
+#ifndef GAP_MIN_BYTES
+#define GAP_MIN_BYTES 512   // minimum free space left after growing
+#endif
+
+#define BUFFER_MAX_BYTES INT32_MAX  // positions are i32, text and gap must fit
 
 typedef struct GapBuffer {
   char *buf;
@@ -24,14 +45,20 @@ typedef struct GapBuffer {
 GapBuffer buffer_create();
 void      buffer_destroy(GapBuffer *gb);
 void      buffer_insert(GapBuffer *gb, char c);
+void      buffer_insert_string8(GapBuffer *gb, String8 s);
 void      buffer_backspace(GapBuffer *gb);
+void      buffer_delete(GapBuffer *gb);
+void      buffer_move_gap(GapBuffer *gb, i32 pos);
+i32       buffer_length(GapBuffer *gb);
+char      buffer_get(GapBuffer *gb, i32 index);
 void      buffer_print(GapBuffer *gb);
 
 i32  __buffer_gap_size(GapBuffer *gb);
-void __buffer_grow(GapBuffer *gb);
+void __buffer_grow(GapBuffer *gb, i32 required);
 
 GapBuffer buffer_create() {
   char *buf = malloc(GAP_SIZE_BYTES);
+  assert(buf != NULL);
 
   // create the buffer with the entire buffer being the gap
   return (GapBuffer){
@@ -44,6 +71,7 @@ GapBuffer buffer_create() {
 
 void      buffer_destroy(GapBuffer *gb) {
   free(gb->buf);
+  gb->buf = NULL;
   gb->gap_start = 0;
   gb->gap_end = 0;
   gb->size = 0;
@@ -51,12 +79,31 @@ void      buffer_destroy(GapBuffer *gb) {
 
 void      buffer_insert(GapBuffer *gb, char c) {
   if (__buffer_gap_size(gb) == 0) {
-    __buffer_grow(gb);
+    __buffer_grow(gb, 1);
   }
 
   gb->buf[gb->gap_start++] = c;
 }
 
+/*
+ * Inserts all of `s` at the gap. The buffer grows (at most) once for the
+ * whole string instead of once per byte, which matters for large pastes.
+ */
+void      buffer_insert_string8(GapBuffer *gb, String8 s) {
+  if (s.length == 0) {
+    return;
+  }
+
+  assert(s.length <= BUFFER_MAX_BYTES);
+  if ((u64)__buffer_gap_size(gb) < s.length) {
+    __buffer_grow(gb, (i32)s.length);
+  }
+
+  memcpy(gb->buf + gb->gap_start, s.data, s.length);
+  gb->gap_start += s.length;
+}
+
+/* deletes the char before the gap. */
 void      buffer_backspace(GapBuffer *gb) {
   if (gb->gap_start == 0) {
     return;
@@ -64,6 +111,56 @@ void      buffer_backspace(GapBuffer *gb) {
   gb->gap_start--;
 }
 
+/* deletes the char after the gap. */
+void      buffer_delete(GapBuffer *gb) {
+  if (gb->gap_end == gb->size) {
+    return;
+  }
+  gb->gap_end++;
+}
+
+/*
+ * Moves the gap so that it starts at text position `pos` (clamped to the
+ * text length). Only the bytes between the old and new gap position are
+ * moved.
+ */
+void      buffer_move_gap(GapBuffer *gb, i32 pos) {
+  i32 length = buffer_length(gb);
+  if (pos < 0) pos = 0;
+  if (pos > length) pos = length;
+
+  i32 gap_size = __buffer_gap_size(gb);
+  if (pos < gb->gap_start) {
+    // move the text in [pos, gap_start) to the right side of the gap
+    i32 n = gb->gap_start - pos;
+    memmove(gb->buf + gb->gap_end - n, gb->buf + pos, n);
+  } else if (pos > gb->gap_start) {
+    // move the text in [gap_end, gap_end + n) to the left side of the gap
+    i32 n = pos - gb->gap_start;
+    memmove(gb->buf + gb->gap_start, gb->buf + gb->gap_end, n);
+  }
+
+  gb->gap_start = pos;
+  gb->gap_end = pos + gap_size;
+}
+
+/* number of bytes of text (excluding the gap) */
+i32       buffer_length(GapBuffer *gb) {
+  return gb->size - __buffer_gap_size(gb);
+}
+
+/* returns the char at text position `index`, or -1 if out of bounds */
+char      buffer_get(GapBuffer *gb, i32 index) {
+  if (index < 0 || index >= buffer_length(gb)) {
+    return -1;
+  }
+
+  if (index < gb->gap_start) {
+    return gb->buf[index];
+  }
+  return gb->buf[index + __buffer_gap_size(gb)];
+}
+
 i32  __buffer_gap_size(GapBuffer *gb) {
   return gb->gap_end - gb->gap_start;
 }
@@ -86,21 +183,37 @@ void buffer_print(GapBuffer *gb) {
   printf("\n");
 }
 
-void __buffer_grow(GapBuffer *gb) {
-  i32 new_size = gb->size * 2;
+/*
+ * Grows the buffer so the gap can hold at least `required` more bytes.
+ * The size at least doubles and keeps doubling until the gap fits
+ * `required` plus GAP_MIN_BYTES of slack, without going past
+ * BUFFER_MAX_BYTES (text that can't fit there is a caller's bug).
+ */
+void __buffer_grow(GapBuffer *gb, i32 required) {
+  i64 length = buffer_length(gb);
+  assert(length + required + GAP_MIN_BYTES <= BUFFER_MAX_BYTES);
+
+  // doubled in i64, an i32 size would wrap past 1 GB
+  i64 new_size = gb->size < GAP_SIZE_BYTES ? GAP_SIZE_BYTES : (i64)gb->size * 2;
+  while ((new_size - length) < (required + GAP_MIN_BYTES)) {
+    new_size *= 2;
+  }
+  new_size = MIN(new_size, BUFFER_MAX_BYTES);
+
   char *new_buf = malloc(new_size);
+  assert(new_buf != NULL);
 
   // copy text to the left of the gap
   memcpy(new_buf, gb->buf, gb->gap_start);
 
-  // copy text to the right of the gap
+  // copy text to the right of the gap to the end of the new buffer
   i32 right_side_len = gb->size - gb->gap_end;
-  memcpy(gb->buf + new_size - right_side_len, gb->buf + right_side_len, right_side_len);
+  memcpy(new_buf + new_size - right_side_len, gb->buf + gb->gap_end, right_side_len);
 
   // free old buffer
   free(gb->buf);
   gb->buf = new_buf;
-  gb->gap_end = new_size - right_side_len;
-  gb->size = new_size;
+  gb->gap_end = (i32)new_size - right_side_len;
+  gb->size = (i32)new_size;
 }
 #endif
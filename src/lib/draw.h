@@ -6,6 +6,7 @@
 #include <stdbool.h>
 
 #include "base.h"
+#include "profile.h"
 
 #define PIXEL_INDEX(x, y, w) (y * w) + x
 #define RGBA_RED(color)   (color >> 24) & 0xFF
@@ -68,6 +69,7 @@ Color  bitmap_get_pixel(Bitmap *b, i32 x, i32 y);
 void   bitmap_set_pixel(Bitmap *b, i32 x, i32 y, Color color);
 void   bitmap_clear(Bitmap *b);
 void   bitmap_fill(Bitmap *b, Color color);
+void   bitmap_fill_rect(Bitmap *b, Rect r, Color color);
 
 void bitblt(Bitmap *src, Bitmap *dst, Rect src_rect, Point at_pos, DrawOp op);
 void bitblt_clipped(Bitmap *src, Bitmap *dst, Rect src_rect, Point at_pos, Rect clip_rect, DrawOp op);
@@ -137,11 +139,38 @@ void   bitmap_fill(Bitmap *b, Color color) {
   }
 }
 
+/*
+  Fill the region `r` (clipped to `b`) with `color`, used to repaint parts of a
+  bitmap without clearing all of it.
+*/
+void   bitmap_fill_rect(Bitmap *b, Rect r, Color color) {
+  if (r.origin.x < 0) r.origin.x = 0;
+  if (r.origin.y < 0) r.origin.y = 0;
+  if (r.corner.x > b->w) r.corner.x = b->w;
+  if (r.corner.y > b->h) r.corner.y = b->h;
+
+  i32 w = r.corner.x - r.origin.x;
+  if (w <= 0 || r.corner.y <= r.origin.y) {
+    return;
+  }
+
+  // same approach as bitmap_fill, fill the first row and copy it down
+  Color *first_row = b->pixels + (b->w * r.origin.y) + r.origin.x;
+  for (i32 x = 0; x < w; x++) {
+    first_row[x] = color;
+  }
+
+  for (i32 y = r.origin.y + 1; y < r.corner.y; y++) {
+    memcpy(b->pixels + (b->w * y) + r.origin.x, first_row, w * sizeof(Color));
+  }
+}
+
 void draw_line(Bitmap *brush, Bitmap *dst, Point from, Point to, DrawOp op) {
   draw_line_clipped(brush, dst, from, to, bitmap_rect(dst), op);
 }
 
 void draw_line_clipped(Bitmap *brush, Bitmap *dst, Point from, Point to, Rect clip_rect, DrawOp op) {
+  PROFILE_BEGIN(draw_line);
   i32 from_x = from.x;
   i32 from_y = from.y;
   i32 to_x = to.x;
@@ -207,6 +236,7 @@ void draw_line_clipped(Bitmap *brush, Bitmap *dst, Point from, Point to, Rect cl
   // draw the first point
   Point first_point = is_forward ? from : to;
   bitblt_clipped(brush, dst, src_rect, at, clip_rect, op);
+  PROFILE_END(draw_line);
 }
 
 void bitblt(Bitmap *src, Bitmap *dst, Rect src_rect, Point at_pos, DrawOp op) {
@@ -214,13 +244,18 @@ void bitblt(Bitmap *src, Bitmap *dst, Rect src_rect, Point at_pos, DrawOp op) {
 }
 
 void bitblt_clipped(Bitmap *src, Bitmap *dst, Rect src_rect, Point at_pos, Rect clip_rect, DrawOp op) {
+  PROFILE_BEGIN(bitblt);
   __clip(src, dst, &src_rect, &at_pos, clip_rect);
   __copy_bits(src, dst, src_rect, at_pos, op);
+  PROFILE_END(bitblt);
 }
 
 /*
   Adjust the dimensions of source and clipping rectangle to fit within the src and dst bitmaps so that
   we avoid doing extra work for regions of the bitmap that won't be displayed.
+
+  Afterwards `src_rect` is inside `src` and, placed at `at_pos`, inside `clip_rect` and `dst`. It can
+  end up empty (or inverted, when it came in that way), in which case nothing is copied.
 */
 void __clip(Bitmap *src, Bitmap *dst, Rect *src_rect, Point *at_pos, Rect clip_rect) {
   // if clipping rectangle `clip_rect` is outside of destination bitmap `dst` we discard the out of bands region
@@ -230,62 +265,38 @@ void __clip(Bitmap *src, Bitmap *dst, Rect *src_rect, Point *at_pos, Rect clip_r
   if (clip_rect.corner.x > dst->w) clip_rect.corner.x = dst->w; // right edge
   if (clip_rect.corner.y > dst->h) clip_rect.corner.y = dst->h; // bottom edge
 
-  // clip and adjust src_rect according to clip_rect
-  // in x
-  if (at_pos->x <= clip_rect.origin.x) {
-    // the src_rect's left side is outside the clip_rect's left side
-    // so we must adjust the src_rect's left side so we only copy the
-    // src pixels that overlap with the clip_rect.
-    // 1. move src_rect left side by the difference between at.x and clip_rect.origin.x
-    // 2. adjust at.x to clip_rect.origin.x so we copy bits right at the clip_rect's origin.
-    src_rect->origin.x += (clip_rect.origin.x - at_pos->x);
-    at_pos->x = clip_rect.origin.x;
-  }
-
-  i32 src_rect_w = src_rect->corner.x - src_rect->origin.x;
-  if ((at_pos->x + src_rect_w) > clip_rect.corner.x) {
-    // the src_rect's right side is outside the clip_rect's right side
-    // so we must adjust the src_rect's right side so we only copy the
-    // src pixels that will fit into the clip_Rect.
-    // 1. get the width of the clip_rect
-    // 2. get the width of the src_rect (which has been adjusted above somewhat)
-    // 3. if src_rect width is < clip_rect width do nothing
-    // 4. otherwise get the difference and adjust src_rect left side by this amount.
-    i32 clip_rect_w = clip_rect.corner.x - clip_rect.origin.x;
-    i32 diff = (at_pos->x + src_rect_w) - clip_rect_w;
-    if (diff > 0) {
-      i32 delta_x = diff > src_rect_w ? src_rect_w : diff;
-      src_rect->corner.x -= delta_x;
+  // src_rect can't reach outside of src either. pixels it names left of (or above) src don't
+  // exist, so the ones that do land further right (or down).
+  if (src != NULL) {
+    if (src_rect->origin.x < 0) {
+      at_pos->x -= src_rect->origin.x;
+      src_rect->origin.x = 0;
+    }
+    if (src_rect->origin.y < 0) {
+      at_pos->y -= src_rect->origin.y;
+      src_rect->origin.y = 0;
     }
+    if (src_rect->corner.x > src->w) src_rect->corner.x = src->w;
+    if (src_rect->corner.y > src->h) src_rect->corner.y = src->h;
   }
 
-  // in y (we do the same but for y and height)
-  if (at_pos->y <= clip_rect.origin.y) {
+  // the src_rect's left (top) side is outside the clip_rect's, skip the src pixels that land
+  // there and copy the rest right at the clip_rect's left (top) side.
+  if (at_pos->x < clip_rect.origin.x) {
+    src_rect->origin.x += (clip_rect.origin.x - at_pos->x);
+    at_pos->x = clip_rect.origin.x;
+  }
+  if (at_pos->y < clip_rect.origin.y) {
     src_rect->origin.y += (clip_rect.origin.y - at_pos->y);
     at_pos->y = clip_rect.origin.y;
   }
 
-  i32 src_rect_h = src_rect->corner.y - src_rect->origin.y;
-  if ((at_pos->y + src_rect_h) > clip_rect.corner.y) {
-    i32 clip_rect_h = clip_rect.corner.y - clip_rect.origin.y;
-    i32 diff = (at_pos->y + src_rect_h) - clip_rect_h;
-    i32 delta_y = diff > src_rect_h ? src_rect_h : diff;
-    if (diff > 0) src_rect->corner.y -= delta_y;
-  }
-
-  if (src == NULL) return;
+  // the src_rect's right (bottom) side is outside the clip_rect's, drop the src pixels past it.
+  i32 overflow_x = (at_pos->x + (src_rect->corner.x - src_rect->origin.x)) - clip_rect.corner.x;
+  if (overflow_x > 0) src_rect->corner.x -= overflow_x;
 
-  if (src_rect->origin.x < 0) {
-    at_pos->x -= src_rect->origin.x;
-    src_rect->origin.x = 0;
-  }
-  if (src_rect->corner.x > src->w) src_rect->corner.x = src->w;
-
-  if (src_rect->origin.y < 0) {
-    at_pos->y -= src_rect->origin.y;
-    src_rect->origin.y = 0;
-  }
-  if (src_rect->corner.y > src->h) src_rect->corner.y = src->h;
+  i32 overflow_y = (at_pos->y + (src_rect->corner.y - src_rect->origin.y)) - clip_rect.corner.y;
+  if (overflow_y > 0) src_rect->corner.y -= overflow_y;
 }
 
 void __copy_bits(Bitmap *src, Bitmap *dst, Rect src_rect, Point at_pos, DrawOp op) {
@@ -366,7 +377,7 @@ Color __blend_alpha(Color src, Color dst) {
   u8 out_b = (src_b * alpha + dst_b * alpha_inv) >> 8;
 
   // 4. re-pack the individual channels into a 32bit color
-  return (out_r << 24) | (out_g << 16) | (out_b << 8) | 0xFF;
+  return ((Color)out_r << 24) | ((Color)out_g << 16) | ((Color)out_b << 8) | 0xFF;
 }
 
 i8 __sign(i32 val) {
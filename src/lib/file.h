@@ -0,0 +1,74 @@
+#ifndef _FILE_H_
+#define _FILE_H_
+
+/*
+  file.h - read-only memory mapped files.
+
+  Mapping a file instead of reading it means opening it is O(1) regardless
+  of its size: pages are only read from disk (or the page cache) when they
+  are first touched, and they are shared with every other process that maps
+  the same file.
+
+  The mapping is read-only, anything built on top of it (i.e. a rope
+  created with `rope_from_external`) must keep its edits elsewhere.
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "base.h"
+
+typedef struct MappedFile {
+  String8 contents;   // the mapped bytes, NOT null terminated
+  bool is_mapped;
+} MappedFile;
+
+MappedFile file_map(String8 filepath);
+void       file_unmap(MappedFile *file);
+
+/*
+ * Maps the file at `filepath` into memory. On failure (or for an empty
+ * file) `is_mapped` is false and `contents` is empty. The file is closed
+ * right after it's mapped, so a mapping holds no descriptor.
+ */
+MappedFile file_map(String8 filepath) {
+  MappedFile file = { .contents = { .data = NULL, .length = 0 }, .is_mapped = false };
+
+  i32 fd = open(filepath.data, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "ERROR: Failed to open file=%s.\n", filepath.data);
+    return file;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) < 0 || info.st_size == 0) {
+    close(fd);
+    return file;
+  }
+
+  void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "ERROR: Failed to map file=%s.\n", filepath.data);
+    return file;
+  }
+
+  file.contents.data = (char *)data;
+  file.contents.length = (u64)info.st_size;
+  file.is_mapped = true;
+  return file;
+}
+
+void file_unmap(MappedFile *file) {
+  if (file->is_mapped) {
+    munmap(file->contents.data, file->contents.length);
+  }
+
+  file->contents = (String8){ .data = NULL, .length = 0 };
+  file->is_mapped = false;
+}
+
+#endif
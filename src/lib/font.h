@@ -31,6 +31,9 @@ typedef struct Font {
   i32 h;
   Glyph glyphs[95];  // considering printable ascii rn
   i32 num_glyphs;
+
+  u64 glyph_hits;    // chars rendered from the preloaded glyphs
+  u64 glyph_misses;  // chars that weren't preloaded, rendered as '?'
 } Font;
 
 
@@ -77,12 +80,16 @@ void font_destroy(Font *font) {
 }
 
 Glyph font_render_char(Font *font, char c, Bitmap *dst, Point pos, Color fg) {
+  PROFILE_BEGIN(font_render_char);
   MemoryArena *scratch = arena_create(2 * (font->w * font->h * sizeof(Color)));
   Bitmap mask = bitmap_create(scratch, font->w, font->h);
   bitmap_fill(&mask, fg);
 
   // printf("Rendering char='%c' -- ", c);
-  Glyph g = font->glyphs[(u8)c - 32];
+  bool is_preloaded = (u8)c >= 32 && (u8)c < 127;
+  font->glyph_hits += is_preloaded;
+  font->glyph_misses += !is_preloaded;
+  Glyph g = font->glyphs[(u8)(is_preloaded ? c : '?') - 32];
   // printf("found glyph -- ");
 
   //bitblt(&(g.bitmap), &mask, bitmap_rect(&(g.bitmap)), (Point){0, 0}, DRAWOP_AND);
@@ -94,6 +101,7 @@ Glyph font_render_char(Font *font, char c, Bitmap *dst, Point pos, Color fg) {
 
   bitblt(&(g.bitmap), dst, bitmap_rect(&(g.bitmap)), pos, DRAWOP_STORE);
   arena_destroy(scratch);
+  PROFILE_END(font_render_char);
   return g;
 }
 
@@ -1,101 +1,569 @@
+#ifndef __HTTP_C__
+#define __HTTP_C__
+
 #include "http.h"
+#include "profile.h"
+#include <assert.h>
 #include <curl/curl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+
+#define HTTP_BODY_MIN_CAPACITY (16 * KB)  // first reservation when there's no Content-Length
 
 /*
- * Used to store and process the contents of a CURL data transfer.
- * I found it commplicated to pass an arena into this so opted for
- * malloc/realloc/free here and then copy it into an arena allocated
- * String8
+ * Used to store the contents of a CURL data transfer. The body is written
+ * straight into the caller's arena: it is always the arena's topmost
+ * allocation while the transfer runs, so it grows in place with `arena_grow`
+ * and the bytes are copied exactly once, from curl's buffer into the arena.
  */
 typedef struct Chunk {
-  char* memory;
-  usize size;
+  CURL *curl;
+  MemoryArena *arena;
+  char *memory;
+  u64 size;      // bytes received
+  u64 capacity;  // bytes reserved in the arena, always > size
+
+  // header lines of the response, one after the other, split in __http_finish
+  char *header_block;
+  u64 header_size;
+  u64 header_capacity;
+
+  HttpBodyCallback on_body;
+  void *on_body_context;
 } Chunk;
 
+/* a request submitted to an HttpAsync, see http_submit */
+typedef enum HttpTransferState {
+  HTTP_TRANSFER_FREE = 0,
+  HTTP_TRANSFER_QUEUED,
+  HTTP_TRANSFER_RUNNING,
+  HTTP_TRANSFER_DONE,
+} HttpTransferState;
+
+struct HttpTransfer {
+  CURL *curl;
+  struct curl_slist *headers;
+  HttpTransferState state;
+  u32 generation;  // bumped every time the slot is reused, see HttpHandle
+  u32 sequence;    // submission order
+
+  HttpRequest request;
+  HttpResponse response;
+  Chunk chunk;
+
+  HttpCallback on_done;
+  void *context;
+  u64 submitted_at;  // profile_now(), the transfer is a zone from submit to done
+};
+
 static size_t curl_callback(void *contents, size_t size, size_t nmemb, void *userp);
+static size_t curl_header_callback(char *buffer, size_t size, size_t nitems, void *userp);
+static bool   __http_set_method(CURL *curl, HttpRequest request);
+static void   __http_parse_headers(Chunk *chunk, HttpResponse *response);
+static bool   __chunk_reserve(Chunk *chunk, u64 required);
+static bool   __arena_can_grow(MemoryArena *arena, void *ptr, u64 old_size, u64 new_size);
+static void   __http_client_configure(HttpClient *client);
+static bool               __http_prepare(CURL *curl, HttpRequest *request, Chunk *chunk, struct curl_slist **headers);
+static u64                __http_url_encode_into(char *dst, String8 s);
+static HttpResponse       __http_finish(CURL *curl, CURLcode code, HttpRequest request, struct curl_slist *headers, Chunk *chunk);
+static HttpTransfer      *__http_async_transfer(HttpAsync *async, HttpHandle handle);
+static void               __http_async_start_queued(HttpAsync *async);
+static void               __http_async_complete(HttpAsync *async);
+static void               __http_async_release(HttpTransfer *transfer);
 
 HttpClient http_client_create() {
-  HttpClient client = { .created = false };
+  HttpClient client = { .curl = NULL, .share = NULL, .created = false };
 
   if ((client.curl = curl_easy_init()) == NULL) {
     fprintf(stderr, "ERROR: Failed to create HttpClient, curl init failed.");
-  } else {
-    client.created = true;
+    return client;
   }
 
+  if ((client.share = curl_share_init()) == NULL) {
+    fprintf(stderr, "ERROR: Failed to create HttpClient, curl share init failed.");
+    curl_easy_cleanup(client.curl);
+    client.curl = NULL;
+    return client;
+  }
+
+  __http_client_configure(&client);
+  client.created = true;
   return client;
 }
 
 void http_client_destroy(HttpClient *client) {
+  // the easy handle uses the share, it has to go first
   curl_easy_cleanup(client->curl);
+  curl_share_cleanup(client->share);
   client->curl = NULL;
+  client->share = NULL;
   client->created = false;
 }
 
+/*
+ * Returns the value of the first header named `header_name` (names are
+ * case insensitive, http/2 sends them lowercase), empty if there's none.
+ */
 String8 http_response_get_header(HttpResponse *resp, String8 header_name) {
   for (usize i = 0; i < resp->header_count; i++) {
-    if (string8_startswith(resp->headers[i], header_name)) {
-      return string8_substringfrom(resp->headers[i], header_name.length + 1);
+    String8 header = resp->headers[i];
+    if (header.length <= header_name.length || header.data[header_name.length] != ':'
+        || strncasecmp(header.data, header_name.data, header_name.length) != 0) {
+      continue;
+    }
+
+    String8 value = string8_substringfrom(header, header_name.length + 1);
+    while (value.length > 0 && (value.data[0] == ' ' || value.data[0] == '\t')) {
+      value = string8_substringfrom(value, 1);
     }
+    return value;
   }
-  return (String8){ .length = 0 };
+  return (String8){ .data = "", .length = 0 };
 }
 
-HttpResponse http_post(HttpClient client, HttpRequest request, MemoryArena *arena) {
-  CURLcode code;
+/*
+ * Returns `uri` with `params` appended as a url-encoded query string, after
+ * any query the uri already has.
+ */
+String8 http_build_url(MemoryArena *arena, String8 uri, HttpParam *params, usize param_count) {
+  if (param_count == 0) {
+    return uri;
+  }
 
-  long http_code = 0L;
+  // worst case every byte of every param is percent encoded
+  u64 capacity = uri.length + 1;
+  for (usize i = 0; i < param_count; i++) {
+    capacity += 2 + (3 * (params[i].name.length + params[i].value.length));
+  }
+
+  char *url = arena_push(arena, capacity);
+  memcpy(url, uri.data, uri.length);
+  u64 length = uri.length;
+
+  bool has_query = memchr(uri.data, '?', uri.length) != NULL;
+  for (usize i = 0; i < param_count; i++) {
+    url[length++] = (i == 0 && !has_query) ? '?' : '&';
+    length += __http_url_encode_into(url + length, params[i].name);
+    url[length++] = '=';
+    length += __http_url_encode_into(url + length, params[i].value);
+  }
+
+  // give back what the worst case estimate didn't use, keep the terminator
+  arena_grow(arena, url, capacity, length + 1);
+  return (String8){ .data = url, .length = length };
+}
+
+/* percent encodes everything but the unreserved characters of RFC 3986 */
+String8 http_url_encode(MemoryArena *arena, String8 s) {
+  u64 capacity = (3 * s.length) + 1;
+  char *encoded = arena_push(arena, capacity);
+  u64 length = __http_url_encode_into(encoded, s);
+
+  arena_grow(arena, encoded, capacity, length + 1);
+  return (String8){ .data = encoded, .length = length };
+}
+
+/*
+ * Performs `request` with the method it names. The body is streamed into
+ * `arena` and the response headers are stored in it too.
+ */
+HttpResponse http_request(HttpClient client, HttpRequest request, MemoryArena *arena) {
+  Chunk chunk = { .curl = client.curl, .arena = arena, .memory = NULL, .size = 0, .capacity = 0 };
   struct curl_slist *headers = NULL;
-  Chunk chunk = { .memory = NULL, .size = 0 };
+  if (!__http_prepare(client.curl, &request, &chunk, &headers)) {
+    return (HttpResponse){ .status = 0 };
+  }
+
+  PROFILE_BEGIN(http_request);
+  CURLcode code = curl_easy_perform(client.curl);
+  HttpResponse response = __http_finish(client.curl, code, request, headers, &chunk);
+  PROFILE_END(http_request);
+  return response;
+}
+
+/* POSTs `request`, whatever method it names */
+HttpResponse http_post(HttpClient client, HttpRequest request, MemoryArena *arena) {
+  request.method = STRING8("POST");
+  return http_request(client, request, arena);
+}
+
+HttpAsync http_async_create(HttpClient *client, i32 max_in_flight) {
+  HttpAsync async = {
+    .client = client,
+    .multi = curl_multi_init(),
+    .transfers = calloc(HTTP_ASYNC_MAX_TRANSFERS, sizeof(HttpTransfer)),
+    .max_in_flight = max_in_flight > 0 ? max_in_flight : 1,
+    .in_flight = 0,
+    .queued = 0,
+    .next_sequence = 0,
+  };
+  assert(async.multi != NULL && async.transfers != NULL);
+
+  // requests to the same host share a connection when it speaks http/2
+  curl_multi_setopt(async.multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+  return async;
+}
+
+void http_async_destroy(HttpAsync *async) {
+  for (i32 i = 0; i < HTTP_ASYNC_MAX_TRANSFERS; i++) {
+    HttpTransfer *transfer = &(async->transfers[i]);
+    if (transfer->state == HTTP_TRANSFER_RUNNING) {
+      curl_multi_remove_handle(async->multi, transfer->curl);
+    }
+    if (transfer->headers) {
+      curl_slist_free_all(transfer->headers);
+    }
+    if (transfer->curl) {
+      curl_easy_cleanup(transfer->curl);
+    }
+  }
+
+  curl_multi_cleanup(async->multi);
+  free(async->transfers);
+  async->multi = NULL;
+  async->transfers = NULL;
+}
+
+/*
+ * Queues `request`, it starts as soon as fewer than `max_in_flight` requests
+ * are running (requests start in the order they were submitted). The body
+ * is written to `arena`, a separate arena per request keeps each body the
+ * topmost allocation of its arena so it's copied once.
+ *
+ * When the request completes `on_done` is called from `http_async_run`, and
+ * the handle is released. Without a callback the response is kept until it's
+ * taken with `http_async_wait`.
+ *
+ * Returns HTTP_INVALID_HANDLE if HTTP_ASYNC_MAX_TRANSFERS requests are
+ * already pending.
+ */
+HttpHandle http_submit(HttpAsync *async, HttpRequest request, MemoryArena *arena, HttpCallback on_done, void *context) {
+  for (i32 i = 0; i < HTTP_ASYNC_MAX_TRANSFERS; i++) {
+    HttpTransfer *transfer = &(async->transfers[i]);
+    if (transfer->state != HTTP_TRANSFER_FREE) {
+      continue;
+    }
+
+    if (transfer->curl == NULL) {
+      // copies the options configured on the client, the handle is reused by
+      // every request that gets this slot
+      transfer->curl = curl_easy_duphandle(async->client->curl);
+      curl_easy_setopt(transfer->curl, CURLOPT_SHARE, async->client->share);
+      curl_easy_setopt(transfer->curl, CURLOPT_PRIVATE, transfer);
+    }
+
+    transfer->state = HTTP_TRANSFER_QUEUED;
+    transfer->generation++;
+    transfer->sequence = async->next_sequence++;
+    transfer->request = request;
+    transfer->response = (HttpResponse){ .status = 0 };
+    transfer->chunk = (Chunk){ .curl = transfer->curl, .arena = arena, .memory = NULL, .size = 0, .capacity = 0 };
+    transfer->on_done = on_done;
+    transfer->context = context;
+    transfer->submitted_at = profile_now();
+    async->queued++;
+
+    return (HttpHandle){ .slot = i, .generation = transfer->generation };
+  }
+
+  fprintf(stderr, "ERROR: Failed to submit request, url=%s, too many pending requests.", request.uri.data);
+  return HTTP_INVALID_HANDLE;
+}
+
+/*
+ * Drives the pending requests: starts queued requests, waits up to
+ * `timeout_ms` for network activity and completes finished requests.
+ * Returns the number of requests that are still running or queued.
+ */
+i32 http_async_run(HttpAsync *async, i32 timeout_ms) {
+  PROFILE_BEGIN(http_async_run);
+  __http_async_start_queued(async);
+
+  i32 running = 0;
+  curl_multi_perform(async->multi, &running);
+  __http_async_complete(async);
+
+  if (async->in_flight > 0 && timeout_ms > 0) {
+    curl_multi_poll(async->multi, NULL, 0, timeout_ms, NULL);
+    curl_multi_perform(async->multi, &running);
+    __http_async_complete(async);
+  }
+
+  // completed requests may have freed room for queued ones
+  __http_async_start_queued(async);
+  PROFILE_END(http_async_run);
+  return async->in_flight + async->queued;
+}
+
+bool http_async_done(HttpAsync *async, HttpHandle handle) {
+  HttpTransfer *transfer = __http_async_transfer(async, handle);
+  return transfer == NULL || transfer->state == HTTP_TRANSFER_DONE;
+}
+
+/*
+ * Runs the requests until the one for `handle` completes and returns its
+ * response, the handle is released. Only for requests without a callback.
+ */
+HttpResponse http_async_wait(HttpAsync *async, HttpHandle handle) {
+  HttpTransfer *transfer = __http_async_transfer(async, handle);
+  if (transfer == NULL || transfer->on_done != NULL) {
+    return (HttpResponse){ .status = 0 };
+  }
+
+  while (transfer->state != HTTP_TRANSFER_DONE) {
+    http_async_run(async, HTTP_ASYNC_POLL_MS);
+  }
+
+  transfer->state = HTTP_TRANSFER_FREE;
+  return transfer->response;
+}
+
+static HttpTransfer *__http_async_transfer(HttpAsync *async, HttpHandle handle) {
+  if (handle.slot < 0 || handle.slot >= HTTP_ASYNC_MAX_TRANSFERS) {
+    return NULL;
+  }
+
+  HttpTransfer *transfer = &(async->transfers[handle.slot]);
+  if (transfer->generation != handle.generation || transfer->state == HTTP_TRANSFER_FREE) {
+    return NULL;
+  }
+  return transfer;
+}
+
+static void __http_async_start_queued(HttpAsync *async) {
+  while (async->queued > 0 && async->in_flight < async->max_in_flight) {
+    // oldest queued request first
+    HttpTransfer *next = NULL;
+    for (i32 i = 0; i < HTTP_ASYNC_MAX_TRANSFERS; i++) {
+      HttpTransfer *transfer = &(async->transfers[i]);
+      if (transfer->state == HTTP_TRANSFER_QUEUED && (next == NULL || transfer->sequence < next->sequence)) {
+        next = transfer;
+      }
+    }
+
+    async->queued--;
+    if (!__http_prepare(next->curl, &(next->request), &(next->chunk), &(next->headers))) {
+      next->response = (HttpResponse){ .status = 0 };
+      __http_async_release(next);
+      continue;
+    }
+
+    curl_multi_add_handle(async->multi, next->curl);
+    next->state = HTTP_TRANSFER_RUNNING;
+    async->in_flight++;
+  }
+}
+
+static void __http_async_complete(HttpAsync *async) {
+  CURLMsg *message;
+  i32 remaining = 0;
+
+  while ((message = curl_multi_info_read(async->multi, &remaining)) != NULL) {
+    if (message->msg != CURLMSG_DONE) {
+      continue;
+    }
+
+    HttpTransfer *transfer = NULL;
+    curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char **)&transfer);
+    CURLcode code = message->data.result;
+    curl_multi_remove_handle(async->multi, transfer->curl);
+
+    transfer->response = __http_finish(transfer->curl, code, transfer->request, transfer->headers, &(transfer->chunk));
+    transfer->headers = NULL;
+    async->in_flight--;
+    profile_record("http_transfer", transfer->submitted_at, profile_now());
+    __http_async_release(transfer);
+  }
+}
+
+/* marks `transfer` done and hands its response to the callback, if any */
+static void __http_async_release(HttpTransfer *transfer) {
+  transfer->state = HTTP_TRANSFER_DONE;
 
-  for (size_t header_idx = 0; header_idx < request.header_count; header_idx++) {
+  if (transfer->on_done) {
+    // released before the callback so it can submit a follow up request
+    transfer->state = HTTP_TRANSFER_FREE;
+    transfer->on_done(transfer->response, transfer->context);
+  }
+}
+
+/*
+ * Sets the per request options on `curl`, the options shared by every
+ * request are set once, see __http_client_configure. The url (with its
+ * query string) is built in the chunk's arena. `headers` is set to the
+ * header list that __http_finish frees. Returns false for unknown methods.
+ */
+static bool __http_prepare(CURL *curl, HttpRequest *request, Chunk *chunk, struct curl_slist **headers) {
+  if (!__http_set_method(curl, *request)) {
+    fprintf(stderr, "ERROR: Unsupported http method=%.*s.", (int)request->method.length, request->method.data);
+    return false;
+  }
+
+  *headers = NULL;
+  for (size_t header_idx = 0; header_idx < request->header_count; header_idx++) {
     // TODO: DEBUG log headers
-    headers = curl_slist_append(headers, request.headers[header_idx].data);
-  }
-
-  curl_easy_setopt(client.curl, CURLOPT_URL, request.uri.data);         // set url
-  curl_easy_setopt(client.curl, CURLOPT_HTTPHEADER, headers);           // set headers
-  curl_easy_setopt(client.curl, CURLOPT_POSTFIELDS, request.body.data); // set POST method and body
-  curl_easy_setopt(client.curl, CURLOPT_WRITEFUNCTION, curl_callback);  // set callback
-  curl_easy_setopt(client.curl, CURLOPT_WRITEDATA, &chunk);             // set pointer to response
-  curl_easy_setopt(client.curl, CURLOPT_TIMEOUT, 5L);                   // set timeout in seconds
-  curl_easy_setopt(client.curl, CURLOPT_FOLLOWLOCATION, 1L);            // follow redirects
-  curl_easy_setopt(client.curl, CURLOPT_MAXREDIRS, 1L);                 // max 1 redirect
-  curl_easy_setopt(client.curl, CURLOPT_USERAGENT, USER_AGENT);         // set user agent
-  // TODO: conditional set CURLOPT_VERBOSE if in debug mode
+    *headers = curl_slist_append(*headers, request->headers[header_idx].data);
+  }
+
+  request->uri = http_build_url(chunk->arena, request->uri, request->params, request->param_count);
+  curl_easy_setopt(curl, CURLOPT_URL, request->uri.data);                     // set url
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, *headers);                       // set headers
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, chunk);                           // set pointer to response
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, chunk);                          // set pointer to response headers
+
+  chunk->on_body = request->on_body;
+  chunk->on_body_context = request->on_body_context;
+  return true;
+}
+
+/*
+ * The handle is reused, so every method sets (or clears) all the options
+ * the other methods change.
+ */
+static bool __http_set_method(CURL *curl, HttpRequest request) {
+  String8 method = request.method;
+  bool has_body = request.body.data != NULL;
+
+  curl_easy_setopt(curl, CURLOPT_NOBODY, 0L);
+  curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, NULL);
+
+  if (method.length == 0 || string8_equals(method, STRING8("GET"))) {
+    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+  } else if (string8_equals(method, STRING8("HEAD"))) {
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+  } else if (string8_equals(method, STRING8("POST"))) {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)request.body.length);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, has_body ? request.body.data : "");
+  } else if (string8_equals(method, STRING8("PUT")) || string8_equals(method, STRING8("DELETE"))) {
+    if (has_body) {
+      curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)request.body.length);
+      curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body.data);
+    } else {
+      curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+    }
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, method.data);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/* writes the encoding of `s` to `dst`, returns its length */
+static u64 __http_url_encode_into(char *dst, String8 s) {
+  static const char hex[] = "0123456789ABCDEF";
+  u64 length = 0;
+
+  for (u64 i = 0; i < s.length; i++) {
+    u8 c = (u8)s.data[i];
+    bool unreserved = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+      || c == '-' || c == '_' || c == '.' || c == '~';
+
+    if (unreserved) {
+      dst[length++] = (char)c;
+      continue;
+    }
+    dst[length++] = '%';
+    dst[length++] = hex[c >> 4];
+    dst[length++] = hex[c & 0x0F];
+  }
+  return length;
+}
+
+static HttpResponse __http_finish(CURL *curl, CURLcode code, HttpRequest request, struct curl_slist *headers, Chunk *chunk) {
+  long http_code = 0L;
+
+  // the header list is freed below, don't leave the handle pointing at it
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, NULL);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, NULL);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, NULL);
+  curl_slist_free_all(headers);
 
-  code = curl_easy_perform(client.curl);
   if (code != CURLE_OK) {
     fprintf(stderr, "ERROR: Failed to perform network call, url=%s, error=%s.",
             request.uri.data, curl_easy_strerror(code));
 
-    free(chunk.memory);
-    curl_slist_free_all(headers);
-    curl_easy_reset(client.curl);
+    // give the partial body back (only possible if nothing was allocated after it)
+    if (chunk->memory != NULL) {
+      arena_grow(chunk->arena, chunk->memory, chunk->capacity, 0);
+    }
     return (HttpResponse){ .status = (usize)http_code };
   }
 
-  String8 body = string8_from_charbuf(arena, chunk.memory, chunk.size);
+  String8 body = { .data = "", .length = 0 };
+  if (chunk->memory != NULL) {
+    // give back what was reserved but not used
+    chunk->memory = arena_grow(chunk->arena, chunk->memory, chunk->capacity, chunk->size + 1);
+    chunk->memory[chunk->size] = 0;
+    body = (String8){ .data = chunk->memory, .length = chunk->size };
+  }
 
-  free(chunk.memory);
-  curl_easy_getinfo(client.curl, CURLINFO_RESPONSE_CODE, &http_code);
-  curl_slist_free_all(headers);
-  curl_easy_reset(client.curl);
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+  HttpResponse response = { .status = (usize) http_code, .body = body };
+  __http_parse_headers(chunk, &response);
+  return response;
+}
 
-  return (HttpResponse){ .status = (usize) http_code, .body = body };
+/*
+ * Splits the header block into "Name: value" slices, the slices point into
+ * the block (the line endings are dropped, they aren't null terminated) only
+ * the array is allocated.
+ */
+static void __http_parse_headers(Chunk *chunk, HttpResponse *response) {
+  if (chunk->header_block == NULL) {
+    return;
+  }
+
+  usize count = 0;
+  for (u64 i = 0; i < chunk->header_size; i++) {
+    count += chunk->header_block[i] == '\n';
+  }
+
+  arena_align(chunk->arena, sizeof(u64));
+  response->headers = arena_push(chunk->arena, count * sizeof(String8));
+  char *line = chunk->header_block;
+  char *end = chunk->header_block + chunk->header_size;
+  while (line < end) {
+    char *newline = memchr(line, '\n', end - line);
+    u64 length = newline - line;
+    if (length > 0 && line[length - 1] == '\r') {
+      length--;
+    }
+    if (length > 0) {
+      response->headers[response->header_count++] = (String8){ .data = line, .length = length };
+    }
+    line = newline + 1;
+  }
+}
+
+/*
+ * Sets the options shared by every request once. The handle is never reset,
+ * which would drop them, and keeps its connections alive between requests.
+ */
+static void __http_client_configure(HttpClient *client) {
+  curl_share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);     // connection cache
+  curl_share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);         // dns cache
+  curl_share_setopt(client->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION); // tls session ids
+
+  curl_easy_setopt(client->curl, CURLOPT_SHARE, client->share);
+  curl_easy_setopt(client->curl, CURLOPT_WRITEFUNCTION, curl_callback);            // set callback
+  curl_easy_setopt(client->curl, CURLOPT_HEADERFUNCTION, curl_header_callback);    // set header callback
+  curl_easy_setopt(client->curl, CURLOPT_TIMEOUT, 5L);                            // set timeout in seconds
+  curl_easy_setopt(client->curl, CURLOPT_FOLLOWLOCATION, 1L);                     // follow redirects
+  curl_easy_setopt(client->curl, CURLOPT_MAXREDIRS, 1L);                          // max 1 redirect
+  curl_easy_setopt(client->curl, CURLOPT_USERAGENT, USER_AGENT);                  // set user agent
+  curl_easy_setopt(client->curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);   // http/2 over https if possible
+  curl_easy_setopt(client->curl, CURLOPT_TCP_KEEPALIVE, 1L);                      // keep idle connections alive
+  curl_easy_setopt(client->curl, CURLOPT_DNS_CACHE_TIMEOUT, 300L);                // seconds
+  // TODO: conditional set CURLOPT_VERBOSE if in debug mode
 }
 
 static size_t curl_callback(void *contents, size_t size, size_t nmemb, void *userp) {
   size_t real_size = size * nmemb; // calculate buffer size
   Chunk *chunk = (Chunk *)userp;   // cast ptr to body struct ptr
 
-  // reallocate data buffer
-  chunk->memory = (char *)realloc(chunk->memory, chunk->size + real_size + 1);
-
-  if (chunk->memory == NULL) {
+  if (!__chunk_reserve(chunk, chunk->size + real_size + 1)) {
     fprintf(stderr, "ERROR: Failed to expand buffer to store response body.");
     // CURL will report this as a failure
     return 0;
@@ -104,6 +572,95 @@ static size_t curl_callback(void *contents, size_t size, size_t nmemb, void *use
   // copy response body data
   memcpy(&(chunk->memory[chunk->size]), contents, real_size);
   chunk->size += real_size;
-  chunk->memory[chunk->size] = 0;
+
+  if (chunk->on_body != NULL) {
+    // error pages aren't what the caller is waiting for, 0 is a protocol
+    // without status codes (file://)
+    long http_code = 0L;
+    curl_easy_getinfo(chunk->curl, CURLINFO_RESPONSE_CODE, &http_code);
+    if (http_code == 0 || (http_code >= 200 && http_code < 300)) {
+      chunk->on_body((String8){ .data = chunk->memory, .length = chunk->size }, chunk->on_body_context);
+    }
+  }
   return real_size;
 }
+
+/*
+ * Appends each header line (status line excluded) to the chunk's header
+ * block. A new status line means a redirect or an interim response, only
+ * the headers of the final response are kept.
+ */
+static size_t curl_header_callback(char *buffer, size_t size, size_t nitems, void *userp) {
+  size_t real_size = size * nitems;
+  Chunk *chunk = (Chunk *)userp;
+
+  if (real_size >= 5 && strncmp(buffer, "HTTP/", 5) == 0) {
+    chunk->header_size = 0;
+    return real_size;
+  }
+
+  // skip the blank line ending the headers, lines are always \n terminated
+  if (real_size <= 2 && (buffer[0] == '\r' || buffer[0] == '\n')) {
+    return real_size;
+  }
+
+  u64 required = chunk->header_size + real_size + 1;
+  if (required > chunk->header_capacity) {
+    u64 capacity = MAX(2 * chunk->header_capacity, required + KB);
+    if (!__arena_can_grow(chunk->arena, chunk->header_block, chunk->header_capacity, capacity)) {
+      fprintf(stderr, "ERROR: Failed to expand buffer to store response headers.");
+      return 0;
+    }
+    chunk->header_block = arena_grow(chunk->arena, chunk->header_block, chunk->header_capacity, capacity);
+    chunk->header_capacity = capacity;
+  }
+
+  memcpy(chunk->header_block + chunk->header_size, buffer, real_size);
+  chunk->header_size += real_size;
+  if (buffer[real_size - 1] != '\n') {
+    chunk->header_block[chunk->header_size++] = '\n';
+  }
+  return real_size;
+}
+
+/*
+ * Makes room for `required` bytes. The first reservation uses the
+ * Content-Length of the response (known by the time the body arrives) so
+ * most responses never grow, after that the reservation doubles.
+ */
+static bool __chunk_reserve(Chunk *chunk, u64 required) {
+  if (required <= chunk->capacity) {
+    return true;
+  }
+
+  u64 capacity = chunk->capacity * 2;
+  if (chunk->memory == NULL) {
+    curl_off_t content_length = -1;
+    curl_easy_getinfo(chunk->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+    capacity = content_length > 0 ? (u64)content_length + 1 : HTTP_BODY_MIN_CAPACITY;
+  }
+  if (capacity < required) {
+    capacity = required;
+  }
+
+  // the arena asserts on overflow, fail the transfer instead
+  if (!__arena_can_grow(chunk->arena, chunk->memory, chunk->capacity, capacity)) {
+    if (!__arena_can_grow(chunk->arena, chunk->memory, chunk->capacity, required)) {
+      return false;
+    }
+    capacity = required;
+  }
+
+  chunk->memory = arena_grow(chunk->arena, chunk->memory, chunk->capacity, capacity);
+  chunk->capacity = capacity;
+  return true;
+}
+
+/* true if arena_grow(arena, ptr, old_size, new_size) has room */
+static bool __arena_can_grow(MemoryArena *arena, void *ptr, u64 old_size, u64 new_size) {
+  bool is_top = ptr != NULL && (u8 *)ptr + old_size == arena->memory + arena->position;
+  u64 available = arena->capacity - arena->position + (is_top ? old_size : 0);
+  return new_size < available;
+}
+
+#endif
@@ -10,39 +10,104 @@
   "Gecko) Chrome/70.0.3538.77 Safari/537.36"
 
 /*
-  TODO: methods to get a given header value from a request response.
   TODO: methods to create and destroy request and response structs.
 */
 
 // TODO: evaluate defining an HttpHeader struct instead of char *headers[]
-// TODO: add support for query params
 
+/*
+  An HttpClient is meant to live as long as the program: its handle keeps the
+  options that don't change between requests, and its share keeps the
+  connection, DNS and TLS session caches, so requests to the same host skip
+  the TCP and TLS handshakes (and multiplex over HTTP/2 when the server
+  supports it).
+*/
 typedef struct HttpClient {
   CURL *curl;
+  CURLSH *share;
   bool created;
 } HttpClient;
 
+/* a query parameter, url-encoded when the request url is built */
+typedef struct HttpParam {
+  String8 name;
+  String8 value;
+} HttpParam;
+
+/*
+  Called each time more of a (2xx) response body arrived, with all of the
+  body received so far: it grows in place in the request's arena, it is not
+  null terminated until the request returns.
+*/
+typedef void (*HttpBodyCallback)(String8 body, void *context);
+
 typedef struct HttpRequest {
-  String8 method;
+  String8 method;   // GET, HEAD, POST, PUT or DELETE, GET when empty
   String8 uri;
   String8 body;
   String8 *headers;
   usize header_count;
+  HttpParam *params;
+  usize param_count;
+
+  HttpBodyCallback on_body;  // optional, to process the body while it downloads
+  void *on_body_context;
 } HttpRequest;
 
 typedef struct HttpResponse {
   usize status;
   String8 body;
-  String8 *headers;
+  String8 *headers;   // "Name: value" lines of the final response, not null terminated
   usize header_count;
 } HttpResponse;
 
 
+/*
+  HttpAsync runs several requests at once on a single thread (curl multi),
+  at most `max_in_flight` of them are on the network at any time, the rest
+  wait in submission order. Nothing happens unless `http_async_run` is
+  called, i.e. once per frame or REPL iteration.
+*/
+#define HTTP_ASYNC_MAX_TRANSFERS 64   // pending (queued + running) requests
+#define HTTP_ASYNC_POLL_MS       100  // how long http_async_wait blocks per iteration
+
+#define HTTP_INVALID_HANDLE (HttpHandle){ .slot = -1, .generation = 0 }
+
+typedef struct HttpTransfer HttpTransfer;
+
+typedef void (*HttpCallback)(HttpResponse response, void *context);
+
+typedef struct HttpHandle {
+  i32 slot;
+  u32 generation;
+} HttpHandle;
+
+typedef struct HttpAsync {
+  HttpClient *client;
+  CURLM *multi;
+  HttpTransfer *transfers;  // HTTP_ASYNC_MAX_TRANSFERS slots
+  i32 max_in_flight;
+  i32 in_flight;
+  i32 queued;
+  u32 next_sequence;
+} HttpAsync;
+
+
 String8 http_response_get_header(HttpResponse *resp, String8 header_name);
+String8 http_build_url(MemoryArena *arena, String8 uri, HttpParam *params, usize param_count);
+String8 http_url_encode(MemoryArena *arena, String8 s);
 
 HttpClient http_client_create();
 void http_client_destroy(HttpClient *client);
 
+HttpResponse http_request(HttpClient client, HttpRequest request, MemoryArena *arena);
 HttpResponse http_post(HttpClient client, HttpRequest request, MemoryArena *arena);
 
+HttpAsync    http_async_create(HttpClient *client, i32 max_in_flight);
+void         http_async_destroy(HttpAsync *async);
+HttpHandle   http_submit(HttpAsync *async, HttpRequest request, MemoryArena *arena, HttpCallback on_done, void *context);
+i32          http_async_run(HttpAsync *async, i32 timeout_ms);
+bool         http_async_done(HttpAsync *async, HttpHandle handle);
+HttpResponse http_async_wait(HttpAsync *async, HttpHandle handle);
+
 #endif
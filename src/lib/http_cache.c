@@ -0,0 +1,485 @@
+#ifndef __HTTP_CACHE_C__
+#define __HTTP_CACHE_C__
+
+#include "http_cache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME        0x100000001b3ULL
+
+#define HTTP_CACHE_PATH_MAX 1024
+
+/* state of a background refresh, lives in its own arena */
+typedef struct HttpCacheRefresh {
+  HttpCache *cache;
+  MemoryArena *arena;
+  HttpCacheKey key;             // its strings live in `arena`
+  HttpCacheEntryHeader header;  // of the stale entry
+} HttpCacheRefresh;
+
+static i64          __http_cache_now(void);
+static u64          __fnv1a(u64 hash, String8 s);
+static void         __http_cache_path(HttpCache *cache, u64 key, char *suffix, char *path);
+static void         __http_cache_release(HttpCache *cache, u64 key);
+static bool         __http_cache_is_refreshing(HttpCache *cache, u64 key);
+static bool         __http_cache_touch(HttpCache *cache, u64 key, HttpCacheEntryHeader header, HttpResponse response);
+static void         __http_cache_freshness(HttpCache *cache, HttpResponse *response, HttpCacheEntryHeader *header);
+static HttpResponse __http_cache_response(HttpRequest request, HttpCacheEntry entry);
+static HttpRequest  __http_cache_conditional(HttpRequest request, HttpCacheEntry entry, MemoryArena *arena);
+static void         __http_cache_refresh(HttpCache *cache, HttpCacheKey key, HttpRequest request, HttpCacheEntry entry);
+static void         __http_cache_on_refresh(HttpResponse response, void *context);
+static i64          __parse_seconds(String8 s);
+
+/*
+ * Creates a cache storing its entries in `dir` (created if it's missing,
+ * its parent has to exist). `dir` has to outlive the cache.
+ */
+HttpCache http_cache_create(HttpClient *client, String8 dir) {
+  if (mkdir(dir.data, 0755) < 0 && errno != EEXIST) {
+    fprintf(stderr, "ERROR: Failed to create cache directory=%s.\n", dir.data);
+  }
+
+  return (HttpCache){
+    .client = client,
+    .async = NULL,
+    .dir = dir,
+    .default_max_age = 0,
+    .stale_while_revalidate = 0,
+    .ignore_cache_control = false,
+    .now = __http_cache_now,
+    .mappings = NULL,
+    .mapping_count = 0,
+    .mapping_capacity = 0,
+    .refreshing = NULL,
+    .refreshing_count = 0,
+    .refreshing_capacity = 0,
+  };
+}
+
+/* unmaps every entry handed out, background refreshes must be done by now */
+void http_cache_destroy(HttpCache *cache) {
+  for (u32 i = 0; i < cache->mapping_count; i++) {
+    file_unmap(&(cache->mappings[i].file));
+  }
+  free(cache->mappings);
+  cache->mappings = NULL;
+  cache->mapping_count = 0;
+  cache->mapping_capacity = 0;
+
+  free(cache->refreshing);
+  cache->refreshing = NULL;
+  cache->refreshing_count = 0;
+  cache->refreshing_capacity = 0;
+}
+
+/*
+ * Like http_request, but answers from the cache when it can. Bodies of
+ * cached responses point into the mapped entry, not into `arena`, and stay
+ * valid until the next request (or lookup) for the same key. Cached
+ * responses carry no headers. A stale entry has at most one background
+ * refresh in flight, however often it's asked for.
+ */
+HttpResponse http_cache_request(HttpCache *cache, HttpRequest request, MemoryArena *arena) {
+  HttpCacheKey key = http_cache_key(request, arena);
+  HttpCacheEntry entry = http_cache_lookup(cache, key);
+
+  if (entry.found) {
+    if (http_cache_is_fresh(cache, &(entry.header))) {
+      return __http_cache_response(request, entry);
+    }
+
+    i64 age = cache->now() - entry.header.stored_at;
+    if (cache->async && age < entry.header.max_age + entry.header.stale_while_revalidate) {
+      __http_cache_refresh(cache, key, request, entry);
+      return __http_cache_response(request, entry);
+    }
+
+    request = __http_cache_conditional(request, entry, arena);
+  }
+
+  HttpResponse response = http_request(*(cache->client), request, arena);
+  if (entry.found && response.status == 304) {
+    __http_cache_touch(cache, key.hash, entry.header, response);
+    return __http_cache_response(request, entry);
+  }
+
+  http_cache_store(cache, key, response);
+  return response;
+}
+
+/* drives background refreshes, see http_async_run */
+i32 http_cache_run(HttpCache *cache, i32 timeout_ms) {
+  if (cache->async == NULL) {
+    return 0;
+  }
+  return http_async_run(cache->async, timeout_ms);
+}
+
+/*
+ * The method, url (query params included, built in `arena` if there are
+ * any) and FNV-1a of the body, hashed together with FNV-1a.
+ */
+HttpCacheKey http_cache_key(HttpRequest request, MemoryArena *arena) {
+  HttpCacheKey key = {
+    .method = request.method.length ? request.method : STRING8("GET"),
+    .url = http_build_url(arena, request.uri, request.params, request.param_count),
+    .body_hash = __fnv1a(FNV_OFFSET_BASIS, request.body),
+  };
+
+  u64 hash = __fnv1a(FNV_OFFSET_BASIS, key.method);
+  hash = __fnv1a(hash, STRING8("\n"));
+  hash = __fnv1a(hash, key.url);
+  hash = __fnv1a(hash, STRING8("\n"));
+  key.hash = __fnv1a(hash, request.body);
+  return key;
+}
+
+/* parses the directives of a Cache-Control header the cache cares about */
+HttpCacheControl http_cache_control_parse(String8 value) {
+  HttpCacheControl control = { .max_age = -1, .stale_while_revalidate = -1, .no_store = false, .no_cache = false };
+
+  u64 start = 0;
+  while (start < value.length) {
+    u64 end = start;
+    while (end < value.length && value.data[end] != ',') {
+      end++;
+    }
+
+    String8 directive = { .data = value.data + start, .length = end - start };
+    while (directive.length > 0 && directive.data[0] == ' ') {
+      directive = string8_substringfrom(directive, 1);
+    }
+
+    if (directive.length >= 8 && strncasecmp(directive.data, "max-age=", 8) == 0) {
+      control.max_age = __parse_seconds(string8_substringfrom(directive, 8));
+    } else if (directive.length >= 23 && strncasecmp(directive.data, "stale-while-revalidate=", 23) == 0) {
+      control.stale_while_revalidate = __parse_seconds(string8_substringfrom(directive, 23));
+    } else if (directive.length >= 8 && strncasecmp(directive.data, "no-store", 8) == 0) {
+      control.no_store = true;
+    } else if (directive.length >= 8 && strncasecmp(directive.data, "no-cache", 8) == 0) {
+      control.no_cache = true;
+    }
+
+    start = end + 1;
+  }
+  return control;
+}
+
+/*
+ * Writes `response` as the entry for `key`. Only 200s are stored, and only
+ * if the response allows it. The entry is written to a temporary file and
+ * renamed, so readers (and existing mappings) never see a partial entry.
+ */
+bool http_cache_store(HttpCache *cache, HttpCacheKey key, HttpResponse response) {
+  if (response.status != 200) {
+    return false;
+  }
+
+  HttpCacheEntryHeader header = {
+    .magic = HTTP_CACHE_MAGIC,
+    .version = HTTP_CACHE_VERSION,
+    .key = key.hash,
+    .body_hash = key.body_hash,
+    .method_length = key.method.length,
+    .url_length = key.url.length,
+    .stored_at = cache->now(),
+    .status = response.status,
+  };
+  __http_cache_freshness(cache, &response, &header);
+  if (header.max_age < 0) {
+    return false;  // no-store
+  }
+
+  String8 etag = http_response_get_header(&response, STRING8("ETag"));
+  String8 last_modified = http_response_get_header(&response, STRING8("Last-Modified"));
+  header.etag_length = etag.length;
+  header.last_modified_length = last_modified.length;
+  header.body_length = response.body.length;
+
+  char tmp_path[HTTP_CACHE_PATH_MAX];
+  char path[HTTP_CACHE_PATH_MAX];
+  __http_cache_path(cache, key.hash, ".tmp", tmp_path);
+  __http_cache_path(cache, key.hash, "", path);
+
+  FILE *f = fopen(tmp_path, "wb");
+  if (f == NULL) {
+    fprintf(stderr, "ERROR: Failed to write cache entry=%s.\n", tmp_path);
+    return false;
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+    && fwrite(key.method.data, 1, key.method.length, f) == key.method.length
+    && fwrite(key.url.data, 1, key.url.length, f) == key.url.length
+    && fwrite(etag.data, 1, etag.length, f) == etag.length
+    && fwrite(last_modified.data, 1, last_modified.length, f) == last_modified.length
+    && fwrite(response.body.data, 1, response.body.length, f) == response.body.length
+    && fputc(0, f) == 0;  // so bodies can be used as c strings in place
+  ok = (fclose(f) == 0) && ok;
+
+  if (!ok || rename(tmp_path, path) < 0) {
+    fprintf(stderr, "ERROR: Failed to write cache entry=%s.\n", path);
+    unlink(tmp_path);
+    return false;
+  }
+
+  // a mapping of the replaced entry stays valid, the next lookup unmaps it
+  return true;
+}
+
+/*
+ * Maps the entry for `key`, `found` is false if there's no valid entry or
+ * it was stored for another request with the same hash. Unmaps what the
+ * previous lookup of `key` handed out.
+ */
+HttpCacheEntry http_cache_lookup(HttpCache *cache, HttpCacheKey key) {
+  HttpCacheEntry entry = { .found = false };
+  __http_cache_release(cache, key.hash);
+
+  char path[HTTP_CACHE_PATH_MAX];
+  __http_cache_path(cache, key.hash, "", path);
+  if (access(path, R_OK) < 0) {
+    return entry;  // a miss, not an error
+  }
+
+  MappedFile file = file_map((String8){ .data = path, .length = strlen(path) });
+  if (!file.is_mapped) {
+    return entry;
+  }
+
+  HttpCacheEntryHeader *header = (HttpCacheEntryHeader *)file.contents.data;
+  bool valid = file.contents.length >= sizeof(HttpCacheEntryHeader)
+    && header->magic == HTTP_CACHE_MAGIC
+    && header->version == HTTP_CACHE_VERSION
+    && header->key == key.hash
+    && file.contents.length == sizeof(HttpCacheEntryHeader) + header->method_length + header->url_length
+                               + header->etag_length + header->last_modified_length + header->body_length + 1;
+  if (!valid) {
+    file_unmap(&file);
+    return entry;
+  }
+
+  char *data = file.contents.data + sizeof(HttpCacheEntryHeader);
+  String8 method = { .data = data, .length = header->method_length };
+  String8 url = { .data = data + header->method_length, .length = header->url_length };
+  if (header->body_hash != key.body_hash || !string8_equals(method, key.method) || !string8_equals(url, key.url)) {
+    file_unmap(&file);
+    return entry;  // another request's entry, the hashes collide
+  }
+  data += header->method_length + header->url_length;
+
+  if (cache->mapping_count == cache->mapping_capacity) {
+    cache->mapping_capacity = cache->mapping_capacity ? cache->mapping_capacity * 2 : 16;
+    cache->mappings = realloc(cache->mappings, cache->mapping_capacity * sizeof(HttpCacheMapping));
+    assert(cache->mappings != NULL);
+  }
+  cache->mappings[cache->mapping_count++] = (HttpCacheMapping){ .key = key.hash, .file = file };
+
+  entry.found = true;
+  entry.header = *header;
+  entry.etag = (String8){ .data = data, .length = header->etag_length };
+  data += header->etag_length;
+  entry.last_modified = (String8){ .data = data, .length = header->last_modified_length };
+  data += header->last_modified_length;
+  entry.body = (String8){ .data = data, .length = header->body_length };
+  return entry;
+}
+
+bool http_cache_is_fresh(HttpCache *cache, HttpCacheEntryHeader *header) {
+  return (cache->now() - header->stored_at) < header->max_age;
+}
+
+static i64 __http_cache_now(void) {
+  return (i64)time(NULL);
+}
+
+static u64 __fnv1a(u64 hash, String8 s) {
+  for (u64 i = 0; i < s.length; i++) {
+    hash ^= (u8)s.data[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+static void __http_cache_path(HttpCache *cache, u64 key, char *suffix, char *path) {
+  snprintf(path, HTTP_CACHE_PATH_MAX, "%s/%016llx%s", cache->dir.data, (unsigned long long)key, suffix);
+}
+
+/* unmaps the entry handed out for `key`, if any, the last mapping takes its slot */
+static void __http_cache_release(HttpCache *cache, u64 key) {
+  for (u32 i = 0; i < cache->mapping_count; i++) {
+    if (cache->mappings[i].key == key) {
+      file_unmap(&(cache->mappings[i].file));
+      cache->mappings[i] = cache->mappings[--cache->mapping_count];
+      return;
+    }
+  }
+}
+
+static bool __http_cache_is_refreshing(HttpCache *cache, u64 key) {
+  for (u32 i = 0; i < cache->refreshing_count; i++) {
+    if (cache->refreshing[i] == key) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/* sets max_age (-1 for no-store) and stale_while_revalidate from the response */
+static void __http_cache_freshness(HttpCache *cache, HttpResponse *response, HttpCacheEntryHeader *header) {
+  HttpCacheControl control = http_cache_control_parse(http_response_get_header(response, STRING8("Cache-Control")));
+  if (cache->ignore_cache_control) {
+    control = (HttpCacheControl){ .max_age = -1, .stale_while_revalidate = -1 };
+  }
+
+  header->max_age = control.max_age >= 0 ? control.max_age : cache->default_max_age;
+  if (control.no_cache) {
+    header->max_age = 0;  // stored, but revalidated every time
+  }
+  if (control.no_store) {
+    header->max_age = -1;
+  }
+
+  header->stale_while_revalidate = control.stale_while_revalidate >= 0
+    ? control.stale_while_revalidate
+    : cache->stale_while_revalidate;
+}
+
+/* a 304 only renews the entry, rewrite its header in place */
+static bool __http_cache_touch(HttpCache *cache, u64 key, HttpCacheEntryHeader header, HttpResponse response) {
+  header.stored_at = cache->now();
+  __http_cache_freshness(cache, &response, &header);
+  if (header.max_age < 0) {
+    header.max_age = 0;
+  }
+
+  char path[HTTP_CACHE_PATH_MAX];
+  __http_cache_path(cache, key, "", path);
+  i32 fd = open(path, O_WRONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  // a fresh fd is at offset 0, the header is the start of the file
+  bool ok = write(fd, &header, sizeof(header)) == sizeof(header);
+  close(fd);
+  return ok;
+}
+
+/* a cached body arrives all at once, streaming callers see it in one call */
+static HttpResponse __http_cache_response(HttpRequest request, HttpCacheEntry entry) {
+  if (request.on_body != NULL) {
+    request.on_body(entry.body, request.on_body_context);
+  }
+  return (HttpResponse){ .status = entry.header.status, .body = entry.body };
+}
+
+/* `request` with If-None-Match/If-Modified-Since for the entry's validators */
+static HttpRequest __http_cache_conditional(HttpRequest request, HttpCacheEntry entry, MemoryArena *arena) {
+  arena_align(arena, sizeof(u64));
+  String8 *headers = arena_push(arena, (request.header_count + 2) * sizeof(String8));
+  if (request.header_count > 0) {
+    memcpy(headers, request.headers, request.header_count * sizeof(String8));
+  }
+
+  usize count = request.header_count;
+  if (entry.etag.length) {
+    headers[count++] = string8_concat(arena, STRING8("If-None-Match: "), entry.etag);
+  }
+  if (entry.last_modified.length) {
+    headers[count++] = string8_concat(arena, STRING8("If-Modified-Since: "), entry.last_modified);
+  }
+
+  request.headers = headers;
+  request.header_count = count;
+  return request;
+}
+
+/*
+ * Submits a conditional request for a stale entry. Everything the request
+ * points to is copied to the refresh's own arena since the caller's request
+ * is gone by the time it runs.
+ */
+static void __http_cache_refresh(HttpCache *cache, HttpCacheKey key, HttpRequest request, HttpCacheEntry entry) {
+  if (__http_cache_is_refreshing(cache, key.hash)) {
+    return;  // the one in flight will renew the entry
+  }
+
+  MemoryArena *arena = arena_create(HTTP_CACHE_REFRESH_ARENA_BYTES);
+  HttpCacheRefresh *refresh = arena_push(arena, sizeof(HttpCacheRefresh));
+  refresh->cache = cache;
+  refresh->arena = arena;
+  refresh->key = key;
+  refresh->key.method = string8_clone(arena, key.method);
+  refresh->key.url = string8_clone(arena, key.url);
+  refresh->header = entry.header;
+
+  HttpRequest copy = {
+    .method = refresh->key.method,
+    .uri = refresh->key.url,
+    .body = string8_clone(arena, request.body),
+    .params = NULL,
+    .param_count = 0,
+  };
+
+  arena_align(arena, sizeof(u64));
+  copy.headers = arena_push(arena, request.header_count * sizeof(String8));
+  copy.header_count = request.header_count;
+  for (usize i = 0; i < request.header_count; i++) {
+    copy.headers[i] = string8_clone(arena, request.headers[i]);
+  }
+  copy = __http_cache_conditional(copy, entry, arena);
+
+  HttpHandle handle = http_submit(cache->async, copy, arena, __http_cache_on_refresh, refresh);
+  if (handle.slot < 0) {
+    arena_destroy(arena);
+    return;
+  }
+
+  if (cache->refreshing_count == cache->refreshing_capacity) {
+    cache->refreshing_capacity = cache->refreshing_capacity ? cache->refreshing_capacity * 2 : 16;
+    cache->refreshing = realloc(cache->refreshing, cache->refreshing_capacity * sizeof(u64));
+    assert(cache->refreshing != NULL);
+  }
+  cache->refreshing[cache->refreshing_count++] = key.hash;
+}
+
+static void __http_cache_on_refresh(HttpResponse response, void *context) {
+  HttpCacheRefresh *refresh = (HttpCacheRefresh *)context;
+  HttpCache *cache = refresh->cache;
+  for (u32 i = 0; i < cache->refreshing_count; i++) {
+    if (cache->refreshing[i] == refresh->key.hash) {
+      cache->refreshing[i] = cache->refreshing[--cache->refreshing_count];
+      break;
+    }
+  }
+
+  if (response.status == 304) {
+    __http_cache_touch(refresh->cache, refresh->key.hash, refresh->header, response);
+  } else {
+    http_cache_store(refresh->cache, refresh->key, response);
+  }
+  arena_destroy(refresh->arena);
+}
+
+/* parses a non negative number of seconds, optionally quoted */
+static i64 __parse_seconds(String8 s) {
+  u64 i = (s.length > 0 && s.data[0] == '"') ? 1 : 0;
+  i64 seconds = 0;
+  bool has_digits = false;
+
+  for (; i < s.length && s.data[i] >= '0' && s.data[i] <= '9'; i++) {
+    seconds = (seconds * 10) + (s.data[i] - '0');
+    has_digits = true;
+  }
+  return has_digits ? seconds : -1;
+}
+
+#endif
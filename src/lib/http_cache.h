@@ -0,0 +1,114 @@
+#ifndef __HTTP_CACHE_H__
+#define __HTTP_CACHE_H__
+
+/*
+  http_cache.h - an on-disk cache in front of an HttpClient.
+
+  Responses are stored one file per request, named after a hash of the
+  method, url (with its query params) and body, so POST requests with the
+  same body (i.e. searches) hit the same entry. Request headers are not part
+  of the key. The entry keeps the method, url and a hash of the body too, a
+  request whose hash collides with another's misses instead of getting the
+  other's response.
+
+  An entry file is laid out to be mapped and used in place:
+
+    [ HttpCacheEntryHeader | method | url | etag | last-modified | body | \0 ]
+
+  so a fresh hit is an open + mmap and the body is returned without being
+  read or copied. The cache keeps one mapping per entry, a body stays valid
+  until its entry is looked up again or the cache is destroyed (replacing
+  the entry, i.e. a background refresh, leaves the old mapping alone).
+
+  Freshness follows the response's Cache-Control (max-age, no-cache,
+  no-store, stale-while-revalidate), stale entries are revalidated with
+  If-None-Match/If-Modified-Since and a 304 only refreshes the entry's
+  timestamps. With a stale-while-revalidate window and an HttpAsync, stale
+  entries are returned right away and refreshed in the background.
+*/
+
+#include <stdbool.h>
+
+#include "base.h"
+#include "file.h"
+#include "http.h"
+
+#define HTTP_CACHE_MAGIC   0x48434531  // "HCE1"
+#define HTTP_CACHE_VERSION 2
+#define HTTP_CACHE_REFRESH_ARENA_BYTES (8 * MB)  // per background refresh, responses are ~3MB
+
+typedef struct HttpCacheControl {
+  i64 max_age;                 // seconds, -1 when not given
+  i64 stale_while_revalidate;  // seconds, -1 when not given
+  bool no_store;
+  bool no_cache;
+} HttpCacheControl;
+
+typedef struct HttpCacheKey {
+  u64 hash;                    // of all three, names the entry's file
+  String8 method;
+  String8 url;                 // with its query params
+  u64 body_hash;
+} HttpCacheKey;
+
+typedef struct HttpCacheEntryHeader {
+  u32 magic;
+  u32 version;
+  u64 key;                     // HttpCacheKey.hash
+  u64 body_hash;
+  u64 method_length;
+  u64 url_length;
+  i64 stored_at;               // unix seconds, updated on revalidation
+  i64 max_age;
+  i64 stale_while_revalidate;
+  u64 status;
+  u64 etag_length;
+  u64 last_modified_length;
+  u64 body_length;
+} HttpCacheEntryHeader;
+
+typedef struct HttpCacheEntry {
+  bool found;
+  HttpCacheEntryHeader header;
+  String8 etag;           // slices of the mapped entry
+  String8 last_modified;
+  String8 body;           // null terminated
+} HttpCacheEntry;
+
+typedef struct HttpCacheMapping {
+  u64 key;
+  MappedFile file;
+} HttpCacheMapping;
+
+typedef struct HttpCache {
+  HttpClient *client;
+  HttpAsync *async;              // optional, used for background refreshes
+  String8 dir;
+
+  i64 default_max_age;           // seconds, for responses without a max-age
+  i64 stale_while_revalidate;    // seconds, for responses that don't say
+  bool ignore_cache_control;     // always use the two above, for apis that say no-cache for everything
+
+  i64 (*now)(void);              // unix seconds, replaceable for tests
+
+  HttpCacheMapping *mappings;    // entries handed out, at most one per key
+  u32 mapping_count;
+  u32 mapping_capacity;
+
+  u64 *refreshing;               // keys with a background refresh in flight
+  u32 refreshing_count;
+  u32 refreshing_capacity;
+} HttpCache;
+
+HttpCache        http_cache_create(HttpClient *client, String8 dir);
+void             http_cache_destroy(HttpCache *cache);
+HttpResponse     http_cache_request(HttpCache *cache, HttpRequest request, MemoryArena *arena);
+i32              http_cache_run(HttpCache *cache, i32 timeout_ms);
+
+HttpCacheKey     http_cache_key(HttpRequest request, MemoryArena *arena);
+HttpCacheControl http_cache_control_parse(String8 value);
+bool             http_cache_store(HttpCache *cache, HttpCacheKey key, HttpResponse response);
+HttpCacheEntry   http_cache_lookup(HttpCache *cache, HttpCacheKey key);
+bool             http_cache_is_fresh(HttpCache *cache, HttpCacheEntryHeader *header);
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef _HUD_H_
+#define _HUD_H_
+
+/*
+  hud.h - an on-screen performance overlay.
+
+  The hud keeps the timings of the last HUD_SAMPLES frames and draws, into
+  a small bitmap of its own (the layer), the frame rate, a graph of where
+  each frame's time went, how full the tracked arenas got and how often the
+  tracked font found its glyphs preloaded.
+
+  It never draws on the screen it measures: the runtime shows the layer on
+  top of the screen when presenting (see runtime_attach_hud, toggled with
+  RUNTIME_HUD_KEY). The layer is only redrawn every HUD_REFRESH_MS, in
+  between a frame costs the hud a copy of its timings.
+*/
+
+#include <stdio.h>
+
+#include "base.h"
+#include "draw.h"
+#include "font.h"
+
+#define HUD_WIDTH       248   // a 2px bar per frame
+#define HUD_HEIGHT      176
+#define HUD_SAMPLES     120   // frames in the graph, 2 seconds at 60 fps
+#define HUD_REFRESH_MS  250
+#define HUD_MAX_ARENAS  4
+#define HUD_PADDING     4
+#define HUD_GRAPH_H     48
+#define HUD_GRAPH_MS    33.3  // the top of the graph, 2 frames at 60 fps
+#define HUD_BUDGET_MS   16.7
+
+#define HUD_BACKGROUND  0x101018C0
+#define HUD_BUDGET_LINE 0xFFFFFF60
+
+typedef enum HudTiming {
+  HUD_STEP,     // on_step
+  HUD_EVENTS,   // input callbacks
+  HUD_UPLOAD,   // the screen to the gpu
+  HUD_PRESENT,
+  HUD_TIMING_COUNT,
+} HudTiming;
+
+typedef struct HudFrame {
+  f64 frame_ms;  // from the start of this frame to the start of the next one
+  f64 ms[HUD_TIMING_COUNT];
+} HudFrame;
+
+typedef struct HudArena {
+  char *name;
+  MemoryArena *arena;
+} HudArena;
+
+typedef struct Hud {
+  bool is_visible;
+  bool is_dirty;        // the layer was redrawn since the runtime last showed it
+
+  Bitmap layer;
+  Font *font;           // the hud's text, NULL draws the graph only
+  Font *tracked_font;   // whose glyph hits are shown
+
+  HudFrame frames[HUD_SAMPLES];
+  u64 frame_count;
+  f64 since_redraw_ms;
+
+  HudArena arenas[HUD_MAX_ARENAS];
+  i32 arena_count;
+} Hud;
+
+Hud  hud_create(MemoryArena *arena, Font *font);
+void hud_track_arena(Hud *hud, char *name, MemoryArena *arena);
+void hud_track_font(Hud *hud, Font *font);
+bool hud_frame(Hud *hud, HudFrame frame);
+void hud_draw(Hud *hud);
+
+static Point __hud_text(Hud *hud, Point at, char *text);
+static f64   __hud_fps(Hud *hud);
+
+static const Color hud_colors[HUD_TIMING_COUNT] = {
+  [HUD_STEP]    = PALETTE_PALE_GREY_BLUE,
+  [HUD_EVENTS]  = PALETTE_MED_GREEN,
+  [HUD_UPLOAD]  = PALETTE_DARK_YELLOW,
+  [HUD_PRESENT] = PALETTE_PURPLE_BLUE,
+};
+static char *hud_names[HUD_TIMING_COUNT] = { "step", "events", "upload", "present" };
+
+Hud hud_create(MemoryArena *arena, Font *font) {
+  return (Hud){
+    .is_visible = false,
+    .is_dirty = false,
+    .layer = bitmap_create(arena, HUD_WIDTH, HUD_HEIGHT),
+    .font = font,
+    .tracked_font = NULL,
+    .frame_count = 0,
+    .since_redraw_ms = 0,
+    .arena_count = 0,
+  };
+}
+
+void hud_track_arena(Hud *hud, char *name, MemoryArena *arena) {
+  if (hud->arena_count < HUD_MAX_ARENAS) {
+    hud->arenas[hud->arena_count++] = (HudArena){ .name = name, .arena = arena };
+  }
+}
+
+void hud_track_font(Hud *hud, Font *font) {
+  hud->tracked_font = font;
+}
+
+/*
+ * Records a frame's timings, redraws the layer when it's visible and due.
+ * Returns whether it was redrawn.
+ */
+bool hud_frame(Hud *hud, HudFrame frame) {
+  hud->frames[hud->frame_count % HUD_SAMPLES] = frame;
+  hud->frame_count++;
+  hud->since_redraw_ms += frame.frame_ms;
+
+  if (!hud->is_visible || hud->since_redraw_ms < HUD_REFRESH_MS) {
+    return false;
+  }
+  hud_draw(hud);
+  return true;
+}
+
+void hud_draw(Hud *hud) {
+  Bitmap *layer = &(hud->layer);
+  bitmap_fill(layer, HUD_BACKGROUND);
+  hud->since_redraw_ms = 0;
+  hud->is_dirty = true;
+
+  // the hud's own text isn't counted in the glyph hits it shows
+  u64 hits = hud->tracked_font ? hud->tracked_font->glyph_hits : 0;
+  u64 misses = hud->tracked_font ? hud->tracked_font->glyph_misses : 0;
+
+  u64 count = MIN(hud->frame_count, HUD_SAMPLES);
+  HudFrame last = count ? hud->frames[(hud->frame_count - 1) % HUD_SAMPLES] : (HudFrame){ 0 };
+  char text[64];
+  Point at = { HUD_PADDING, HUD_PADDING };
+
+  snprintf(text, sizeof(text), "%.1f fps  %.2f ms", __hud_fps(hud), last.frame_ms);
+  at = __hud_text(hud, at, text);
+
+  for (i32 t = 0; t < HUD_TIMING_COUNT; t += 2) {
+    snprintf(text, sizeof(text), "%-7s %5.2f  %-7s %5.2f", hud_names[t], last.ms[t], hud_names[t + 1], last.ms[t + 1]);
+    at = __hud_text(hud, at, text);
+  }
+
+  for (i32 i = 0; i < hud->arena_count; i++) {
+    MemoryArena *arena = hud->arenas[i].arena;
+    snprintf(text, sizeof(text), "%-7s %.1f MB, peak %.1f/%.1f", hud->arenas[i].name,
+             (f64)arena->position / MB, (f64)arena->high_water / MB, (f64)arena->capacity / MB);
+    at = __hud_text(hud, at, text);
+  }
+
+  if (hud->tracked_font != NULL) {
+    f64 rate = hits + misses ? (100.0 * hits) / (hits + misses) : 100.0;
+    snprintf(text, sizeof(text), "glyphs  %.2f%% hit (%llu missed)", rate, (unsigned long long)misses);
+    at = __hud_text(hud, at, text);
+    hud->tracked_font->glyph_hits = hits;
+    hud->tracked_font->glyph_misses = misses;
+  }
+
+  // a bar per frame, oldest on the left, each timing stacked on the previous one
+  i32 bar_w = MAX(1, (layer->w - (2 * HUD_PADDING)) / HUD_SAMPLES);
+  i32 bottom = layer->h - HUD_PADDING;
+  f64 px_per_ms = HUD_GRAPH_H / HUD_GRAPH_MS;
+  for (u64 i = 0; i < count; i++) {
+    HudFrame *frame = &(hud->frames[(hud->frame_count - count + i) % HUD_SAMPLES]);
+    i32 x = HUD_PADDING + ((HUD_SAMPLES - count + i) * bar_w);
+    i32 y = bottom;
+    for (i32 t = 0; t < HUD_TIMING_COUNT; t++) {
+      i32 h = (i32)(frame->ms[t] * px_per_ms + 0.5);
+      i32 top = MAX(bottom - HUD_GRAPH_H, y - h);
+      bitmap_fill_rect(layer, (Rect){ { x, top }, { x + bar_w, y } }, hud_colors[t]);
+      y = top;
+    }
+  }
+  i32 budget_y = bottom - (i32)(HUD_BUDGET_MS * px_per_ms);
+  bitmap_fill_rect(layer, (Rect){ { HUD_PADDING, budget_y }, { layer->w - HUD_PADDING, budget_y + 1 } }, HUD_BUDGET_LINE);
+}
+
+/* draws a line of text at `at`, returns where the next line goes */
+static Point __hud_text(Hud *hud, Point at, char *text) {
+  if (hud->font == NULL) {
+    return at;
+  }
+
+  Point pen = { at.x, at.y + hud->font->h };  // glyphs are drawn from their baseline
+  for (char *c = text; *c != '\0' && pen.x < hud->layer.w; c++) {
+    pen.x += font_render_char(hud->font, *c, &(hud->layer), pen, PALETTE_WHITE).x_advance;
+  }
+  return (Point){ at.x, at.y + hud->font->h + 2 };
+}
+
+/* over the frames in the graph */
+static f64 __hud_fps(Hud *hud) {
+  u64 count = MIN(hud->frame_count, HUD_SAMPLES);
+  f64 total_ms = 0;
+  for (u64 i = 0; i < count; i++) {
+    total_ms += hud->frames[i].frame_ms;
+  }
+  return total_ms > 0 ? (1000.0 * count) / total_ms : 0;
+}
+
+#endif
@@ -0,0 +1,688 @@
+#ifndef _JSON_SCAN_H_
+#define _JSON_SCAN_H_
+
+/*
+  json_scan.h - a streaming, allocation free json scanner.
+
+  Instead of building a tree of the whole document, the scanner walks the
+  input once and hands out tokens whose values are slices of the input:
+  strings are NOT unescaped (and not null terminated) until the caller asks
+  for it with `json_string_decode`, numbers are left as text.
+
+  On top of the tokens, `json_scan_match` takes a list of path patterns and
+  only reports the values found at those paths, i.e.
+
+    contents.sectionListRenderer.contents[*].videoRenderer.videoId
+
+  Containers that no pattern can reach are skipped without being tokenized,
+  only their brackets and strings are looked at, 8 bytes at a time. That is
+  the bulk of a typical api response.
+
+  Pattern syntax: segments are separated by '.', a segment is a key or '*'
+  (any key) optionally followed by any number of '[N]' or '[*]' (any index).
+  Keys are compared with the raw (still escaped) keys of the document.
+
+  The input doesn't have to be complete: a document can be scanned while
+  it's downloaded. `json_scan_feed` hands the scanner everything received
+  so far (the same buffer, grown, or a copy of it), a token cut by the end
+  of the input is JSON_NEED_MORE and is read again from its start after
+  the next feed.
+*/
+
+#include "base.h"
+
+#define JSON_SCAN_MAX_DEPTH       64
+#define JSON_PATTERN_MAX_SEGMENTS 16
+#define JSON_SCAN_MAX_PATTERNS    64  // live patterns are tracked in a u64
+
+typedef enum JsonToken {
+  JSON_NONE,
+  JSON_OBJECT_BEGIN,
+  JSON_OBJECT_END,
+  JSON_ARRAY_BEGIN,
+  JSON_ARRAY_END,
+  JSON_KEY,
+  JSON_STRING,
+  JSON_NUMBER,
+  JSON_TRUE,
+  JSON_FALSE,
+  JSON_NULL,
+  JSON_END,        // the document is complete
+  JSON_ERROR,
+  JSON_NEED_MORE,  // the input ends in the middle of the document, see json_scan_feed
+} JsonToken;
+
+/* what the scanner accepts next */
+typedef enum JsonExpect {
+  JSON_EXPECT_VALUE,
+  JSON_EXPECT_VALUE_OR_END,  // right after '['
+  JSON_EXPECT_KEY,
+  JSON_EXPECT_KEY_OR_END,    // right after '{'
+  JSON_EXPECT_COLON,
+  JSON_EXPECT_COMMA_OR_END,
+  JSON_EXPECT_DONE,
+} JsonExpect;
+
+typedef struct JsonFrame {
+  bool is_array;
+  u64  start;     // offset of the opening bracket
+  String8 key;    // of the current member, objects only
+  i64  index;     // of the current element, arrays only
+  u64  live;      // patterns that can still match below this container
+  u64  matched;   // patterns that matched this container
+} JsonFrame;
+
+typedef struct JsonScanner {
+  String8 input;
+  u64 position;
+  JsonExpect expect;
+  bool is_partial;       // more input may follow
+
+  // a container being skipped, see json_scan_skip
+  bool is_skipping;
+  u64 skip_position;
+  i64 skip_depth;
+
+  i32 depth;      // open containers
+  JsonFrame frames[JSON_SCAN_MAX_DEPTH];
+
+  // the last token, `value` is a slice of `input`: the chars between the
+  // quotes of strings and keys, the text of numbers and literals, the whole
+  // container for OBJECT_END/ARRAY_END
+  JsonToken token;
+  String8 value;
+} JsonScanner;
+
+typedef enum JsonSegmentKind {
+  JSON_SEGMENT_KEY,
+  JSON_SEGMENT_ANY_KEY,
+  JSON_SEGMENT_INDEX,
+  JSON_SEGMENT_ANY_INDEX,
+} JsonSegmentKind;
+
+typedef struct JsonSegment {
+  JsonSegmentKind kind;
+  String8 key;
+  i64 index;
+} JsonSegment;
+
+typedef struct JsonPattern {
+  i32 segment_count;
+  JsonSegment segments[JSON_PATTERN_MAX_SEGMENTS];
+} JsonPattern;
+
+typedef enum JsonEvent {
+  JSON_MATCH_VALUE,  // a string, number or literal
+  JSON_MATCH_BEGIN,  // a container opened, its members follow
+  JSON_MATCH_END,    // a container closed, `value` is all of it
+} JsonEvent;
+
+typedef struct JsonMatch {
+  i32 pattern;       // index in the patterns passed to `json_scan_match`
+  JsonEvent event;
+  JsonToken token;
+  String8 value;
+} JsonMatch;
+
+typedef void (*JsonMatchCallback)(JsonMatch *match, void *context);
+
+JsonScanner json_scan_create(String8 input);
+void        json_scan_feed(JsonScanner *s, String8 input, bool is_last);
+JsonToken   json_scan_next(JsonScanner *s);
+JsonToken   json_scan_skip(JsonScanner *s);
+JsonToken   json_scan_match(JsonScanner *s, JsonPattern *patterns, i32 pattern_count, JsonMatchCallback callback, void *context);
+JsonPattern json_pattern(String8 path);
+String8     json_string_decode(MemoryArena *arena, String8 raw);
+
+JsonToken   __json_scan_token(JsonScanner *s, JsonToken token, u64 start, u64 end);
+JsonToken   __json_scan_error(JsonScanner *s);
+JsonToken   __json_scan_truncated(JsonScanner *s);
+void        __json_scan_member(JsonScanner *s);
+void        __json_scan_close(JsonScanner *s);
+void        __json_scan_value_end(JsonScanner *s);
+u64         __json_skip_whitespace(String8 input, u64 position);
+u64         __json_string_end(String8 input, u64 position);
+bool        __json_container_end(String8 input, u64 *position, i64 *depth);
+bool        __json_segment_matches(JsonSegment *segment, JsonFrame *frame);
+u64         __json_live_patterns(JsonPattern *patterns, i32 pattern_count, u64 live, i32 level, JsonFrame *frame);
+void        __json_emit(JsonMatchCallback callback, void *context, u64 patterns, JsonEvent event, JsonToken token, String8 value);
+i32         __json_utf8_encode(u32 codepoint, char *out);
+i32         __json_hex4(char *s, u32 *out);
+
+/* --- implementation --- */
+
+/* a scanner over `input`, which has to outlive every slice it hands out */
+JsonScanner json_scan_create(String8 input) {
+  return (JsonScanner){
+    .input = input,
+    .position = 0,
+    .expect = JSON_EXPECT_VALUE,
+    .is_partial = false,
+    .is_skipping = false,
+    .depth = 0,
+    .token = JSON_NONE,
+    .value = { .data = input.data, .length = 0 },
+  };
+}
+
+/*
+ * Gives the scanner all the input received so far, `input` starts with
+ * the bytes it already had but may have moved. After the last feed the
+ * end of the input is the end of the document.
+ */
+void json_scan_feed(JsonScanner *s, String8 input, bool is_last) {
+  // the keys of the open containers are the only slices the scanner keeps
+  if (s->input.data != NULL && input.data != s->input.data) {
+    for (i32 i = 0; i < s->depth; i++) {
+      if (s->frames[i].key.data != NULL) {
+        s->frames[i].key.data = input.data + (s->frames[i].key.data - s->input.data);
+      }
+    }
+  }
+
+  s->input = input;
+  s->is_partial = !is_last;
+}
+
+/*
+ * Reads the next token. Commas and colons are consumed (and checked) on the
+ * way, JSON_ERROR is sticky and leaves `position` on the offending char.
+ */
+JsonToken json_scan_next(JsonScanner *s) {
+  if (s->token == JSON_ERROR || s->token == JSON_END) {
+    return s->token;
+  }
+  if (s->is_skipping) {
+    return json_scan_skip(s);
+  }
+
+  for (;;) {
+    u64 p = __json_skip_whitespace(s->input, s->position);
+    s->position = p;
+
+    if (p >= s->input.length) {
+      return s->expect == JSON_EXPECT_DONE ? __json_scan_token(s, JSON_END, p, p) : __json_scan_truncated(s);
+    }
+
+    char c = s->input.data[p];
+    switch (s->expect) {
+    case JSON_EXPECT_DONE:
+      return __json_scan_error(s);
+
+    case JSON_EXPECT_COLON:
+      if (c != ':') return __json_scan_error(s);
+      s->position++;
+      s->expect = JSON_EXPECT_VALUE;
+      continue;
+
+    case JSON_EXPECT_COMMA_OR_END:
+      if (c == ',') {
+        s->position++;
+        s->expect = s->frames[s->depth - 1].is_array ? JSON_EXPECT_VALUE : JSON_EXPECT_KEY;
+        continue;
+      }
+      if (c != '}' && c != ']') return __json_scan_error(s);
+      break;
+
+    case JSON_EXPECT_KEY_OR_END:
+      if (c == '}') break;
+      // fallthrough
+    case JSON_EXPECT_KEY: {
+      if (c != '"') return __json_scan_error(s);
+      u64 end = __json_string_end(s->input, p + 1);
+      if (end >= s->input.length) return __json_scan_truncated(s);
+
+      JsonFrame *frame = &(s->frames[s->depth - 1]);
+      frame->key = (String8){ .data = s->input.data + p + 1, .length = end - (p + 1) };
+      s->expect = JSON_EXPECT_COLON;
+      return __json_scan_token(s, JSON_KEY, p + 1, end);
+    }
+
+    case JSON_EXPECT_VALUE_OR_END:
+      if (c == ']') break;
+      // fallthrough
+    case JSON_EXPECT_VALUE:
+      if (c == '}' || c == ']') return __json_scan_error(s);
+      break;
+    }
+
+    // closing brackets
+    if (c == '}' || c == ']') {
+      JsonFrame *frame = &(s->frames[s->depth - 1]);
+      if (frame->is_array != (c == ']')) return __json_scan_error(s);
+
+      __json_scan_close(s);
+      return __json_scan_token(s, frame->is_array ? JSON_ARRAY_END : JSON_OBJECT_END, frame->start, p + 1);
+    }
+
+    // values, the element count of an array only moves once a value is complete
+    switch (c) {
+    case '{':
+    case '[': {
+      if (s->depth == JSON_SCAN_MAX_DEPTH) return __json_scan_error(s);
+
+      __json_scan_member(s);
+      JsonFrame *frame = &(s->frames[s->depth++]);
+      *frame = (JsonFrame){ .is_array = (c == '['), .start = p, .key = { 0 }, .index = -1 };
+      s->expect = c == '[' ? JSON_EXPECT_VALUE_OR_END : JSON_EXPECT_KEY_OR_END;
+      return __json_scan_token(s, c == '[' ? JSON_ARRAY_BEGIN : JSON_OBJECT_BEGIN, p, p + 1);
+    }
+
+    case '"': {
+      u64 end = __json_string_end(s->input, p + 1);
+      if (end >= s->input.length) return __json_scan_truncated(s);
+
+      __json_scan_value_end(s);
+      s->position = end + 1;
+      s->token = JSON_STRING;
+      s->value = (String8){ .data = s->input.data + p + 1, .length = end - (p + 1) };
+      return s->token;
+    }
+
+    case 't':
+    case 'f':
+    case 'n': {
+      String8 rest = { .data = s->input.data + p, .length = s->input.length - p };
+      JsonToken token = c == 't' ? JSON_TRUE : c == 'f' ? JSON_FALSE : JSON_NULL;
+      String8 literal = c == 't' ? STRING8("true") : c == 'f' ? STRING8("false") : STRING8("null");
+      if (!string8_startswith(rest, literal)) {
+        bool is_cut = rest.length < literal.length && string8_startswith(literal, rest);
+        return is_cut ? __json_scan_truncated(s) : __json_scan_error(s);
+      }
+
+      __json_scan_value_end(s);
+      return __json_scan_token(s, token, p, p + literal.length);
+    }
+
+    default: {
+      if (c != '-' && (c < '0' || c > '9')) return __json_scan_error(s);
+
+      u64 end = p + 1;
+      while (end < s->input.length) {
+        char n = s->input.data[end];
+        bool is_number = (n >= '0' && n <= '9') || n == '.' || n == 'e' || n == 'E' || n == '+' || n == '-';
+        if (!is_number) break;
+        end++;
+      }
+      if (end == s->input.length && s->is_partial) {
+        return JSON_NEED_MORE;  // more digits may follow
+      }
+
+      __json_scan_value_end(s);
+      return __json_scan_token(s, JSON_NUMBER, p, end);
+    }
+    }
+  }
+}
+
+/*
+ * Skips the container that was just opened (the last token was
+ * OBJECT_BEGIN or ARRAY_BEGIN) and returns its END token. Skipped members
+ * are only checked for balanced brackets and terminated strings. A skip
+ * cut by the end of the input goes on with the next call (or the next
+ * `json_scan_next`).
+ */
+JsonToken json_scan_skip(JsonScanner *s) {
+  if (!s->is_skipping) {
+    if (s->token != JSON_OBJECT_BEGIN && s->token != JSON_ARRAY_BEGIN) {
+      return s->token;
+    }
+    s->is_skipping = true;
+    s->skip_position = s->frames[s->depth - 1].start;
+    s->skip_depth = 0;
+  }
+
+  if (!__json_container_end(s->input, &(s->skip_position), &(s->skip_depth))) {
+    s->position = s->skip_position;
+    return __json_scan_truncated(s);
+  }
+
+  JsonFrame *frame = &(s->frames[s->depth - 1]);
+  s->is_skipping = false;
+  __json_scan_close(s);
+  return __json_scan_token(s, frame->is_array ? JSON_ARRAY_END : JSON_OBJECT_END, frame->start, s->skip_position + 1);
+}
+
+/*
+ * Scans the document and calls `callback` for every value found at one of
+ * the `patterns`, containers nobody is interested in are skipped. Returns
+ * JSON_END once the document is complete, JSON_ERROR if it's not valid
+ * json, JSON_NEED_MORE when the input ran out: call it again (with the same
+ * patterns) after the next `json_scan_feed`.
+ */
+JsonToken json_scan_match(JsonScanner *s, JsonPattern *patterns, i32 pattern_count, JsonMatchCallback callback, void *context) {
+  assert(pattern_count <= JSON_SCAN_MAX_PATTERNS);
+  u64 all = pattern_count == JSON_SCAN_MAX_PATTERNS ? ~0ULL : (1ULL << pattern_count) - 1;
+
+  for (;;) {
+    JsonToken token = json_scan_next(s);
+    switch (token) {
+    case JSON_END:
+    case JSON_ERROR:
+    case JSON_NEED_MORE:
+      return token;
+    case JSON_KEY:
+      continue;
+
+    case JSON_OBJECT_END:
+    case JSON_ARRAY_END: {
+      JsonFrame *closed = &(s->frames[s->depth]);
+      __json_emit(callback, context, closed->matched, JSON_MATCH_END, token, s->value);
+      continue;
+    }
+
+    default: {
+      // the value is a member of the innermost open container, or the root
+      bool is_container = token == JSON_OBJECT_BEGIN || token == JSON_ARRAY_BEGIN;
+      i32 level = is_container ? s->depth - 1 : s->depth;
+      u64 live = level == 0 ? all : __json_live_patterns(patterns, pattern_count, s->frames[level - 1].live, level - 1, &(s->frames[level - 1]));
+
+      u64 matched = 0;
+      for (u64 bits = live; bits != 0; bits &= bits - 1) {
+        i32 p = __builtin_ctzll(bits);
+        if (patterns[p].segment_count == level) {
+          matched |= 1ULL << p;
+        }
+      }
+
+      if (!is_container) {
+        __json_emit(callback, context, matched, JSON_MATCH_VALUE, token, s->value);
+        continue;
+      }
+
+      JsonFrame *frame = &(s->frames[s->depth - 1]);
+      frame->live = live & ~matched;
+      frame->matched = matched;
+      if (matched == 0 && frame->live == 0) {
+        token = json_scan_skip(s);
+        if (token == JSON_ERROR || token == JSON_NEED_MORE) {
+          return token;
+        }
+        continue;
+      }
+      __json_emit(callback, context, matched, JSON_MATCH_BEGIN, token, s->value);
+    }
+    }
+  }
+}
+
+/* parses a path pattern, its keys are slices of `path` */
+JsonPattern json_pattern(String8 path) {
+  JsonPattern pattern = { .segment_count = 0 };
+
+  u64 i = 0;
+  while (i < path.length) {
+    if (path.data[i] == '.') {
+      i++;
+      continue;
+    }
+
+    if (path.data[i] != '[') {
+      u64 start = i;
+      while (i < path.length && path.data[i] != '.' && path.data[i] != '[') {
+        i++;
+      }
+
+      assert(pattern.segment_count < JSON_PATTERN_MAX_SEGMENTS);
+      JsonSegment *segment = &(pattern.segments[pattern.segment_count++]);
+      segment->key = (String8){ .data = path.data + start, .length = i - start };
+      segment->kind = (segment->key.length == 1 && segment->key.data[0] == '*') ? JSON_SEGMENT_ANY_KEY : JSON_SEGMENT_KEY;
+      continue;
+    }
+
+    // '[N]' or '[*]'
+    assert(pattern.segment_count < JSON_PATTERN_MAX_SEGMENTS);
+    JsonSegment *segment = &(pattern.segments[pattern.segment_count++]);
+    segment->kind = JSON_SEGMENT_INDEX;
+    segment->index = 0;
+    for (i++; i < path.length && path.data[i] != ']'; i++) {
+      if (path.data[i] == '*') {
+        segment->kind = JSON_SEGMENT_ANY_INDEX;
+      } else {
+        segment->index = (segment->index * 10) + (path.data[i] - '0');
+      }
+    }
+    i++;
+  }
+  return pattern;
+}
+
+/*
+ * Copies the raw contents of a json string into `arena`, resolving its
+ * escapes (\uXXXX becomes utf-8). The copy is null terminated.
+ */
+String8 json_string_decode(MemoryArena *arena, String8 raw) {
+  // escapes only ever shrink, the raw length is enough
+  char *out = arena_push(arena, raw.length + 1);
+  u64 length = 0;
+
+  for (u64 i = 0; i < raw.length; i++) {
+    char c = raw.data[i];
+    if (c != '\\' || i + 1 == raw.length) {
+      out[length++] = c;
+      continue;
+    }
+
+    c = raw.data[++i];
+    switch (c) {
+    case 'b': out[length++] = '\b'; break;
+    case 'f': out[length++] = '\f'; break;
+    case 'n': out[length++] = '\n'; break;
+    case 'r': out[length++] = '\r'; break;
+    case 't': out[length++] = '\t'; break;
+    case 'u': {
+      u32 codepoint = 0;
+      if (i + 4 >= raw.length || !__json_hex4(raw.data + i + 1, &codepoint)) {
+        out[length++] = 'u';
+        break;
+      }
+      i += 4;
+
+      // a high surrogate followed by a low one is a single codepoint
+      u32 low = 0;
+      bool is_pair = codepoint >= 0xD800 && codepoint <= 0xDBFF
+        && i + 6 < raw.length && raw.data[i + 1] == '\\' && raw.data[i + 2] == 'u'
+        && __json_hex4(raw.data + i + 3, &low) && low >= 0xDC00 && low <= 0xDFFF;
+      if (is_pair) {
+        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+        i += 6;
+      }
+      length += __json_utf8_encode(codepoint, out + length);
+      break;
+    }
+    default:  // '"', '\\' and '/'
+      out[length++] = c;
+      break;
+    }
+  }
+
+  out = arena_grow(arena, out, raw.length + 1, length + 1);
+  out[length] = 0;
+  return (String8){ .data = out, .length = length };
+}
+
+JsonToken __json_scan_token(JsonScanner *s, JsonToken token, u64 start, u64 end) {
+  s->position = token == JSON_KEY ? end + 1 : end;
+  s->token = token;
+  s->value = (String8){ .data = s->input.data + start, .length = end - start };
+  return token;
+}
+
+JsonToken __json_scan_error(JsonScanner *s) {
+  s->token = JSON_ERROR;
+  s->value = (String8){ .data = s->input.data + s->position, .length = 0 };
+  return JSON_ERROR;
+}
+
+/* the input ends in the middle of a token, it's read again after the next feed */
+JsonToken __json_scan_truncated(JsonScanner *s) {
+  return s->is_partial ? JSON_NEED_MORE : __json_scan_error(s);
+}
+
+/* a value starts, array elements are counted */
+void __json_scan_member(JsonScanner *s) {
+  if (s->depth > 0 && s->frames[s->depth - 1].is_array) {
+    s->frames[s->depth - 1].index++;
+  }
+}
+
+/* a complete string, number or literal was read */
+void __json_scan_value_end(JsonScanner *s) {
+  __json_scan_member(s);
+  s->expect = s->depth > 0 ? JSON_EXPECT_COMMA_OR_END : JSON_EXPECT_DONE;
+}
+
+/* pops the innermost container, its frame stays readable until the next open */
+void __json_scan_close(JsonScanner *s) {
+  s->depth--;
+  s->expect = s->depth > 0 ? JSON_EXPECT_COMMA_OR_END : JSON_EXPECT_DONE;
+}
+
+/* true for every byte of `x` equal to `b` (high bit set), see "Bit Twiddling Hacks" */
+#define __JSON_ONES  0x0101010101010101ULL
+#define __JSON_HIGHS 0x8080808080808080ULL
+#define __JSON_HAS_BYTE(x, b) ((((x) ^ (__JSON_ONES * (u8)(b))) - __JSON_ONES) & ~((x) ^ (__JSON_ONES * (u8)(b))) & __JSON_HIGHS)
+
+u64 __json_skip_whitespace(String8 input, u64 position) {
+  // indentation comes in long runs of spaces
+  while (position + 8 <= input.length) {
+    u64 word;
+    memcpy(&word, input.data + position, 8);
+    if (word != __JSON_ONES * (u8)' ') break;
+    position += 8;
+  }
+
+  while (position < input.length) {
+    char c = input.data[position];
+    if (c != ' ' && c != '\n' && c != '\r' && c != '\t') break;
+    position++;
+  }
+  return position;
+}
+
+/* offset of the closing quote of the string whose contents start at `position` */
+u64 __json_string_end(String8 input, u64 position) {
+  for (;;) {
+    while (position + 8 <= input.length) {
+      u64 word;
+      memcpy(&word, input.data + position, 8);
+      if (__JSON_HAS_BYTE(word, '"') | __JSON_HAS_BYTE(word, '\\')) break;
+      position += 8;
+    }
+
+    while (position < input.length && input.data[position] != '"' && input.data[position] != '\\') {
+      position++;
+    }
+
+    if (position >= input.length || input.data[position] == '"') {
+      return position;
+    }
+    position += 2;  // an escaped char
+  }
+}
+
+/*
+ * Moves `position` to the bracket closing the container, `depth` counts the
+ * containers opened since the skip started. Returns false when the input
+ * runs out first, `position` is then where to go on from.
+ */
+bool __json_container_end(String8 input, u64 *at, i64 *depth) {
+  u64 position = *at;
+  while (position < input.length) {
+    // nothing but brackets and quotes matter, '{' | 0x20 == '[' | 0x20
+    while (position + 8 <= input.length) {
+      u64 word;
+      memcpy(&word, input.data + position, 8);
+      u64 folded = word | (__JSON_ONES * 0x20);
+      if (__JSON_HAS_BYTE(word, '"') | __JSON_HAS_BYTE(folded, '{') | __JSON_HAS_BYTE(folded, '}')) break;
+      position += 8;
+    }
+    if (position >= input.length) break;
+
+    char c = input.data[position];
+    if (c == '"') {
+      u64 end = __json_string_end(input, position + 1);
+      if (end >= input.length) break;  // go on from the opening quote
+      position = end;
+    } else if (c == '{' || c == '[') {
+      (*depth)++;
+    } else if (c == '}' || c == ']') {
+      if (--(*depth) == 0) {
+        *at = position;
+        return true;
+      }
+    }
+    position++;
+  }
+
+  *at = position < input.length ? position : input.length;
+  return false;
+}
+
+bool __json_segment_matches(JsonSegment *segment, JsonFrame *frame) {
+  switch (segment->kind) {
+  case JSON_SEGMENT_KEY:       return !frame->is_array && string8_equals(segment->key, frame->key);
+  case JSON_SEGMENT_ANY_KEY:   return !frame->is_array;
+  case JSON_SEGMENT_INDEX:     return frame->is_array && segment->index == frame->index;
+  case JSON_SEGMENT_ANY_INDEX: return frame->is_array;
+  }
+  return false;
+}
+
+/* the `live` patterns whose segment at `level` matches the current member of `frame` */
+u64 __json_live_patterns(JsonPattern *patterns, i32 pattern_count, u64 live, i32 level, JsonFrame *frame) {
+  u64 result = 0;
+  for (u64 bits = live; bits != 0; bits &= bits - 1) {
+    i32 p = __builtin_ctzll(bits);
+    if (p < pattern_count && level < patterns[p].segment_count && __json_segment_matches(&(patterns[p].segments[level]), frame)) {
+      result |= 1ULL << p;
+    }
+  }
+  return result;
+}
+
+void __json_emit(JsonMatchCallback callback, void *context, u64 patterns, JsonEvent event, JsonToken token, String8 value) {
+  for (u64 bits = patterns; bits != 0; bits &= bits - 1) {
+    JsonMatch match = { .pattern = __builtin_ctzll(bits), .event = event, .token = token, .value = value };
+    callback(&match, context);
+  }
+}
+
+i32 __json_utf8_encode(u32 codepoint, char *out) {
+  if (codepoint < 0x80) {
+    out[0] = (char)codepoint;
+    return 1;
+  }
+  if (codepoint < 0x800) {
+    out[0] = (char)(0xC0 | (codepoint >> 6));
+    out[1] = (char)(0x80 | (codepoint & 0x3F));
+    return 2;
+  }
+  if (codepoint < 0x10000) {
+    out[0] = (char)(0xE0 | (codepoint >> 12));
+    out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (codepoint & 0x3F));
+    return 3;
+  }
+  out[0] = (char)(0xF0 | (codepoint >> 18));
+  out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+  out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+  out[3] = (char)(0x80 | (codepoint & 0x3F));
+  return 4;
+}
+
+i32 __json_hex4(char *s, u32 *out) {
+  u32 value = 0;
+  for (i32 i = 0; i < 4; i++) {
+    char c = s[i];
+    value <<= 4;
+    if (c >= '0' && c <= '9')      value |= (u32)(c - '0');
+    else if (c >= 'a' && c <= 'f') value |= (u32)(c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F') value |= (u32)(c - 'A' + 10);
+    else return 0;
+  }
+  *out = value;
+  return 1;
+}
+
+#endif
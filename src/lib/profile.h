@@ -0,0 +1,188 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+/*
+  profile.h - scoped timing zones, exported as a chrome trace.
+
+    PROFILE_BEGIN(bitblt);
+    ...
+    PROFILE_END(bitblt);
+
+  A zone reads the cpu's cycle counter when it begins and when it ends and
+  records both (with the zone's name) into a ring buffer owned by the
+  calling thread: a few stores, no allocation and no lock in the hot path.
+  When a ring is full its oldest zones are overwritten. Zones nest, a
+  zone's name is an identifier so its begin and end can't be mismatched.
+
+  profile_export writes every thread's zones in the chrome trace_event
+  format, open it in https://ui.perfetto.dev (or chrome://tracing) to see
+  where a frame or a search spends its time. Cycle counts are converted to
+  time with the rate measured between profile_init and the export.
+
+  Everything compiles to nothing unless PROFILE is defined (make PROFILE=1).
+*/
+
+#include "base.h"
+
+#define PROFILE_MAX_THREADS 8
+#define PROFILE_RING_ZONES  (1 << 16)  // per thread, a power of 2
+
+#ifdef PROFILE
+
+#include <stdio.h>
+#include <sys/time.h>
+
+#define PROFILE_BEGIN(name) u64 __profile_##name = profile_now()
+#define PROFILE_END(name)   profile_record(#name, __profile_##name, profile_now())
+
+typedef struct ProfileZone {
+  const char *name;  // a string literal, see PROFILE_END
+  u64 begin;         // cycles
+  u64 end;
+} ProfileZone;
+
+typedef struct ProfileRing {
+  const char *thread_name;
+  u64 count;         // zones ever recorded, the ring keeps the last PROFILE_RING_ZONES
+  ProfileZone zones[PROFILE_RING_ZONES];
+} ProfileRing;
+
+typedef struct Profile {
+  ProfileRing rings[PROFILE_MAX_THREADS];
+  i32 ring_count;
+  u64 start_cycles;  // at profile_init, to convert cycles to time
+  u64 start_ns;
+} Profile;
+
+void profile_init(void);
+void profile_thread_name(const char *name);
+bool profile_export(String8 path);
+static inline u64 profile_now(void);
+static inline void profile_record(const char *name, u64 begin, u64 end);
+
+static u64          __profile_clock_ns(void);  // µs resolution is plenty to calibrate the counter
+static ProfileRing *__profile_ring(void);
+
+static Profile profile;
+static __thread ProfileRing *profile_ring;  // the calling thread's, taken on its first zone
+
+void profile_init(void) {
+  profile.start_cycles = profile_now();
+  profile.start_ns = __profile_clock_ns();
+}
+
+/* names the calling thread's track in the trace */
+void profile_thread_name(const char *name) {
+  ProfileRing *ring = __profile_ring();
+  if (ring != NULL) {
+    ring->thread_name = name;
+  }
+}
+
+/* the cycle counter, or the monotonic clock in ns where there is none */
+static inline u64 profile_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  u32 lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((u64)hi << 32) | lo;
+#elif defined(__aarch64__)
+  u64 cycles;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(cycles));
+  return cycles;
+#else
+  return __profile_clock_ns();
+#endif
+}
+
+static inline void profile_record(const char *name, u64 begin, u64 end) {
+  ProfileRing *ring = profile_ring ? profile_ring : __profile_ring();
+  if (ring == NULL) {
+    return;
+  }
+  ProfileZone *zone = &(ring->zones[ring->count & (PROFILE_RING_ZONES - 1)]);
+  zone->name = name;
+  zone->begin = begin;
+  zone->end = end;
+  ring->count++;
+}
+
+/*
+ * Writes the zones recorded so far to `path` as chrome trace_event json.
+ * Threads still recording while it runs may have their newest zones cut.
+ */
+bool profile_export(String8 path) {
+  FILE *f = fopen(path.data, "w");
+  if (f == NULL) {
+    fprintf(stderr, "ERROR: Failed to write profile=%s.\n", path.data);
+    return false;
+  }
+
+  u64 cycles = profile_now() - profile.start_cycles;
+  u64 ns = __profile_clock_ns() - profile.start_ns;
+  f64 us_per_cycle = cycles ? (ns / 1000.0) / cycles : 0;
+
+  fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  bool is_first = true;
+  i32 ring_count = MIN(__atomic_load_n(&(profile.ring_count), __ATOMIC_ACQUIRE), PROFILE_MAX_THREADS);
+  for (i32 tid = 0; tid < ring_count; tid++) {
+    ProfileRing *ring = &(profile.rings[tid]);
+    if (ring->thread_name != NULL) {
+      fprintf(f, "%s{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+              is_first ? "" : ",\n", tid, ring->thread_name);
+      is_first = false;
+    }
+
+    u64 count = ring->count;
+    u64 first = count > PROFILE_RING_ZONES ? count - PROFILE_RING_ZONES : 0;
+    for (u64 i = first; i < count; i++) {
+      ProfileZone *zone = &(ring->zones[i & (PROFILE_RING_ZONES - 1)]);
+      if (zone->begin < profile.start_cycles) {
+        continue;  // recorded before profile_init
+      }
+      fprintf(f, "%s{\"ph\": \"X\", \"name\": \"%s\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+              is_first ? "" : ",\n", zone->name, tid,
+              (zone->begin - profile.start_cycles) * us_per_cycle, (zone->end - zone->begin) * us_per_cycle);
+      is_first = false;
+    }
+  }
+  fprintf(f, "\n]}\n");
+
+  bool ok = fclose(f) == 0;
+  printf("profile: wrote %s\n", path.data);
+  return ok;
+}
+
+/* gettimeofday rather than clock_gettime, which -std=c99 hides without _POSIX_C_SOURCE */
+static u64 __profile_clock_ns(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ((u64)tv.tv_sec * 1000000000ULL) + ((u64)tv.tv_usec * 1000);
+}
+
+/* takes a ring for the calling thread, NULL once every ring is taken */
+static ProfileRing *__profile_ring(void) {
+  if (profile_ring == NULL) {
+    i32 tid = __atomic_fetch_add(&(profile.ring_count), 1, __ATOMIC_ACQ_REL);
+    if (tid >= PROFILE_MAX_THREADS) {
+      return NULL;  // the count stays past the end, every later thread lands here too
+    }
+    profile_ring = &(profile.rings[tid]);
+  }
+  return profile_ring;
+}
+
+#else
+
+#define PROFILE_BEGIN(name)
+#define PROFILE_END(name)
+
+// zones that can't be scoped (i.e. an async transfer) call these directly
+static inline u64  profile_now(void) { return 0; }
+static inline void profile_record(const char *name, u64 begin, u64 end) { (void)name; (void)begin; (void)end; }
+static inline void profile_init(void) {}
+static inline void profile_thread_name(const char *name) { (void)name; }
+static inline bool profile_export(String8 path) { (void)path; return true; }
+
+#endif
+
+#endif
@@ -0,0 +1,698 @@
+#ifndef _ROPE_H_
+#define _ROPE_H_
+
+/*
+  rope.h - a persistent, balanced rope for storing text.
+
+  The text is split into leaves of at most ROPE_LEAF_MAX bytes which hang
+  off a height balanced (AVL) binary tree. Every node caches the number of
+  bytes and the number of newlines in its subtree, so:
+
+  - insert/delete at any offset is O(log n): split the tree at the offset
+    and join the pieces back together.
+  - finding the offset where line N starts (and the line an offset belongs
+    to) is O(log n): descend using the cached newline counts.
+
+  Nodes are immutable once created and reference counted. An edit copies
+  the path from the root to the edited leaves and shares every other node
+  with the previous version, so `rope_snapshot` is O(1) and a snapshot is
+  never affected by later edits. This is what makes undo history and
+  rendering from a stable version cheap: they just hold on to a root.
+
+  Nodes and leaves are heap allocated (not arena allocated) since old
+  versions are released individually as snapshots go away.
+
+  Leaves either own their text (inserted text, at most ROPE_LEAF_MAX bytes)
+  or point into external read-only memory, i.e. a memory mapped file (see
+  `rope_from_external`). External leaves are never copied, an edit only
+  allocates the leaves around the edit. Their newline counts start out
+  unknown and are filled in lazily, a few leaves at a time with
+  `rope_index_step`, or on demand by line lookups that need them.
+*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base.h"
+
+#ifndef ROPE_LEAF_MAX
+#define ROPE_LEAF_MAX 1024  // max bytes stored in a single leaf
+#endif
+
+#ifndef ROPE_EXTERNAL_LEAF
+#define ROPE_EXTERNAL_LEAF (64 * KB)  // bytes per leaf when referencing external text
+#endif
+
+#define ROPE_NEWLINES_UNKNOWN UINT64_MAX
+#define ROPE_MAX_HEIGHT 64   // an AVL tree this tall would hold more leaves than addressable memory
+
+typedef struct RopeNode RopeNode;
+struct RopeNode {
+  RopeNode *left;     // NULL for leaves
+  RopeNode *right;    // NULL for leaves
+  u64  length;        // number of bytes in this subtree
+  u64  newlines;      // number of '\n' in this subtree, or ROPE_NEWLINES_UNKNOWN
+  u32  refs;          // number of parents/ropes holding this node
+  u8   height;        // leaves have height 0
+  bool is_external;   // leaf data points to memory not owned by the rope
+  char *data;         // leaf only, `length` bytes of text
+};
+
+typedef struct Rope {
+  RopeNode *root;
+} Rope;
+
+typedef struct RopeIter {
+  RopeNode *stack[ROPE_MAX_HEIGHT];  // ancestors whose right subtree is yet to be visited
+  i32  depth;
+  RopeNode *leaf;                    // current leaf
+  u64  leaf_offset;                  // offset into the current leaf
+} RopeIter;
+
+/* --- definitions --- */
+
+Rope    rope_create();
+Rope    rope_from_string8(String8 s);
+Rope    rope_from_external(String8 s);
+void    rope_destroy(Rope *rope);
+Rope    rope_snapshot(Rope *rope);
+u64     rope_length(Rope *rope);
+u64     rope_line_count(Rope *rope);
+bool    rope_is_indexed(Rope *rope);
+bool    rope_index_step(Rope *rope, u64 budget);
+void    rope_insert(Rope *rope, u64 offset, String8 s);
+void    rope_delete(Rope *rope, u64 offset, u64 length);
+char    rope_get(Rope *rope, u64 offset);
+u64     rope_line_start(Rope *rope, u64 line);
+u64     rope_line_of(Rope *rope, u64 offset);
+String8 rope_to_string8(Rope *rope, MemoryArena *arena, u64 offset, u64 length);
+
+RopeIter rope_iter(Rope *rope, u64 offset);
+bool     rope_iter_next(RopeIter *it, String8 *chunk);
+
+RopeNode *__rope_leaf(char *data, u64 length, bool is_external);
+RopeNode *__rope_node(RopeNode *left, RopeNode *right);
+RopeNode *__rope_build(char *data, u64 length, u64 leaf_size, bool is_external);
+RopeNode *__rope_retain(RopeNode *node);
+void      __rope_release(RopeNode *node);
+RopeNode *__rope_join(RopeNode *left, RopeNode *right);
+void      __rope_split(RopeNode *node, u64 offset, RopeNode **left, RopeNode **right);
+bool      __rope_index(RopeNode *node, u64 *budget);
+bool      __rope_find_line(RopeNode *node, u64 *remaining, u64 *offset);
+u64       __rope_count_newlines(char *data, u64 length);
+
+/* --- implementation --- */
+
+Rope rope_create() {
+  return (Rope){ .root = NULL };
+}
+
+Rope rope_from_string8(String8 s) {
+  return (Rope){ .root = __rope_build(s.data, s.length, ROPE_LEAF_MAX, false) };
+}
+
+/*
+ * Creates a rope referencing `s` without copying it, `s` must be kept
+ * alive (and unchanged) for as long as the rope or any of its snapshots.
+ * Newlines aren't counted up front, see `rope_index_step`.
+ */
+Rope rope_from_external(String8 s) {
+  return (Rope){ .root = __rope_build(s.data, s.length, ROPE_EXTERNAL_LEAF, true) };
+}
+
+/*
+ * Releases this handle on the text. Nodes shared with snapshots stay alive
+ * until every rope referencing them has been destroyed.
+ */
+void rope_destroy(Rope *rope) {
+  __rope_release(rope->root);
+  rope->root = NULL;
+}
+
+/*
+ * Returns an immutable version of the text as it is right now.
+ * The snapshot must be released with `rope_destroy`.
+ */
+Rope rope_snapshot(Rope *rope) {
+  return (Rope){ .root = __rope_retain(rope->root) };
+}
+
+u64 rope_length(Rope *rope) {
+  return rope->root ? rope->root->length : 0;
+}
+
+/*
+ * Returns the number of lines in the text. For external text that hasn't
+ * been fully indexed yet this has to count every remaining newline.
+ */
+u64 rope_line_count(Rope *rope) {
+  if (rope->root == NULL) {
+    return 1;
+  }
+
+  __rope_index(rope->root, NULL);
+  return rope->root->newlines + 1;
+}
+
+/* returns true once the newlines of the whole text have been counted */
+bool rope_is_indexed(Rope *rope) {
+  return rope->root == NULL || rope->root->newlines != ROPE_NEWLINES_UNKNOWN;
+}
+
+/*
+ * Counts the newlines of (roughly) the next `budget` bytes of text that
+ * haven't been indexed yet. Meant to be called once per frame/idle period
+ * so indexing a large file never blocks. Returns true when done.
+ */
+bool rope_index_step(Rope *rope, u64 budget) {
+  return __rope_index(rope->root, &budget);
+}
+
+/*
+ * Inserts `s` at `offset` (clamped to the length of the text).
+ */
+void rope_insert(Rope *rope, u64 offset, String8 s) {
+  if (s.length == 0) {
+    return;
+  }
+
+  RopeNode *left = NULL;
+  RopeNode *right = NULL;
+  __rope_split(rope->root, MIN(offset, rope_length(rope)), &left, &right);
+
+  RopeNode *text = __rope_build(s.data, s.length, ROPE_LEAF_MAX, false);
+  rope->root = __rope_join(__rope_join(left, text), right);
+}
+
+/*
+ * Deletes `length` bytes starting at `offset`, both clamped to the text.
+ */
+void rope_delete(Rope *rope, u64 offset, u64 length) {
+  u64 total = rope_length(rope);
+  if (offset >= total || length == 0) {
+    return;
+  }
+  length = MIN(length, total - offset);
+
+  RopeNode *left = NULL;
+  RopeNode *middle = NULL;
+  RopeNode *right = NULL;
+  __rope_split(rope->root, offset, &left, &right);
+  __rope_split(right, length, &middle, &right);
+
+  __rope_release(middle);
+  rope->root = __rope_join(left, right);
+}
+
+/* returns the char at `offset`, or -1 if out of bounds */
+char rope_get(Rope *rope, u64 offset) {
+  RopeNode *node = rope->root;
+  if (node == NULL || offset >= node->length) {
+    return -1;
+  }
+
+  while (node->height > 0) {
+    if (offset < node->left->length) {
+      node = node->left;
+    } else {
+      offset -= node->left->length;
+      node = node->right;
+    }
+  }
+  return node->data[offset];
+}
+
+/*
+ * Returns the offset of the first byte of `line` (0 based). Lines past the
+ * end of the text return the length of the text.
+ */
+u64 rope_line_start(Rope *rope, u64 line) {
+  if (line == 0 || rope->root == NULL) {
+    return 0;
+  }
+
+  // find the `line`th newline, i.e. the end of line - 1
+  u64 offset = 0;
+  u64 remaining = line;
+  if (!__rope_find_line(rope->root, &remaining, &offset)) {
+    return rope_length(rope);
+  }
+  return offset;
+}
+
+/*
+ * Returns the line (0 based) that `offset` belongs to, i.e. the number of
+ * newlines before it.
+ */
+u64 rope_line_of(Rope *rope, u64 offset) {
+  RopeNode *node = rope->root;
+  if (node == NULL) {
+    return 0;
+  }
+  if (offset >= node->length) {
+    __rope_index(node, NULL);  // an external rope may not be indexed yet
+    return node->newlines;
+  }
+
+  u64 line = 0;
+  while (node->height > 0) {
+    if (offset < node->left->length) {
+      node = node->left;
+    } else {
+      __rope_index(node->left, NULL);
+      offset -= node->left->length;
+      line += node->left->newlines;
+      node = node->right;
+    }
+  }
+  return line + __rope_count_newlines(node->data, offset);
+}
+
+/*
+ * Copies `length` bytes starting at `offset` into an arena allocated
+ * (and null terminated) String8.
+ */
+String8 rope_to_string8(Rope *rope, MemoryArena *arena, u64 offset, u64 length) {
+  u64 total = rope_length(rope);
+  offset = MIN(offset, total);
+  length = MIN(length, total - offset);
+
+  String8 s = { .length = length };
+  s.data = (char *)arena_push_nozero(arena, length + 1);
+
+  u64 copied = 0;
+  String8 chunk;
+  RopeIter it = rope_iter(rope, offset);
+  while (copied < length && rope_iter_next(&it, &chunk)) {
+    u64 n = MIN(chunk.length, length - copied);
+    memcpy(s.data + copied, chunk.data, n);
+    copied += n;
+  }
+  s.data[length] = 0;
+  return s;
+}
+
+/*
+ * Returns an iterator over the text starting at `offset`. Each call to
+ * `rope_iter_next` yields a slice of a leaf, without copying. The iterator
+ * is valid as long as `rope` (or a snapshot of it) is alive.
+ */
+RopeIter rope_iter(Rope *rope, u64 offset) {
+  RopeIter it = { .depth = 0, .leaf = NULL, .leaf_offset = 0 };
+  RopeNode *node = rope->root;
+  if (node == NULL || offset >= node->length) {
+    return it;
+  }
+
+  while (node->height > 0) {
+    if (offset < node->left->length) {
+      it.stack[it.depth++] = node;
+      node = node->left;
+    } else {
+      offset -= node->left->length;
+      node = node->right;
+    }
+  }
+  it.leaf = node;
+  it.leaf_offset = offset;
+  return it;
+}
+
+bool rope_iter_next(RopeIter *it, String8 *chunk) {
+  if (it->leaf == NULL) {
+    return false;
+  }
+
+  chunk->data = it->leaf->data + it->leaf_offset;
+  chunk->length = it->leaf->length - it->leaf_offset;
+
+  // advance to the leftmost leaf of the next pending right subtree
+  it->leaf = NULL;
+  it->leaf_offset = 0;
+  if (it->depth > 0) {
+    RopeNode *node = it->stack[--it->depth]->right;
+    while (node->height > 0) {
+      it->stack[it->depth++] = node;
+      node = node->left;
+    }
+    it->leaf = node;
+  }
+  return true;
+}
+
+/* --- internals ---
+   Every function below that takes RopeNode pointers takes ownership of one
+   reference to each of them, and returns an owned reference. To reuse the
+   child of a node that is being released, retain it first.
+*/
+
+/*
+ * Counts '\n' 8 bytes at a time (SWAR): xor-ing a word with 0x0a in every
+ * byte turns newlines into zero bytes, and the bit trick below sets the high
+ * bit of exactly those bytes so a popcount gives the number of newlines.
+ */
+u64 __rope_count_newlines(char *data, u64 length) {
+  const u64 newlines = 0x0a0a0a0a0a0a0a0aULL;
+  const u64 low_bits = 0x7f7f7f7f7f7f7f7fULL;
+
+  u64 count = 0;
+  u64 i = 0;
+  for (; i + 8 <= length; i += 8) {
+    u64 word;
+    memcpy(&word, data + i, sizeof(word));  // unaligned load
+    word ^= newlines;
+    u64 zeros = ~(((word & low_bits) + low_bits) | word | low_bits);
+    count += __builtin_popcountll(zeros);
+  }
+
+  for (; i < length; i++) {
+    count += (data[i] == '\n');
+  }
+  return count;
+}
+
+/*
+ * Counts the newlines of the unindexed leaves under `node`, in order, and
+ * fills in the counts of nodes whose children are all indexed. Stops once
+ * `budget` bytes have been scanned, NULL means no limit. Counts are cached
+ * in place, that's fine for shared nodes since they depend only on the
+ * (immutable) text. Returns true if `node` is fully indexed.
+ */
+bool __rope_index(RopeNode *node, u64 *budget) {
+  if (node == NULL || node->newlines != ROPE_NEWLINES_UNKNOWN) {
+    return true;
+  }
+
+  if (node->height == 0) {
+    if (budget && *budget == 0) return false;
+    node->newlines = __rope_count_newlines(node->data, node->length);
+    if (budget) *budget -= MIN(*budget, node->length);
+    return true;
+  }
+
+  if (!__rope_index(node->left, budget)) return false;
+  if (!__rope_index(node->right, budget)) return false;
+  node->newlines = node->left->newlines + node->right->newlines;
+  return true;
+}
+
+/*
+ * Looks for the `*remaining`th newline under `node` and sets `*offset` right
+ * after it. Subtrees with a known newline count are skipped or descended
+ * into directly, unknown ones are scanned in order (and indexed as a side
+ * effect), so finding a line near the start of a large file that hasn't
+ * been indexed only looks at the text before it.
+ */
+bool __rope_find_line(RopeNode *node, u64 *remaining, u64 *offset) {
+  if (node->newlines != ROPE_NEWLINES_UNKNOWN && node->newlines < *remaining) {
+    *remaining -= node->newlines;
+    *offset += node->length;
+    return false;
+  }
+
+  if (node->height == 0) {
+    char *p = node->data;
+    char *end = node->data + node->length;
+    u64 seen = 0;
+    while ((p = memchr(p, '\n', end - p)) != NULL) {
+      p++;
+      if (++seen == *remaining) {
+        *offset += p - node->data;
+        return true;
+      }
+    }
+
+    node->newlines = seen;  // scanned the whole leaf
+    *remaining -= seen;
+    *offset += node->length;
+    return false;
+  }
+
+  bool found = __rope_find_line(node->left, remaining, offset) ||
+               __rope_find_line(node->right, remaining, offset);
+
+  if (node->left->newlines != ROPE_NEWLINES_UNKNOWN && node->right->newlines != ROPE_NEWLINES_UNKNOWN) {
+    node->newlines = node->left->newlines + node->right->newlines;
+  }
+  return found;
+}
+
+RopeNode *__rope_leaf(char *data, u64 length, bool is_external) {
+  RopeNode *leaf = NULL;
+
+  if (is_external) {
+    leaf = NEW(RopeNode, sizeof(RopeNode));
+    assert(leaf != NULL);
+    leaf->data = data;
+  } else {
+    // store the text right after the node, in the same allocation
+    assert(length <= ROPE_LEAF_MAX);
+    leaf = NEW(RopeNode, sizeof(RopeNode) + length);
+    assert(leaf != NULL);
+    leaf->data = (char *)(leaf + 1);
+    memcpy(leaf->data, data, length);
+  }
+
+  leaf->left = NULL;
+  leaf->right = NULL;
+  leaf->length = length;
+  leaf->newlines = is_external ? ROPE_NEWLINES_UNKNOWN : __rope_count_newlines(leaf->data, length);
+  leaf->refs = 1;
+  leaf->height = 0;
+  leaf->is_external = is_external;
+  return leaf;
+}
+
+RopeNode *__rope_node(RopeNode *left, RopeNode *right) {
+  RopeNode *node = NEW(RopeNode, sizeof(RopeNode));
+  assert(node != NULL);
+
+  node->left = left;
+  node->right = right;
+  node->length = left->length + right->length;
+  node->newlines = ROPE_NEWLINES_UNKNOWN;
+  if (left->newlines != ROPE_NEWLINES_UNKNOWN && right->newlines != ROPE_NEWLINES_UNKNOWN) {
+    node->newlines = left->newlines + right->newlines;
+  }
+  node->refs = 1;
+  node->height = 1 + (left->height > right->height ? left->height : right->height);
+  node->is_external = false;
+  node->data = NULL;
+  return node;
+}
+
+/* builds a balanced tree out of `length` bytes of `data`, `leaf_size` bytes per leaf */
+RopeNode *__rope_build(char *data, u64 length, u64 leaf_size, bool is_external) {
+  if (length == 0) {
+    return NULL;
+  }
+  if (length <= leaf_size) {
+    return __rope_leaf(data, length, is_external);
+  }
+
+  // split on a leaf boundary so all leaves but the last one are full
+  u64 leaves = (length + leaf_size - 1) / leaf_size;
+  u64 half = (leaves / 2) * leaf_size;
+  return __rope_node(__rope_build(data, half, leaf_size, is_external),
+                     __rope_build(data + half, length - half, leaf_size, is_external));
+}
+
+RopeNode *__rope_retain(RopeNode *node) {
+  if (node) node->refs++;
+  return node;
+}
+
+void __rope_release(RopeNode *node) {
+  while (node && --node->refs == 0) {
+    RopeNode *right = node->right;
+    __rope_release(node->left);
+    DELETE(node);
+    node = right;  // release the right side without recursing
+  }
+}
+
+static i32 __rope_height(RopeNode *node) {
+  return node ? node->height : -1;
+}
+
+static RopeNode *__rope_rotate_left(RopeNode *node) {
+  RopeNode *a = node->left;
+  RopeNode *b = node->right;
+  RopeNode *rotated = __rope_node(__rope_node(__rope_retain(a), __rope_retain(b->left)),
+                                  __rope_retain(b->right));
+  __rope_release(node);
+  return rotated;
+}
+
+static RopeNode *__rope_rotate_right(RopeNode *node) {
+  RopeNode *a = node->left;
+  RopeNode *b = node->right;
+  RopeNode *rotated = __rope_node(__rope_retain(a->left),
+                                  __rope_node(__rope_retain(a->right), __rope_retain(b)));
+  __rope_release(node);
+  return rotated;
+}
+
+/* concatenates two leaves into a new leaf, they must fit in ROPE_LEAF_MAX */
+static RopeNode *__rope_merge_leaves(RopeNode *left, RopeNode *right) {
+  char data[ROPE_LEAF_MAX];
+  memcpy(data, left->data, left->length);
+  memcpy(data + left->length, right->data, right->length);
+
+  RopeNode *merged = __rope_leaf(data, left->length + right->length, false);
+  __rope_release(left);
+  __rope_release(right);
+  return merged;
+}
+
+/*
+ * If `leaf` fits into the last leaf of `node` returns a copy of `node` with
+ * `leaf` appended to its last leaf, otherwise NULL. Tree shape is unchanged.
+ * Keeps typing one char at a time from creating one leaf per keystroke.
+ */
+static RopeNode *__rope_append_small(RopeNode *node, RopeNode *leaf) {
+  if (node->height == 0) {
+    if (node->length + leaf->length > ROPE_LEAF_MAX) return NULL;
+    return __rope_merge_leaves(__rope_retain(node), __rope_retain(leaf));
+  }
+
+  RopeNode *right = __rope_append_small(node->right, leaf);
+  if (right == NULL) return NULL;
+  return __rope_node(__rope_retain(node->left), right);
+}
+
+static RopeNode *__rope_prepend_small(RopeNode *leaf, RopeNode *node) {
+  if (node->height == 0) {
+    if (node->length + leaf->length > ROPE_LEAF_MAX) return NULL;
+    return __rope_merge_leaves(__rope_retain(leaf), __rope_retain(node));
+  }
+
+  RopeNode *left = __rope_prepend_small(leaf, node->left);
+  if (left == NULL) return NULL;
+  return __rope_node(left, __rope_retain(node->right));
+}
+
+/* joins `left` with a shorter `right` by descending the right spine of `left` */
+static RopeNode *__rope_join_right(RopeNode *left, RopeNode *right) {
+  RopeNode *joined = NULL;
+  RopeNode *inner = left->right;
+
+  if (__rope_height(inner) <= __rope_height(right) + 1) {
+    joined = __rope_node(__rope_retain(inner), right);
+    if (joined->height > __rope_height(left->left) + 1) {
+      joined = __rope_rotate_right(joined);
+      joined = __rope_rotate_left(__rope_node(__rope_retain(left->left), joined));
+    } else {
+      joined = __rope_node(__rope_retain(left->left), joined);
+    }
+  } else {
+    joined = __rope_join_right(__rope_retain(inner), right);
+    if (joined->height > __rope_height(left->left) + 1) {
+      joined = __rope_rotate_left(__rope_node(__rope_retain(left->left), joined));
+    } else {
+      joined = __rope_node(__rope_retain(left->left), joined);
+    }
+  }
+
+  __rope_release(left);
+  return joined;
+}
+
+/* joins a shorter `left` with `right` by descending the left spine of `right` */
+static RopeNode *__rope_join_left(RopeNode *left, RopeNode *right) {
+  RopeNode *joined = NULL;
+  RopeNode *inner = right->left;
+
+  if (__rope_height(inner) <= __rope_height(left) + 1) {
+    joined = __rope_node(left, __rope_retain(inner));
+    if (joined->height > __rope_height(right->right) + 1) {
+      joined = __rope_rotate_left(joined);
+      joined = __rope_rotate_right(__rope_node(joined, __rope_retain(right->right)));
+    } else {
+      joined = __rope_node(joined, __rope_retain(right->right));
+    }
+  } else {
+    joined = __rope_join_left(left, __rope_retain(inner));
+    if (joined->height > __rope_height(right->right) + 1) {
+      joined = __rope_rotate_right(__rope_node(joined, __rope_retain(right->right)));
+    } else {
+      joined = __rope_node(joined, __rope_retain(right->right));
+    }
+  }
+
+  __rope_release(right);
+  return joined;
+}
+
+/* concatenates `left` and `right` keeping the tree balanced */
+RopeNode *__rope_join(RopeNode *left, RopeNode *right) {
+  if (left == NULL) return right;
+  if (right == NULL) return left;
+
+  // merge small edits into a neighbouring leaf
+  RopeNode *merged = NULL;
+  if (right->height == 0 && !right->is_external && right->length < ROPE_LEAF_MAX / 2) {
+    merged = __rope_append_small(left, right);
+  } else if (left->height == 0 && !left->is_external && left->length < ROPE_LEAF_MAX / 2) {
+    merged = __rope_prepend_small(left, right);
+  }
+  if (merged) {
+    __rope_release(left);
+    __rope_release(right);
+    return merged;
+  }
+
+  i32 left_height = __rope_height(left);
+  i32 right_height = __rope_height(right);
+  if (left_height > right_height + 1) return __rope_join_right(left, right);
+  if (right_height > left_height + 1) return __rope_join_left(left, right);
+  return __rope_node(left, right);
+}
+
+/* splits `node` into the text before `offset` and the text from `offset` on */
+void __rope_split(RopeNode *node, u64 offset, RopeNode **left, RopeNode **right) {
+  if (node == NULL) {
+    *left = NULL;
+    *right = NULL;
+    return;
+  }
+
+  if (offset == 0) {
+    *left = NULL;
+    *right = node;
+    return;
+  }
+
+  if (offset >= node->length) {
+    *left = node;
+    *right = NULL;
+    return;
+  }
+
+  if (node->height == 0) {
+    *left = __rope_leaf(node->data, offset, node->is_external);
+    *right = __rope_leaf(node->data + offset, node->length - offset, node->is_external);
+    if (node->is_external && node->newlines != ROPE_NEWLINES_UNKNOWN) {
+      // keep indexed text indexed after an edit
+      __rope_index(*left, NULL);
+      __rope_index(*right, NULL);
+    }
+    __rope_release(node);
+    return;
+  }
+
+  u64 left_length = node->left->length;
+  if (offset < left_length) {
+    RopeNode *rest = NULL;
+    __rope_split(__rope_retain(node->left), offset, left, &rest);
+    *right = __rope_join(rest, __rope_retain(node->right));
+  } else {
+    RopeNode *rest = NULL;
+    __rope_split(__rope_retain(node->right), offset - left_length, &rest, right);
+    *left = __rope_join(__rope_retain(node->left), rest);
+  }
+  __rope_release(node);
+}
+
+#endif
@@ -1,11 +1,16 @@
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <SDL.h>
 
 #include "base.h"
 #include "draw.h"
+#include "hud.h"
+#include "profile.h"
+
+#define RUNTIME_HUD_KEY FN_F3  // shows and hides the hud, see runtime_attach_hud
 
 typedef enum Key {
   K_UNKNOWN    = 0,
@@ -140,6 +145,10 @@ struct Runtime {
   SDL_Renderer *renderer;
   SDL_Texture  *texture;
 
+  Hud *hud;                  // NULL unless attached
+  SDL_Texture *hud_texture;
+  HudFrame timings;          // of the frame being run
+
   void *context;
   void (*on_step)(Runtime *);
   void (*on_text_in)(Runtime *, String8);
@@ -169,6 +178,7 @@ void runtime_stop(Runtime *runtime);
 
 void runtime_redisplay(Runtime *runtime);
 void runtime_destroy(Runtime *runtime);
+void runtime_attach_hud(Runtime *runtime, Hud *hud);
 
 void _run(Runtime *runtime);
 void _step(Runtime *runtime);
@@ -178,11 +188,17 @@ void _text_in(Runtime *runtime, SDL_Event event);
 void _mouse_down(Runtime *runtime, SDL_Event event);
 void _mouse_up(Runtime *runtime, SDL_Event event);
 void _mouse_pos(Runtime *runtime, SDL_Event event);
+void _present(Runtime *runtime);
 
+bool __map_fn_key(SDL_Keysym key, FnKey *fn);
+f64  __ms_since(u64 counter);
 Key  __map_key(SDL_Keysym key);
 void __print_key_info(String8 type, SDL_Keysym key);
 
 Runtime runtime_create(MemoryArena *arena, String8 title, Point position, i32 width, i32 height, u32 zoom) {
+  profile_init();
+  profile_thread_name("main");
+
   if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     fprintf(stderr, "Unable to initialize SDL backend, error=%s\n", SDL_GetError());
     assert(false);
@@ -227,6 +243,8 @@ Runtime runtime_create(MemoryArena *arena, String8 title, Point position, i32 wi
     .window = window,
     .renderer = renderer,
     .texture = texture,
+    .hud = NULL,
+    .hud_texture = NULL,
   };
   return sdl;
 }
@@ -244,22 +262,49 @@ void runtime_stop(Runtime *runtime) {
 }
 
 void runtime_redisplay(Runtime *runtime) {
+  PROFILE_BEGIN(upload);
+  u64 upload_start = SDL_GetPerformanceCounter();
   SDL_UpdateTexture(runtime->texture,
 		    NULL,
 		    runtime->screen.pixels,
 		    runtime->width * sizeof(Color));
+  runtime->timings.ms[HUD_UPLOAD] += __ms_since(upload_start);
+  PROFILE_END(upload);
 
-  SDL_RenderClear(runtime->renderer);
-  SDL_RenderCopy(runtime->renderer, runtime->texture, NULL, NULL);
-  SDL_RenderPresent(runtime->renderer);
+  _present(runtime);
   runtime->needs_redisplay = false;
 }
 
+/*
+ * Shows `hud` over the screen while RUNTIME_HUD_KEY toggles it on, every
+ * frame's timings are recorded in it. The hud is drawn in a texture of its
+ * own, the screen is left alone.
+ */
+void runtime_attach_hud(Runtime *runtime, Hud *hud) {
+  SDL_Texture *texture = SDL_CreateTexture(runtime->renderer,
+					   SDL_PIXELFORMAT_RGBA8888,
+					   SDL_TEXTUREACCESS_STATIC,
+					   hud->layer.w,
+					   hud->layer.h);
+  assert(texture);
+  SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+  runtime->hud = hud;
+  runtime->hud_texture = texture;
+}
+
 void runtime_destroy(Runtime *runtime) {
   // clean up sdl resources
+  if (runtime->hud_texture) {
+    SDL_DestroyTexture(runtime->hud_texture);
+  }
   SDL_DestroyTexture(runtime->texture);
   SDL_DestroyRenderer(runtime->renderer);
   SDL_DestroyWindow(runtime->window);
+
+  // a no-op unless built with PROFILE=1
+  char *profile_path = getenv("PROFILE_OUTPUT") ? getenv("PROFILE_OUTPUT") : "profile.json";
+  profile_export((String8){ .data = profile_path, .length = strlen(profile_path) });
 }
 
 void _run(Runtime *runtime) {
@@ -267,7 +312,10 @@ void _run(Runtime *runtime) {
 
   while (runtime->is_executing) {
     u64 frame_start = SDL_GetTicks64();
+    u64 frame_counter = SDL_GetPerformanceCounter();
+    PROFILE_BEGIN(frame);
     _step(runtime);
+    PROFILE_END(frame);
     u64 frame_end = SDL_GetTicks64();
     u64 frame_time = frame_end - frame_start;
     if (frame_delay > frame_time) {
@@ -276,18 +324,32 @@ void _run(Runtime *runtime) {
       }
       SDL_Delay(frame_delay - frame_time);
     }
+
+    if (runtime->hud) {
+      runtime->timings.frame_ms = __ms_since(frame_counter);
+      hud_frame(runtime->hud, runtime->timings);
+    }
+    runtime->timings = (HudFrame){ 0 };
   }
 }
 
 void _step(Runtime *runtime) {
   if (runtime->needs_redisplay) {
     runtime_redisplay(runtime);
+  } else if (runtime->hud && runtime->hud->is_dirty) {
+    _present(runtime);  // the screen hasn't changed, the hud has
   }
 
   if (runtime->on_step) {
+    PROFILE_BEGIN(step);
+    u64 step_start = SDL_GetPerformanceCounter();
     runtime->on_step(runtime);
+    runtime->timings.ms[HUD_STEP] += __ms_since(step_start);
+    PROFILE_END(step);
   }
 
+  PROFILE_BEGIN(events);
+  u64 events_start = SDL_GetPerformanceCounter();
   SDL_Event event;
   while (SDL_PollEvent(&event) !=0) {
     switch(event.type) {
@@ -326,6 +388,31 @@ void _step(Runtime *runtime) {
       break;
     }
   }
+  runtime->timings.ms[HUD_EVENTS] += __ms_since(events_start);
+  PROFILE_END(events);
+}
+
+/* the uploaded screen, and the hud over it when it's shown */
+void _present(Runtime *runtime) {
+  PROFILE_BEGIN(present);
+  u64 present_start = SDL_GetPerformanceCounter();
+  SDL_RenderClear(runtime->renderer);
+  SDL_RenderCopy(runtime->renderer, runtime->texture, NULL, NULL);
+
+  Hud *hud = runtime->hud;
+  if (hud && hud->is_visible) {
+    if (hud->is_dirty) {
+      SDL_UpdateTexture(runtime->hud_texture, NULL, hud->layer.pixels, hud->layer.w * sizeof(Color));
+      hud->is_dirty = false;
+    }
+    // top right corner, in window pixels so zoom doesn't blow it up
+    SDL_Rect at = { (runtime->width * runtime->zoom) - hud->layer.w - HUD_PADDING, HUD_PADDING, hud->layer.w, hud->layer.h };
+    SDL_RenderCopy(runtime->renderer, runtime->hud_texture, NULL, &at);
+  }
+
+  SDL_RenderPresent(runtime->renderer);
+  runtime->timings.ms[HUD_PRESENT] += __ms_since(present_start);
+  PROFILE_END(present);
 }
 
 void _text_in(Runtime *runtime, SDL_Event event) {
@@ -346,7 +433,19 @@ void _key_down(Runtime *runtime, SDL_Event event) {
     runtime->keyboard.keys[code] = true;
   }
 
-  // TODO handle fn keys, modifiers, arrows
+  FnKey fn;
+  if (__map_fn_key(event.key.keysym, &fn)) {
+    runtime->keyboard.fn_keys[fn] = true;
+    if (fn == RUNTIME_HUD_KEY && runtime->hud && !event.key.repeat) {
+      runtime->hud->is_visible = !runtime->hud->is_visible;
+      if (runtime->hud->is_visible) {
+        hud_draw(runtime->hud);
+      }
+      runtime->needs_redisplay = true;
+    }
+  }
+
+  // TODO handle modifiers, arrows
   if (runtime->on_key_down) { runtime->on_key_down(runtime); }
 }
 
@@ -358,7 +457,12 @@ void _key_up(Runtime *runtime, SDL_Event event) {
     runtime->keyboard.keys[code] = false;
   }
 
-  // TODO handle fn keys, modifiers, arrows
+  FnKey fn;
+  if (__map_fn_key(event.key.keysym, &fn)) {
+    runtime->keyboard.fn_keys[fn] = false;
+  }
+
+  // TODO handle modifiers, arrows
   if (runtime->on_key_up) { runtime->on_key_up(runtime); }
 }
 
@@ -407,6 +511,37 @@ void _mouse_pos(Runtime *runtime, SDL_Event event) {
   if (runtime->on_mouse_motion) { runtime->on_mouse_motion(runtime); }
 }
 
+bool __map_fn_key(SDL_Keysym key, FnKey *fn) {
+  switch (key.sym) {
+  case SDLK_F1:             *fn = FN_F1;             return true;
+  case SDLK_F2:             *fn = FN_F2;             return true;
+  case SDLK_F3:             *fn = FN_F3;             return true;
+  case SDLK_F4:             *fn = FN_F4;             return true;
+  case SDLK_F5:             *fn = FN_F5;             return true;
+  case SDLK_F6:             *fn = FN_F6;             return true;
+  case SDLK_F7:             *fn = FN_F7;             return true;
+  case SDLK_F8:             *fn = FN_F8;             return true;
+  case SDLK_F9:             *fn = FN_F9;             return true;
+  case SDLK_F10:            *fn = FN_F10;            return true;
+  case SDLK_F11:            *fn = FN_F11;            return true;
+  case SDLK_F12:            *fn = FN_F12;            return true;
+  case SDLK_MUTE:           *fn = FN_MUTE;           return true;
+  case SDLK_BRIGHTNESSDOWN: *fn = FN_BRIGHT_DOWN;    return true;
+  case SDLK_BRIGHTNESSUP:   *fn = FN_BRIGHT_UP;      return true;
+  case SDLK_HOME:           *fn = FN_HOME;           return true;
+  case SDLK_END:            *fn = FN_END;            return true;
+  case SDLK_INSERT:         *fn = FN_INSERT;         return true;
+  case SDLK_PAGEUP:         *fn = FN_PAGE_UP;        return true;
+  case SDLK_PAGEDOWN:       *fn = FN_PAGE_DOWN;      return true;
+  case SDLK_PRINTSCREEN:    *fn = FN_PRINT_SCREEN;   return true;
+  default:                                           return false;
+  }
+}
+
+f64 __ms_since(u64 counter) {
+  return (SDL_GetPerformanceCounter() - counter) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
 void __print_key_info(String8 type, SDL_Keysym key) {
   printf("%s: ", type.data);
   printf("sym=%d, ", key.sym);
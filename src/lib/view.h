@@ -0,0 +1,389 @@
+#ifndef _VIEW_H_
+#define _VIEW_H_
+
+/*
+  view.h - incremental rendering of the visible part of a text.
+
+  A TextView caches the layout of the screen lines (rows) that are currently
+  visible: where each row starts in the text and which glyphs it shows. Text
+  never has to be re-laid out (or redrawn) from the start:
+
+    - `text_view_edit` records which part of the text changed,
+    - `text_view_layout` re-lays out only the rows from the edit onwards and
+      stops as soon as a row starts at the same (shifted) position as before,
+      after that the old layout is still valid,
+    - `text_view_draw` repaints only the rows whose glyphs actually changed.
+
+  Typing a character on a line therefore touches one row (or the few rows
+  of a wrapped line), regardless of the size of the text.
+
+  The view does not own the text, it reads it through a TextSource so it
+  works the same on top of a GapBuffer or a Rope.
+*/
+
+#include "base.h"
+#include "draw.h"
+#include "font.h"
+
+typedef struct TextSource {
+  void *context;
+  u64  (*length)(void *context);
+  char (*char_at)(void *context, u64 offset);
+  u64  (*line_start)(void *context, u64 offset);  // optional, NULL walks back through char_at
+} TextSource;
+
+typedef struct ViewRow {
+  u64  start;        // offset of the first char of the row
+  i32  length;       // chars consumed by the row, including its trailing '\n'
+  i32  glyph_count;  // chars drawn by the row
+  bool is_dirty;     // has to be redrawn
+} ViewRow;
+
+typedef struct TextView {
+  Font *font;
+  Rect frame;
+  Color background;
+  Color foreground;
+
+  i32 line_height;
+  i32 ascent;          // distance from the top of a row to its baseline
+  i32 advances[95];    // per printable ascii char, see Font.glyphs
+
+  i32 row_count;
+  i32 max_cols;        // the most glyphs a row can hold
+  ViewRow *rows;
+  char *glyphs;        // row_count * max_cols, the glyphs drawn by each row
+  char *scratch;       // max_cols, used while laying out a row
+
+  u64 top;             // offset of the first visible char
+  bool needs_layout;   // the whole viewport has to be laid out again
+
+  // pending edit, in the coordinates of the edited text
+  bool has_edit;
+  u64 edit_start;
+  u64 edit_end;
+  i64 edit_delta;
+} TextView;
+
+TextView text_view_create(MemoryArena *arena, Font *font, Rect frame, Color fg, Color bg);
+void     text_view_edit(TextView *view, u64 offset, i64 delta);
+void     text_view_scroll_to(TextView *view, TextSource src, u64 offset);
+i32      text_view_layout(TextView *view, TextSource src);
+i32      text_view_draw(TextView *view, Bitmap *dst);
+i32      text_view_update(TextView *view, TextSource src, Bitmap *dst);
+
+TextView __text_view_init(MemoryArena *arena, Rect frame, i32 line_height, i32 ascent, i32 *advances);
+i32      __text_view_advance(TextView *view, char c);
+i32      __text_view_layout_row(TextView *view, TextSource src, u64 start, ViewRow *row, char *glyphs);
+bool     __text_view_store_row(TextView *view, i32 index, ViewRow row);
+u64      __text_view_line_start(TextSource src, u64 offset);
+u64      __text_view_end(TextView *view);
+
+TextView text_view_create(MemoryArena *arena, Font *font, Rect frame, Color fg, Color bg) {
+  i32 advances[95];
+  for (i32 i=0; i < 95; i++) {
+    // same advance as the text.c renderer used
+    advances[i] = font->glyphs[i].x_advance + font->glyphs[i].x_bearing_h;
+  }
+
+  FT_Size_Metrics metrics = font->face->size->metrics;
+  i32 ascent = (i32)(metrics.ascender >> 6);
+  i32 line_height = (i32)((metrics.ascender - metrics.descender) >> 6);
+  if (line_height < font->h) {
+    line_height = font->h;
+  }
+
+  TextView view = __text_view_init(arena, frame, line_height, ascent, advances);
+  view.font = font;
+  view.foreground = fg;
+  view.background = bg;
+  return view;
+}
+
+/*
+ * Records an edit of the text: `delta` bytes were inserted at `offset` when
+ * positive, `-delta` bytes were deleted from `offset` when negative. Edits
+ * are merged until the next `text_view_layout`.
+ */
+void     text_view_edit(TextView *view, u64 offset, i64 delta) {
+  u64 end = delta > 0 ? offset + (u64)delta : offset;
+
+  if (!view->has_edit) {
+    view->has_edit = true;
+    view->edit_start = offset;
+    view->edit_end = end;
+    view->edit_delta = delta;
+    return;
+  }
+
+  // shift the pending range into the coordinates of the new text
+  if (view->edit_end > offset) {
+    i64 shifted = (i64)view->edit_end + delta;
+    view->edit_end = shifted < (i64)offset ? offset : (u64)shifted;
+  }
+
+  if (offset < view->edit_start) view->edit_start = offset;
+  if (end > view->edit_end)      view->edit_end = end;
+  view->edit_delta += delta;
+}
+
+/*
+ * Moves the viewport so `offset` is visible. Offsets less than a screen past
+ * the bottom scroll by as many rows as it takes, anything further away jumps
+ * to the start of its line. The viewport is laid out again once, by the
+ * next `text_view_layout`.
+ */
+void     text_view_scroll_to(TextView *view, TextSource src, u64 offset) {
+  text_view_layout(view, src);
+
+  if (offset < view->top) {
+    view->top = __text_view_line_start(src, offset);
+    view->needs_layout = true;
+    return;
+  }
+
+  u64 length = src.length(src.context);
+  u64 end = __text_view_end(view);
+  if (offset < end || (offset == end && end == length)) {
+    return;
+  }
+
+  // lay out the rows below the viewport until the one holding `offset`,
+  // the kth of them is visible once the viewport starts at its kth row
+  for (i32 k=1; k < view->row_count; k++) {
+    ViewRow row;
+    if (__text_view_layout_row(view, src, end, &row, view->scratch) == 0) {
+      break;
+    }
+
+    end += row.length;
+    if (offset < end || (offset == end && end == length)) {
+      view->top = view->rows[k].start;
+      view->needs_layout = true;
+      return;
+    }
+  }
+
+  view->top = __text_view_line_start(src, offset);
+  view->needs_layout = true;
+}
+
+/*
+ * Brings the cached layout up to date with the text, returns the number of
+ * rows that have to be redrawn.
+ */
+i32      text_view_layout(TextView *view, TextSource src) {
+  if (view->has_edit && !view->needs_layout) {
+    if (view->edit_start < view->top) {
+      // the text above the viewport changed, keep showing the same text
+      i64 top = (i64)view->top + view->edit_delta;
+      if (view->edit_start + (view->edit_delta < 0 ? (u64)(-view->edit_delta) : 0) > view->top) {
+        top = (i64)view->edit_start;
+      }
+      view->top = __text_view_line_start(src, top < 0 ? 0 : (u64)top);
+      view->needs_layout = true;
+    }
+  }
+
+  i32 first = 0;
+  if (!view->needs_layout) {
+    if (!view->has_edit) {
+      return 0;
+    }
+
+    // last row starting at or before the edit, the row before it is laid out
+    // again too in case the edit lets it hold more (or fewer) chars
+    for (i32 i=0; i < view->row_count; i++) {
+      if (view->rows[i].start > view->edit_start) {
+        break;
+      }
+      first = i;
+    }
+    first = first > 0 ? first - 1 : 0;
+  }
+
+  i32 dirty = 0;
+  u64 start = view->rows[first].start;
+  if (view->needs_layout) {
+    start = view->top;
+  }
+
+  for (i32 i=first; i < view->row_count; i++) {
+    ViewRow row;
+    __text_view_layout_row(view, src, start, &row, view->scratch);
+
+    // past the edit and aligned with the old layout, the rest is unchanged
+    bool past_edit = view->has_edit && start >= view->edit_end;
+    bool aligned   = (i64)view->rows[i].start + view->edit_delta == (i64)start;
+    if (!view->needs_layout && past_edit && aligned) {
+      for (i32 j=i; j < view->row_count; j++) {
+        view->rows[j].start = (u64)((i64)view->rows[j].start + view->edit_delta);
+      }
+      break;
+    }
+
+    if (__text_view_store_row(view, i, row)) {
+      dirty++;
+    }
+    start += row.length;
+  }
+
+  view->has_edit = false;
+  view->edit_delta = 0;
+  view->needs_layout = false;
+  return dirty;
+}
+
+/*
+ * Redraws the rows that changed since the last draw, returns the number of
+ * rows drawn.
+ */
+i32      text_view_draw(TextView *view, Bitmap *dst) {
+  i32 drawn = 0;
+  for (i32 i=0; i < view->row_count; i++) {
+    ViewRow *row = &(view->rows[i]);
+    if (!row->is_dirty) {
+      continue;
+    }
+
+    i32 top = view->frame.origin.y + (i * view->line_height);
+    Rect r = {
+      .origin = { view->frame.origin.x, top },
+      .corner = { view->frame.corner.x, top + view->line_height },
+    };
+    bitmap_fill_rect(dst, r, view->background);
+
+    Point pen = { view->frame.origin.x, top + view->ascent };
+    char *glyphs = view->glyphs + (i * view->max_cols);
+    for (i32 gi=0; gi < row->glyph_count; gi++) {
+      if (glyphs[gi] != ' ') {
+        font_render_char(view->font, glyphs[gi], dst, pen, view->foreground);
+      }
+      pen.x += __text_view_advance(view, glyphs[gi]);
+    }
+
+    row->is_dirty = false;
+    drawn++;
+  }
+  return drawn;
+}
+
+i32      text_view_update(TextView *view, TextSource src, Bitmap *dst) {
+  text_view_layout(view, src);
+  return text_view_draw(view, dst);
+}
+
+TextView __text_view_init(MemoryArena *arena, Rect frame, i32 line_height, i32 ascent, i32 *advances) {
+  assert(line_height > 0);
+
+  TextView view = {
+    .frame = frame,
+    .background = PALETTE_TRANSPARENT,
+    .foreground = PALETTE_WHITE,
+    .line_height = line_height,
+    .ascent = ascent,
+    .top = 0,
+    .needs_layout = true,
+    .has_edit = false,
+  };
+
+  i32 min_advance = 0;
+  for (i32 i=0; i < 95; i++) {
+    view.advances[i] = advances[i] > 0 ? advances[i] : 1;
+    if (min_advance == 0 || view.advances[i] < min_advance) {
+      min_advance = view.advances[i];
+    }
+  }
+
+  view.row_count = (i32)(rect_height(frame) / line_height);
+  view.max_cols = (i32)(rect_width(frame) / min_advance) + 1;
+  view.rows = arena_push(arena, view.row_count * sizeof(ViewRow));
+  view.glyphs = arena_push(arena, view.row_count * view.max_cols);
+  view.scratch = arena_push(arena, view.max_cols);
+  return view;
+}
+
+/* non printable chars take the space of a blank */
+i32      __text_view_advance(TextView *view, char c) {
+  u8 index = (u8)c;
+  if (index < 32 || index > 126) {
+    index = ' ';
+  }
+  return view->advances[index - 32];
+}
+
+/*
+ * Lays out the row starting at `start`: chars are added until a newline, the
+ * end of the text or the right edge of the frame (the char that doesn't fit
+ * starts the next row). Returns the number of chars consumed.
+ */
+i32      __text_view_layout_row(TextView *view, TextSource src, u64 start, ViewRow *row, char *glyphs) {
+  u64 length = src.length(src.context);
+  i32 width = (i32)rect_width(view->frame);
+
+  *row = (ViewRow){ .start = start, .length = 0, .glyph_count = 0, .is_dirty = false };
+
+  i32 x = 0;
+  for (u64 offset = start; offset < length; offset++) {
+    char c = src.char_at(src.context, offset);
+    if (c == '\n') {
+      row->length++;
+      break;
+    }
+
+    i32 advance = __text_view_advance(view, c);
+    bool fits = (x + advance <= width) && (row->glyph_count < view->max_cols);
+    if (!fits && row->glyph_count > 0) {
+      break;
+    }
+
+    glyphs[row->glyph_count++] = ((u8)c < 32 || (u8)c > 126) ? ' ' : c;
+    row->length++;
+    x += advance;
+  }
+  return row->length;
+}
+
+/* stores the new layout of row `index`, returns true if it looks different */
+bool     __text_view_store_row(TextView *view, i32 index, ViewRow row) {
+  ViewRow *cached = &(view->rows[index]);
+  char *glyphs = view->glyphs + (index * view->max_cols);
+
+  bool changed = cached->glyph_count != row.glyph_count
+    || memcmp(glyphs, view->scratch, row.glyph_count) != 0;
+
+  if (changed) {
+    memcpy(glyphs, view->scratch, row.glyph_count);
+  }
+
+  row.is_dirty = cached->is_dirty || changed;
+  *cached = row;
+  return changed;
+}
+
+/*
+ * Offset of the first char of the line containing `offset`. Sources that
+ * know their lines answer it, otherwise it's a walk back over the line.
+ */
+u64      __text_view_line_start(TextSource src, u64 offset) {
+  u64 length = src.length(src.context);
+  if (offset > length) {
+    offset = length;
+  }
+  if (src.line_start != NULL) {
+    return src.line_start(src.context, offset);
+  }
+
+  while (offset > 0 && src.char_at(src.context, offset - 1) != '\n') {
+    offset--;
+  }
+  return offset;
+}
+
+/* offset just past the last visible char */
+u64      __text_view_end(TextView *view) {
+  ViewRow *last = &(view->rows[view->row_count - 1]);
+  return last->start + last->length;
+}
+
+#endif
@@ -0,0 +1,570 @@
+#ifndef __HTTP_TEST_SERVER_H__
+#define __HTTP_TEST_SERVER_H__
+
+/*
+  http_test_server.h - a loopback HTTP/1.1 server for tests.
+
+  The server runs on threads of the test process, listens on 127.0.0.1 on
+  a port picked by the kernel and answers each request with the first route
+  whose method and path match it:
+
+    TestServer *server = test_server_start(TEST_SERVER_ROUTES, STRING8(""));
+    test_server_route(server, (TestRoute){
+      .path = STRING8("/search"),
+      .body = payload,
+      .latency_ms = 50,
+      .chunk_size = 16 * KB,
+    });
+    String8 url = test_server_url(server, arena, STRING8("/search"));
+    ...
+    test_server_stop(server);
+
+  A route can delay its response, send its body with chunked transfer
+  encoding (a chunk at a time), answer with any status, and answer
+  conditional requests for its etag with a 304. Connections are kept alive
+  and served concurrently, every request is logged (method, path, headers,
+  body) for the test to look at.
+
+  In record mode requests are forwarded to `upstream` and its 200s are saved
+  to `dir` as HttpCache entries, keyed by method, path and body. In replay
+  mode they are answered from `dir` only, so a test recorded once against
+  the real api replays offline.
+*/
+
+#include <dirent.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "base.h"
+#include "http.h"
+#include "http_cache.h"
+
+#define TEST_SERVER_MAX_ROUTES      16
+#define TEST_SERVER_MAX_REQUESTS    64    // logged, later requests are served but not logged
+#define TEST_SERVER_MAX_CONNECTIONS 32
+#define TEST_SERVER_MAX_HEADERS     32    // per logged request
+#define TEST_SERVER_REQUEST_BYTES   (64 * KB)
+#define TEST_SERVER_ARENA_BYTES     (4 * MB)
+#define TEST_SERVER_POLL_MS         20    // how often idle threads check if the server stopped
+
+typedef enum TestServerMode {
+  TEST_SERVER_ROUTES,
+  TEST_SERVER_RECORD,
+  TEST_SERVER_REPLAY,
+} TestServerMode;
+
+typedef struct TestRoute {
+  String8 method;         // empty for any
+  String8 path;           // without the query string, empty for any
+  u32 status;             // 200 when 0
+  String8 body;           // must outlive the server
+  String8 etag;           // a request with If-None-Match: etag gets a 304
+  String8 cache_control;
+  i32 latency_ms;         // before the status line
+  u64 chunk_size;         // > 0 sends the body chunked, chunk_size bytes at a time
+  i32 chunk_delay_ms;     // between chunks
+} TestRoute;
+
+typedef struct TestServerRequest {
+  String8 method;
+  String8 path;           // with the query string
+  String8 headers[TEST_SERVER_MAX_HEADERS];
+  usize header_count;
+  String8 body;
+} TestServerRequest;
+
+typedef struct TestServer {
+  i32 fd;
+  i32 port;
+  pthread_t thread;
+
+  pthread_mutex_t lock;   // everything below
+  bool is_running;
+  i32 connections;
+
+  TestRoute routes[TEST_SERVER_MAX_ROUTES];
+  i32 route_count;
+  TestServerRequest requests[TEST_SERVER_MAX_REQUESTS];
+  i32 request_count;
+  MemoryArena *arena;     // the logged requests
+
+  TestServerMode mode;
+  String8 upstream;       // record mode, i.e. https://www.youtube.com
+  HttpClient client;      // record mode
+  HttpCache recordings;   // record and replay modes
+} TestServer;
+
+TestServer       *test_server_start(TestServerMode mode, String8 dir);
+void              test_server_stop(TestServer *server);
+void              test_server_route(TestServer *server, TestRoute route);
+String8           test_server_url(TestServer *server, MemoryArena *arena, String8 path);
+i32               test_server_request_count(TestServer *server);
+TestServerRequest test_server_request(TestServer *server, i32 index);
+String8           test_server_header(TestServerRequest *request, String8 name);
+bool              test_remove_dir(char *path);
+
+typedef struct TestConnection {
+  TestServer *server;
+  i32 fd;
+} TestConnection;
+
+static void   *__test_server_accept(void *context);
+static void   *__test_server_connection(void *context);
+static bool    __test_server_is_running(TestServer *server);
+static bool    __test_server_read(TestServer *server, i32 fd, char *buffer, u64 *length);
+static bool    __test_server_send(i32 fd, char *data, u64 length);
+static bool    __test_server_respond(TestServer *server, i32 fd, TestServerRequest *request);
+static bool    __test_server_respond_route(i32 fd, TestServerRequest *request, TestRoute route);
+static bool    __test_server_respond_recorded(TestServer *server, i32 fd, TestServerRequest *request);
+static String8 __test_server_status_text(u32 status);
+static void    __test_server_sleep(i32 ms);
+
+/*
+ * Starts listening, `dir` is where record mode saves responses and replay
+ * mode reads them from (ignored by TEST_SERVER_ROUTES). Set the record
+ * mode's `upstream` before the first request.
+ */
+TestServer *test_server_start(TestServerMode mode, String8 dir) {
+  TestServer *server = calloc(1, sizeof(TestServer));
+  assert(server != NULL);
+
+  // a client that hangs up mid response must not kill the test process
+  signal(SIGPIPE, SIG_IGN);
+
+  server->fd = socket(AF_INET, SOCK_STREAM, 0);
+  i32 reuse = 1;
+  setsockopt(server->fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+  struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = 0 };
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_length = sizeof(addr);
+  if (bind(server->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(server->fd, 64) < 0) {
+    fprintf(stderr, "ERROR: Failed to start the test server.\n");
+    close(server->fd);
+    free(server);
+    return NULL;
+  }
+  getsockname(server->fd, (struct sockaddr *)&addr, &addr_length);
+  server->port = ntohs(addr.sin_port);
+
+  pthread_mutex_init(&(server->lock), NULL);
+  server->is_running = true;
+  server->arena = arena_create(TEST_SERVER_ARENA_BYTES);
+  server->mode = mode;
+  if (mode == TEST_SERVER_RECORD) {
+    server->client = http_client_create();
+  }
+  if (mode != TEST_SERVER_ROUTES) {
+    server->recordings = http_cache_create(&(server->client), dir);
+    server->recordings.ignore_cache_control = true;  // every 200 is recorded
+  }
+
+  pthread_create(&(server->thread), NULL, __test_server_accept, server);
+  return server;
+}
+
+/* stops accepting, waits for the open connections to close and frees the server */
+void test_server_stop(TestServer *server) {
+  pthread_mutex_lock(&(server->lock));
+  server->is_running = false;
+  pthread_mutex_unlock(&(server->lock));
+  pthread_join(server->thread, NULL);
+  close(server->fd);
+
+  for (;;) {
+    pthread_mutex_lock(&(server->lock));
+    i32 connections = server->connections;
+    pthread_mutex_unlock(&(server->lock));
+    if (connections == 0) {
+      break;
+    }
+    __test_server_sleep(TEST_SERVER_POLL_MS);
+  }
+
+  if (server->mode != TEST_SERVER_ROUTES) {
+    http_cache_destroy(&(server->recordings));
+  }
+  if (server->mode == TEST_SERVER_RECORD) {
+    http_client_destroy(&(server->client));
+  }
+  pthread_mutex_destroy(&(server->lock));
+  arena_destroy(server->arena);
+  free(server);
+}
+
+void test_server_route(TestServer *server, TestRoute route) {
+  pthread_mutex_lock(&(server->lock));
+  assert(server->route_count < TEST_SERVER_MAX_ROUTES);
+  server->routes[server->route_count++] = route;
+  pthread_mutex_unlock(&(server->lock));
+}
+
+/* http://127.0.0.1:<port><path> */
+String8 test_server_url(TestServer *server, MemoryArena *arena, String8 path) {
+  char base[64];
+  i32 length = snprintf(base, sizeof(base), "http://127.0.0.1:%d", server->port);
+  return string8_concat(arena, (String8){ .data = base, .length = length }, path);
+}
+
+i32 test_server_request_count(TestServer *server) {
+  pthread_mutex_lock(&(server->lock));
+  i32 count = server->request_count;
+  pthread_mutex_unlock(&(server->lock));
+  return count;
+}
+
+/* the `index`th logged request, its strings live until the server stops */
+TestServerRequest test_server_request(TestServer *server, i32 index) {
+  pthread_mutex_lock(&(server->lock));
+  assert(index >= 0 && index < server->request_count);
+  TestServerRequest request = server->requests[index];
+  pthread_mutex_unlock(&(server->lock));
+  return request;
+}
+
+String8 test_server_header(TestServerRequest *request, String8 name) {
+  HttpResponse headers = { .headers = request->headers, .header_count = request->header_count };
+  return http_response_get_header(&headers, name);
+}
+
+/*
+ * Removes `path` and the files in it (i.e. recordings or cache entries, no
+ * subdirectories), for cleaning up after a test without spawning a shell.
+ */
+bool test_remove_dir(char *path) {
+  DIR *dir = opendir(path);
+  if (dir == NULL) {
+    fprintf(stderr, "ERROR: Failed to open directory=%s.\n", path);
+    return false;
+  }
+
+  bool ok = true;
+  char file[1024];
+  for (struct dirent *entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+    if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+      continue;
+    }
+
+    snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+    if (unlink(file) < 0) {
+      fprintf(stderr, "ERROR: Failed to remove file=%s.\n", file);
+      ok = false;
+    }
+  }
+  closedir(dir);
+
+  if (rmdir(path) < 0) {
+    fprintf(stderr, "ERROR: Failed to remove directory=%s.\n", path);
+    ok = false;
+  }
+  return ok;
+}
+
+static void *__test_server_accept(void *context) {
+  TestServer *server = context;
+  struct pollfd listener = { .fd = server->fd, .events = POLLIN };
+
+  while (__test_server_is_running(server)) {
+    if (poll(&listener, 1, TEST_SERVER_POLL_MS) <= 0) {
+      continue;
+    }
+
+    i32 fd = accept(server->fd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+
+    pthread_mutex_lock(&(server->lock));
+    bool is_full = server->connections == TEST_SERVER_MAX_CONNECTIONS;
+    server->connections += is_full ? 0 : 1;
+    pthread_mutex_unlock(&(server->lock));
+    if (is_full) {
+      close(fd);
+      continue;
+    }
+
+    TestConnection *connection = malloc(sizeof(TestConnection));
+    connection->server = server;
+    connection->fd = fd;
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, __test_server_connection, connection);
+    pthread_detach(thread);
+  }
+  return NULL;
+}
+
+/* serves the requests of one keep-alive connection */
+static void *__test_server_connection(void *context) {
+  TestConnection *connection = context;
+  TestServer *server = connection->server;
+  i32 fd = connection->fd;
+  free(connection);
+
+  char *buffer = malloc(TEST_SERVER_REQUEST_BYTES + 1);
+  u64 length = 0;
+
+  for (;;) {
+    // headers
+    char *headers_end = NULL;
+    while ((buffer[length] = '\0', headers_end = strstr(buffer, "\r\n\r\n")) == NULL) {
+      if (!__test_server_read(server, fd, buffer, &length)) {
+        goto done;
+      }
+    }
+
+    TestServerRequest request = { .header_count = 0 };
+    char *line_end = strstr(buffer, "\r\n");
+    char *method_end = memchr(buffer, ' ', line_end - buffer);
+    char *path_end = method_end ? memchr(method_end + 1, ' ', line_end - method_end - 1) : NULL;
+    if (path_end == NULL) {
+      goto done;
+    }
+    request.method = (String8){ .data = buffer, .length = method_end - buffer };
+    request.path = (String8){ .data = method_end + 1, .length = path_end - method_end - 1 };
+
+    for (char *line = line_end + 2; line < headers_end; line = strstr(line, "\r\n") + 2) {
+      char *end = strstr(line, "\r\n");
+      if (request.header_count < TEST_SERVER_MAX_HEADERS) {
+        request.headers[request.header_count++] = (String8){ .data = line, .length = end - line };
+      }
+    }
+
+    // body
+    String8 content_length = test_server_header(&request, STRING8("Content-Length"));
+    u64 body_length = content_length.length ? strtoull(content_length.data, NULL, 10) : 0;
+    u64 request_length = (headers_end + 4 - buffer) + body_length;
+    if (request_length > TEST_SERVER_REQUEST_BYTES) {
+      goto done;
+    }
+    if (test_server_header(&request, STRING8("Expect")).length) {
+      __test_server_send(fd, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+    }
+    while (length < request_length) {
+      if (!__test_server_read(server, fd, buffer, &length)) {
+        goto done;
+      }
+    }
+    request.body = (String8){ .data = headers_end + 4, .length = body_length };
+
+    bool keep_alive = !string8_equals(test_server_header(&request, STRING8("Connection")), STRING8("close"));
+    if (!__test_server_respond(server, fd, &request) || !keep_alive) {
+      goto done;
+    }
+
+    // keep anything that belongs to the next request
+    memmove(buffer, buffer + request_length, length - request_length);
+    length -= request_length;
+  }
+
+done:
+  free(buffer);
+  close(fd);
+  pthread_mutex_lock(&(server->lock));
+  server->connections--;
+  pthread_mutex_unlock(&(server->lock));
+  return NULL;
+}
+
+static bool __test_server_is_running(TestServer *server) {
+  pthread_mutex_lock(&(server->lock));
+  bool is_running = server->is_running;
+  pthread_mutex_unlock(&(server->lock));
+  return is_running;
+}
+
+/* appends what arrived to `buffer`, false once the connection or the server closed */
+static bool __test_server_read(TestServer *server, i32 fd, char *buffer, u64 *length) {
+  struct pollfd client = { .fd = fd, .events = POLLIN };
+  while (poll(&client, 1, TEST_SERVER_POLL_MS) == 0) {
+    if (!__test_server_is_running(server)) {
+      return false;
+    }
+  }
+
+  if (*length == TEST_SERVER_REQUEST_BYTES) {
+    return false;
+  }
+  ssize_t n = recv(fd, buffer + *length, TEST_SERVER_REQUEST_BYTES - *length, 0);
+  if (n <= 0) {
+    return false;
+  }
+  *length += n;
+  return true;
+}
+
+static bool __test_server_send(i32 fd, char *data, u64 length) {
+  while (length > 0) {
+    ssize_t n = send(fd, data, length, 0);
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    length -= n;
+  }
+  return true;
+}
+
+/* logs `request` and answers it the way the server's mode says */
+static bool __test_server_respond(TestServer *server, i32 fd, TestServerRequest *request) {
+  pthread_mutex_lock(&(server->lock));
+  if (server->request_count < TEST_SERVER_MAX_REQUESTS) {
+    TestServerRequest *logged = &(server->requests[server->request_count++]);
+    logged->method = string8_clone(server->arena, request->method);
+    logged->path = string8_clone(server->arena, request->path);
+    logged->body = string8_clone(server->arena, request->body);
+    logged->header_count = request->header_count;
+    for (usize i = 0; i < request->header_count; i++) {
+      logged->headers[i] = string8_clone(server->arena, request->headers[i]);
+    }
+  }
+
+  TestRoute route = { .status = 404, .body = STRING8("no route") };
+  String8 path = request->path;
+  for (u64 i = 0; i < path.length; i++) {
+    if (path.data[i] == '?') {
+      path.length = i;
+      break;
+    }
+  }
+  for (i32 i = 0; i < server->route_count; i++) {
+    TestRoute *candidate = &(server->routes[i]);
+    if ((candidate->method.length == 0 || string8_equals(candidate->method, request->method))
+        && (candidate->path.length == 0 || string8_equals(candidate->path, path))) {
+      route = *candidate;
+      break;
+    }
+  }
+  TestServerMode mode = server->mode;
+  pthread_mutex_unlock(&(server->lock));
+
+  if (mode != TEST_SERVER_ROUTES) {
+    return __test_server_respond_recorded(server, fd, request);
+  }
+  return __test_server_respond_route(fd, request, route);
+}
+
+static bool __test_server_respond_route(i32 fd, TestServerRequest *request, TestRoute route) {
+  __test_server_sleep(route.latency_ms);
+
+  u32 status = route.status ? route.status : 200;
+  String8 if_none_match = test_server_header(request, STRING8("If-None-Match"));
+  if (route.etag.length && string8_equals(if_none_match, route.etag)) {
+    status = 304;
+  }
+
+  bool has_body = status != 304 && !string8_equals(request->method, STRING8("HEAD"));
+  bool is_chunked = route.chunk_size > 0;
+  char head[1024];
+  i32 length = snprintf(head, sizeof(head), "HTTP/1.1 %u %s\r\nContent-Type: application/json\r\n",
+                        status, __test_server_status_text(status).data);
+  if (route.etag.length) {
+    length += snprintf(head + length, sizeof(head) - length, "ETag: %.*s\r\n", (i32)route.etag.length, route.etag.data);
+  }
+  if (route.cache_control.length) {
+    length += snprintf(head + length, sizeof(head) - length, "Cache-Control: %.*s\r\n",
+                       (i32)route.cache_control.length, route.cache_control.data);
+  }
+  if (status != 304) {
+    length += is_chunked
+      ? snprintf(head + length, sizeof(head) - length, "Transfer-Encoding: chunked\r\n")
+      : snprintf(head + length, sizeof(head) - length, "Content-Length: %llu\r\n", (unsigned long long)route.body.length);
+  }
+  length += snprintf(head + length, sizeof(head) - length, "\r\n");
+
+  if (!__test_server_send(fd, head, length)) {
+    return false;
+  }
+  if (!has_body) {
+    return true;
+  }
+  if (!is_chunked) {
+    return __test_server_send(fd, route.body.data, route.body.length);
+  }
+
+  for (u64 sent = 0; sent < route.body.length; sent += route.chunk_size) {
+    u64 size = MIN(route.chunk_size, route.body.length - sent);
+    char chunk_head[32];
+    i32 chunk_head_length = snprintf(chunk_head, sizeof(chunk_head), "%llx\r\n", (unsigned long long)size);
+    if (!__test_server_send(fd, chunk_head, chunk_head_length)
+        || !__test_server_send(fd, route.body.data + sent, size)
+        || !__test_server_send(fd, "\r\n", 2)) {
+      return false;
+    }
+    __test_server_sleep(route.chunk_delay_ms);
+  }
+  return __test_server_send(fd, "0\r\n\r\n", 5);
+}
+
+/* record: forwards the request and saves its 200, replay: answers from the saved ones */
+static bool __test_server_respond_recorded(TestServer *server, i32 fd, TestServerRequest *request) {
+  HttpRequest key_request = { .method = request->method, .uri = request->path, .body = request->body };
+  TestRoute route = { .status = 404, .body = STRING8("no recording") };
+
+  // the client, the recordings' mappings and the arena aren't shared between threads
+  pthread_mutex_lock(&(server->lock));
+  u64 position = server->arena->position;
+  HttpCacheKey key = http_cache_key(key_request, server->arena);
+  if (server->mode == TEST_SERVER_RECORD) {
+    String8 content_type = test_server_header(request, STRING8("Content-Type"));
+    String8 headers[1] = { string8_concat(server->arena, STRING8("Content-Type: "), content_type) };
+    HttpRequest upstream = {
+      .method = request->method,
+      .uri = string8_concat(server->arena, server->upstream, request->path),
+      .body = request->body,
+      .headers = headers,
+      .header_count = content_type.length ? 1 : 0,
+    };
+
+    HttpResponse response = http_request(server->client, upstream, server->arena);
+    http_cache_store(&(server->recordings), key, response);
+    route.status = response.status ? (u32)response.status : 502;
+    route.body = response.body;
+  } else {
+    HttpCacheEntry entry = http_cache_lookup(&(server->recordings), key);
+    if (entry.found) {
+      route.status = (u32)entry.header.status;
+      route.body = entry.body;
+    } else {
+      fprintf(stderr, "ERROR: No recording for %.*s %.*s.\n", (i32)request->method.length, request->method.data,
+              (i32)request->path.length, request->path.data);
+    }
+  }
+
+  bool ok = __test_server_respond_route(fd, request, route);
+  arena_pop_to(server->arena, position);
+  pthread_mutex_unlock(&(server->lock));
+  return ok;
+}
+
+static String8 __test_server_status_text(u32 status) {
+  switch (status) {
+  case 200: return STRING8("OK");
+  case 201: return STRING8("Created");
+  case 204: return STRING8("No Content");
+  case 304: return STRING8("Not Modified");
+  case 400: return STRING8("Bad Request");
+  case 404: return STRING8("Not Found");
+  case 429: return STRING8("Too Many Requests");
+  case 500: return STRING8("Internal Server Error");
+  case 502: return STRING8("Bad Gateway");
+  case 503: return STRING8("Service Unavailable");
+  default:  return STRING8("Status");
+  }
+}
+
+static void __test_server_sleep(i32 ms) {
+  if (ms > 0) {
+    poll(NULL, 0, ms);
+  }
+}
+
+#endif
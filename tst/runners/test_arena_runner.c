@@ -0,0 +1,9 @@
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "test_arena.c"
+
+TEST_GROUP_RUNNER(ArenaTests) {
+  RUN_TEST_CASE(ArenaTests, arena_grow_resizes_topmost_allocation_in_place);
+  RUN_TEST_CASE(ArenaTests, arena_grow_copies_allocation_that_is_not_on_top);
+}
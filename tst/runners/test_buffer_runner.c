@@ -0,0 +1,18 @@
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "test_buffer.c"
+
+TEST_GROUP_RUNNER(GapBufferTests) {
+  RUN_TEST_CASE(GapBufferTests, buffer_create_creates_an_empty_buffer);
+  RUN_TEST_CASE(GapBufferTests, buffer_insert_adds_chars_at_the_gap);
+  RUN_TEST_CASE(GapBufferTests, buffer_backspace_deletes_char_before_the_gap);
+  RUN_TEST_CASE(GapBufferTests, buffer_backspace_does_nothing_at_start_of_buffer);
+  RUN_TEST_CASE(GapBufferTests, buffer_delete_deletes_char_after_the_gap);
+  RUN_TEST_CASE(GapBufferTests, buffer_delete_does_nothing_at_end_of_buffer);
+  RUN_TEST_CASE(GapBufferTests, buffer_move_gap_moves_insertion_point);
+  RUN_TEST_CASE(GapBufferTests, buffer_move_gap_clamps_out_of_bounds_positions);
+  RUN_TEST_CASE(GapBufferTests, buffer_grow_preserves_text_after_the_gap);
+  RUN_TEST_CASE(GapBufferTests, buffer_insert_string8_grows_once_for_large_inserts);
+  RUN_TEST_CASE(GapBufferTests, buffer_operations_match_naive_array);
+}
@@ -0,0 +1,17 @@
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "test_editor.c"
+
+TEST_GROUP_RUNNER(EditorTests) {
+  RUN_TEST_CASE(EditorTests, mark_add_keeps_location);
+  RUN_TEST_CASE(EditorTests, mark_list_insert_shifts_marks_after_location);
+  RUN_TEST_CASE(EditorTests, mark_list_delete_collapses_marks_in_deleted_range);
+  RUN_TEST_CASE(EditorTests, mark_remove_and_mark_set_update_marks);
+  RUN_TEST_CASE(EditorTests, mark_list_matches_naive_locations);
+  RUN_TEST_CASE(EditorTests, editor_buffer_create_counts_chars_and_lines);
+  RUN_TEST_CASE(EditorTests, editor_buffer_insert_updates_point_and_lines);
+  RUN_TEST_CASE(EditorTests, editor_buffer_delete_updates_lines_and_marks);
+  RUN_TEST_CASE(EditorTests, editor_buffer_set_point_updates_current_line);
+  RUN_TEST_CASE(EditorTests, editor_buffer_undo_reverts_edits_in_reverse_order);
+}
@@ -0,0 +1,19 @@
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "test_http_cache.c"
+
+TEST_GROUP_RUNNER(HttpCacheTests) {
+  RUN_TEST_CASE(HttpCacheTests, http_cache_key_depends_on_method_url_params_and_body);
+  RUN_TEST_CASE(HttpCacheTests, http_cache_control_parse_reads_directives);
+  RUN_TEST_CASE(HttpCacheTests, http_cache_store_and_lookup_round_trip);
+  RUN_TEST_CASE(HttpCacheTests, http_cache_lookup_misses_entries_of_colliding_requests);
+  RUN_TEST_CASE(HttpCacheTests, http_cache_lookup_keeps_one_mapping_per_key);
+  RUN_TEST_CASE(HttpCacheTests, http_cache_entries_expire_after_max_age);
+  RUN_TEST_CASE(HttpCacheTests, http_cache_store_skips_no_store_and_errors);
+  RUN_TEST_CASE(HttpCacheTests, http_cache_ignore_cache_control_uses_the_cache_defaults);
+  RUN_TEST_CASE(HttpCacheTests, http_cache_request_answers_fresh_entries_without_the_network);
+  RUN_TEST_CASE(HttpCacheTests, http_cache_request_revalidates_stale_entries_with_their_etag);
+  RUN_TEST_CASE(HttpCacheTests, http_cache_request_replaces_entries_whose_etag_changed);
+  RUN_TEST_CASE(HttpCacheTests, http_cache_request_revalidates_in_the_background_while_stale);
+}
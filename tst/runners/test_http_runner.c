@@ -5,4 +5,16 @@
 
 TEST_GROUP_RUNNER(HttpTests) {
   RUN_TEST_CASE(HttpTests, http_post_makes_successful_post_request);
+  RUN_TEST_CASE(HttpTests, http_post_streams_body_into_arena_with_a_single_allocation);
+  RUN_TEST_CASE(HttpTests, http_request_reports_the_body_while_it_downloads);
+  RUN_TEST_CASE(HttpTests, http_client_is_reused_across_requests);
+  RUN_TEST_CASE(HttpTests, http_submit_runs_requests_with_bounded_concurrency);
+  RUN_TEST_CASE(HttpTests, http_async_wait_returns_the_response_of_a_polled_request);
+  RUN_TEST_CASE(HttpTests, http_build_url_appends_url_encoded_query_params);
+  RUN_TEST_CASE(HttpTests, http_response_get_header_ignores_case_and_leading_whitespace);
+  RUN_TEST_CASE(HttpTests, http_request_head_returns_headers_without_body);
+  RUN_TEST_CASE(HttpTests, http_request_rejects_unknown_methods);
+  RUN_TEST_CASE(HttpTests, http_request_reports_a_chunked_body_while_it_arrives);
+  RUN_TEST_CASE(HttpTests, http_request_returns_error_statuses_with_their_body);
+  RUN_TEST_CASE(HttpTests, http_test_server_replays_what_it_recorded);
 }
@@ -0,0 +1,11 @@
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "test_hud.c"
+
+TEST_GROUP_RUNNER(HudTests) {
+  RUN_TEST_CASE(HudTests, arena_tracks_its_high_water_mark);
+  RUN_TEST_CASE(HudTests, redraws_only_when_visible_and_due);
+  RUN_TEST_CASE(HudTests, fps_is_averaged_over_the_graph);
+  RUN_TEST_CASE(HudTests, graph_stacks_timings_from_the_bottom);
+}
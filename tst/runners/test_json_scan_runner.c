@@ -0,0 +1,15 @@
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "test_json_scan.c"
+
+TEST_GROUP_RUNNER(JsonScanTests) {
+  RUN_TEST_CASE(JsonScanTests, json_scan_next_returns_tokens_as_slices_of_the_input);
+  RUN_TEST_CASE(JsonScanTests, json_scan_next_rejects_malformed_documents);
+  RUN_TEST_CASE(JsonScanTests, json_scan_skip_jumps_over_a_container);
+  RUN_TEST_CASE(JsonScanTests, json_scan_match_reports_only_subscribed_paths);
+  RUN_TEST_CASE(JsonScanTests, json_string_decode_resolves_escapes);
+  RUN_TEST_CASE(JsonScanTests, json_scan_next_resumes_tokens_cut_by_the_end_of_the_input);
+  RUN_TEST_CASE(JsonScanTests, json_scan_match_extracts_videos_from_a_youtube_response);
+  RUN_TEST_CASE(JsonScanTests, json_scan_match_reports_videos_while_the_response_arrives);
+}
@@ -0,0 +1,20 @@
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "test_rope.c"
+
+TEST_GROUP_RUNNER(RopeTests) {
+  RUN_TEST_CASE(RopeTests, rope_create_creates_an_empty_rope);
+  RUN_TEST_CASE(RopeTests, rope_insert_adds_text_at_offset);
+  RUN_TEST_CASE(RopeTests, rope_delete_removes_text_at_offset);
+  RUN_TEST_CASE(RopeTests, rope_get_returns_char_at_offset);
+  RUN_TEST_CASE(RopeTests, rope_line_start_returns_offset_of_line);
+  RUN_TEST_CASE(RopeTests, rope_line_of_returns_line_of_offset);
+  RUN_TEST_CASE(RopeTests, rope_snapshot_is_not_affected_by_later_edits);
+  RUN_TEST_CASE(RopeTests, rope_iter_yields_text_from_offset);
+  RUN_TEST_CASE(RopeTests, rope_count_newlines_counts_every_newline);
+  RUN_TEST_CASE(RopeTests, rope_from_external_indexes_lines_lazily);
+  RUN_TEST_CASE(RopeTests, rope_from_external_line_of_end_counts_every_line);
+  RUN_TEST_CASE(RopeTests, rope_from_external_edits_do_not_modify_external_text);
+  RUN_TEST_CASE(RopeTests, rope_operations_match_naive_array);
+}
@@ -6,6 +6,7 @@
 TEST_GROUP_RUNNER(String8Tests) {
   RUN_TEST_CASE(String8Tests, string8_creates_string8_struct);
   RUN_TEST_CASE(String8Tests, string8_from_charbuf_creates_an_arena_allocated_string8_from_char_buffer);
+  RUN_TEST_CASE(String8Tests, string8_from_charbuf_does_not_read_past_length);
   RUN_TEST_CASE(String8Tests, string8_creates_multiple_arena_allocated_string8_values);
   RUN_TEST_CASE(String8Tests, string8_clone_copies_string8);
   RUN_TEST_CASE(String8Tests, string8_concat_returns_a_new_string_joining_lhs_and_rhs);
@@ -26,6 +27,7 @@ TEST_GROUP_RUNNER(String8Tests) {
   RUN_TEST_CASE(String8Tests, string8_startswith_returns_false_if_s_does_not_start_with_prefix);
   RUN_TEST_CASE(String8Tests, string8_endswith_returns_true_if_suffix_is_empty);
   RUN_TEST_CASE(String8Tests, string8_endswith_returns_true_if_s_ends_with_suffix);
+  RUN_TEST_CASE(String8Tests, string8_endswith_returns_true_for_suffixes_of_any_length);
   RUN_TEST_CASE(String8Tests, string8_endswith_returns_false_if_suffix_is_longer_than_s);
   RUN_TEST_CASE(String8Tests, string8_endswith_returns_false_if_s_does_not_end_with_suffix);
 }
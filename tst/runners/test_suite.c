@@ -1,15 +1,33 @@
 #include "unity_fixture.h"
 
+#include "test_arena_runner.c"
+#include "test_buffer_runner.c"
+#include "test_editor_runner.c"
 #include "test_http_runner.c"
+#include "test_hud_runner.c"
+#include "test_http_cache_runner.c"
+#include "test_json_scan_runner.c"
+#include "test_rope_runner.c"
 #include "test_string8_runner.c"
+#include "test_view_runner.c"
+#include "test_yt_snapshot_runner.c"
 
 
 static void run_unit_tests(void) {
   RUN_TEST_GROUP(String8Tests);
+  RUN_TEST_GROUP(ArenaTests);
+  RUN_TEST_GROUP(GapBufferTests);
+  RUN_TEST_GROUP(RopeTests);
+  RUN_TEST_GROUP(EditorTests);
+  RUN_TEST_GROUP(TextViewTests);
+  RUN_TEST_GROUP(HudTests);
+  RUN_TEST_GROUP(JsonScanTests);
+  RUN_TEST_GROUP(YoutubeSnapshotTests);
 }
 
 static void run_integ_tests(void) {
   RUN_TEST_GROUP(HttpTests);
+  RUN_TEST_GROUP(HttpCacheTests);
 }
 
 static void run_full_test_suite(void) {
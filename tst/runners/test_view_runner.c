@@ -0,0 +1,16 @@
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "test_view.c"
+
+TEST_GROUP_RUNNER(TextViewTests) {
+  RUN_TEST_CASE(TextViewTests, layout_splits_lines_and_wraps_long_lines);
+  RUN_TEST_CASE(TextViewTests, layout_without_edits_does_nothing);
+  RUN_TEST_CASE(TextViewTests, insert_dirties_only_the_edited_row);
+  RUN_TEST_CASE(TextViewTests, delete_of_newline_dirties_rows_below);
+  RUN_TEST_CASE(TextViewTests, edit_above_viewport_keeps_visible_text);
+  RUN_TEST_CASE(TextViewTests, scroll_to_moves_viewport_one_row_at_a_time);
+  RUN_TEST_CASE(TextViewTests, scroll_to_lays_out_the_viewport_once);
+  RUN_TEST_CASE(TextViewTests, scroll_to_uses_the_sources_line_start);
+  RUN_TEST_CASE(TextViewTests, incremental_layout_matches_full_layout);
+}
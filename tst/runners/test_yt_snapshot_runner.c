@@ -0,0 +1,12 @@
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "test_yt_snapshot.c"
+
+TEST_GROUP_RUNNER(YoutubeSnapshotTests) {
+  RUN_TEST_CASE(YoutubeSnapshotTests, yt_snapshot_round_trips_a_search_response);
+  RUN_TEST_CASE(YoutubeSnapshotTests, yt_snapshot_open_rejects_other_versions_and_truncated_images);
+  RUN_TEST_CASE(YoutubeSnapshotTests, yt_snapshot_strings_outside_the_image_are_empty);
+  RUN_TEST_CASE(YoutubeSnapshotTests, yt_snapshot_save_maps_a_parsed_response_in_place);
+  RUN_TEST_CASE(YoutubeSnapshotTests, yt_search_restore_makes_saved_videos_playable);
+}
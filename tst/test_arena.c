@@ -0,0 +1,42 @@
+#include <string.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "base.h"
+
+MemoryArena *grow_arena;
+
+TEST_GROUP(ArenaTests);
+
+TEST_SETUP(ArenaTests) {
+  grow_arena = arena_create(100);
+}
+
+TEST_TEAR_DOWN(ArenaTests) {
+  arena_destroy(grow_arena);
+}
+
+TEST(ArenaTests, arena_grow_resizes_topmost_allocation_in_place) {
+  char *data = arena_push(grow_arena, 4);
+  memcpy(data, "foo", 4);
+
+  char *grown = arena_grow(grow_arena, data, 4, 32);
+  TEST_ASSERT_EQUAL_PTR(data, grown);
+  TEST_ASSERT_EQUAL(32, grow_arena->position);
+
+  char *shrunk = arena_grow(grow_arena, grown, 32, 8);
+  TEST_ASSERT_EQUAL_PTR(data, shrunk);
+  TEST_ASSERT_EQUAL(8, grow_arena->position);
+  TEST_ASSERT_EQUAL_STRING("foo", shrunk);
+}
+
+TEST(ArenaTests, arena_grow_copies_allocation_that_is_not_on_top) {
+  char *data = arena_push(grow_arena, 4);
+  memcpy(data, "foo", 4);
+  arena_push(grow_arena, 4);
+
+  char *grown = arena_grow(grow_arena, data, 4, 16);
+  TEST_ASSERT_TRUE(grown != data);
+  TEST_ASSERT_EQUAL_STRING("foo", grown);
+}
@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "base.h"
+#include "buffer.h"
+
+#define FUZZ_ITERATIONS 20000
+#define FUZZ_MAX_TEXT   (1 << 16)
+
+GapBuffer gb;
+
+TEST_GROUP(GapBufferTests);
+
+TEST_SETUP(GapBufferTests) {
+  gb = buffer_create();
+}
+
+TEST_TEAR_DOWN(GapBufferTests) {
+  buffer_destroy(&gb);
+}
+
+static void assert_buffer_text(GapBuffer *b, char *expected) {
+  i32 length = (i32)strlen(expected);
+  TEST_ASSERT_EQUAL(length, buffer_length(b));
+  for (i32 i = 0; i < length; i++) {
+    TEST_ASSERT_EQUAL_CHAR(expected[i], buffer_get(b, i));
+  }
+}
+
+TEST(GapBufferTests, buffer_create_creates_an_empty_buffer) {
+  TEST_ASSERT_EQUAL(0, buffer_length(&gb));
+  TEST_ASSERT_EQUAL(GAP_SIZE_BYTES, __buffer_gap_size(&gb));
+}
+
+TEST(GapBufferTests, buffer_insert_adds_chars_at_the_gap) {
+  buffer_insert(&gb, 'f');
+  buffer_insert(&gb, 'o');
+  buffer_insert(&gb, 'o');
+  assert_buffer_text(&gb, "foo");
+}
+
+TEST(GapBufferTests, buffer_backspace_deletes_char_before_the_gap) {
+  buffer_insert_string8(&gb, STRING8("foo"));
+  buffer_backspace(&gb);
+  assert_buffer_text(&gb, "fo");
+}
+
+TEST(GapBufferTests, buffer_backspace_does_nothing_at_start_of_buffer) {
+  buffer_backspace(&gb);
+  TEST_ASSERT_EQUAL(0, buffer_length(&gb));
+}
+
+TEST(GapBufferTests, buffer_delete_deletes_char_after_the_gap) {
+  buffer_insert_string8(&gb, STRING8("foobar"));
+  buffer_move_gap(&gb, 3);
+  buffer_delete(&gb);
+  assert_buffer_text(&gb, "fooar");
+}
+
+TEST(GapBufferTests, buffer_delete_does_nothing_at_end_of_buffer) {
+  buffer_insert_string8(&gb, STRING8("foo"));
+  buffer_delete(&gb);
+  assert_buffer_text(&gb, "foo");
+}
+
+TEST(GapBufferTests, buffer_move_gap_moves_insertion_point) {
+  buffer_insert_string8(&gb, STRING8("fobar"));
+  buffer_move_gap(&gb, 2);
+  buffer_insert(&gb, 'o');
+  buffer_move_gap(&gb, 0);
+  buffer_insert(&gb, '>');
+  buffer_move_gap(&gb, buffer_length(&gb));
+  buffer_insert(&gb, '<');
+  assert_buffer_text(&gb, ">foobar<");
+}
+
+TEST(GapBufferTests, buffer_move_gap_clamps_out_of_bounds_positions) {
+  buffer_insert_string8(&gb, STRING8("foo"));
+  buffer_move_gap(&gb, -10);
+  TEST_ASSERT_EQUAL(0, gb.gap_start);
+  buffer_move_gap(&gb, 10);
+  TEST_ASSERT_EQUAL(3, gb.gap_start);
+}
+
+TEST(GapBufferTests, buffer_grow_preserves_text_after_the_gap) {
+  buffer_insert_string8(&gb, STRING8("world"));
+  buffer_move_gap(&gb, 0);
+  for (i32 i = 0; i < GAP_SIZE_BYTES; i++) {
+    buffer_insert(&gb, '.');
+  }
+
+  TEST_ASSERT_TRUE(gb.size > GAP_SIZE_BYTES);
+  TEST_ASSERT_EQUAL(GAP_SIZE_BYTES + 5, buffer_length(&gb));
+  TEST_ASSERT_EQUAL_CHAR('.', buffer_get(&gb, GAP_SIZE_BYTES - 1));
+  TEST_ASSERT_EQUAL_CHAR('w', buffer_get(&gb, GAP_SIZE_BYTES));
+  TEST_ASSERT_EQUAL_CHAR('d', buffer_get(&gb, GAP_SIZE_BYTES + 4));
+}
+
+TEST(GapBufferTests, buffer_insert_string8_grows_once_for_large_inserts) {
+  i32 paste_len = 10 * GAP_SIZE_BYTES;
+  char *paste = malloc(paste_len);
+  memset(paste, 'x', paste_len);
+
+  buffer_insert_string8(&gb, (String8){ .data = paste, .length = paste_len });
+  TEST_ASSERT_EQUAL(paste_len, buffer_length(&gb));
+  TEST_ASSERT_TRUE(__buffer_gap_size(&gb) >= GAP_MIN_BYTES);
+  free(paste);
+}
+
+/*
+  Applies a random sequence of operations to both the gap buffer and a naive
+  array and checks they agree after every step.
+*/
+TEST(GapBufferTests, buffer_operations_match_naive_array) {
+  char *naive = malloc(FUZZ_MAX_TEXT);
+  i32 naive_len = 0;
+  i32 cursor = 0;
+  char chunk[64];
+
+  srand(0x5eed);
+  for (i32 step = 0; step < FUZZ_ITERATIONS; step++) {
+    switch (rand() % 5) {
+    case 0: // insert char
+      if (naive_len + 1 >= FUZZ_MAX_TEXT) break;
+      chunk[0] = 'a' + (rand() % 26);
+      memmove(naive + cursor + 1, naive + cursor, naive_len - cursor);
+      naive[cursor++] = chunk[0];
+      naive_len++;
+      buffer_insert(&gb, chunk[0]);
+      break;
+    case 1: { // insert string
+      i32 n = rand() % (i32)sizeof(chunk);
+      if (naive_len + n >= FUZZ_MAX_TEXT) break;
+      for (i32 i = 0; i < n; i++) chunk[i] = 'A' + (rand() % 26);
+      memmove(naive + cursor + n, naive + cursor, naive_len - cursor);
+      memcpy(naive + cursor, chunk, n);
+      cursor += n;
+      naive_len += n;
+      buffer_insert_string8(&gb, (String8){ .data = chunk, .length = n });
+      break;
+    }
+    case 2: // backspace
+      if (cursor > 0) {
+        memmove(naive + cursor - 1, naive + cursor, naive_len - cursor);
+        cursor--;
+        naive_len--;
+      }
+      buffer_backspace(&gb);
+      break;
+    case 3: // delete forward
+      if (cursor < naive_len) {
+        memmove(naive + cursor, naive + cursor + 1, naive_len - cursor - 1);
+        naive_len--;
+      }
+      buffer_delete(&gb);
+      break;
+    case 4: // move
+      cursor = naive_len ? rand() % (naive_len + 1) : 0;
+      buffer_move_gap(&gb, cursor);
+      break;
+    }
+
+    TEST_ASSERT_EQUAL(cursor, gb.gap_start);
+    TEST_ASSERT_EQUAL(naive_len, buffer_length(&gb));
+  }
+
+  for (i32 i = 0; i < naive_len; i++) {
+    TEST_ASSERT_EQUAL_CHAR(naive[i], buffer_get(&gb, i));
+  }
+  free(naive);
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "base.h"
+#include "rope.h"
+#include "fooled/editor.h"
+
+#define MARK_FUZZ_ITERATIONS 5000
+#define MARK_FUZZ_MARKS      64
+
+MarkList marks;
+Buffer editor_buffer;
+
+TEST_GROUP(EditorTests);
+
+TEST_SETUP(EditorTests) {
+  marks = mark_list_create();
+  editor_buffer = editor_buffer_create(STRING8("*scratch*"), rope_from_string8(STRING8("foo\nbar\nbaz")));
+}
+
+TEST_TEAR_DOWN(EditorTests) {
+  mark_list_destroy(&marks);
+  editor_buffer_destroy(&editor_buffer);
+}
+
+TEST(EditorTests, mark_add_keeps_location) {
+  marks.text_length = 100;
+  i32 a = mark_add(&marks, 50, MARK_NORMAL);
+  i32 b = mark_add(&marks, 10, MARK_NORMAL);
+  i32 c = mark_add(&marks, 90, MARK_FIXED);
+
+  TEST_ASSERT_EQUAL(3, mark_list_count(&marks));
+  TEST_ASSERT_EQUAL(50, mark_get(&marks, a));
+  TEST_ASSERT_EQUAL(10, mark_get(&marks, b));
+  TEST_ASSERT_EQUAL(90, mark_get(&marks, c));
+}
+
+TEST(EditorTests, mark_list_insert_shifts_marks_after_location) {
+  marks.text_length = 100;
+  i32 before = mark_add(&marks, 10, MARK_NORMAL);
+  i32 after = mark_add(&marks, 60, MARK_NORMAL);
+  i32 normal = mark_add(&marks, 50, MARK_NORMAL);
+  i32 fixed = mark_add(&marks, 50, MARK_FIXED);
+
+  mark_list_insert(&marks, 50, 5);
+  TEST_ASSERT_EQUAL(10, mark_get(&marks, before));
+  TEST_ASSERT_EQUAL(65, mark_get(&marks, after));
+  TEST_ASSERT_EQUAL(55, mark_get(&marks, normal));
+  TEST_ASSERT_EQUAL(50, mark_get(&marks, fixed));
+}
+
+TEST(EditorTests, mark_list_delete_collapses_marks_in_deleted_range) {
+  marks.text_length = 100;
+  i32 inside = mark_add(&marks, 25, MARK_NORMAL);
+  i32 at_end = mark_add(&marks, 30, MARK_FIXED);
+  i32 after = mark_add(&marks, 80, MARK_NORMAL);
+
+  mark_list_delete(&marks, 20, 10);
+  TEST_ASSERT_EQUAL(20, mark_get(&marks, inside));
+  TEST_ASSERT_EQUAL(20, mark_get(&marks, at_end));
+  TEST_ASSERT_EQUAL(70, mark_get(&marks, after));
+}
+
+TEST(EditorTests, mark_remove_and_mark_set_update_marks) {
+  marks.text_length = 100;
+  i32 a = mark_add(&marks, 20, MARK_NORMAL);
+  i32 b = mark_add(&marks, 20, MARK_FIXED);
+  i32 c = mark_add(&marks, 40, MARK_NORMAL);
+
+  mark_remove(&marks, b);
+  mark_set(&marks, c, 5);
+  TEST_ASSERT_EQUAL(2, mark_list_count(&marks));
+  TEST_ASSERT_EQUAL(20, mark_get(&marks, a));
+  TEST_ASSERT_EQUAL(5, mark_get(&marks, c));
+}
+
+/*
+  Applies random edits to the mark list and to a plain array of locations
+  and checks they agree.
+*/
+TEST(EditorTests, mark_list_matches_naive_locations) {
+  i32 locations[MARK_FUZZ_MARKS];
+  MarkType types[MARK_FUZZ_MARKS];
+  i32 length = 1000;
+
+  srand(0xa11);
+  marks.text_length = length;
+  for (i32 i = 0; i < MARK_FUZZ_MARKS; i++) {
+    locations[i] = rand() % (length + 1);
+    types[i] = (rand() % 2) ? MARK_NORMAL : MARK_FIXED;
+    TEST_ASSERT_EQUAL(i, mark_add(&marks, locations[i], types[i]));
+  }
+
+  for (i32 step = 0; step < MARK_FUZZ_ITERATIONS; step++) {
+    i32 at = rand() % (length + 1);
+    if (rand() % 2) {
+      i32 n = 1 + rand() % 20;
+      for (i32 i = 0; i < MARK_FUZZ_MARKS; i++) {
+        if (locations[i] > at || (locations[i] == at && types[i] == MARK_NORMAL)) locations[i] += n;
+      }
+      mark_list_insert(&marks, at, n);
+      length += n;
+    } else {
+      i32 n = MIN(rand() % 20, length - at);
+      for (i32 i = 0; i < MARK_FUZZ_MARKS; i++) {
+        if (locations[i] > at + n) locations[i] -= n;
+        else if (locations[i] > at) locations[i] = at;
+      }
+      mark_list_delete(&marks, at, n);
+      length -= n;
+    }
+
+    i32 id = rand() % MARK_FUZZ_MARKS;
+    TEST_ASSERT_EQUAL(locations[id], mark_get(&marks, id));
+  }
+
+  for (i32 i = 0; i < MARK_FUZZ_MARKS; i++) {
+    TEST_ASSERT_EQUAL(locations[i], mark_get(&marks, i));
+  }
+}
+
+TEST(EditorTests, editor_buffer_create_counts_chars_and_lines) {
+  TEST_ASSERT_EQUAL(11, editor_buffer.char_count);
+  TEST_ASSERT_EQUAL(3, editor_buffer.line_count);
+  TEST_ASSERT_EQUAL(0, editor_buffer.point);
+  TEST_ASSERT_EQUAL(0, editor_buffer.current_line);
+}
+
+TEST(EditorTests, editor_buffer_insert_updates_point_and_lines) {
+  editor_buffer_goto_line(&editor_buffer, 1);
+  editor_buffer_insert(&editor_buffer, STRING8("one\ntwo\n"));
+
+  TEST_ASSERT_EQUAL(12, editor_buffer.point);
+  TEST_ASSERT_EQUAL(3, editor_buffer.current_line);
+  TEST_ASSERT_EQUAL(19, editor_buffer.char_count);
+  TEST_ASSERT_EQUAL(5, editor_buffer.line_count);
+  TEST_ASSERT_EQUAL(0, editor_buffer_column(&editor_buffer));
+  TEST_ASSERT_TRUE(editor_buffer.is_modified);
+}
+
+TEST(EditorTests, editor_buffer_delete_updates_lines_and_marks) {
+  i32 mark = mark_add(&(editor_buffer.marks), 9, MARK_NORMAL);  // 'a' in baz
+
+  editor_buffer_set_point(&editor_buffer, 2);
+  editor_buffer_delete(&editor_buffer, 4);  // "o\nba"
+
+  TEST_ASSERT_EQUAL(7, editor_buffer.char_count);
+  TEST_ASSERT_EQUAL(2, editor_buffer.line_count);
+  TEST_ASSERT_EQUAL(5, mark_get(&(editor_buffer.marks), mark));
+  TEST_ASSERT_EQUAL(1, editor_buffer_mark_line(&editor_buffer, mark));
+}
+
+TEST(EditorTests, editor_buffer_set_point_updates_current_line) {
+  editor_buffer_set_point(&editor_buffer, 9);
+  TEST_ASSERT_EQUAL(2, editor_buffer.current_line);
+  TEST_ASSERT_EQUAL(1, editor_buffer_column(&editor_buffer));
+
+  editor_buffer_set_point(&editor_buffer, 100);
+  TEST_ASSERT_EQUAL(11, editor_buffer.point);
+}
+
+TEST(EditorTests, editor_buffer_undo_reverts_edits_in_reverse_order) {
+  MemoryArena *arena = arena_create(KB);
+  i32 mark = mark_add(&(editor_buffer.marks), 9, MARK_NORMAL);  // 'a' in baz
+
+  editor_buffer_goto_line(&editor_buffer, 1);
+  editor_buffer_insert(&editor_buffer, STRING8("one\n"));
+  editor_buffer_set_point(&editor_buffer, 2);
+  editor_buffer_delete(&editor_buffer, 4);  // "o\non"
+  TEST_ASSERT_EQUAL_STRING("foe\nbar\nbaz", rope_to_string8(&(editor_buffer.contents), arena, 0, editor_buffer.char_count).data);
+
+  TEST_ASSERT_TRUE(editor_buffer_undo(&editor_buffer));
+  TEST_ASSERT_EQUAL_STRING("foo\none\nbar\nbaz", rope_to_string8(&(editor_buffer.contents), arena, 0, editor_buffer.char_count).data);
+  TEST_ASSERT_EQUAL(2, editor_buffer.point);
+  TEST_ASSERT_EQUAL(4, editor_buffer.line_count);
+  TEST_ASSERT_EQUAL(13, mark_get(&(editor_buffer.marks), mark));
+
+  TEST_ASSERT_TRUE(editor_buffer_undo(&editor_buffer));
+  TEST_ASSERT_EQUAL_STRING("foo\nbar\nbaz", rope_to_string8(&(editor_buffer.contents), arena, 0, editor_buffer.char_count).data);
+  TEST_ASSERT_EQUAL(4, editor_buffer.point);
+  TEST_ASSERT_EQUAL(1, editor_buffer.current_line);
+  TEST_ASSERT_EQUAL(11, editor_buffer.char_count);
+  TEST_ASSERT_EQUAL(3, editor_buffer.line_count);
+  TEST_ASSERT_EQUAL(9, mark_get(&(editor_buffer.marks), mark));
+
+  TEST_ASSERT_FALSE(editor_buffer_undo(&editor_buffer));
+  arena_destroy(arena);
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <json-c/json.h>
 
@@ -8,13 +9,22 @@
 #include "unity_fixture.h"
 
 #include "base.h"
+#include "file.h"
 #include "http.h"
 #include "http.c"
+#include "http_cache.h"
+#include "http_cache.c"
+#include "http_test_server.h"
+#include "youtube_fixture.h"
 
 String8 __prepare_post_request_body(String8 query, MemoryArena *arena);
+String8 __file_url(String8 relative_path, MemoryArena *arena);
 
 HttpClient http;
 MemoryArena *arena;
+TestServer *http_server;
+MappedFile search_response;
+String8 search_payload;  // the body of the captured response
 
 TEST_GROUP(HttpTests);
 
@@ -24,16 +34,31 @@ TEST_SETUP(HttpTests) {
     exit(1);
   }
 
-  arena = arena_create(sizeof(char) * 2000000);
+  arena = arena_create(8 * MB);  // youtube search responses are ~3MB
+
+  // the search api, answered from the captured response
+  search_response = file_map(STRING8(YOUTUBE_FIXTURE_PATH));
+  search_payload = youtube_fixture_payload(&search_response);
+  http_server = test_server_start(TEST_SERVER_ROUTES, STRING8(""));
+  if (search_payload.length == 0 || http_server == NULL) {
+    exit(1);
+  }
+  test_server_route(http_server, (TestRoute){
+    .method = STRING8("POST"),
+    .path = STRING8("/youtubei/v1/search"),
+    .body = search_payload,
+  });
 }
 
 TEST_TEAR_DOWN(HttpTests) {
+  test_server_stop(http_server);
+  file_unmap(&search_response);
   arena_destroy(arena);
   http_client_destroy(&http);
 }
 
 TEST(HttpTests, http_post_makes_successful_post_request) {
-  String8 url = STRING8("https://www.youtube.com/youtubei/v1/search?key=None");
+  String8 url = test_server_url(http_server, arena, STRING8("/youtubei/v1/search?key=None"));
   String8 body = __prepare_post_request_body(STRING8("hollow purple 1hr"), arena);
   String8 headers[2] = {
     STRING8("Accept: application/json"),
@@ -41,7 +66,7 @@ TEST(HttpTests, http_post_makes_successful_post_request) {
   };
 
   HttpRequest req = {
-    .method = "POST",
+    .method = STRING8("POST"),
     .uri = url,
     .body = body,
     .headers = headers,
@@ -51,7 +76,278 @@ TEST(HttpTests, http_post_makes_successful_post_request) {
 
   HttpResponse resp = http_post(http, req, arena);
   TEST_ASSERT_EQUAL(200, resp.status);
-  TEST_ASSERT_TRUE(resp.body.length);
+  TEST_ASSERT_EQUAL(search_payload.length, resp.body.length);
+
+  TEST_ASSERT_EQUAL(1, test_server_request_count(http_server));
+  TestServerRequest sent = test_server_request(http_server, 0);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("POST"), sent.method));
+  TEST_ASSERT_TRUE(string8_equals(STRING8("/youtubei/v1/search?key=None"), sent.path));
+  TEST_ASSERT_TRUE(string8_equals(body, sent.body));
+  TEST_ASSERT_TRUE(string8_equals(STRING8("application/json"), test_server_header(&sent, STRING8("Content-Type"))));
+}
+
+TEST(HttpTests, http_post_streams_body_into_arena_with_a_single_allocation) {
+  // curl reports a Content-Length for file:// urls too, no network needed
+  String8 url = __file_url(STRING8("data/youtube-search-response.json"), arena);
+  HttpRequest req = { .method = STRING8("POST"), .uri = url, .body = STRING8("") };
+
+  FILE *f = fopen("data/youtube-search-response.json", "rb");
+  TEST_ASSERT_NOT_NULL(f);
+  fseek(f, 0, SEEK_END);
+  u64 file_size = (u64)ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char *expected = malloc(file_size);
+  TEST_ASSERT_EQUAL(file_size, fread(expected, 1, file_size, f));
+  fclose(f);
+
+  u64 position = arena->position;
+  HttpResponse resp = http_post(http, req, arena);
+
+  TEST_ASSERT_EQUAL(file_size, resp.body.length);
+  // body + null terminator, plus the few response headers curl reports for files
+  TEST_ASSERT_TRUE(arena->position - position < file_size + 1 + 4 * KB);
+  TEST_ASSERT_EQUAL(0, resp.body.data[resp.body.length]);
+  TEST_ASSERT_EQUAL_MEMORY(expected, resp.body.data, file_size);
+  free(expected);
+}
+
+typedef struct BodyProgress {
+  i32 calls;
+  u64 length;
+  bool is_growing;
+} BodyProgress;
+
+void __on_body(String8 body, void *context) {
+  BodyProgress *progress = context;
+  progress->is_growing = progress->is_growing && body.length > progress->length;
+  progress->length = body.length;
+  progress->calls++;
+}
+
+TEST(HttpTests, http_request_reports_the_body_while_it_downloads) {
+  String8 url = __file_url(STRING8("data/youtube-search-response.json"), arena);
+  BodyProgress progress = { .calls = 0, .length = 0, .is_growing = true };
+  HttpRequest req = { .uri = url, .on_body = __on_body, .on_body_context = &progress };
+
+  HttpResponse resp = http_request(http, req, arena);
+
+  // curl hands file bodies over 16KB at a time
+  TEST_ASSERT_TRUE(progress.calls > 1);
+  TEST_ASSERT_TRUE(progress.is_growing);
+  TEST_ASSERT_EQUAL(resp.body.length, progress.length);
+}
+
+TEST(HttpTests, http_client_is_reused_across_requests) {
+  String8 url = __file_url(STRING8("data/youtube-search-request.json"), arena);
+  String8 headers[1] = { STRING8("Accept: application/json") };
+  HttpRequest req = { .method = STRING8("POST"), .uri = url, .body = STRING8(""), .headers = headers, .header_count = 1 };
+
+  HttpResponse first = http_post(http, req, arena);
+  HttpResponse second = http_post(http, req, arena);
+
+  TEST_ASSERT_TRUE(first.body.length);
+  TEST_ASSERT_EQUAL(first.body.length, second.body.length);
+  TEST_ASSERT_EQUAL_MEMORY(first.body.data, second.body.data, first.body.length);
+}
+
+typedef struct Completion {
+  i32 count;
+  u64 lengths[8];
+} Completion;
+
+void __on_done(HttpResponse response, void *context) {
+  Completion *completion = (Completion *)context;
+  completion->lengths[completion->count++] = response.body.length;
+}
+
+TEST(HttpTests, http_submit_runs_requests_with_bounded_concurrency) {
+  String8 url = __file_url(STRING8("data/youtube-search-request.json"), arena);
+  HttpRequest req = { .method = STRING8("POST"), .uri = url, .body = STRING8("") };
+
+  HttpAsync async = http_async_create(&http, 2);
+  Completion completion = { .count = 0 };
+  for (i32 i = 0; i < 5; i++) {
+    HttpHandle handle = http_submit(&async, req, arena, __on_done, &completion);
+    TEST_ASSERT_TRUE(handle.slot >= 0);
+  }
+  TEST_ASSERT_EQUAL(5, async.queued);
+
+  i32 pending = 5;
+  while (pending > 0) {
+    pending = http_async_run(&async, 10);
+    TEST_ASSERT_TRUE(async.in_flight <= 2);
+  }
+
+  TEST_ASSERT_EQUAL(5, completion.count);
+  for (i32 i = 1; i < 5; i++) {
+    TEST_ASSERT_TRUE(completion.lengths[i] > 0);
+    TEST_ASSERT_EQUAL(completion.lengths[0], completion.lengths[i]);
+  }
+  http_async_destroy(&async);
+}
+
+TEST(HttpTests, http_async_wait_returns_the_response_of_a_polled_request) {
+  String8 request_url = __file_url(STRING8("data/youtube-search-request.json"), arena);
+  String8 response_url = __file_url(STRING8("data/youtube-search-response.json"), arena);
+  HttpRequest small = { .method = STRING8("POST"), .uri = request_url, .body = STRING8("") };
+  HttpRequest large = { .method = STRING8("POST"), .uri = response_url, .body = STRING8("") };
+
+  // separate arenas so both bodies are streamed concurrently
+  MemoryArena *second_arena = arena_create(4 * MB);
+  HttpAsync async = http_async_create(&http, 4);
+  HttpHandle large_handle = http_submit(&async, large, arena, NULL, NULL);
+  HttpHandle small_handle = http_submit(&async, small, second_arena, NULL, NULL);
+
+  HttpResponse small_resp = http_async_wait(&async, small_handle);
+  HttpResponse large_resp = http_async_wait(&async, large_handle);
+
+  TEST_ASSERT_TRUE(small_resp.body.length > 0);
+  TEST_ASSERT_EQUAL(search_response.contents.length, large_resp.body.length);  // the whole file, as mapped
+  TEST_ASSERT_TRUE(http_async_done(&async, small_handle));  // released handles count as done
+
+  http_async_destroy(&async);
+  arena_destroy(second_arena);
+}
+
+TEST(HttpTests, http_build_url_appends_url_encoded_query_params) {
+  HttpParam params[2] = {
+    { .name = STRING8("q"), .value = STRING8("hollow purple 1hr") },
+    { .name = STRING8("sp"), .value = STRING8("a&b=c/d~e") },
+  };
+
+  String8 url = http_build_url(arena, STRING8("https://example.com/search"), params, 2);
+  TEST_ASSERT_EQUAL_STRING("https://example.com/search?q=hollow%20purple%201hr&sp=a%26b%3Dc%2Fd~e", url.data);
+
+  String8 with_query = http_build_url(arena, STRING8("https://example.com/search?key=None"), params, 1);
+  TEST_ASSERT_EQUAL_STRING("https://example.com/search?key=None&q=hollow%20purple%201hr", with_query.data);
+}
+
+TEST(HttpTests, http_response_get_header_ignores_case_and_leading_whitespace) {
+  String8 headers[3] = {
+    STRING8("content-type: application/json"),
+    STRING8("ETag:   \"abc\""),
+    STRING8("Cache-Control: max-age=60"),
+  };
+  HttpResponse resp = { .status = 200, .headers = headers, .header_count = 3 };
+
+  TEST_ASSERT_TRUE(string8_equals(STRING8("application/json"), http_response_get_header(&resp, STRING8("Content-Type"))));
+  TEST_ASSERT_TRUE(string8_equals(STRING8("\"abc\""), http_response_get_header(&resp, STRING8("etag"))));
+  TEST_ASSERT_EQUAL(0, http_response_get_header(&resp, STRING8("Cache")).length);
+  TEST_ASSERT_EQUAL(0, http_response_get_header(&resp, STRING8("Last-Modified")).length);
+}
+
+TEST(HttpTests, http_request_head_returns_headers_without_body) {
+  String8 url = __file_url(STRING8("data/youtube-search-response.json"), arena);
+  HttpRequest req = { .method = STRING8("HEAD"), .uri = url };
+
+  HttpResponse resp = http_request(http, req, arena);
+
+  char file_size[32];
+  i32 file_size_length = snprintf(file_size, sizeof(file_size), "%llu", (unsigned long long)search_response.contents.length);
+  String8 content_length = { .data = file_size, .length = (u64)file_size_length };
+  TEST_ASSERT_EQUAL(0, resp.body.length);
+  TEST_ASSERT_TRUE(resp.header_count > 0);
+  TEST_ASSERT_TRUE(string8_equals(content_length, http_response_get_header(&resp, STRING8("Content-Length"))));
+
+  // the same handle goes back to downloading bodies
+  req.method = STRING8("GET");
+  resp = http_request(http, req, arena);
+  TEST_ASSERT_EQUAL(search_response.contents.length, resp.body.length);
+}
+
+TEST(HttpTests, http_request_rejects_unknown_methods) {
+  String8 url = __file_url(STRING8("data/youtube-search-request.json"), arena);
+  HttpRequest req = { .method = STRING8("BREW"), .uri = url };
+
+  HttpResponse resp = http_request(http, req, arena);
+  TEST_ASSERT_EQUAL(0, resp.status);
+  TEST_ASSERT_EQUAL(0, resp.body.length);
+}
+
+TEST(HttpTests, http_request_reports_a_chunked_body_while_it_arrives) {
+  test_server_route(http_server, (TestRoute){
+    .path = STRING8("/slow"),
+    .body = search_payload,
+    .latency_ms = 20,
+    .chunk_size = 256 * KB,
+    .chunk_delay_ms = 2,
+  });
+  String8 url = test_server_url(http_server, arena, STRING8("/slow"));
+  BodyProgress progress = { .calls = 0, .length = 0, .is_growing = true };
+  HttpRequest req = { .uri = url, .on_body = __on_body, .on_body_context = &progress };
+
+  HttpResponse resp = http_request(http, req, arena);
+
+  // no Content-Length, the body grows from HTTP_BODY_MIN_CAPACITY as the chunks arrive
+  TEST_ASSERT_EQUAL(200, resp.status);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("chunked"), http_response_get_header(&resp, STRING8("Transfer-Encoding"))));
+  TEST_ASSERT_TRUE(progress.calls > 1);
+  TEST_ASSERT_TRUE(progress.is_growing);
+  TEST_ASSERT_EQUAL(search_payload.length, resp.body.length);
+  TEST_ASSERT_EQUAL_MEMORY(search_payload.data, resp.body.data, resp.body.length);
+}
+
+TEST(HttpTests, http_request_returns_error_statuses_with_their_body) {
+  test_server_route(http_server, (TestRoute){ .path = STRING8("/missing"), .status = 404, .body = STRING8("not here") });
+  test_server_route(http_server, (TestRoute){ .path = STRING8("/broken"), .status = 500, .body = STRING8("") });
+  test_server_route(http_server, (TestRoute){ .path = STRING8("/busy"), .status = 503, .body = STRING8("later"), .chunk_size = 2 });
+
+  HttpResponse missing = http_request(http, (HttpRequest){ .uri = test_server_url(http_server, arena, STRING8("/missing")) }, arena);
+  HttpResponse broken = http_request(http, (HttpRequest){ .uri = test_server_url(http_server, arena, STRING8("/broken")) }, arena);
+  HttpResponse busy = http_request(http, (HttpRequest){ .uri = test_server_url(http_server, arena, STRING8("/busy")) }, arena);
+
+  TEST_ASSERT_EQUAL(404, missing.status);
+  TEST_ASSERT_EQUAL_STRING("not here", missing.body.data);
+  TEST_ASSERT_EQUAL(500, broken.status);
+  TEST_ASSERT_EQUAL(0, broken.body.length);
+  TEST_ASSERT_EQUAL(503, busy.status);
+  TEST_ASSERT_EQUAL_STRING("later", busy.body.data);
+  TEST_ASSERT_EQUAL(3, test_server_request_count(http_server));
+}
+
+TEST(HttpTests, http_test_server_replays_what_it_recorded) {
+  char dir[64];
+  snprintf(dir, sizeof(dir), "/tmp/test_http_recordings_%d", (i32)getpid());
+  String8 recordings = string8_from_charbuf(arena, dir, strlen(dir));
+  String8 body = STRING8("{\"query\": \"hollow purple 1hr\"}");
+  String8 headers[1] = { STRING8("Content-Type: application/json") };
+  HttpRequest req = { .method = STRING8("POST"), .body = body, .headers = headers, .header_count = 1 };
+
+  // record through a second server, forwarding to the search api
+  TestServer *recorder = test_server_start(TEST_SERVER_RECORD, recordings);
+  recorder->upstream = test_server_url(http_server, arena, STRING8(""));
+  req.uri = test_server_url(recorder, arena, STRING8("/youtubei/v1/search?key=None"));
+  HttpResponse recorded = http_post(http, req, arena);
+  test_server_stop(recorder);
+
+  TEST_ASSERT_EQUAL(200, recorded.status);
+  TEST_ASSERT_EQUAL(search_payload.length, recorded.body.length);
+  TEST_ASSERT_EQUAL(1, test_server_request_count(http_server));
+
+  // replaying never reaches the search api
+  TestServer *player = test_server_start(TEST_SERVER_REPLAY, recordings);
+  req.uri = test_server_url(player, arena, STRING8("/youtubei/v1/search?key=None"));
+  HttpResponse replayed = http_post(http, req, arena);
+  req.body = STRING8("{\"query\": \"never recorded\"}");
+  HttpResponse unknown = http_post(http, req, arena);
+  test_server_stop(player);
+
+  TEST_ASSERT_EQUAL(200, replayed.status);
+  TEST_ASSERT_EQUAL(recorded.body.length, replayed.body.length);
+  TEST_ASSERT_EQUAL_MEMORY(recorded.body.data, replayed.body.data, recorded.body.length);
+  TEST_ASSERT_EQUAL(404, unknown.status);
+  TEST_ASSERT_EQUAL(1, test_server_request_count(http_server));
+
+  TEST_ASSERT_TRUE(test_remove_dir(dir));
+}
+
+String8 __file_url(String8 relative_path, MemoryArena *arena) {
+  char cwd[1024];
+  TEST_ASSERT_NOT_NULL(getcwd(cwd, sizeof(cwd)));
+
+  String8 dir = string8_from_charbuf(arena, cwd, strlen(cwd));
+  String8 path = string8_join(arena, STRING8("/"), 2, dir, relative_path);
+  return string8_concat(arena, STRING8("file://"), path);
 }
 
 String8 __prepare_post_request_body(String8 query, MemoryArena *arena) {
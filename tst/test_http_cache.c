@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "base.h"
+#include "http.h"
+#include "http.c"
+#include "http_cache.h"
+#include "http_cache.c"
+#include "http_test_server.h"
+
+HttpClient cache_client;
+HttpCache cache;
+MemoryArena *cache_arena;
+char cache_dir[64];
+i64 fake_now;
+TestServer *cache_server;
+
+i64 fake_clock(void) { return fake_now; }
+
+HttpResponse cached_response(String8 cache_control, String8 body) {
+  arena_align(cache_arena, sizeof(u64));
+  String8 *headers = arena_push(cache_arena, 3 * sizeof(String8));
+  headers[0] = string8_concat(cache_arena, STRING8("Cache-Control: "), cache_control);
+  headers[1] = STRING8("ETag: \"v1\"");
+  headers[2] = STRING8("Last-Modified: Tue, 30 Jun 2026 13:44:07 GMT");
+  return (HttpResponse){ .status = 200, .body = body, .headers = headers, .header_count = 3 };
+}
+
+/* a key for entries stored directly, `hash` names the file */
+HttpCacheKey cache_key(u64 hash) {
+  return (HttpCacheKey){ .hash = hash, .method = STRING8("GET"), .url = STRING8("http://127.0.0.1/entry"), .body_hash = 0 };
+}
+
+TEST_GROUP(HttpCacheTests);
+
+TEST_SETUP(HttpCacheTests) {
+  // http_cache_create makes the directory
+  snprintf(cache_dir, sizeof(cache_dir), "/tmp/test_http_cache_%d", (i32)getpid());
+
+  cache_client = http_client_create();
+  cache_arena = arena_create(MB);
+  cache = http_cache_create(&cache_client, (String8){ .data = cache_dir, .length = strlen(cache_dir) });
+  cache.now = fake_clock;
+  fake_now = 1000;
+
+  cache_server = test_server_start(TEST_SERVER_ROUTES, STRING8(""));
+  if (cache_server == NULL) {
+    exit(1);
+  }
+}
+
+TEST_TEAR_DOWN(HttpCacheTests) {
+  test_server_stop(cache_server);
+  http_cache_destroy(&cache);
+  http_client_destroy(&cache_client);
+  arena_destroy(cache_arena);
+  TEST_ASSERT_TRUE(test_remove_dir(cache_dir));
+}
+
+TEST(HttpCacheTests, http_cache_key_depends_on_method_url_params_and_body) {
+  HttpParam params[1] = { { .name = STRING8("q"), .value = STRING8("foo") } };
+  HttpRequest req = { .method = STRING8("POST"), .uri = STRING8("https://example.com/search"), .body = STRING8("{}") };
+
+  u64 key = http_cache_key(req, cache_arena).hash;
+  TEST_ASSERT_EQUAL_UINT64(key, http_cache_key(req, cache_arena).hash);
+
+  HttpRequest other = req;
+  other.method = STRING8("GET");
+  TEST_ASSERT_TRUE(key != http_cache_key(other, cache_arena).hash);
+
+  other = req;
+  other.body = STRING8("{\"query\": \"foo\"}");
+  TEST_ASSERT_TRUE(key != http_cache_key(other, cache_arena).hash);
+
+  other = req;
+  other.params = params;
+  other.param_count = 1;
+  TEST_ASSERT_TRUE(key != http_cache_key(other, cache_arena).hash);
+}
+
+TEST(HttpCacheTests, http_cache_control_parse_reads_directives) {
+  HttpCacheControl control = http_cache_control_parse(STRING8("public, Max-Age=60, stale-while-revalidate=\"30\""));
+  TEST_ASSERT_EQUAL(60, control.max_age);
+  TEST_ASSERT_EQUAL(30, control.stale_while_revalidate);
+  TEST_ASSERT_FALSE(control.no_store);
+
+  control = http_cache_control_parse(STRING8("no-cache, no-store"));
+  TEST_ASSERT_EQUAL(-1, control.max_age);
+  TEST_ASSERT_TRUE(control.no_cache);
+  TEST_ASSERT_TRUE(control.no_store);
+}
+
+TEST(HttpCacheTests, http_cache_store_and_lookup_round_trip) {
+  HttpResponse resp = cached_response(STRING8("max-age=60"), STRING8("{\"videos\": []}"));
+  TEST_ASSERT_TRUE(http_cache_store(&cache, cache_key(42), resp));
+
+  HttpCacheEntry entry = http_cache_lookup(&cache, cache_key(42));
+  TEST_ASSERT_TRUE(entry.found);
+  TEST_ASSERT_EQUAL(200, entry.header.status);
+  TEST_ASSERT_EQUAL(60, entry.header.max_age);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("\"v1\""), entry.etag));
+  TEST_ASSERT_TRUE(string8_equals(STRING8("Tue, 30 Jun 2026 13:44:07 GMT"), entry.last_modified));
+  TEST_ASSERT_EQUAL_STRING("{\"videos\": []}", entry.body.data);  // null terminated in place
+
+  TEST_ASSERT_FALSE(http_cache_lookup(&cache, cache_key(43)).found);
+}
+
+TEST(HttpCacheTests, http_cache_lookup_misses_entries_of_colliding_requests) {
+  HttpCacheKey key = cache_key(42);
+  TEST_ASSERT_TRUE(http_cache_store(&cache, key, cached_response(STRING8("max-age=60"), STRING8("body"))));
+
+  // same hash, so the same file, but another request
+  HttpCacheKey other = key;
+  other.url = STRING8("http://127.0.0.1/other");
+  TEST_ASSERT_FALSE(http_cache_lookup(&cache, other).found);
+  other = key;
+  other.method = STRING8("POST");
+  TEST_ASSERT_FALSE(http_cache_lookup(&cache, other).found);
+  other = key;
+  other.body_hash = 1;
+  TEST_ASSERT_FALSE(http_cache_lookup(&cache, other).found);
+
+  TEST_ASSERT_TRUE(http_cache_lookup(&cache, key).found);
+}
+
+TEST(HttpCacheTests, http_cache_lookup_keeps_one_mapping_per_key) {
+  http_cache_store(&cache, cache_key(42), cached_response(STRING8("max-age=60"), STRING8("body")));
+  for (i32 i = 0; i < 8; i++) {
+    TEST_ASSERT_TRUE(http_cache_lookup(&cache, cache_key(42)).found);
+  }
+  TEST_ASSERT_EQUAL(1, cache.mapping_count);
+
+  // replacing the entry leaves the old mapping to the next lookup
+  http_cache_store(&cache, cache_key(42), cached_response(STRING8("max-age=60"), STRING8("new body")));
+  TEST_ASSERT_EQUAL(1, cache.mapping_count);
+  TEST_ASSERT_EQUAL_STRING("new body", http_cache_lookup(&cache, cache_key(42)).body.data);
+  TEST_ASSERT_EQUAL(1, cache.mapping_count);
+}
+
+TEST(HttpCacheTests, http_cache_entries_expire_after_max_age) {
+  http_cache_store(&cache, cache_key(42), cached_response(STRING8("max-age=60"), STRING8("body")));
+  HttpCacheEntry entry = http_cache_lookup(&cache, cache_key(42));
+
+  fake_now += 59;
+  TEST_ASSERT_TRUE(http_cache_is_fresh(&cache, &(entry.header)));
+  fake_now += 1;
+  TEST_ASSERT_FALSE(http_cache_is_fresh(&cache, &(entry.header)));
+}
+
+TEST(HttpCacheTests, http_cache_store_skips_no_store_and_errors) {
+  TEST_ASSERT_FALSE(http_cache_store(&cache, cache_key(1), cached_response(STRING8("no-store"), STRING8("body"))));
+  TEST_ASSERT_FALSE(http_cache_lookup(&cache, cache_key(1)).found);
+
+  HttpResponse error = cached_response(STRING8("max-age=60"), STRING8("body"));
+  error.status = 500;
+  TEST_ASSERT_FALSE(http_cache_store(&cache, cache_key(2), error));
+  TEST_ASSERT_FALSE(http_cache_lookup(&cache, cache_key(2)).found);
+}
+
+TEST(HttpCacheTests, http_cache_ignore_cache_control_uses_the_cache_defaults) {
+  cache.ignore_cache_control = true;
+  cache.default_max_age = 300;
+
+  TEST_ASSERT_TRUE(http_cache_store(&cache, cache_key(1), cached_response(STRING8("no-store"), STRING8("body"))));
+  HttpCacheEntry entry = http_cache_lookup(&cache, cache_key(1));
+  TEST_ASSERT_TRUE(entry.found);
+  TEST_ASSERT_EQUAL(300, entry.header.max_age);
+}
+
+void count_body(String8 body, void *context) {
+  TEST_ASSERT_TRUE(string8_equals(STRING8("cached"), body));
+  (*(i32 *)context)++;
+}
+
+TEST(HttpCacheTests, http_cache_request_answers_fresh_entries_without_the_network) {
+  i32 body_calls = 0;
+  // nothing listens on the discard port, only a cache hit can succeed
+  HttpRequest req = { .method = STRING8("POST"), .uri = STRING8("http://127.0.0.1:9/search"), .body = STRING8("{}") };
+  http_cache_store(&cache, http_cache_key(req, cache_arena), cached_response(STRING8("max-age=60"), STRING8("cached")));
+
+  HttpResponse resp = http_cache_request(&cache, req, cache_arena);
+  TEST_ASSERT_EQUAL(200, resp.status);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("cached"), resp.body));
+
+  // streaming callers get the cached body in one go
+  req.on_body = count_body;
+  req.on_body_context = &body_calls;
+  http_cache_request(&cache, req, cache_arena);
+  TEST_ASSERT_EQUAL(1, body_calls);
+
+  // once stale it has to be revalidated, which fails here
+  fake_now += 60;
+  resp = http_cache_request(&cache, req, cache_arena);
+  TEST_ASSERT_EQUAL(0, resp.status);
+}
+
+TEST(HttpCacheTests, http_cache_request_revalidates_stale_entries_with_their_etag) {
+  test_server_route(cache_server, (TestRoute){
+    .path = STRING8("/search"),
+    .body = STRING8("fresh"),
+    .etag = STRING8("\"v1\""),
+    .cache_control = STRING8("max-age=60"),
+  });
+  HttpRequest req = { .uri = test_server_url(cache_server, cache_arena, STRING8("/search")) };
+
+  HttpResponse resp = http_cache_request(&cache, req, cache_arena);
+  TEST_ASSERT_EQUAL(200, resp.status);
+  fake_now += 30;
+  http_cache_request(&cache, req, cache_arena);
+  TEST_ASSERT_EQUAL(1, test_server_request_count(cache_server));
+
+  // stale: asked again with the etag, the 304 answers from the entry
+  fake_now += 60;
+  resp = http_cache_request(&cache, req, cache_arena);
+  TEST_ASSERT_EQUAL(200, resp.status);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("fresh"), resp.body));
+  TEST_ASSERT_EQUAL(2, test_server_request_count(cache_server));
+  TestServerRequest revalidation = test_server_request(cache_server, 1);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("\"v1\""), test_server_header(&revalidation, STRING8("If-None-Match"))));
+
+  // and renews it for another max-age
+  HttpCacheEntry entry = http_cache_lookup(&cache, http_cache_key(req, cache_arena));
+  TEST_ASSERT_EQUAL(fake_now, entry.header.stored_at);
+  fake_now += 59;
+  http_cache_request(&cache, req, cache_arena);
+  TEST_ASSERT_EQUAL(2, test_server_request_count(cache_server));
+}
+
+TEST(HttpCacheTests, http_cache_request_replaces_entries_whose_etag_changed) {
+  test_server_route(cache_server, (TestRoute){
+    .path = STRING8("/search"),
+    .body = STRING8("new"),
+    .etag = STRING8("\"v2\""),
+    .cache_control = STRING8("max-age=60"),
+  });
+  HttpRequest req = { .uri = test_server_url(cache_server, cache_arena, STRING8("/search")) };
+  http_cache_store(&cache, http_cache_key(req, cache_arena), cached_response(STRING8("max-age=60"), STRING8("old")));
+
+  fake_now += 60;
+  HttpResponse resp = http_cache_request(&cache, req, cache_arena);
+  TEST_ASSERT_EQUAL(200, resp.status);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("new"), resp.body));
+
+  TestServerRequest revalidation = test_server_request(cache_server, 0);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("\"v1\""), test_server_header(&revalidation, STRING8("If-None-Match"))));
+  TEST_ASSERT_TRUE(test_server_header(&revalidation, STRING8("If-Modified-Since")).length > 0);
+
+  HttpCacheEntry entry = http_cache_lookup(&cache, http_cache_key(req, cache_arena));
+  TEST_ASSERT_TRUE(string8_equals(STRING8("\"v2\""), entry.etag));
+  TEST_ASSERT_EQUAL_STRING("new", entry.body.data);
+}
+
+TEST(HttpCacheTests, http_cache_request_revalidates_in_the_background_while_stale) {
+  test_server_route(cache_server, (TestRoute){
+    .path = STRING8("/search"),
+    .body = STRING8("fresh"),
+    .etag = STRING8("\"v1\""),
+    .cache_control = STRING8("max-age=60, stale-while-revalidate=600"),
+    .latency_ms = 50,
+  });
+  HttpAsync async = http_async_create(&cache_client, 2);
+  cache.async = &async;
+  HttpRequest req = { .uri = test_server_url(cache_server, cache_arena, STRING8("/search")) };
+  http_cache_request(&cache, req, cache_arena);
+
+  // answered from the stale entry before the server has replied
+  fake_now += 120;
+  HttpResponse resp = http_cache_request(&cache, req, cache_arena);
+  TEST_ASSERT_EQUAL(200, resp.status);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("fresh"), resp.body));
+  TEST_ASSERT_EQUAL(1, http_cache_run(&cache, 0));
+
+  // asked again while the refresh is in flight, nothing new is submitted
+  resp = http_cache_request(&cache, req, cache_arena);
+  TEST_ASSERT_EQUAL(1, cache.refreshing_count);
+  TEST_ASSERT_EQUAL(1, http_cache_run(&cache, 0));
+
+  while (http_cache_run(&cache, 10) > 0) {
+  }
+  TEST_ASSERT_EQUAL(0, cache.refreshing_count);
+  TEST_ASSERT_EQUAL(2, test_server_request_count(cache_server));
+  // the refresh doesn't unmap the body handed out before it
+  TEST_ASSERT_TRUE(string8_equals(STRING8("fresh"), resp.body));
+  TestServerRequest revalidation = test_server_request(cache_server, 1);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("\"v1\""), test_server_header(&revalidation, STRING8("If-None-Match"))));
+  TEST_ASSERT_EQUAL(fake_now, http_cache_lookup(&cache, http_cache_key(req, cache_arena)).header.stored_at);
+
+  cache.async = NULL;
+  http_async_destroy(&async);
+}
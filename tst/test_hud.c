@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "base.h"
+#include "hud.h"
+
+MemoryArena *hud_arena;
+Hud hud;
+
+/* a frame of `frame_ms` that spent `step_ms` in on_step */
+HudFrame hud_test_frame(f64 frame_ms, f64 step_ms) {
+  HudFrame frame = { .frame_ms = frame_ms };
+  frame.ms[HUD_STEP] = step_ms;
+  return frame;
+}
+
+TEST_GROUP(HudTests);
+
+TEST_SETUP(HudTests) {
+  hud_arena = arena_create(MB);
+  hud = hud_create(hud_arena, NULL);
+}
+
+TEST_TEAR_DOWN(HudTests) {
+  arena_destroy(hud_arena);
+}
+
+TEST(HudTests, arena_tracks_its_high_water_mark) {
+  MemoryArena *arena = arena_create(KB);
+  TEST_ASSERT_EQUAL(0, arena->high_water);
+
+  arena_push(arena, 100);
+  u64 position = arena->position;
+  void *p = arena_push(arena, 200);
+  TEST_ASSERT_EQUAL(300, arena->high_water);
+
+  arena_pop_to(arena, position);
+  TEST_ASSERT_EQUAL(100, arena->position);
+  TEST_ASSERT_EQUAL(300, arena->high_water);
+
+  p = arena_push(arena, 100);
+  arena_grow(arena, p, 100, 400);
+  TEST_ASSERT_EQUAL(500, arena->high_water);
+  arena_destroy(arena);
+}
+
+TEST(HudTests, redraws_only_when_visible_and_due) {
+  TEST_ASSERT_FALSE(hud_frame(&hud, hud_test_frame(HUD_REFRESH_MS, 1)));
+  TEST_ASSERT_FALSE(hud.is_dirty);
+
+  hud.is_visible = true;
+  TEST_ASSERT_TRUE(hud_frame(&hud, hud_test_frame(16, 1)));  // hidden time counts towards the refresh
+  TEST_ASSERT_TRUE(hud.is_dirty);
+
+  hud.is_dirty = false;
+  for (i32 elapsed = 16; elapsed < HUD_REFRESH_MS; elapsed += 16) {
+    TEST_ASSERT_FALSE(hud_frame(&hud, hud_test_frame(16, 1)));
+  }
+  TEST_ASSERT_TRUE(hud_frame(&hud, hud_test_frame(16, 1)));
+  TEST_ASSERT_TRUE(hud.is_dirty);
+}
+
+TEST(HudTests, fps_is_averaged_over_the_graph) {
+  for (i32 i = 0; i < HUD_SAMPLES; i++) {
+    hud_frame(&hud, hud_test_frame(10, 1));
+  }
+  TEST_ASSERT_EQUAL_FLOAT(100.0, __hud_fps(&hud));
+
+  // older frames fall out of the graph
+  for (i32 i = 0; i < HUD_SAMPLES; i++) {
+    hud_frame(&hud, hud_test_frame(20, 1));
+  }
+  TEST_ASSERT_EQUAL_FLOAT(50.0, __hud_fps(&hud));
+}
+
+TEST(HudTests, graph_stacks_timings_from_the_bottom) {
+  HudFrame frame = { .frame_ms = HUD_BUDGET_MS };
+  frame.ms[HUD_STEP] = HUD_GRAPH_MS / 4;
+  frame.ms[HUD_PRESENT] = HUD_GRAPH_MS / 4;
+  hud_frame(&hud, frame);
+  hud_draw(&hud);
+
+  // the newest frame is the rightmost bar
+  i32 x = HUD_PADDING + ((HUD_SAMPLES - 1) * 2);
+  i32 bottom = hud.layer.h - HUD_PADDING;
+  TEST_ASSERT_EQUAL_HEX32(hud_colors[HUD_STEP], bitmap_get_pixel(&(hud.layer), x, bottom - 1));
+  TEST_ASSERT_EQUAL_HEX32(hud_colors[HUD_PRESENT], bitmap_get_pixel(&(hud.layer), x, bottom - (HUD_GRAPH_H / 4) - 1));
+  TEST_ASSERT_EQUAL_HEX32(HUD_BACKGROUND, bitmap_get_pixel(&(hud.layer), x, bottom - (HUD_GRAPH_H / 2) - 2));
+
+  // older frames weren't recorded yet
+  TEST_ASSERT_EQUAL_HEX32(HUD_BACKGROUND, bitmap_get_pixel(&(hud.layer), HUD_PADDING, bottom - 1));
+}
@@ -0,0 +1,216 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "base.h"
+#include "file.h"
+#include "json_scan.h"
+#include "youtube_fixture.h"
+
+#define YT_RENDERER "contents.twoColumnSearchResultsRenderer.primaryContents.sectionListRenderer" \
+                    ".contents[*].itemSectionRenderer.contents[*].videoRenderer"
+
+MemoryArena *json_arena;
+
+typedef struct MatchLog {
+  i32 count;
+  JsonMatch matches[32];
+} MatchLog;
+
+void log_match(JsonMatch *match, void *context) {
+  MatchLog *log = context;
+  if (log->count < 32) {
+    log->matches[log->count++] = *match;
+  }
+}
+
+typedef struct Videos {
+  i32 count;
+  String8 ids[32];
+  String8 titles[32];
+} Videos;
+
+void collect_video(JsonMatch *match, void *context) {
+  Videos *videos = context;
+  if (match->pattern == 0 && match->event == JSON_MATCH_END) {
+    videos->count++;
+  } else if (match->pattern == 1 && videos->count < 32) {
+    videos->ids[videos->count] = match->value;
+  } else if (match->pattern == 2 && videos->count < 32) {
+    videos->titles[videos->count] = json_string_decode(json_arena, match->value);
+  }
+}
+
+TEST_GROUP(JsonScanTests);
+
+TEST_SETUP(JsonScanTests) {
+  json_arena = arena_create(16 * KB);
+}
+
+TEST_TEAR_DOWN(JsonScanTests) {
+  arena_destroy(json_arena);
+}
+
+TEST(JsonScanTests, json_scan_next_returns_tokens_as_slices_of_the_input) {
+  JsonScanner s = json_scan_create(STRING8(" {\"a\": [1, -2.5e3, \"x\\\"y\"], \"b\": {}, \"c\": true, \"d\": null} "));
+  JsonToken expected[] = {
+    JSON_OBJECT_BEGIN, JSON_KEY, JSON_ARRAY_BEGIN, JSON_NUMBER, JSON_NUMBER, JSON_STRING, JSON_ARRAY_END,
+    JSON_KEY, JSON_OBJECT_BEGIN, JSON_OBJECT_END, JSON_KEY, JSON_TRUE, JSON_KEY, JSON_NULL, JSON_OBJECT_END, JSON_END,
+  };
+
+  for (u64 i = 0; i < COUNTOF(expected); i++) {
+    JsonToken token = json_scan_next(&s);
+    TEST_ASSERT_EQUAL(expected[i], token);
+
+    if (i == 1)  TEST_ASSERT_TRUE(string8_equals(STRING8("a"), s.value));
+    if (i == 4)  TEST_ASSERT_TRUE(string8_equals(STRING8("-2.5e3"), s.value));
+    if (i == 5)  TEST_ASSERT_TRUE(string8_equals(STRING8("x\\\"y"), s.value));
+    if (i == 6)  TEST_ASSERT_TRUE(string8_equals(STRING8("[1, -2.5e3, \"x\\\"y\"]"), s.value));
+    if (token == JSON_END) break;
+  }
+}
+
+TEST(JsonScanTests, json_scan_next_rejects_malformed_documents) {
+  char *documents[] = { "{\"a\" 1}", "[1,]", "[1 2]", "{\"a\": [1}", "[\"open", "{} {}", "[tru]", "" };
+
+  for (u64 i = 0; i < COUNTOF(documents); i++) {
+    JsonScanner s = json_scan_create((String8){ .data = documents[i], .length = strlen(documents[i]) });
+    JsonToken token;
+    do {
+      token = json_scan_next(&s);
+    } while (token != JSON_END && token != JSON_ERROR);
+
+    TEST_ASSERT_EQUAL_MESSAGE(JSON_ERROR, token, documents[i]);
+  }
+}
+
+TEST(JsonScanTests, json_scan_skip_jumps_over_a_container) {
+  JsonScanner s = json_scan_create(STRING8("[{\"a\": [\"]}\", {}]}, 2]"));
+  TEST_ASSERT_EQUAL(JSON_ARRAY_BEGIN, json_scan_next(&s));
+  TEST_ASSERT_EQUAL(JSON_OBJECT_BEGIN, json_scan_next(&s));
+
+  TEST_ASSERT_EQUAL(JSON_OBJECT_END, json_scan_skip(&s));
+  TEST_ASSERT_TRUE(string8_equals(STRING8("{\"a\": [\"]}\", {}]}"), s.value));
+  TEST_ASSERT_EQUAL(JSON_NUMBER, json_scan_next(&s));
+  TEST_ASSERT_EQUAL(1, s.frames[0].index);
+  TEST_ASSERT_EQUAL(JSON_ARRAY_END, json_scan_next(&s));
+  TEST_ASSERT_EQUAL(JSON_END, json_scan_next(&s));
+}
+
+TEST(JsonScanTests, json_scan_match_reports_only_subscribed_paths) {
+  JsonPattern patterns[] = {
+    json_pattern(STRING8("items[*].id")),
+    json_pattern(STRING8("items[1]")),
+    json_pattern(STRING8("*.name")),
+  };
+  JsonScanner s = json_scan_create(STRING8("{\"items\": [{\"id\": 1, \"x\": {\"id\": 0}}, {\"id\": 2}], \"owner\": {\"name\": \"me\"}}"));
+
+  MatchLog log = { .count = 0 };
+  TEST_ASSERT_EQUAL(JSON_END, json_scan_match(&s, patterns, 3, log_match, &log));
+
+  TEST_ASSERT_EQUAL(5, log.count);
+  TEST_ASSERT_EQUAL(0, log.matches[0].pattern);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("1"), log.matches[0].value));
+  TEST_ASSERT_EQUAL(1, log.matches[1].pattern);
+  TEST_ASSERT_EQUAL(JSON_MATCH_BEGIN, log.matches[1].event);
+  TEST_ASSERT_EQUAL(0, log.matches[2].pattern);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("2"), log.matches[2].value));
+  TEST_ASSERT_EQUAL(JSON_MATCH_END, log.matches[3].event);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("{\"id\": 2}"), log.matches[3].value));
+  TEST_ASSERT_EQUAL(2, log.matches[4].pattern);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("me"), log.matches[4].value));
+}
+
+TEST(JsonScanTests, json_string_decode_resolves_escapes) {
+  String8 s = json_string_decode(json_arena, STRING8("a\\\"b\\\\c\\/\\n\\u0026\\u00e9\\u547c\\ud83d\\ude00"));
+  TEST_ASSERT_EQUAL_STRING("a\"b\\c/\n&\xc3\xa9\xe5\x91\xbc\xf0\x9f\x98\x80", s.data);
+  TEST_ASSERT_EQUAL(strlen(s.data), s.length);
+}
+
+TEST(JsonScanTests, json_scan_next_resumes_tokens_cut_by_the_end_of_the_input) {
+  String8 document = STRING8("{\"key\": [12345, \"a\\\"b\", true, false, null, {\"x\": -1.5e10}], \"k2\": \"\"}");
+  JsonToken expected[64];
+  String8 values[64];
+  i32 count = 0;
+
+  JsonScanner full = json_scan_create(document);
+  do {
+    expected[count] = json_scan_next(&full);
+    values[count++] = full.value;
+  } while (full.token != JSON_END && full.token != JSON_ERROR);
+  TEST_ASSERT_EQUAL(JSON_END, expected[count - 1]);
+
+  // the same document fed one byte at a time, from a buffer that moves
+  char buffers[2][128];
+  JsonScanner s = json_scan_create((String8){ .data = NULL, .length = 0 });
+  i32 read = 0;
+  for (u64 length = 0; length <= document.length && read < count; length++) {
+    char *buffer = buffers[length % 2];
+    memcpy(buffer, document.data, length);
+    json_scan_feed(&s, (String8){ .data = buffer, .length = length }, length == document.length);
+
+    JsonToken token;
+    while (read < count && (token = json_scan_next(&s)) != JSON_NEED_MORE) {
+      TEST_ASSERT_EQUAL(expected[read], token);
+      TEST_ASSERT_TRUE(string8_equals(values[read], s.value));
+      read++;
+    }
+  }
+  TEST_ASSERT_EQUAL(count, read);
+}
+
+TEST(JsonScanTests, json_scan_match_extracts_videos_from_a_youtube_response) {
+  MappedFile file = file_map(STRING8(YOUTUBE_FIXTURE_PATH));
+  TEST_ASSERT_TRUE(file.is_mapped);
+
+  JsonPattern patterns[] = {
+    json_pattern(STRING8(YT_RENDERER)),
+    json_pattern(STRING8(YT_RENDERER ".videoId")),
+    json_pattern(STRING8(YT_RENDERER ".title.runs[0].text")),
+  };
+  JsonScanner s = json_scan_create(youtube_fixture_payload(&file));
+  Videos videos = { .count = 0 };
+
+  TEST_ASSERT_EQUAL(JSON_END, json_scan_match(&s, patterns, 3, collect_video, &videos));
+  TEST_ASSERT_EQUAL(19, videos.count);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("VDemrDlBVXI"), videos.ids[0]));
+  TEST_ASSERT_EQUAL_STRING("JUJUTSU KAISEN OST - \"Hollow Purple\" | 1 HOUR", videos.titles[0].data);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("nvFt7Csytnk"), videos.ids[18]));
+
+  file_unmap(&file);
+}
+
+TEST(JsonScanTests, json_scan_match_reports_videos_while_the_response_arrives) {
+  MappedFile file = file_map(STRING8(YOUTUBE_FIXTURE_PATH));
+  String8 payload = youtube_fixture_payload(&file);
+
+  JsonPattern patterns[] = {
+    json_pattern(STRING8(YT_RENDERER)),
+    json_pattern(STRING8(YT_RENDERER ".videoId")),
+    json_pattern(STRING8(YT_RENDERER ".title.runs[0].text")),
+  };
+  JsonScanner s = json_scan_create((String8){ .data = payload.data, .length = 0 });
+  Videos videos = { .count = 0 };
+
+  // 16KB at a time like curl does, the first video is near the start
+  u64 first_video_at = 0;
+  JsonToken token = JSON_NEED_MORE;
+  for (u64 length = 0; token == JSON_NEED_MORE && length < payload.length;) {
+    length = MIN(length + 16 * KB, payload.length);
+    json_scan_feed(&s, (String8){ .data = payload.data, .length = length }, length == payload.length);
+    token = json_scan_match(&s, patterns, 3, collect_video, &videos);
+
+    if (first_video_at == 0 && videos.count > 0) {
+      first_video_at = length;
+    }
+  }
+
+  TEST_ASSERT_EQUAL(JSON_END, token);
+  TEST_ASSERT_EQUAL(19, videos.count);
+  TEST_ASSERT_TRUE(string8_equals(STRING8("nvFt7Csytnk"), videos.ids[18]));
+  TEST_ASSERT_TRUE(first_video_at < payload.length / 10);
+
+  file_unmap(&file);
+}
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "base.h"
+#include "rope.h"
+
+#define ROPE_FUZZ_ITERATIONS 5000
+#define ROPE_FUZZ_MAX_TEXT   ((u64)1 << 16)
+
+Rope rope;
+MemoryArena *rope_arena;
+
+TEST_GROUP(RopeTests);
+
+TEST_SETUP(RopeTests) {
+  rope = rope_create();
+  rope_arena = arena_create(2 * ROPE_FUZZ_MAX_TEXT);
+}
+
+TEST_TEAR_DOWN(RopeTests) {
+  rope_destroy(&rope);
+  arena_destroy(rope_arena);
+}
+
+static void assert_rope_text(Rope *r, char *expected) {
+  TEST_ASSERT_EQUAL(strlen(expected), rope_length(r));
+  TEST_ASSERT_EQUAL_STRING(expected, rope_to_string8(r, rope_arena, 0, rope_length(r)).data);
+}
+
+/* checks the cached metadata and the AVL invariant, returns the height */
+static i32 assert_rope_node(RopeNode *node) {
+  if (node->height == 0) {
+    if (node->newlines != ROPE_NEWLINES_UNKNOWN) {
+      TEST_ASSERT_EQUAL(__rope_count_newlines(node->data, node->length), node->newlines);
+    }
+    return 0;
+  }
+
+  i32 lh = assert_rope_node(node->left);
+  i32 rh = assert_rope_node(node->right);
+  TEST_ASSERT_TRUE(abs(lh - rh) <= 1);
+  TEST_ASSERT_EQUAL(node->left->length + node->right->length, node->length);
+  if (node->newlines != ROPE_NEWLINES_UNKNOWN) {
+    TEST_ASSERT_EQUAL(node->left->newlines + node->right->newlines, node->newlines);
+  }
+  TEST_ASSERT_EQUAL(1 + (lh > rh ? lh : rh), node->height);
+  return node->height;
+}
+
+TEST(RopeTests, rope_create_creates_an_empty_rope) {
+  TEST_ASSERT_EQUAL(0, rope_length(&rope));
+  TEST_ASSERT_EQUAL(1, rope_line_count(&rope));
+  TEST_ASSERT_EQUAL(-1, rope_get(&rope, 0));
+}
+
+TEST(RopeTests, rope_insert_adds_text_at_offset) {
+  rope_insert(&rope, 0, STRING8("world"));
+  rope_insert(&rope, 0, STRING8("hello "));
+  rope_insert(&rope, 100, STRING8("!"));
+  assert_rope_text(&rope, "hello world!");
+}
+
+TEST(RopeTests, rope_delete_removes_text_at_offset) {
+  rope_insert(&rope, 0, STRING8("hello cruel world"));
+  rope_delete(&rope, 5, 6);
+  assert_rope_text(&rope, "hello world");
+
+  rope_delete(&rope, 5, 100);
+  assert_rope_text(&rope, "hello");
+}
+
+TEST(RopeTests, rope_get_returns_char_at_offset) {
+  rope_insert(&rope, 0, STRING8("foobar"));
+  TEST_ASSERT_EQUAL_CHAR('f', rope_get(&rope, 0));
+  TEST_ASSERT_EQUAL_CHAR('r', rope_get(&rope, 5));
+  TEST_ASSERT_EQUAL(-1, rope_get(&rope, 6));
+}
+
+TEST(RopeTests, rope_line_start_returns_offset_of_line) {
+  rope_insert(&rope, 0, STRING8("foo\nbar\n\nbaz"));
+  TEST_ASSERT_EQUAL(4, rope_line_count(&rope));
+  TEST_ASSERT_EQUAL(0, rope_line_start(&rope, 0));
+  TEST_ASSERT_EQUAL(4, rope_line_start(&rope, 1));
+  TEST_ASSERT_EQUAL(8, rope_line_start(&rope, 2));
+  TEST_ASSERT_EQUAL(9, rope_line_start(&rope, 3));
+  TEST_ASSERT_EQUAL(12, rope_line_start(&rope, 4));
+}
+
+TEST(RopeTests, rope_line_of_returns_line_of_offset) {
+  rope_insert(&rope, 0, STRING8("foo\nbar\n\nbaz"));
+  TEST_ASSERT_EQUAL(0, rope_line_of(&rope, 3));
+  TEST_ASSERT_EQUAL(1, rope_line_of(&rope, 4));
+  TEST_ASSERT_EQUAL(2, rope_line_of(&rope, 8));
+  TEST_ASSERT_EQUAL(3, rope_line_of(&rope, 11));
+  TEST_ASSERT_EQUAL(3, rope_line_of(&rope, 100));
+}
+
+TEST(RopeTests, rope_snapshot_is_not_affected_by_later_edits) {
+  rope_insert(&rope, 0, STRING8("hello world"));
+  Rope snapshot = rope_snapshot(&rope);
+
+  rope_delete(&rope, 0, 6);
+  rope_insert(&rope, 5, STRING8("!"));
+
+  assert_rope_text(&rope, "world!");
+  assert_rope_text(&snapshot, "hello world");
+  rope_destroy(&snapshot);
+}
+
+TEST(RopeTests, rope_iter_yields_text_from_offset) {
+  char text[3 * ROPE_LEAF_MAX];
+  for (i32 i = 0; i < (i32)sizeof(text); i++) text[i] = 'a' + (i % 26);
+  rope_insert(&rope, 0, (String8){ .data = text, .length = sizeof(text) });
+
+  u64 offset = ROPE_LEAF_MAX / 2;
+  String8 chunk;
+  RopeIter it = rope_iter(&rope, offset);
+  while (rope_iter_next(&it, &chunk)) {
+    TEST_ASSERT_EQUAL_MEMORY(text + offset, chunk.data, chunk.length);
+    offset += chunk.length;
+  }
+  TEST_ASSERT_EQUAL(sizeof(text), offset);
+}
+
+static String8 create_lines(MemoryArena *arena, u64 line_count, u64 line_length) {
+  String8 text = { .length = line_count * line_length };
+  text.data = arena_push(arena, text.length + 1);
+  for (u64 i = 0; i < text.length; i++) {
+    text.data[i] = (i % line_length == line_length - 1) ? '\n' : 'a' + (i % 26);
+  }
+  return text;
+}
+
+TEST(RopeTests, rope_count_newlines_counts_every_newline) {
+  char *text = "\n\na\nbcdefgh\nijklmnopq\n\n\n\n\n\nr";
+  TEST_ASSERT_EQUAL(10, __rope_count_newlines(text, strlen(text)));
+  TEST_ASSERT_EQUAL(0, __rope_count_newlines("abcdefghijklmnop", 16));
+}
+
+TEST(RopeTests, rope_from_external_indexes_lines_lazily) {
+  MemoryArena *text_arena = arena_create(8 * ROPE_EXTERNAL_LEAF);
+  String8 text = create_lines(text_arena, (3 * ROPE_EXTERNAL_LEAF) / 100, 100);
+  u64 line_count = __rope_count_newlines(text.data, text.length) + 1;
+
+  Rope external = rope_from_external(text);
+  TEST_ASSERT_FALSE(rope_is_indexed(&external));
+  TEST_ASSERT_EQUAL(text.data, external.root->left->data);  // not copied
+
+  // looking up a line near the start only indexes what's before it
+  TEST_ASSERT_EQUAL(200, rope_line_start(&external, 2));
+  TEST_ASSERT_FALSE(rope_is_indexed(&external));
+
+  while (!rope_index_step(&external, ROPE_EXTERNAL_LEAF)) {}
+  TEST_ASSERT_TRUE(rope_is_indexed(&external));
+  TEST_ASSERT_EQUAL(line_count, rope_line_count(&external));
+  TEST_ASSERT_EQUAL(100 * (line_count - 1), rope_line_start(&external, line_count - 1));
+
+  rope_destroy(&external);
+  arena_destroy(text_arena);
+}
+
+TEST(RopeTests, rope_from_external_line_of_end_counts_every_line) {
+  MemoryArena *text_arena = arena_create(8 * ROPE_EXTERNAL_LEAF);
+  String8 text = create_lines(text_arena, (3 * ROPE_EXTERNAL_LEAF) / 100, 100);
+  u64 newlines = __rope_count_newlines(text.data, text.length);
+
+  Rope external = rope_from_external(text);
+  TEST_ASSERT_FALSE(rope_is_indexed(&external));
+  TEST_ASSERT_EQUAL(newlines, rope_line_of(&external, text.length));  // a cursor at EOF
+
+  rope_destroy(&external);
+  arena_destroy(text_arena);
+}
+
+TEST(RopeTests, rope_from_external_edits_do_not_modify_external_text) {
+  MemoryArena *text_arena = arena_create(8 * ROPE_EXTERNAL_LEAF);
+  String8 text = create_lines(text_arena, (3 * ROPE_EXTERNAL_LEAF) / 100, 100);
+  String8 original = string8_clone(text_arena, text);
+
+  Rope external = rope_from_external(text);
+  rope_delete(&external, 50, ROPE_EXTERNAL_LEAF);
+  rope_insert(&external, 60, STRING8("hello\n"));
+
+  TEST_ASSERT_EQUAL_MEMORY(original.data, text.data, text.length);
+  TEST_ASSERT_EQUAL(text.length + 6 - ROPE_EXTERNAL_LEAF, rope_length(&external));
+  TEST_ASSERT_EQUAL_CHAR('h', rope_get(&external, 60));
+  TEST_ASSERT_EQUAL(rope_line_of(&external, 60) + 1, rope_line_of(&external, 66));
+  assert_rope_node(external.root);
+
+  rope_destroy(&external);
+  arena_destroy(text_arena);
+}
+
+/*
+  Applies random inserts and deletes to both the rope and a naive array and
+  checks their text, line lookups and the tree invariants agree.
+*/
+TEST(RopeTests, rope_operations_match_naive_array) {
+  char *naive = malloc(ROPE_FUZZ_MAX_TEXT);
+  u64 naive_len = 0;
+  char chunk[3 * ROPE_LEAF_MAX];
+
+  srand(0x7095);
+  for (i32 step = 0; step < ROPE_FUZZ_ITERATIONS; step++) {
+    u64 offset = rand() % (naive_len + 1);
+
+    if (rand() % 3) {
+      u64 n = (rand() % 4) ? (u64)(1 + rand() % 8) : rand() % sizeof(chunk);
+      if (naive_len + n >= ROPE_FUZZ_MAX_TEXT) continue;
+      for (u64 i = 0; i < n; i++) chunk[i] = (rand() % 10) ? 'a' + (rand() % 26) : '\n';
+
+      memmove(naive + offset + n, naive + offset, naive_len - offset);
+      memcpy(naive + offset, chunk, n);
+      naive_len += n;
+      rope_insert(&rope, offset, (String8){ .data = chunk, .length = n });
+    } else {
+      u64 n = MIN((u64)(rand() % 64), naive_len - offset);
+      memmove(naive + offset, naive + offset + n, naive_len - offset - n);
+      naive_len -= n;
+      rope_delete(&rope, offset, n);
+    }
+
+    TEST_ASSERT_EQUAL(naive_len, rope_length(&rope));
+    if (naive_len) {
+      u64 at = rand() % naive_len;
+      TEST_ASSERT_EQUAL_CHAR(naive[at], rope_get(&rope, at));
+      TEST_ASSERT_EQUAL(__rope_count_newlines(naive, at), rope_line_of(&rope, at));
+    }
+  }
+
+  assert_rope_node(rope.root);
+  TEST_ASSERT_EQUAL_MEMORY(naive, rope_to_string8(&rope, rope_arena, 0, naive_len).data, naive_len);
+
+  for (u64 line = 1; line < rope_line_count(&rope); line++) {
+    u64 start = rope_line_start(&rope, line);
+    TEST_ASSERT_EQUAL_CHAR('\n', naive[start - 1]);
+    TEST_ASSERT_EQUAL(line, __rope_count_newlines(naive, start));
+  }
+  free(naive);
+}
@@ -29,6 +29,14 @@ TEST(String8Tests, string8_from_charbuf_creates_an_arena_allocated_string8_from_
   TEST_ASSERT_EQUAL_STRING(s.data, "foo");
 }
 
+TEST(String8Tests, string8_from_charbuf_does_not_read_past_length) {
+  char buf[3] = { 'f', 'o', 'o' };  // not null terminated
+  String8 s = string8_from_charbuf(arena, buf, 3);
+
+  TEST_ASSERT_EQUAL(3, s.length);
+  TEST_ASSERT_EQUAL_STRING("foo", s.data);
+}
+
 TEST(String8Tests, string8_creates_multiple_arena_allocated_string8_values) {
   String8 s1 = string8_from_charbuf(arena, "foo", 3);
   String8 s2 = string8_from_charbuf(arena, "bar", 3);
@@ -131,6 +139,13 @@ TEST(String8Tests, string8_endswith_returns_true_if_s_ends_with_suffix) {
   TEST_ASSERT_TRUE(string8_endswith(STRING8("foobar"), STRING8("bar")));
 }
 
+TEST(String8Tests, string8_endswith_returns_true_for_suffixes_of_any_length) {
+  TEST_ASSERT_TRUE(string8_endswith(STRING8("foobar"), STRING8("r")));
+  TEST_ASSERT_TRUE(string8_endswith(STRING8("foobar"), STRING8("ar")));
+  TEST_ASSERT_TRUE(string8_endswith(STRING8("foobar"), STRING8("oobar")));
+  TEST_ASSERT_TRUE(string8_endswith(STRING8("foobar"), STRING8("foobar")));
+}
+
 TEST(String8Tests, string8_endswith_returns_false_if_suffix_is_longer_than_s) {
   TEST_ASSERT_FALSE(string8_endswith(STRING8("bar"), STRING8("bartoz")));
 }
@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "base.h"
+#include "buffer.h"
+#include "view.h"
+
+#define VIEW_COLS 10
+#define VIEW_ROWS 4
+#define VIEW_FUZZ_ITERATIONS 2000
+
+MemoryArena *view_arena;
+GapBuffer view_text;
+TextView view;
+
+u64  view_text_length(void *context) { return (u64)buffer_length((GapBuffer *)context); }
+char view_text_char_at(void *context, u64 offset) { return buffer_get((GapBuffer *)context, (i32)offset); }
+
+TextSource view_source() {
+  return (TextSource){ .context = &view_text, .length = view_text_length, .char_at = view_text_char_at };
+}
+
+i32 view_reads;
+i32 view_line_lookups;
+
+char view_counted_char_at(void *context, u64 offset) {
+  view_reads++;
+  return view_text_char_at(context, offset);
+}
+
+u64 view_counted_line_start(void *context, u64 offset) {
+  view_line_lookups++;
+  while (offset > 0 && buffer_get((GapBuffer *)context, (i32)offset - 1) != '\n') {
+    offset--;
+  }
+  return offset;
+}
+
+/* counts the chars the view reads and the line starts it looks up */
+TextSource view_counted_source() {
+  view_reads = 0;
+  view_line_lookups = 0;
+  return (TextSource){
+    .context = &view_text,
+    .length = view_text_length,
+    .char_at = view_counted_char_at,
+    .line_start = view_counted_line_start,
+  };
+}
+
+/* a VIEW_COLS x VIEW_ROWS view where every char is 1 pixel wide */
+TextView create_view(MemoryArena *arena) {
+  i32 advances[95];
+  for (i32 i=0; i < 95; i++) {
+    advances[i] = 1;
+  }
+  Rect frame = { .origin = {0, 0}, .corner = {VIEW_COLS, VIEW_ROWS} };
+  return __text_view_init(arena, frame, 1, 0, advances);
+}
+
+void view_insert(u64 offset, String8 s) {
+  buffer_move_gap(&view_text, (i32)offset);
+  buffer_insert_string8(&view_text, s);
+  text_view_edit(&view, offset, (i64)s.length);
+}
+
+void view_delete(u64 offset, u64 count) {
+  buffer_move_gap(&view_text, (i32)offset);
+  for (u64 i=0; i < count; i++) {
+    buffer_delete(&view_text);
+  }
+  text_view_edit(&view, offset, -(i64)count);
+}
+
+/* lays out a fresh view of the same text and compares it with `view` */
+void assert_view_matches_full_layout() {
+  MemoryArena *arena = arena_create(KB);
+  TextView expected = create_view(arena);
+  expected.top = view.top;
+  text_view_layout(&expected, view_source());
+
+  for (i32 i=0; i < VIEW_ROWS; i++) {
+    TEST_ASSERT_EQUAL(expected.rows[i].start, view.rows[i].start);
+    TEST_ASSERT_EQUAL(expected.rows[i].length, view.rows[i].length);
+    TEST_ASSERT_EQUAL(expected.rows[i].glyph_count, view.rows[i].glyph_count);
+    if (expected.rows[i].glyph_count > 0) {
+      TEST_ASSERT_EQUAL_MEMORY(expected.glyphs + (i * expected.max_cols),
+                               view.glyphs + (i * view.max_cols),
+                               expected.rows[i].glyph_count);
+    }
+  }
+  arena_destroy(arena);
+}
+
+void clear_dirty_rows() {
+  for (i32 i=0; i < view.row_count; i++) {
+    view.rows[i].is_dirty = false;
+  }
+}
+
+TEST_GROUP(TextViewTests);
+
+TEST_SETUP(TextViewTests) {
+  view_arena = arena_create(KB);
+  view_text = buffer_create();
+  view = create_view(view_arena);
+}
+
+TEST_TEAR_DOWN(TextViewTests) {
+  buffer_destroy(&view_text);
+  arena_destroy(view_arena);
+}
+
+TEST(TextViewTests, layout_splits_lines_and_wraps_long_lines) {
+  buffer_insert_string8(&view_text, STRING8("foo\n0123456789abc\nbar"));
+
+  TEST_ASSERT_EQUAL(VIEW_ROWS, text_view_layout(&view, view_source()));
+
+  TEST_ASSERT_EQUAL(0, view.rows[0].start);
+  TEST_ASSERT_EQUAL(4, view.rows[0].length);
+  TEST_ASSERT_EQUAL(3, view.rows[0].glyph_count);
+  TEST_ASSERT_EQUAL(4, view.rows[1].start);
+  TEST_ASSERT_EQUAL(VIEW_COLS, view.rows[1].glyph_count);
+  TEST_ASSERT_EQUAL(14, view.rows[2].start);
+  TEST_ASSERT_EQUAL_MEMORY("abc", view.glyphs + (2 * view.max_cols), 3);
+  TEST_ASSERT_EQUAL(18, view.rows[3].start);
+  TEST_ASSERT_EQUAL_MEMORY("bar", view.glyphs + (3 * view.max_cols), 3);
+}
+
+TEST(TextViewTests, layout_without_edits_does_nothing) {
+  buffer_insert_string8(&view_text, STRING8("foo\nbar"));
+  text_view_layout(&view, view_source());
+  clear_dirty_rows();
+
+  TEST_ASSERT_EQUAL(0, text_view_layout(&view, view_source()));
+}
+
+TEST(TextViewTests, insert_dirties_only_the_edited_row) {
+  buffer_insert_string8(&view_text, STRING8("foo\nbar\nbaz\nqux"));
+  text_view_layout(&view, view_source());
+  clear_dirty_rows();
+
+  view_insert(5, STRING8("x"));
+
+  TEST_ASSERT_EQUAL(1, text_view_layout(&view, view_source()));
+  TEST_ASSERT_FALSE(view.rows[0].is_dirty);
+  TEST_ASSERT_TRUE(view.rows[1].is_dirty);
+  TEST_ASSERT_FALSE(view.rows[2].is_dirty);
+  TEST_ASSERT_EQUAL(9, view.rows[2].start);
+  TEST_ASSERT_EQUAL(13, view.rows[3].start);
+  assert_view_matches_full_layout();
+}
+
+TEST(TextViewTests, delete_of_newline_dirties_rows_below) {
+  buffer_insert_string8(&view_text, STRING8("foo\nbar\nbaz\nqux"));
+  text_view_layout(&view, view_source());
+  clear_dirty_rows();
+
+  view_delete(3, 1);
+
+  // "foobar", "baz", "qux" and an empty row
+  TEST_ASSERT_EQUAL(4, text_view_layout(&view, view_source()));
+  assert_view_matches_full_layout();
+}
+
+TEST(TextViewTests, edit_above_viewport_keeps_visible_text) {
+  buffer_insert_string8(&view_text, STRING8("a\nb\nc\nd\ne\nf\n"));
+  view.top = 4;  // starts at "c"
+  text_view_layout(&view, view_source());
+
+  view_insert(0, STRING8("zz\n"));
+  text_view_layout(&view, view_source());
+
+  TEST_ASSERT_EQUAL(7, view.top);
+  TEST_ASSERT_EQUAL('c', view.glyphs[0]);
+  assert_view_matches_full_layout();
+}
+
+TEST(TextViewTests, scroll_to_moves_viewport_one_row_at_a_time) {
+  buffer_insert_string8(&view_text, STRING8("a\nb\nc\nd\ne\nf\n"));
+  text_view_layout(&view, view_source());
+
+  text_view_scroll_to(&view, view_source(), 8);  // "e"
+  text_view_layout(&view, view_source());
+
+  TEST_ASSERT_EQUAL(2, view.top);
+  TEST_ASSERT_EQUAL('b', view.glyphs[0]);
+  TEST_ASSERT_EQUAL('e', view.glyphs[3 * view.max_cols]);
+}
+
+TEST(TextViewTests, scroll_to_lays_out_the_viewport_once) {
+  buffer_insert_string8(&view_text, STRING8("a\nb\nc\nd\ne\nf\ng\nh\n"));
+  text_view_layout(&view, view_source());
+
+  TextSource src = view_counted_source();
+  text_view_scroll_to(&view, src, 12);  // "g", 3 rows below the viewport
+  text_view_layout(&view, src);
+
+  TEST_ASSERT_EQUAL(6, view.top);
+  TEST_ASSERT_EQUAL('g', view.glyphs[3 * view.max_cols]);
+  TEST_ASSERT_EQUAL(3 * 2 + VIEW_ROWS * 2, view_reads);  // the 3 rows below, then the viewport
+}
+
+TEST(TextViewTests, scroll_to_uses_the_sources_line_start) {
+  buffer_insert_string8(&view_text, STRING8("a\nlong line above\nc\nd\ne\nf\n"));
+  view.top = 20;  // "d"
+  text_view_layout(&view, view_source());
+
+  TextSource src = view_counted_source();
+  text_view_scroll_to(&view, src, 8);  // in "long line above"
+  TEST_ASSERT_EQUAL(2, view.top);
+  TEST_ASSERT_EQUAL(1, view_line_lookups);
+  TEST_ASSERT_EQUAL(0, view_reads);
+}
+
+TEST(TextViewTests, incremental_layout_matches_full_layout) {
+  srand(7);
+  buffer_insert_string8(&view_text, STRING8("lorem ipsum\ndolor sit amet\n\nconsectetur"));
+  text_view_layout(&view, view_source());
+
+  char alphabet[] = "abc \n";
+  for (i32 i=0; i < VIEW_FUZZ_ITERATIONS; i++) {
+    // mostly edit around the viewport, it only shows the first few rows
+    u64 length = (u64)buffer_length(&view_text);
+    u64 range = length < 4 * VIEW_COLS * VIEW_ROWS ? length : 4 * VIEW_COLS * VIEW_ROWS;
+    u64 offset = (u64)rand() % (range + 1);
+
+    // a few edits between layouts, like typing between two frames
+    i32 edits = 1 + (rand() % 3);
+    for (i32 e=0; e < edits; e++) {
+      length = (u64)buffer_length(&view_text);
+      if (offset > length) offset = length;
+
+      if (rand() % 3 == 0 && offset < length) {
+        u64 count = 1 + ((u64)rand() % 3);
+        if (offset + count > length) count = length - offset;
+        view_delete(offset, count);
+      } else {
+        char c = alphabet[rand() % (sizeof(alphabet) - 1)];
+        view_insert(offset, (String8){ .data = &c, .length = 1 });
+        offset++;
+      }
+    }
+
+    text_view_layout(&view, view_source());
+    assert_view_matches_full_layout();
+  }
+}
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "unity.h"
+#include "unity_fixture.h"
+
+#include "base.h"
+#include "file.h"
+#include "http.h"
+#include "http.c"
+#include "http_cache.h"
+#include "http_cache.c"
+#include "json_scan.h"
+#include "ymp/yt.h"
+#include "ymp/yt_snapshot.h"
+#include "youtube_fixture.h"
+
+MemoryArena *snapshot_arena;
+
+VideoData snapshot_videos[3] = {
+  { .uid = STRING8("VDemrDlBVXI"), .title = STRING8("Hollow Purple"), .length = STRING8("1:01:02"),
+    .url = STRING8("https://www.youtube.com/watch?v=VDemrDlBVXI") },
+  { .uid = STRING8("nvFt7Csytnk"), .title = STRING8("\xe5\x91\xaa\xe8\xa1\x93\xe5\xbb\xbb\xe6\x88\xa6"), .length = STRING8(""),
+    .url = STRING8("https://www.youtube.com/watch?v=nvFt7Csytnk") },
+  { .uid = STRING8("x"), .title = STRING8(""), .length = STRING8("0:01"), .url = STRING8("") },
+};
+
+void assert_same_video(VideoData expected, VideoData actual) {
+  TEST_ASSERT_TRUE(string8_equals(expected.uid, actual.uid));
+  TEST_ASSERT_TRUE(string8_equals(expected.title, actual.title));
+  TEST_ASSERT_TRUE(string8_equals(expected.length, actual.length));
+  TEST_ASSERT_TRUE(string8_equals(expected.url, actual.url));
+  TEST_ASSERT_EQUAL_CHAR('\0', actual.title.data[actual.title.length]);
+}
+
+TEST_GROUP(YoutubeSnapshotTests);
+
+TEST_SETUP(YoutubeSnapshotTests) {
+  snapshot_arena = arena_create(4 * MB);
+}
+
+TEST_TEAR_DOWN(YoutubeSnapshotTests) {
+  arena_destroy(snapshot_arena);
+}
+
+TEST(YoutubeSnapshotTests, yt_snapshot_round_trips_a_search_response) {
+  YoutubeSearchResponse response = {
+    .code = YT_SEARCH_OK,
+    .videos = snapshot_videos,
+    .video_count = COUNTOF(snapshot_videos),
+    .continuation = STRING8("EsgDEhFob2xsb3cgcHVycGxl"),
+  };
+
+  String8 image = yt_snapshot_write(snapshot_arena, response);
+  TEST_ASSERT_EQUAL_UINT64(snapshot_arena->position, (u8 *)image.data - snapshot_arena->memory + image.length);
+
+  YoutubeSnapshot snapshot = yt_snapshot_open(image);
+  TEST_ASSERT_TRUE(snapshot.is_valid);
+  TEST_ASSERT_EQUAL_UINT64(3, snapshot.header->video_count);
+  for (usize i = 0; i < COUNTOF(snapshot_videos); i++) {
+    assert_same_video(snapshot_videos[i], yt_snapshot_video(&snapshot, i));
+  }
+  TEST_ASSERT_TRUE(string8_equals(response.continuation, yt_snapshot_continuation(&snapshot)));
+  TEST_ASSERT_EQUAL_UINT64(0, yt_snapshot_video(&snapshot, 3).uid.length);
+
+  // offsets, not pointers: a copy of the image anywhere else reads the same
+  char *copy = arena_push(snapshot_arena, image.length + sizeof(u64));
+  copy += sizeof(u64) - ((uintptr_t)copy % sizeof(u64));
+  memcpy(copy, image.data, image.length);
+  memset(image.data, 0, image.length);
+
+  YoutubeSnapshot moved = yt_snapshot_open((String8){ .data = copy, .length = image.length });
+  TEST_ASSERT_TRUE(moved.is_valid);
+  assert_same_video(snapshot_videos[1], yt_snapshot_video(&moved, 1));
+}
+
+TEST(YoutubeSnapshotTests, yt_snapshot_open_rejects_other_versions_and_truncated_images) {
+  YoutubeSearchResponse response = { .code = YT_SEARCH_OK, .videos = snapshot_videos, .video_count = 3 };
+  String8 image = yt_snapshot_write(snapshot_arena, response);
+  YoutubeSnapshotHeader *header = (YoutubeSnapshotHeader *)image.data;
+
+  TEST_ASSERT_FALSE(yt_snapshot_open((String8){ .data = image.data, .length = image.length - 1 }).is_valid);
+  TEST_ASSERT_FALSE(yt_snapshot_open((String8){ .data = image.data, .length = 4 }).is_valid);
+
+  header->version = YT_SNAPSHOT_VERSION + 1;
+  TEST_ASSERT_FALSE(yt_snapshot_open(image).is_valid);
+  header->version = YT_SNAPSHOT_VERSION;
+
+  header->video_count = image.length;  // more videos than fit in the image
+  TEST_ASSERT_FALSE(yt_snapshot_open(image).is_valid);
+  header->video_count = 3;
+
+  header->magic = 0;
+  TEST_ASSERT_FALSE(yt_snapshot_open(image).is_valid);
+  header->magic = YT_SNAPSHOT_MAGIC;
+  TEST_ASSERT_TRUE(yt_snapshot_open(image).is_valid);
+}
+
+TEST(YoutubeSnapshotTests, yt_snapshot_strings_outside_the_image_are_empty) {
+  YoutubeSearchResponse response = { .code = YT_SEARCH_OK, .videos = snapshot_videos, .video_count = 3 };
+  String8 image = yt_snapshot_write(snapshot_arena, response);
+  YoutubeSnapshot snapshot = yt_snapshot_open(image);
+
+  snapshot.videos[0].title.offset = image.length + 100;
+  snapshot.videos[0].url.length = image.length;
+  snapshot.videos[1].title.length -= 1;  // not followed by its terminator
+
+  VideoData video = yt_snapshot_video(&snapshot, 0);
+  TEST_ASSERT_TRUE(string8_equals(snapshot_videos[0].uid, video.uid));
+  TEST_ASSERT_EQUAL_UINT64(0, video.title.length);
+  TEST_ASSERT_EQUAL_UINT64(0, video.url.length);
+  TEST_ASSERT_EQUAL_UINT64(0, yt_snapshot_video(&snapshot, 1).title.length);
+}
+
+TEST(YoutubeSnapshotTests, yt_snapshot_save_maps_a_parsed_response_in_place) {
+  MappedFile fixture = file_map(STRING8(YOUTUBE_FIXTURE_PATH));
+  TEST_ASSERT_TRUE(fixture.is_mapped);
+
+  YoutubeSearchResponse response = parse_response(youtube_fixture_payload(&fixture), snapshot_arena);
+  TEST_ASSERT_EQUAL_INT(YT_SEARCH_OK, response.code);
+  TEST_ASSERT_EQUAL_UINT64(19, response.video_count);
+
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/test_yt_snapshot_%d", (i32)getpid());
+  String8 snapshot_path = { .data = path, .length = strlen(path) };
+  TEST_ASSERT_TRUE(yt_snapshot_save(snapshot_path, response, snapshot_arena));
+
+  MappedFile file = file_map(snapshot_path);
+  YoutubeSnapshot snapshot = yt_snapshot_open(file.contents);
+  TEST_ASSERT_TRUE(snapshot.is_valid);
+  TEST_ASSERT_EQUAL_UINT64(response.video_count, snapshot.header->video_count);
+  for (usize i = 0; i < response.video_count; i++) {
+    VideoData video = yt_snapshot_video(&snapshot, i);
+    assert_same_video(response.videos[i], video);
+    // used in place, nothing was copied out of the mapping
+    TEST_ASSERT_TRUE(video.uid.data > file.contents.data && video.uid.data < file.contents.data + file.contents.length);
+  }
+  TEST_ASSERT_TRUE(string8_equals(response.continuation, yt_snapshot_continuation(&snapshot)));
+
+  file_unmap(&file);
+  file_unmap(&fixture);
+  unlink(path);
+}
+
+TEST(YoutubeSnapshotTests, yt_search_restore_makes_saved_videos_playable) {
+  YoutubeSearch search = yt_search_create(NULL, NULL, snapshot_arena);
+  for (usize i = 0; i < 40; i++) {
+    video_list_push(&(search.videos), &(snapshot_videos[i % 3]));  // more than a block of the list
+  }
+  search.continuation = STRING8("next-page");
+
+  char path[64];
+  snprintf(path, sizeof(path), "/tmp/test_yt_search_restore_%d", (i32)getpid());
+  String8 search_path = { .data = path, .length = strlen(path) };
+  u64 position = snapshot_arena->position;
+  TEST_ASSERT_TRUE(yt_search_save(&search, search_path, snapshot_arena));
+  TEST_ASSERT_EQUAL_UINT64(position, snapshot_arena->position);
+
+  MappedFile file = file_map(search_path);
+  YoutubeSnapshot snapshot = yt_snapshot_open(file.contents);
+  YoutubeSearch restored = yt_search_create(NULL, NULL, snapshot_arena);
+  yt_search_restore(&restored, &snapshot);
+
+  TEST_ASSERT_EQUAL_UINT64(40, restored.videos.count);
+  assert_same_video(snapshot_videos[0], *yt_search_video(&restored, 0));
+  assert_same_video(snapshot_videos[38 % 3], *yt_search_video(&restored, 38));
+  TEST_ASSERT_NULL(yt_search_video(&restored, 40));
+  TEST_ASSERT_TRUE(string8_equals(STRING8("next-page"), restored.continuation));
+
+  file_unmap(&file);
+  unlink(path);
+}
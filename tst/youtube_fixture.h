@@ -0,0 +1,48 @@
+#ifndef _YOUTUBE_FIXTURE_H_
+#define _YOUTUBE_FIXTURE_H_
+
+/*
+  youtube_fixture.h - the recorded search response under data/.
+
+  youtube-search-response.json is a log of the request, not json: the
+  response body sits between a "Response Payload:" line and a "Parsed JSON:"
+  dump. Tests, benchmarks and the fuzz seeds all want just the body.
+*/
+
+#include <string.h>
+
+#include "base.h"
+#include "file.h"
+
+#define YOUTUBE_FIXTURE_PATH "data/youtube-search-response.json"
+
+String8 youtube_fixture_payload(MappedFile *file);
+
+/*
+ * The response body of the mapped log, a slice of `file`. Empty if either
+ * marker is missing.
+ */
+String8 youtube_fixture_payload(MappedFile *file) {
+  String8 contents = file->contents;
+  String8 start_marker = STRING8("Response Payload:");
+  String8 end_marker = STRING8("Parsed JSON:");
+
+  u64 start = 0;
+  while (start + start_marker.length <= contents.length
+         && memcmp(contents.data + start, start_marker.data, start_marker.length) != 0) {
+    start++;
+  }
+  u64 end = start + start_marker.length;
+  while (end + end_marker.length <= contents.length
+         && memcmp(contents.data + end, end_marker.data, end_marker.length) != 0) {
+    end++;
+  }
+  if (end + end_marker.length > contents.length) {
+    return (String8){ .data = contents.data, .length = 0 };
+  }
+
+  start += start_marker.length;
+  return (String8){ .data = contents.data + start, .length = end - start };
+}
+
+#endif